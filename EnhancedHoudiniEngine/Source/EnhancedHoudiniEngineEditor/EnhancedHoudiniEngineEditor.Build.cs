@@ -78,10 +78,12 @@ public class EnhancedHoudiniEngineEditor : ModuleRules
 			{
 				// Plugin Dependencies
 				"EnhancedHoudiniEngineRuntime",
+				"HoudiniEngine",
                 
 				// Core Dependencies (Epic)
 				"AssetTools",
 				"EditorSubsystem",
+				"Json",
 				"GameProjectGeneration",
 				"KismetWidgets",
 				"ToolMenus",
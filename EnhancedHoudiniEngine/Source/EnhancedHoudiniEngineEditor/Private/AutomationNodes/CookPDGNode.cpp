@@ -0,0 +1,352 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "AutomationNodes/CookPDGNode.h"
+
+#include "EHEEditorLoggingDefs.h"
+#include "HoudiniAssetActor.h"
+#include "HoudiniEngine/Private/HoudiniPDGManager.h"
+#include "HoudiniEngineRuntime/Private/HoudiniAssetComponent.h"
+#include "HoudiniEngineRuntime/Private/HoudiniPDGAssetLink.h"
+
+namespace
+{
+	UTOPNetwork* FindTOPNetwork(UHoudiniPDGAssetLink* AssetLink, const FString& NetworkName)
+	{
+		if (NetworkName.IsEmpty())
+		{
+			return AssetLink->GetSelectedTOPNetwork();
+		}
+
+		for (UTOPNetwork* Network : AssetLink->AllTOPNetworks)
+		{
+			if (Network && (Network->NodeName == NetworkName || Network->NodePath == NetworkName))
+			{
+				return Network;
+			}
+		}
+		return nullptr;
+	}
+
+	UTOPNode* FindTOPNode(UTOPNetwork* Network, const FString& NodeName)
+	{
+		if (NodeName.IsEmpty())
+		{
+			return Network->AllTOPNodes.IsValidIndex(Network->SelectedTOPIndex) ? Network->AllTOPNodes[Network->SelectedTOPIndex] : nullptr;
+		}
+
+		for (UTOPNode* Node : Network->AllTOPNodes)
+		{
+			if (Node && (Node->NodeName == NodeName || Node->NodePath == NodeName))
+			{
+				return Node;
+			}
+		}
+		return nullptr;
+	}
+}
+
+void UHoudiniBuildWorkItem_CookPDG::OnDeadlineReached(int32 ForBuildSerial, bool bFailDeadline)
+{
+	const bool bWasBuilding = BuildState == EEHEBuildState::Building && ForBuildSerial == BuildSerial;
+	Super::OnDeadlineReached(ForBuildSerial, bFailDeadline);
+
+	if (bWasBuilding && BuildState != EEHEBuildState::Building)
+	{
+		// Don't leave the PDG scheduler running work nobody is waiting for anymore.
+		if (TOPNetwork.IsValid())
+		{
+			FHoudiniPDGManager::CancelCook(TOPNetwork.Get());
+		}
+		UnbindPDGDelegates();
+	}
+}
+
+void UHoudiniBuildWorkItem_CookPDG::BeginDestroy()
+{
+	UnbindPDGDelegates();
+	Super::BeginDestroy();
+}
+
+bool UHoudiniBuildWorkItem_CookPDG::GetPDGProgress(FHoudiniPDGProgress& OutProgress) const
+{
+	UTOPNetwork* Network = TOPNetwork.Get();
+	if (!Network)
+	{
+		return false;
+	}
+
+	OutProgress = FHoudiniPDGProgress();
+	for (UTOPNode* Node : Network->AllTOPNodes)
+	{
+		if (!Node)
+		{
+			continue;
+		}
+
+		const FWorkItemTallyBase& Tally = Node->GetWorkItemTally();
+		OutProgress.NumWorkItems += Tally.NumWorkItems();
+		OutProgress.NumCooking += Tally.NumCookingWorkItems();
+		OutProgress.NumCooked += Tally.NumCookedWorkItems();
+		OutProgress.NumFailed += Tally.NumErroredWorkItems();
+
+		if (!Node->bAutoLoad)
+		{
+			continue;
+		}
+		for (const FTOPWorkResult& Result : Node->WorkResult)
+		{
+			for (const FTOPWorkResultObject& ResultObject : Result.ResultObjects)
+			{
+				switch (ResultObject.GetState())
+				{
+				case EPDGWorkResultState::ToLoad:
+				case EPDGWorkResultState::Loading:
+					OutProgress.NumOutputs++;
+					break;
+				case EPDGWorkResultState::Loaded:
+					OutProgress.NumOutputs++;
+					OutProgress.NumOutputsLoaded++;
+					break;
+				default:
+					break;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+bool UHoudiniBuildWorkItem_CookPDG::BuildInternal(UHoudiniAssetComponent* AssetComponent)
+{
+	if (!AssetComponent)
+	{
+		return false;
+	}
+
+	bWaitingForHDACook = false;
+	bNetworkCooked = false;
+	
+	UHoudiniPDGAssetLink* PDGAssetLink = AssetComponent->GetPDGAssetLink();
+	if (!PDGAssetLink || PDGAssetLink->LinkState != EPDGLinkState::Linked)
+	{
+		// The TOP networks only show up once the HDA has been cooked. The PDG cook starts from OnHoudiniAssetPostProcess.
+		bWaitingForHDACook = true;
+		AssetComponent->MarkAsNeedCook();
+		return true;
+	}
+
+	return StartPDGCook(AssetComponent);
+}
+
+void UHoudiniBuildWorkItem_CookPDG::OnHoudiniAssetPostProcess(UHoudiniAssetComponent* AssetComponent, bool Succeeded)
+{
+	if (BuildState != EEHEBuildState::Building || !bWaitingForHDACook)
+	{
+		// The HDA cook isn't the result of this work item; the TOP network is.
+		return;
+	}
+
+	bWaitingForHDACook = false;
+	if (!Succeeded)
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildWorkItem_CookPDG::OnHoudiniAssetPostProcess() houdini asset failed to build"));
+		SetBuildState(EEHEBuildState::Error);
+		return;
+	}
+
+	if (!StartPDGCook(AssetComponent))
+	{
+		SetBuildState(EEHEBuildState::Error);
+	}
+}
+
+bool UHoudiniBuildWorkItem_CookPDG::StartPDGCook(UHoudiniAssetComponent* AssetComponent)
+{
+	UAGN_CookPDG* PDGNode = Cast<UAGN_CookPDG>(Owner);
+	UHoudiniPDGAssetLink* PDGAssetLink = AssetComponent ? AssetComponent->GetPDGAssetLink() : nullptr;
+	if (!PDGNode || !PDGAssetLink || PDGAssetLink->LinkState != EPDGLinkState::Linked)
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildWorkItem_CookPDG::StartPDGCook() %s doesn't have any TOP networks"), *GetNameSafe(ToBuild.Get()));
+		return false;
+	}
+
+	UTOPNetwork* Network = FindTOPNetwork(PDGAssetLink, PDGNode->TOPNetworkName);
+	if (!Network)
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildWorkItem_CookPDG::StartPDGCook() %s has no TOP network named '%s'"), *GetNameSafe(ToBuild.Get()), *PDGNode->TOPNetworkName);
+		return false;
+	}
+
+	UTOPNode* Node = FindTOPNode(Network, PDGNode->TOPNodeName);
+	if (!Node && !PDGNode->TOPNodeName.IsEmpty())
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildWorkItem_CookPDG::StartPDGCook() %s has no TOP node named '%s'"), *GetNameSafe(ToBuild.Get()), *PDGNode->TOPNodeName);
+		return false;
+	}
+	if (Node && PDGNode->bLoadOutputs)
+	{
+		Node->bAutoLoad = true;
+	}
+
+	UnbindPDGDelegates();
+	AssetLink = PDGAssetLink;
+	TOPNetwork = Network;
+	bNetworkCooked = false;
+	PostTOPNetworkCookDelegateHandle = PDGAssetLink->GetOnPostTOPNetworkCookDelegate().AddUObject(this, &ThisClass::OnTOPNetworkCooked);
+	WorkResultObjectLoadedDelegateHandle = PDGAssetLink->GetOnWorkResultObjectLoaded().AddUObject(this, &ThisClass::OnWorkResultObjectLoaded);
+
+	if (PDGNode->bDirtyBeforeCook)
+	{
+		FHoudiniPDGManager::DirtyAll(Network);
+	}
+
+	const bool bStarted = PDGNode->TOPNodeName.IsEmpty() ? FHoudiniPDGManager::CookOutput(Network) : FHoudiniPDGManager::CookTOPNode(Node);
+	if (!bStarted)
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildWorkItem_CookPDG::StartPDGCook() failed to start cooking %s on %s"), *Network->NodePath, *GetNameSafe(ToBuild.Get()));
+		UnbindPDGDelegates();
+		return false;
+	}
+
+	UE_LOG(LogEHEEditor, Verbose, TEXT("UHoudiniBuildWorkItem_CookPDG: cooking %s on %s."), *Network->NodePath, *GetNameSafe(ToBuild.Get()));
+	return true;
+}
+
+void UHoudiniBuildWorkItem_CookPDG::OnTOPNetworkCooked(UHoudiniPDGAssetLink* InAssetLink, UTOPNetwork* InTOPNetwork, bool bAnyWorkItemsFailed)
+{
+	if (BuildState != EEHEBuildState::Building || InAssetLink != AssetLink.Get() || InTOPNetwork != TOPNetwork.Get())
+	{
+		return;
+	}
+
+	const UAGN_CookPDG* PDGNode = Cast<UAGN_CookPDG>(Owner);
+	if (bAnyWorkItemsFailed && !(PDGNode && PDGNode->bAllowFailedWorkItems))
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildWorkItem_CookPDG::OnTOPNetworkCooked() %s finished with failed work items on %s"), *InTOPNetwork->NodePath, *GetNameSafe(ToBuild.Get()));
+		UnbindPDGDelegates();
+		SetBuildState(EEHEBuildState::Error);
+		return;
+	}
+
+	bNetworkCooked = true;
+	FinishIfOutputsLoaded();
+}
+
+void UHoudiniBuildWorkItem_CookPDG::OnWorkResultObjectLoaded(UHoudiniPDGAssetLink* InAssetLink, UTOPNode* InTOPNode, int32 WorkItemHAPIIndex, int32 WorkItemResultInfoIndex)
+{
+	if (BuildState != EEHEBuildState::Building || !bNetworkCooked || InAssetLink != AssetLink.Get())
+	{
+		return;
+	}
+
+	FinishIfOutputsLoaded();
+}
+
+void UHoudiniBuildWorkItem_CookPDG::FinishIfOutputsLoaded()
+{
+	FHoudiniPDGProgress Progress;
+	if (!GetPDGProgress(Progress))
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildWorkItem_CookPDG::FinishIfOutputsLoaded() TOP network is invalid"));
+		UnbindPDGDelegates();
+		SetBuildState(EEHEBuildState::Error);
+		return;
+	}
+
+	// The results are loaded by the PDG manager over the next few ticks, after the network itself has finished.
+	if (Progress.NumOutputsLoaded < Progress.NumOutputs)
+	{
+		return;
+	}
+
+	UE_LOG(LogEHEEditor, Verbose, TEXT("UHoudiniBuildWorkItem_CookPDG: %s cooked %d work items and loaded %d results."), *GetNameSafe(ToBuild.Get()), Progress.NumCooked, Progress.NumOutputsLoaded);
+	UnbindPDGDelegates();
+	SetBuildState(EEHEBuildState::Finished);
+}
+
+void UHoudiniBuildWorkItem_CookPDG::UnbindPDGDelegates()
+{
+	if (UHoudiniPDGAssetLink* PDGAssetLink = AssetLink.Get())
+	{
+		if (PostTOPNetworkCookDelegateHandle.IsValid())
+		{
+			PDGAssetLink->GetOnPostTOPNetworkCookDelegate().Remove(PostTOPNetworkCookDelegateHandle);
+		}
+		if (WorkResultObjectLoadedDelegateHandle.IsValid())
+		{
+			PDGAssetLink->GetOnWorkResultObjectLoaded().Remove(WorkResultObjectLoadedDelegateHandle);
+		}
+	}
+	PostTOPNetworkCookDelegateHandle.Reset();
+	WorkResultObjectLoadedDelegateHandle.Reset();
+}
+
+UAGN_CookPDG::UAGN_CookPDG(const FObjectInitializer& Initializer): Super(Initializer)
+{
+	Title = FText::FromString("CookPDG");
+	WorkItemClass = UHoudiniBuildWorkItem_CookPDG::StaticClass();
+
+	// A single TOP network cook already fans out over the PDG scheduler, and takes a lot longer than a regular cook.
+	BuildInfo.MaxInFlightWorkItems = 1;
+	BuildInfo.BuildWarnTimeoutSec = 300.0;
+	BuildInfo.BuildFailTimeoutSec = 3600.0;
+}
+
+FString UAGN_CookPDG::GetMessageText()
+{
+	if (GetState() != EAutomationGraphNodeState::Active)
+	{
+		return Super::GetMessageText();
+	}
+
+	FHoudiniPDGProgress Total;
+	for (UHoudiniBuildWorkItem* WorkItem : WorkItems)
+	{
+		UHoudiniBuildWorkItem_CookPDG* PDGWorkItem = Cast<UHoudiniBuildWorkItem_CookPDG>(WorkItem);
+		FHoudiniPDGProgress Progress;
+		if (!PDGWorkItem || PDGWorkItem->GetBuildState() != EEHEBuildState::Building || !PDGWorkItem->GetPDGProgress(Progress))
+		{
+			continue;
+		}
+
+		Total.NumWorkItems += Progress.NumWorkItems;
+		Total.NumCooking += Progress.NumCooking;
+		Total.NumCooked += Progress.NumCooked;
+		Total.NumFailed += Progress.NumFailed;
+		Total.NumOutputs += Progress.NumOutputs;
+		Total.NumOutputsLoaded += Progress.NumOutputsLoaded;
+	}
+
+	return FString::Printf(TEXT("%s\nPDG: %d/%d Work Items Cooked, %d Cooking, %d Failed\n%d/%d Results Loaded"), *Super::GetMessageText(),
+		Total.NumCooked, Total.NumWorkItems, Total.NumCooking, Total.NumFailed, Total.NumOutputsLoaded, Total.NumOutputs);
+}
@@ -0,0 +1,1250 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Commandlets/HoudiniBuildCommandlet.h"
+
+#include "AssetCompilingManager.h"
+#include "EHEEditorLoggingDefs.h"
+#include "EngineUtils.h"
+#include "FileHelpers.h"
+#include "HoudiniAssetActor.h"
+#include "Algo/AllOf.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Commandlets/HoudiniBuildShardQueue.h"
+#include "Containers/Ticker.h"
+#include "Foundation/HoudiniAssetActorIndex.h"
+#include "Foundation/HoudiniBuildDescriptorPlan.h"
+#include "Foundation/HoudiniBuildManager.h"
+#include "Foundation/HoudiniBuildSequenceGraph.h"
+#include "Foundation/HoudiniBuildSequenceNode.h"
+#include "Foundation/HoudiniBuildShard.h"
+#include "Engine/Level.h"
+#include "HAL/ThreadManager.h"
+#include "HoudiniEngine/Private/HoudiniEngine.h"
+#include "HoudiniEngineRuntime/Private/HoudiniAsset.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectGlobals.h"
+#include "WorldPartition/WorldPartition.h"
+#include "WorldPartition/LoaderAdapter/LoaderAdapterShape.h"
+
+static TAutoConsoleVariable<float> CVarHoudiniBuildCommandletPumpIntervalSec(
+	TEXT("houdini.BuildCommandlet.PumpIntervalSec"),
+	0.01f,
+	TEXT("How long the build commandlet sleeps between engine ticks while waiting for a build to finish.")
+);
+
+static TAutoConsoleVariable<float> CVarHoudiniBuildCommandletPollIntervalSec(
+	TEXT("houdini.BuildCommandlet.PollIntervalSec"),
+	0.25f,
+	TEXT("How often the coordinator of a split build checks on its workers.")
+);
+
+static TAutoConsoleVariable<float> CVarHoudiniBuildCommandletAsyncLoadingSec(
+	TEXT("houdini.BuildCommandlet.AsyncLoadingSec"),
+	0.005f,
+	TEXT("How much of each engine tick the build commandlet spends on preloading the next map.")
+);
+
+// What the coordinator of a split build tracks for each build manager.
+struct UHoudiniBuildCommandlet::FCoordinatedManager
+{
+	AHoudiniBuildManager* BuildManager = nullptr;
+	FString Name;
+	TSharedPtr<const FAutomationGraphPlan> Plan;
+	TArray<bool> Released;
+	TArray<bool> Ended;
+};
+
+UHoudiniBuildCommandlet::UHoudiniBuildCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+	ShowErrorCount = true;
+}
+
+int32 UHoudiniBuildCommandlet::Main(const FString& Params)
+{
+	FString ManagerName;
+	FParse::Value(*Params, TEXT("Manager="), ManagerName);
+	FParse::Value(*Params, TEXT("TimeoutSec="), TimeoutSec);
+	bSave = !FParse::Param(*Params, TEXT("NoSave"));
+	bSaveDuringRun = FParse::Param(*Params, TEXT("SaveDuringRun"));
+	bResume = FParse::Param(*Params, TEXT("Resume"));
+
+	// Each map, and the build manager to run in it (empty for all of them).
+	TArray<TPair<FString, FString>> Maps;
+	FString MapPath;
+	if (FParse::Value(*Params, TEXT("Map="), MapPath))
+	{
+		Maps.Emplace(MapPath, ManagerName);
+	}
+	FString MapPaths;
+	if (FParse::Value(*Params, TEXT("Maps="), MapPaths))
+	{
+		TArray<FString> SplitMapPaths;
+		MapPaths.ParseIntoArray(SplitMapPaths, TEXT("+"));
+		for (const FString& SplitMapPath : SplitMapPaths)
+		{
+			Maps.Emplace(SplitMapPath, ManagerName);
+		}
+	}
+	FString MapListPath;
+	if (FParse::Value(*Params, TEXT("MapList="), MapListPath))
+	{
+		TArray<FString> Lines;
+		if (!FFileHelper::LoadFileToStringArray(Lines, *MapListPath))
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::Main(): Failed to read map list %s."), *MapListPath);
+			return 1;
+		}
+		
+		for (const FString& Line : Lines)
+		{
+			TArray<FString> Columns;
+			Line.TrimStartAndEnd().ParseIntoArrayWS(Columns);
+			if (!Columns.IsEmpty() && !Columns[0].StartsWith(TEXT("#")))
+			{
+				Maps.Emplace(Columns[0], Columns.Num() > 1 ? Columns[1] : ManagerName);
+			}
+		}
+	}
+	if (Maps.IsEmpty())
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::Main(): Expected a map, e.g. -Map=/Game/Maps/MyMap."));
+		return 1;
+	}
+
+	// Keep going after a failed map, a weekly rebuild of thirty maps shouldn't stop at the first bad one.
+	int32 NumFailed = 0;
+	for (int32 MapIndex = 0; MapIndex < Maps.Num(); ++MapIndex)
+	{
+		const FString NextMapPath = MapIndex + 1 < Maps.Num() ? Maps[MapIndex + 1].Key : FString();
+		if (Maps.Num() > 1)
+		{
+			UE_LOG(LogEHEEditor, Display, TEXT("Building map %d/%d: %s."), MapIndex + 1, Maps.Num(), *Maps[MapIndex].Key);
+		}
+		
+		if (BuildMap(Maps[MapIndex].Key, Maps[MapIndex].Value, NextMapPath, Params) != 0)
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::Main(): %s failed."), *Maps[MapIndex].Key);
+			++NumFailed;
+		}
+	}
+
+	if (Maps.Num() > 1)
+	{
+		UE_LOG(LogEHEEditor, Display, TEXT("Built %d/%d maps."), Maps.Num() - NumFailed, Maps.Num());
+	}
+	return NumFailed > 0 ? 1 : 0;
+}
+
+int32 UHoudiniBuildCommandlet::BuildMap(const FString& MapPath, const FString& ManagerName, const FString& NextMapPath, const FString& Params)
+{
+	ShardQueue.Reset();
+	WorkerIndex = INDEX_NONE;
+	
+	FString GraphPath;
+	FParse::Value(*Params, TEXT("Graph="), GraphPath);
+	int32 NumWorkers = 0;
+	FParse::Value(*Params, TEXT("Workers="), NumWorkers);
+	FString ShardQueueDirectory;
+	FParse::Value(*Params, TEXT("ShardQueue="), ShardQueueDirectory);
+	int32 ShardIndex = INDEX_NONE;
+	FParse::Value(*Params, TEXT("ShardIndex="), ShardIndex);
+	const bool bStreaming = FParse::Param(*Params, TEXT("Streaming"));
+	if (bStreaming && (NumWorkers > 1 || !ShardQueueDirectory.IsEmpty()))
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::BuildMap(): Streaming builds can't be split across workers."));
+		return 1;
+	}
+
+	// Loading through the editor makes this the editor world, which is the only world build managers will run in.
+	UWorld* World = UEditorLoadingAndSavingUtils::LoadMap(MapPath);
+	PreloadedPackages.Empty();
+	if (!World)
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::BuildMap(): Failed to load map %s."), *MapPath);
+		return 1;
+	}
+
+	// The next map's content loads while this one builds. The coordinator of a split build doesn't build anything itself.
+	if (!NextMapPath.IsEmpty() && NumWorkers <= 1)
+	{
+		PreloadMap(NextMapPath);
+	}
+
+	TArray<AHoudiniBuildManager*> BuildManagers = FindBuildManagers(World, ManagerName, GraphPath);
+	if (BuildManagers.IsEmpty())
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::BuildMap(): No build manager to run in %s."), *MapPath);
+		return 1;
+	}
+
+	if (NumWorkers > 1)
+	{
+		return RunCoordinator(World, BuildManagers, MapPath, ManagerName, Params);
+	}
+
+	if (!ShardQueueDirectory.IsEmpty())
+	{
+		ShardQueue = MakeShared<FHoudiniBuildShardQueue>(ShardQueueDirectory);
+		if (!StartWorker(BuildManagers, ShardIndex))
+		{
+			ShardQueue->Abort();
+			return 1;
+		}
+	}
+
+	if (!StartHoudiniEngine())
+	{
+		return 1;
+	}
+
+	for (AHoudiniBuildManager* BuildManager : BuildManagers)
+	{
+		// -NoSave also applies to managers that save during their runs on their own. Workers of a split build wait for
+		// the coordinator before saving anything, see CheckWorkerSaves().
+		BuildManager->bSaveDuringRun = bSave && WorkerIndex == INDEX_NONE && (bSaveDuringRun || BuildManager->bSaveDuringRun);
+	}
+
+	if (bStreaming)
+	{
+		return RunStreaming(World, BuildManagers, Params);
+	}
+
+	bool bFailed = false;
+	for (AHoudiniBuildManager* BuildManager : BuildManagers)
+	{
+		UE_LOG(LogEHEEditor, Display, TEXT("Running %s."), *BuildManager->GetActorNameOrLabel());
+		if (!BuildManager->Run(bResume))
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::BuildMap(): Failed to start %s."), *BuildManager->GetActorNameOrLabel());
+			bFailed = true;
+		}
+	}
+
+	bFailed |= !WaitForBuildManagers(World, BuildManagers);
+	for (AHoudiniBuildManager* BuildManager : BuildManagers)
+	{
+		if (BuildManager->HasRunFailed())
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::BuildMap(): %s finished with errors."), *BuildManager->GetActorNameOrLabel());
+			bFailed = true;
+		}
+		if (ShardQueue)
+		{
+			ShardQueue->WriteHistory(BuildManager->GetName(), ShardIndex, BuildManager->BuildHistory);
+		}
+	}
+
+	// Meshes produced by the build may still be compiling, and would otherwise be saved without their render data.
+	FAssetCompilingManager::Get().FinishAllCompilation();
+
+	if (bFailed)
+	{
+		// Don't save a partial build over the last good one.
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::BuildMap(): Build failed, not saving."));
+		if (ShardQueue)
+		{
+			ShardQueue->Abort();
+		}
+		return 1;
+	}
+
+	if (bSave && WorkerIndex != INDEX_NONE && !WaitForSaveRelease(GetPackagesToSave(World, BuildManagers)))
+	{
+		return 1;
+	}
+	if (bSave && !SaveBuild(World, BuildManagers))
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::BuildMap(): Failed to save the packages dirtied by the build."));
+		return 1;
+	}
+
+	UE_LOG(LogEHEEditor, Display, TEXT("Houdini build finished."));
+	return 0;
+}
+
+bool UHoudiniBuildCommandlet::StartHoudiniEngine() const
+{
+	// Houdini Engine doesn't create a session or start ticking on its own when running a commandlet.
+	FHoudiniEngine& HoudiniEngine = FHoudiniEngine::Get();
+	if (!HoudiniEngine.GetSession() && !HoudiniEngine.RestartSession())
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::StartHoudiniEngine(): Failed to start a Houdini Engine session."));
+		return false;
+	}
+
+	if (!HoudiniEngine.IsTicking())
+	{
+		HoudiniEngine.StartTicking();
+	}
+
+	return true;
+}
+
+TArray<AHoudiniBuildManager*> UHoudiniBuildCommandlet::FindBuildManagers(UWorld* World, const FString& ManagerName, const FString& GraphPath) const
+{
+	TArray<AHoudiniBuildManager*> BuildManagers;
+	
+	if (!GraphPath.IsEmpty())
+	{
+		auto* SequenceGraph = LoadObject<UHoudiniBuildSequenceGraph>(nullptr, *GraphPath);
+		if (!SequenceGraph)
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::FindBuildManagers(): Failed to load sequence graph %s."), *GraphPath);
+			return BuildManagers;
+		}
+
+		// Transient, so that running someone else's graph doesn't end up saved into the map. Named, so that the
+		// processes of a split build agree on what it is called.
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.Name = TEXT("HoudiniBuildCommandletManager");
+		SpawnParameters.ObjectFlags |= RF_Transient;
+		auto* BuildManager = World->SpawnActor<AHoudiniBuildManager>(SpawnParameters);
+		if (!BuildManager)
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::FindBuildManagers(): Failed to spawn a build manager."));
+			return BuildManagers;
+		}
+		
+		BuildManager->SequenceGraph = SequenceGraph;
+		BuildManagers.Add(BuildManager);
+		return BuildManagers;
+	}
+
+	for (TActorIterator<AHoudiniBuildManager> ActorItr(World); ActorItr; ++ActorItr)
+	{
+		AHoudiniBuildManager* BuildManager = *ActorItr;
+		if (ManagerName.IsEmpty() || BuildManager->GetName() == ManagerName || BuildManager->GetActorLabel() == ManagerName)
+		{
+			BuildManagers.Add(BuildManager);
+		}
+	}
+
+	return BuildManagers;
+}
+
+bool UHoudiniBuildCommandlet::WaitForBuildManagers(UWorld* World, TConstArrayView<AHoudiniBuildManager*> BuildManagers) const
+{
+	const double TimeStarted = FPlatformTime::Seconds();
+	double LastTickTime = TimeStarted;
+	
+	while (BuildManagers.ContainsByPredicate([](const AHoudiniBuildManager* BuildManager) { return BuildManager->IsRunning(); }))
+	{
+		const double CurrentTime = FPlatformTime::Seconds();
+		if (TimeoutSec > 0.0 && CurrentTime - TimeStarted > TimeoutSec)
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::WaitForBuildManagers(): Timed out after %.0f seconds."), TimeoutSec);
+			return false;
+		}
+		if (ShardQueue && ShardQueue->IsAborted())
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::WaitForBuildManagers(): The split build was aborted."));
+			return false;
+		}
+
+		// There's no editor loop in a commandlet, so pump everything the build depends on ourselves: Houdini Engine
+		// and the stand-in cook sessions run on the core ticker, and the build managers tick with the world.
+		const float DeltaSeconds = static_cast<float>(CurrentTime - LastTickTime);
+		LastTickTime = CurrentTime;
+		
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+		FTSTicker::GetCoreTicker().Tick(DeltaSeconds);
+		FThreadManager::Get().Tick();
+		FAssetCompilingManager::Get().ProcessAsyncTasks();
+		if (IsAsyncLoading())
+		{
+			// Preloading of the next map.
+			ProcessAsyncLoading(true, false, CVarHoudiniBuildCommandletAsyncLoadingSec.GetValueOnGameThread());
+		}
+		World->Tick(LEVELTICK_ViewportsOnly, DeltaSeconds);
+		GEngine->TickDeferredCommands();
+		
+		FPlatformProcess::Sleep(CVarHoudiniBuildCommandletPumpIntervalSec.GetValueOnGameThread());
+	}
+
+	return true;
+}
+
+bool UHoudiniBuildCommandlet::SaveBuild(UWorld* World, TConstArrayView<AHoudiniBuildManager*> BuildManagers) const
+{
+	// Most of the build may already be saved, the rest is whatever the save queues haven't gotten to yet.
+	bool bSaved = true;
+	for (AHoudiniBuildManager* BuildManager : BuildManagers)
+	{
+		bSaved &= BuildManager->FlushSaves();
+	}
+
+	TArray<UPackage*> Packages = GetPackagesToSave(World, BuildManagers);
+	return (Packages.IsEmpty() || UEditorLoadingAndSavingUtils::SavePackages(Packages, true)) && bSaved;
+}
+
+TArray<UPackage*> UHoudiniBuildCommandlet::GetPackagesToSave(UWorld* World, TConstArrayView<AHoudiniBuildManager*> BuildManagers) const
+{
+	TArray<UPackage*> Packages;
+	FEditorFileUtils::GetDirtyWorldPackages(Packages);
+	FEditorFileUtils::GetDirtyContentPackages(Packages);
+
+	if (WorkerIndex != INDEX_NONE)
+	{
+		// The map and the build managers are shared by every worker. The coordinator saves the build managers once it
+		// has merged their histories.
+		Packages.RemoveAll([World, BuildManagers](const UPackage* Package)
+		{
+			return Package == World->GetPackage() || BuildManagers.ContainsByPredicate([Package](const AHoudiniBuildManager* BuildManager) { return BuildManager->GetPackage() == Package; });
+		});
+	}
+
+	return Packages;
+}
+
+bool UHoudiniBuildCommandlet::WaitForSaveRelease(TConstArrayView<UPackage*> Packages) const
+{
+	TArray<FString> PackageNames;
+	for (const UPackage* Package : Packages)
+	{
+		PackageNames.Add(Package->GetName());
+	}
+	if (!ShardQueue->WritePackages(WorkerIndex, PackageNames))
+	{
+		ShardQueue->Abort();
+		return false;
+	}
+
+	while (!ShardQueue->AreSavesReleased())
+	{
+		if (ShardQueue->IsAborted())
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::WaitForSaveRelease(): The split build was aborted, not saving."));
+			return false;
+		}
+		FPlatformProcess::Sleep(CVarHoudiniBuildCommandletPollIntervalSec.GetValueOnGameThread());
+	}
+
+	return true;
+}
+
+int32 UHoudiniBuildCommandlet::RunCoordinator(UWorld* World, TConstArrayView<AHoudiniBuildManager*> BuildManagers, const FString& MapPath, const FString& ManagerName, const FString& Params)
+{
+	int32 NumWorkers = 0;
+	FParse::Value(*Params, TEXT("Workers="), NumWorkers);
+	FString ShardBy = TEXT("Cell");
+	FParse::Value(*Params, TEXT("ShardBy="), ShardBy);
+	double CellSize = 25600.0;
+	FParse::Value(*Params, TEXT("ShardCellSize="), CellSize);
+	FString GraphPath;
+	FParse::Value(*Params, TEXT("Graph="), GraphPath);
+
+	if (!World->PersistentLevel->IsUsingExternalActors())
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunCoordinator(): Split builds need a map that uses one file per actor."));
+		return 1;
+	}
+
+	TArray<FCoordinatedManager> Managers;
+	bool bHasSharedNodesAfter = false;
+	bool bHasInterleavedNodes = false;
+	for (AHoudiniBuildManager* BuildManager : BuildManagers)
+	{
+		if (!BuildManager->SequenceGraph)
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunCoordinator(): %s has no sequence graph."), *BuildManager->GetActorNameOrLabel());
+			return 1;
+		}
+		
+		FCoordinatedManager& Manager = Managers.AddDefaulted_GetRef();
+		Manager.BuildManager = BuildManager;
+		Manager.Name = BuildManager->GetName();
+		Manager.Plan = BuildManager->SequenceGraph->GetPlan();
+		Manager.Released.Init(false, Manager.Plan->Num());
+		Manager.Ended.Init(false, Manager.Plan->Num());
+
+		// The workers can't see what this process changes while they run, so the nodes that run here have to come
+		// before or after all of the nodes that build HDA actors.
+		for (int32 NodeIndex : FHoudiniBuildShard::FindInterleavedSharedNodes(*Manager.Plan))
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunCoordinator(): %s / %s comes between nodes that build HDA actors, so the build can't be split."), *Manager.Name, *Manager.Plan->Nodes[NodeIndex]->Title.ToString());
+			bHasInterleavedNodes = true;
+		}
+
+		FHoudiniBuildShard AfterShard;
+		AfterShard.Nodes = EHoudiniBuildShardNodes::SharedNodesAfter;
+		TArray<bool> RunsNodeAfter;
+		AfterShard.GetNodesToRun(*Manager.Plan, RunsNodeAfter);
+		bHasSharedNodesAfter |= RunsNodeAfter.Contains(true);
+	}
+	if (bHasInterleavedNodes)
+	{
+		return 1;
+	}
+
+	bool bRunSharedNodesBefore = true;
+	bool bRunWorkers = true;
+	FindResumePhase(BuildManagers, NumWorkers, bRunSharedNodesBefore, bRunWorkers);
+
+	// Saved before the workers start, so that they load the map with these changes.
+	if (bRunSharedNodesBefore && !RunSharedNodes(World, BuildManagers, EHoudiniBuildShardNodes::SharedNodesBefore))
+	{
+		return 1;
+	}
+
+	FString ShardQueueDirectory;
+	if (!FParse::Value(*Params, TEXT("ShardQueue="), ShardQueueDirectory))
+	{
+		ShardQueueDirectory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("HoudiniBuild"), FGuid::NewGuid().ToString());
+	}
+	ShardQueueDirectory = FPaths::ConvertRelativePathToFull(ShardQueueDirectory);
+	ShardQueue = MakeShared<FHoudiniBuildShardQueue>(ShardQueueDirectory);
+
+	if (bRunWorkers)
+	{
+		// Assign every HDA actor in the map, not just the ones the graphs pick, so that inputs are followed everywhere.
+		TArray<AHoudiniAssetActor*> AssetActors;
+		for (TActorIterator<AHoudiniAssetActor> ActorItr(World); ActorItr; ++ActorItr)
+		{
+			AssetActors.Add(*ActorItr);
+		}
+		const EHoudiniBuildShardKey ShardKey = ShardBy == TEXT("ActorPath") ? EHoudiniBuildShardKey::ActorPath : EHoudiniBuildShardKey::Cell;
+		if (!ShardQueue->WriteAssignment(NumWorkers, FHoudiniBuildShard::Assign(AssetActors, NumWorkers, ShardKey, CellSize)))
+		{
+			return 1;
+		}
+
+		if (!RunWorkers(Managers, NumWorkers, MapPath, ManagerName, Params))
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunCoordinator(): Build failed, see %s."), *ShardQueueDirectory);
+			return 1;
+		}
+	}
+
+	if (bHasSharedNodesAfter)
+	{
+		// The nodes after the workers have to see what the workers saved, so the map is loaded again.
+		World = UEditorLoadingAndSavingUtils::LoadMap(MapPath);
+		TArray<AHoudiniBuildManager*> ReloadedManagers;
+		if (World)
+		{
+			ReloadedManagers = FindBuildManagers(World, ManagerName, GraphPath);
+		}
+		for (FCoordinatedManager& Manager : Managers)
+		{
+			AHoudiniBuildManager** ReloadedManager = ReloadedManagers.FindByPredicate([&Manager](const AHoudiniBuildManager* BuildManager) { return BuildManager->GetName() == Manager.Name; });
+			if (!ReloadedManager)
+			{
+				UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunCoordinator(): Lost %s when loading %s again."), *Manager.Name, *MapPath);
+				return 1;
+			}
+			Manager.BuildManager = *ReloadedManager;
+		}
+	}
+
+	// Merge the workers' build histories into the build managers.
+	TArray<AHoudiniBuildManager*> MergedManagers;
+	for (FCoordinatedManager& Manager : Managers)
+	{
+		for (int32 ShardIndex = 0; ShardIndex < NumWorkers && bRunWorkers; ++ShardIndex)
+		{
+			FHoudiniBuildHistory ShardHistory;
+			FHoudiniBuildShard Shard;
+			if (ShardQueue->ReadHistory(Manager.Name, ShardIndex, ShardHistory) && ShardQueue->ReadShard(ShardIndex, Shard))
+			{
+				Manager.BuildManager->BuildHistory.MergeShard(ShardHistory, Shard);
+			}
+		}
+		Manager.BuildManager->MarkPackageDirty();
+		MergedManagers.Add(Manager.BuildManager);
+	}
+
+	if (bHasSharedNodesAfter && !RunSharedNodes(World, MergedManagers, EHoudiniBuildShardNodes::SharedNodesAfter))
+	{
+		return 1;
+	}
+
+	if (bSave)
+	{
+		TArray<UPackage*> Packages;
+		for (const AHoudiniBuildManager* BuildManager : MergedManagers)
+		{
+			if (!BuildManager->HasAnyFlags(RF_Transient))
+			{
+				Packages.AddUnique(BuildManager->GetPackage());
+			}
+		}
+		if (!Packages.IsEmpty() && !UEditorLoadingAndSavingUtils::SavePackages(Packages, true))
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunCoordinator(): Failed to save the build managers."));
+			return 1;
+		}
+	}
+
+	UE_LOG(LogEHEEditor, Display, TEXT("Houdini build finished."));
+	return 0;
+}
+
+bool UHoudiniBuildCommandlet::RunSharedNodes(UWorld* World, TConstArrayView<AHoudiniBuildManager*> BuildManagers, EHoudiniBuildShardNodes Nodes)
+{
+	const TCHAR* When = Nodes == EHoudiniBuildShardNodes::SharedNodesBefore ? TEXT("before") : TEXT("after");
+	UE_LOG(LogEHEEditor, Display, TEXT("Running the nodes that don't build HDA actors, %s the ones that do."), When);
+
+	FHoudiniBuildShard Shard;
+	Shard.Nodes = Nodes;
+	bool bFailed = false;
+	for (AHoudiniBuildManager* BuildManager : BuildManagers)
+	{
+		BuildManager->SetShard(Shard);
+		if (!BuildManager->Run(bResume))
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunSharedNodes(): Failed to start %s."), *BuildManager->GetActorNameOrLabel());
+			bFailed = true;
+		}
+	}
+
+	bFailed |= !WaitForBuildManagers(World, BuildManagers);
+	for (AHoudiniBuildManager* BuildManager : BuildManagers)
+	{
+		bFailed |= BuildManager->HasRunFailed();
+		BuildManager->SetShard(FHoudiniBuildShard());
+	}
+
+	FAssetCompilingManager::Get().FinishAllCompilation();
+	if (bFailed)
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunSharedNodes(): The nodes %s the HDA actor builds failed, not saving."), When);
+		return false;
+	}
+	if (bSave && !SaveBuild(World, BuildManagers))
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunSharedNodes(): Failed to save the packages dirtied by the nodes %s the HDA actor builds."), When);
+		return false;
+	}
+
+	return true;
+}
+
+void UHoudiniBuildCommandlet::FindResumePhase(TConstArrayView<AHoudiniBuildManager*> BuildManagers, int32 NumShards, bool& bOutRunSharedNodesBefore, bool& bOutRunShards) const
+{
+	// When resuming, pick up from the phase the interrupted build got to. The shards only started once the nodes before
+	// them were done, and the nodes after them only once every shard was done.
+	bOutRunSharedNodesBefore = true;
+	bOutRunShards = true;
+	if (!bResume)
+	{
+		return;
+	}
+	
+	for (AHoudiniBuildManager* BuildManager : BuildManagers)
+	{
+		FHoudiniBuildShard Shard;
+		Shard.Nodes = EHoudiniBuildShardNodes::SharedNodesAfter;
+		BuildManager->SetShard(Shard);
+		bOutRunShards &= !BuildManager->HasJournal();
+
+		for (int32 ShardIndex = 0; ShardIndex < NumShards; ++ShardIndex)
+		{
+			Shard = FHoudiniBuildShard();
+			Shard.Index = ShardIndex;
+			Shard.Count = FMath::Max(2, NumShards);
+			BuildManager->SetShard(Shard);
+			bOutRunSharedNodesBefore &= !BuildManager->HasJournal();
+		}
+		BuildManager->SetShard(FHoudiniBuildShard());
+	}
+	bOutRunSharedNodesBefore &= bOutRunShards;
+}
+
+bool UHoudiniBuildCommandlet::RunWorkers(TArray<FCoordinatedManager>& Managers, int32 NumWorkers, const FString& MapPath, const FString& ManagerName, const FString& Params)
+{
+	// The workers run this same commandlet, minus the coordinator arguments.
+	FString WorkerParams = FString::Printf(TEXT("\"%s\" -run=HoudiniBuild -ShardQueue=\"%s\" -Map=\"%s\""), *FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath()), *ShardQueue->GetDirectory(), *MapPath);
+	if (!ManagerName.IsEmpty())
+	{
+		WorkerParams += FString::Printf(TEXT(" -Manager=\"%s\""), *ManagerName);
+	}
+	for (const TCHAR* ForwardedParam : {TEXT("Graph="), TEXT("TimeoutSec=")})
+	{
+		FString Value;
+		if (FParse::Value(*Params, ForwardedParam, Value))
+		{
+			WorkerParams += FString::Printf(TEXT(" -%s\"%s\""), ForwardedParam, *Value);
+		}
+	}
+	if (!bSave)
+	{
+		WorkerParams += TEXT(" -NoSave");
+	}
+	if (bResume)
+	{
+		WorkerParams += TEXT(" -Resume");
+	}
+	WorkerParams += TEXT(" -unattended -nullrhi -nosplash -nopause");
+
+	TArray<FProcHandle> Workers;
+	for (int32 ShardIndex = 0; ShardIndex < NumWorkers; ++ShardIndex)
+	{
+		const FString Args = FString::Printf(TEXT("%s -ShardIndex=%d -abslog=\"%s\""), *WorkerParams, ShardIndex, *ShardQueue->GetLogPath(ShardIndex));
+		Workers.Add(FPlatformProcess::CreateProc(FPlatformProcess::ExecutablePath(), *Args, false, true, true, nullptr, 0, nullptr, nullptr));
+		if (!Workers.Last().IsValid())
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunWorkers(): Failed to start worker %d."), ShardIndex);
+			ShardQueue->Abort();
+			return false;
+		}
+	}
+	UE_LOG(LogEHEEditor, Display, TEXT("Started %d workers, queue: %s"), NumWorkers, *ShardQueue->GetDirectory());
+
+	const double TimeStarted = FPlatformTime::Seconds();
+	bool bFailed = false;
+	bool bSavesChecked = false;
+	bool bAnyWorkerRunning = true;
+	while (bAnyWorkerRunning)
+	{
+		for (FCoordinatedManager& Manager : Managers)
+		{
+			for (int32 NodeIndex = 0; NodeIndex < Manager.Plan->Num(); ++NodeIndex)
+			{
+				if (Manager.Ended[NodeIndex])
+				{
+					continue;
+				}
+				
+				bool bEndedEverywhere = true;
+				for (int32 ShardIndex = 0; ShardIndex < NumWorkers && bEndedEverywhere; ++ShardIndex)
+				{
+					TSharedPtr<FJsonObject> NodeReport = ShardQueue->ReadNodeReport(Manager.Name, NodeIndex, ShardIndex);
+					bEndedEverywhere = NodeReport.IsValid();
+					if (NodeReport && NodeReport->GetBoolField(TEXT("failed")))
+					{
+						UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunWorkers(): %s failed in worker %d."), *NodeReport->GetStringField(TEXT("title")), ShardIndex);
+						bFailed = true;
+					}
+				}
+				Manager.Ended[NodeIndex] = bEndedEverywhere;
+			}
+
+			// This is where graph order is kept across the workers: a node only starts once its parents are done in
+			// all of them.
+			for (int32 NodeIndex = 0; NodeIndex < Manager.Plan->Num(); ++NodeIndex)
+			{
+				if (!Manager.Released[NodeIndex] && Algo::AllOf(Manager.Plan->GetParents(NodeIndex), [&Manager](int32 ParentIndex) { return Manager.Ended[ParentIndex]; }))
+				{
+					ShardQueue->ReleaseNode(Manager.Name, NodeIndex);
+					Manager.Released[NodeIndex] = true;
+				}
+			}
+		}
+
+		if (bSave && !bSavesChecked && !bFailed)
+		{
+			bSavesChecked = CheckWorkerSaves(NumWorkers, bFailed);
+		}
+
+		if (TimeoutSec > 0.0 && FPlatformTime::Seconds() - TimeStarted > TimeoutSec)
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunWorkers(): Timed out after %.0f seconds."), TimeoutSec);
+			bFailed = true;
+		}
+
+		bAnyWorkerRunning = false;
+		for (int32 ShardIndex = 0; ShardIndex < NumWorkers; ++ShardIndex)
+		{
+			if (FPlatformProcess::IsProcRunning(Workers[ShardIndex]))
+			{
+				bAnyWorkerRunning = true;
+				continue;
+			}
+
+			int32 ReturnCode = 0;
+			if (FPlatformProcess::GetProcReturnCode(Workers[ShardIndex], &ReturnCode) && ReturnCode != 0 && !bFailed)
+			{
+				UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunWorkers(): Worker %d exited with %d, see %s."), ShardIndex, ReturnCode, *ShardQueue->GetLogPath(ShardIndex));
+				bFailed = true;
+			}
+		}
+
+		if (bFailed && !ShardQueue->IsAborted())
+		{
+			// The other workers stop at their next tick, without saving.
+			ShardQueue->Abort();
+		}
+		
+		FPlatformProcess::Sleep(CVarHoudiniBuildCommandletPollIntervalSec.GetValueOnGameThread());
+	}
+
+	for (FProcHandle& Worker : Workers)
+	{
+		FPlatformProcess::CloseProc(Worker);
+	}
+
+	// Merge what the workers reported into one report.
+	TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+	for (FCoordinatedManager& Manager : Managers)
+	{
+		TArray<TSharedPtr<FJsonValue>> NodeReports;
+		for (int32 NodeIndex = 0; NodeIndex < Manager.Plan->Num(); ++NodeIndex)
+		{
+			UAutomationGraphNode* GraphNode = Manager.Plan->Nodes[NodeIndex];
+			TSharedRef<FJsonObject> NodeReport = MakeShared<FJsonObject>();
+			NodeReport->SetStringField(TEXT("title"), GraphNode ? GraphNode->Title.ToString() : FString());
+
+			int32 NumWorkItems = 0;
+			int32 NumUpToDate = 0;
+			int32 NumRetried = 0;
+			TArray<TSharedPtr<FJsonValue>> ShardReports;
+			for (int32 ShardIndex = 0; ShardIndex < NumWorkers; ++ShardIndex)
+			{
+				TSharedPtr<FJsonObject> ShardReport = ShardQueue->ReadNodeReport(Manager.Name, NodeIndex, ShardIndex);
+				if (!ShardReport)
+				{
+					// Never got to this node.
+					bFailed = true;
+					continue;
+				}
+				
+				NumWorkItems += ShardReport->GetIntegerField(TEXT("work_items"));
+				NumUpToDate += ShardReport->GetBoolField(TEXT("up_to_date")) ? 1 : 0;
+				
+				const TArray<TSharedPtr<FJsonValue>>* RetriedReports = nullptr;
+				if (ShardReport->TryGetArrayField(TEXT("retried"), RetriedReports))
+				{
+					NumRetried += RetriedReports->Num();
+					for (const TSharedPtr<FJsonValue>& RetriedReport : *RetriedReports)
+					{
+						const TSharedPtr<FJsonObject>& Retried = RetriedReport->AsObject();
+						UE_LOG(LogEHEEditor, Display, TEXT("%s / %s: %s needed %d attempts (worker %d)%s."), *Manager.Name, *NodeReport->GetStringField(TEXT("title")), *Retried->GetStringField(TEXT("actor")), static_cast<int32>(Retried->GetNumberField(TEXT("attempts"))), ShardIndex, Retried->GetBoolField(TEXT("finished")) ? TEXT("") : TEXT(" and still failed"));
+					}
+				}
+				ShardReports.Add(MakeShared<FJsonValueObject>(ShardReport));
+			}
+			NodeReport->SetNumberField(TEXT("work_items"), NumWorkItems);
+			NodeReport->SetNumberField(TEXT("retried"), NumRetried);
+			NodeReport->SetArrayField(TEXT("shards"), ShardReports);
+			NodeReports.Add(MakeShared<FJsonValueObject>(NodeReport));
+
+			UE_LOG(LogEHEEditor, Display, TEXT("%s / %s: %d work items (%d retried), reported by %d/%d workers, up to date in %d."), *Manager.Name, *NodeReport->GetStringField(TEXT("title")), NumWorkItems, NumRetried, ShardReports.Num(), NumWorkers, NumUpToDate);
+		}
+		Report->SetArrayField(Manager.Name, NodeReports);
+	}
+	Report->SetBoolField(TEXT("failed"), bFailed);
+	ShardQueue->WriteReport(Report);
+
+	return !bFailed;
+}
+
+bool UHoudiniBuildCommandlet::CheckWorkerSaves(int32 NumWorkers, bool& bOutConflict) const
+{
+	TArray<TArray<FString>> PackagesByWorker;
+	for (int32 ShardIndex = 0; ShardIndex < NumWorkers; ++ShardIndex)
+	{
+		if (!ShardQueue->ReadPackages(ShardIndex, PackagesByWorker.AddDefaulted_GetRef()))
+		{
+			// Still building.
+			return false;
+		}
+	}
+
+	TMap<FString, int32> WorkerByPackage;
+	for (int32 ShardIndex = 0; ShardIndex < NumWorkers; ++ShardIndex)
+	{
+		for (const FString& PackageName : PackagesByWorker[ShardIndex])
+		{
+			if (const int32* OtherShardIndex = WorkerByPackage.Find(PackageName))
+			{
+				UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::CheckWorkerSaves(): Workers %d and %d both changed %s. HDAs whose outputs end up in the same package have to be built by the same worker, e.g. with a larger -ShardCellSize."), *OtherShardIndex, ShardIndex, *PackageName);
+				bOutConflict = true;
+				continue;
+			}
+			WorkerByPackage.Add(PackageName, ShardIndex);
+		}
+	}
+
+	if (!bOutConflict)
+	{
+		ShardQueue->ReleaseSaves();
+	}
+	return true;
+}
+
+int32 UHoudiniBuildCommandlet::RunStreaming(UWorld* World, TConstArrayView<AHoudiniBuildManager*> BuildManagers, const FString& Params)
+{
+	UWorldPartition* WorldPartition = World->GetWorldPartition();
+	if (!WorldPartition)
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunStreaming(): Streaming builds need a world partition map."));
+		return 1;
+	}
+	if (!bSave)
+	{
+		UE_LOG(LogEHEEditor, Warning, TEXT("warning: UHoudiniBuildCommandlet::RunStreaming(): -NoSave was passed, the result of each region is thrown away when it is unloaded."));
+	}
+
+	double CellSize = 51200.0;
+	FParse::Value(*Params, TEXT("StreamCellSize="), CellSize);
+	FString StreamOrder = TEXT("Snake");
+	FParse::Value(*Params, TEXT("StreamOrder="), StreamOrder);
+	uint64 MaxMemoryMB = 0;
+	FParse::Value(*Params, TEXT("MaxMemoryMB="), MaxMemoryMB);
+	const uint64 MaxMemory = MaxMemoryMB * 1024 * 1024;
+	const bool bPrefetch = FParse::Param(*Params, TEXT("Prefetch"));
+
+	if (CellSize <= 0.0)
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunStreaming(): Expected a positive -StreamCellSize."));
+		return 1;
+	}
+
+	// Plan from the actor descriptors first, so that only regions with something to build are ever loaded.
+	TArray<FHoudiniBuildDescriptorPlan> Plans;
+	FBox PlannedBounds(ForceInit);
+	bool bHasInterleavedNodes = false;
+	for (AHoudiniBuildManager* BuildManager : BuildManagers)
+	{
+		// The nodes that don't build HDA actors only run once, outside of the regions, so they have to come before or
+		// after all of the nodes that do.
+		if (BuildManager->SequenceGraph)
+		{
+			const TSharedRef<const FAutomationGraphPlan> GraphPlan = BuildManager->SequenceGraph->GetPlan();
+			for (int32 NodeIndex : FHoudiniBuildShard::FindInterleavedSharedNodes(*GraphPlan))
+			{
+				UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunStreaming(): %s / %s comes between nodes that build HDA actors, so the build can't be streamed."), *BuildManager->GetActorNameOrLabel(), *GraphPlan->Nodes[NodeIndex]->Title.ToString());
+				bHasInterleavedNodes = true;
+			}
+		}
+		
+		FHoudiniBuildDescriptorPlan& Plan = Plans.AddDefaulted_GetRef();
+		if (!BuildManager->PlanFromDescriptors(Plan))
+		{
+			return 1;
+		}
+		Plan.Log();
+		PlannedBounds += Plan.Bounds;
+	}
+	if (bHasInterleavedNodes)
+	{
+		return 1;
+	}
+
+	// A region for every cell of a full height grid over the planned actors. Snake order walks every other row backwards, so
+	// that consecutive regions are always neighbors and share as many loaded actors as possible.
+	struct FBuildRegion
+	{
+		FHoudiniBuildShard Shard;
+		FBox LoadBounds = FBox(ForceInit);
+	};
+	TArray<FBuildRegion> Regions;
+	
+	const int32 NumColumns = PlannedBounds.IsValid ? FMath::FloorToInt32((PlannedBounds.Max.X - PlannedBounds.Min.X) / CellSize) + 1 : 0;
+	const int32 NumRows = PlannedBounds.IsValid ? FMath::FloorToInt32((PlannedBounds.Max.Y - PlannedBounds.Min.Y) / CellSize) + 1 : 0;
+	for (int32 Row = 0; Row < NumRows; ++Row)
+	{
+		for (int32 Step = 0; Step < NumColumns; ++Step)
+		{
+			const int32 Column = (StreamOrder == TEXT("Snake") && Row % 2 == 1) ? NumColumns - 1 - Step : Step;
+			const FVector Min(PlannedBounds.Min.X + Column * CellSize, PlannedBounds.Min.Y + Row * CellSize, PlannedBounds.Min.Z);
+			const FBox Cell(Min, FVector(Min.X + CellSize, Min.Y + CellSize, PlannedBounds.Max.Z));
+
+			// Only the area the planned actors and their inputs cover is loaded, not the whole cell.
+			FBuildRegion Region;
+			for (const FHoudiniBuildDescriptorPlan& Plan : Plans)
+			{
+				for (int32 ActorIndex : Plan.GetActorsInRegion(Cell))
+				{
+					const FHoudiniBuildPlannedActor& PlannedActor = Plan.Actors[ActorIndex];
+					Region.Shard.Actors.Add(PlannedActor.ActorPath);
+					Region.LoadBounds += PlannedActor.Bounds;
+					if (PlannedActor.InputBounds.IsValid)
+					{
+						Region.LoadBounds += PlannedActor.InputBounds;
+					}
+				}
+			}
+			if (!Region.Shard.Actors.IsEmpty())
+			{
+				Regions.Add(MoveTemp(Region));
+			}
+		}
+	}
+	for (int32 RegionIndex = 0; RegionIndex < Regions.Num(); ++RegionIndex)
+	{
+		Regions[RegionIndex].Shard.Index = RegionIndex;
+		Regions[RegionIndex].Shard.Count = FMath::Max(2, Regions.Num());
+		Regions[RegionIndex].Shard.Nodes = EHoudiniBuildShardNodes::ActorNodes;
+	}
+
+	bool bRunSharedNodesBefore = true;
+	bool bRunRegions = true;
+	FindResumePhase(BuildManagers, Regions.Num(), bRunSharedNodesBefore, bRunRegions);
+	if (!bRunRegions)
+	{
+		Regions.Empty();
+	}
+	
+	// These only see what is loaded outside of the regions.
+	if (bRunSharedNodesBefore && !RunSharedNodes(World, BuildManagers, EHoudiniBuildShardNodes::SharedNodesBefore))
+	{
+		return 1;
+	}
+
+	auto IsOverMemoryCap = [MaxMemory]()
+	{
+		return MaxMemory > 0 && FPlatformMemory::GetStats().UsedPhysical > MaxMemory;
+	};
+	auto MakeLoader = [World](const FBuildRegion& Region)
+	{
+		TUniquePtr<FLoaderAdapterShape> Loader;
+		if (Region.LoadBounds.IsValid)
+		{
+			Loader = MakeUnique<FLoaderAdapterShape>(World, Region.LoadBounds, TEXT("Houdini Build Region"));
+			Loader->Load();
+		}
+		return Loader;
+	};
+
+	UHoudiniAssetActorIndex* ActorIndex = UHoudiniAssetActorIndex::Get(World);
+	TUniquePtr<FLoaderAdapterShape> NextLoader;
+	bool bNextLoaderLoaded = false;
+	
+	for (int32 RegionIndex = 0; RegionIndex < Regions.Num(); ++RegionIndex)
+	{
+		const FBuildRegion& Region = Regions[RegionIndex];
+		if (IsOverMemoryCap())
+		{
+			CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS, true);
+			if (IsOverMemoryCap())
+			{
+				UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunStreaming(): Using %llu MB before loading region %d, over the %llu MB cap."), FPlatformMemory::GetStats().UsedPhysical / (1024 * 1024), RegionIndex, MaxMemoryMB);
+				return 1;
+			}
+		}
+
+		TUniquePtr<FLoaderAdapterShape> Loader = bNextLoaderLoaded ? MoveTemp(NextLoader) : MakeLoader(Region);
+		bNextLoaderLoaded = false;
+
+		// World partition doesn't tell the index about the actors it just loaded.
+		if (ActorIndex)
+		{
+			ActorIndex->Invalidate();
+		}
+
+		UE_LOG(LogEHEEditor, Display, TEXT("Building region %d/%d (%d actors)."), RegionIndex + 1, Regions.Num(), Region.Shard.Actors.Num());
+		bool bFailed = false;
+		for (AHoudiniBuildManager* BuildManager : BuildManagers)
+		{
+			BuildManager->SetShard(Region.Shard);
+			bFailed |= !BuildManager->Run(bResume);
+		}
+
+		// The next region loads while Houdini cooks this one.
+		if (bPrefetch && RegionIndex + 1 < Regions.Num() && !IsOverMemoryCap())
+		{
+			NextLoader = MakeLoader(Regions[RegionIndex + 1]);
+			bNextLoaderLoaded = true;
+		}
+
+		bFailed |= !WaitForBuildManagers(World, BuildManagers);
+		for (AHoudiniBuildManager* BuildManager : BuildManagers)
+		{
+			bFailed |= BuildManager->HasRunFailed();
+		}
+		
+		FAssetCompilingManager::Get().FinishAllCompilation();
+		if (bFailed)
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunStreaming(): Region %d failed, not saving."), RegionIndex);
+			return 1;
+		}
+		if (bSave && !SaveBuild(World, BuildManagers))
+		{
+			UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::RunStreaming(): Failed to save region %d."), RegionIndex);
+			return 1;
+		}
+
+		if (Loader)
+		{
+			Loader->Unload();
+			Loader.Reset();
+		}
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS, true);
+
+		const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+		UE_LOG(LogEHEEditor, Display, TEXT("Region %d done, using %llu MB (peak %llu MB)."), RegionIndex + 1, MemoryStats.UsedPhysical / (1024 * 1024), MemoryStats.PeakUsedPhysical / (1024 * 1024));
+	}
+
+	for (AHoudiniBuildManager* BuildManager : BuildManagers)
+	{
+		BuildManager->SetShard(FHoudiniBuildShard());
+	}
+	if (!RunSharedNodes(World, BuildManagers, EHoudiniBuildShardNodes::SharedNodesAfter))
+	{
+		return 1;
+	}
+
+	UE_LOG(LogEHEEditor, Display, TEXT("Houdini build finished, built %d regions."), Regions.Num());
+	return 0;
+}
+
+void UHoudiniBuildCommandlet::PreloadMap(const FString& MapPath)
+{
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	const FName MapPackageName(*FPackageName::ObjectPathToPackageName(MapPath));
+
+	// Everything the map package needs. The map package itself is left alone, a second world in memory would get in
+	// the way of the map change.
+	TSet<FName> PackageNames;
+	TArray<FName> PackagesToVisit = {MapPackageName};
+	while (!PackagesToVisit.IsEmpty())
+	{
+		TArray<FName> Dependencies;
+		AssetRegistry.GetDependencies(PackagesToVisit.Pop(), Dependencies, UE::AssetRegistry::EDependencyCategory::Package, UE::AssetRegistry::EDependencyQuery::Hard);
+		for (FName Dependency : Dependencies)
+		{
+			bool bAlreadyVisited = false;
+			PackageNames.Add(Dependency, &bAlreadyVisited);
+			if (!bAlreadyVisited)
+			{
+				PackagesToVisit.Add(Dependency);
+			}
+		}
+	}
+	
+	// And the HDAs used by the actors in it, which on world partition maps live in their own packages.
+	TArray<FAssetData> ExternalActors;
+	AssetRegistry.GetAssetsByPath(FName(*ULevel::GetExternalActorsPath(MapPackageName.ToString())), ExternalActors, true, true);
+	TSet<FName> ActorPackageNames;
+	for (const FAssetData& ExternalActor : ExternalActors)
+	{
+		ActorPackageNames.Add(ExternalActor.PackageName);
+	}
+	for (FName ActorPackageName : ActorPackageNames)
+	{
+		TArray<FName> Dependencies;
+		AssetRegistry.GetDependencies(ActorPackageName, Dependencies, UE::AssetRegistry::EDependencyCategory::Package, UE::AssetRegistry::EDependencyQuery::Hard);
+		for (FName Dependency : Dependencies)
+		{
+			TArray<FAssetData> Assets;
+			AssetRegistry.GetAssetsByPackageName(Dependency, Assets);
+			if (Assets.ContainsByPredicate([](const FAssetData& AssetData) { return AssetData.AssetClassPath == UHoudiniAsset::StaticClass()->GetClassPathName(); }))
+			{
+				PackageNames.Add(Dependency);
+			}
+		}
+	}
+	PackageNames.Remove(MapPackageName);
+
+	int32 NumRequested = 0;
+	for (FName PackageName : PackageNames)
+	{
+		const FString PackageNameString = PackageName.ToString();
+		if (FPackageName::IsScriptPackage(PackageNameString) || FindPackage(nullptr, *PackageNameString))
+		{
+			continue;
+		}
+
+		LoadPackageAsync(PackageNameString, FLoadPackageAsyncDelegate::CreateUObject(this, &ThisClass::OnPackagePreloaded));
+		++NumRequested;
+	}
+	UE_LOG(LogEHEEditor, Display, TEXT("Preloading %d packages for %s."), NumRequested, *MapPath);
+}
+
+void UHoudiniBuildCommandlet::OnPackagePreloaded(const FName& PackageName, UPackage* Package, EAsyncLoadingResult::Type Result)
+{
+	// Held on to until the map is loaded, so garbage collection between maps doesn't throw them away again.
+	if (Package && Result == EAsyncLoadingResult::Succeeded)
+	{
+		PreloadedPackages.Add(Package);
+	}
+}
+
+bool UHoudiniBuildCommandlet::StartWorker(TConstArrayView<AHoudiniBuildManager*> BuildManagers, int32 ShardIndex)
+{
+	FHoudiniBuildShard Shard;
+	if (!ShardQueue->ReadShard(ShardIndex, Shard))
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: UHoudiniBuildCommandlet::StartWorker(): Invalid shard %d."), ShardIndex);
+		return false;
+	}
+
+	// The coordinator runs the nodes that don't build HDA actors.
+	Shard.Nodes = EHoudiniBuildShardNodes::ActorNodes;
+	WorkerIndex = ShardIndex;
+
+	UE_LOG(LogEHEEditor, Display, TEXT("Building shard %d/%d (%d actors)."), Shard.Index + 1, Shard.Count, Shard.Actors.Num());
+	for (AHoudiniBuildManager* BuildManager : BuildManagers)
+	{
+		BuildManager->SetShard(Shard);
+		BuildManager->CanStartNodeDelegate.BindLambda([Queue = ShardQueue, ManagerName = BuildManager->GetName()](AHoudiniBuildManager*, int32 NodeIndex)
+		{
+			return Queue->IsNodeReleased(ManagerName, NodeIndex);
+		});
+		BuildManager->OnNodeEndedDelegate.AddUObject(this, &ThisClass::OnWorkerNodeEnded, ShardIndex);
+	}
+
+	return true;
+}
+
+void UHoudiniBuildCommandlet::OnWorkerNodeEnded(AHoudiniBuildManager* BuildManager, int32 NodeIndex, UAutomationGraphNode* GraphNode, int32 ShardIndex) const
+{
+	const EAutomationGraphNodeState NodeState = GraphNode->GetState();
+	auto* BuildSequenceNode = Cast<UHoudiniBuildSequenceNode>(GraphNode);
+	
+	TSharedRef<FJsonObject> NodeReport = MakeShared<FJsonObject>();
+	NodeReport->SetStringField(TEXT("title"), GraphNode->Title.ToString());
+	NodeReport->SetStringField(TEXT("state"), UEnum::GetValueAsString(NodeState));
+	NodeReport->SetBoolField(TEXT("failed"), NodeState == EAutomationGraphNodeState::Error || NodeState == EAutomationGraphNodeState::Expired);
+	NodeReport->SetBoolField(TEXT("up_to_date"), GraphNode->WasFinishedUpToDate());
+	NodeReport->SetNumberField(TEXT("work_items"), BuildSequenceNode ? BuildSequenceNode->GetWorkItems().Num() : 0);
+
+	TArray<TSharedPtr<FJsonValue>> RetriedReports;
+	if (BuildSequenceNode)
+	{
+		for (const UHoudiniBuildWorkItem* WorkItem : BuildSequenceNode->GetRetriedWorkItems())
+		{
+			if (!WorkItem)
+			{
+				continue;
+			}
+			
+			TSharedRef<FJsonObject> RetriedReport = MakeShared<FJsonObject>();
+			RetriedReport->SetStringField(TEXT("actor"), WorkItem->GetAssetActor().IsValid() ? WorkItem->GetAssetActor()->GetPathName() : FString());
+			RetriedReport->SetNumberField(TEXT("attempts"), WorkItem->GetNumAttempts());
+			RetriedReport->SetBoolField(TEXT("finished"), WorkItem->GetBuildState() == EEHEBuildState::Finished);
+			RetriedReports.Add(MakeShared<FJsonValueObject>(RetriedReport));
+		}
+	}
+	NodeReport->SetArrayField(TEXT("retried"), RetriedReports);
+	
+	ShardQueue->WriteNodeReport(BuildManager->GetName(), NodeIndex, ShardIndex, NodeReport);
+}
@@ -0,0 +1,245 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Commandlets/HoudiniBuildShardQueue.h"
+
+#include "EHEEditorLoggingDefs.h"
+#include "Foundation/HoudiniBuildHistory.h"
+#include "Foundation/HoudiniBuildShard.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+
+FHoudiniBuildShardQueue::FHoudiniBuildShardQueue(const FString& InDirectory)
+	: Directory(InDirectory)
+{
+	IFileManager::Get().MakeDirectory(*Directory, true);
+}
+
+FString FHoudiniBuildShardQueue::GetLogPath(int32 ShardIndex) const
+{
+	return FPaths::Combine(Directory, FString::Printf(TEXT("shard_%d.log"), ShardIndex));
+}
+
+bool FHoudiniBuildShardQueue::WriteAssignment(int32 Count, const TMap<FSoftObjectPath, int32>& Assignment) const
+{
+	TSharedRef<FJsonObject> ActorsObject = MakeShared<FJsonObject>();
+	for (const TPair<FSoftObjectPath, int32>& ActorShard : Assignment)
+	{
+		ActorsObject->SetNumberField(ActorShard.Key.ToString(), ActorShard.Value);
+	}
+
+	TSharedRef<FJsonObject> AssignmentObject = MakeShared<FJsonObject>();
+	AssignmentObject->SetNumberField(TEXT("count"), Count);
+	AssignmentObject->SetObjectField(TEXT("actors"), ActorsObject);
+	
+	return WriteJson(FPaths::Combine(Directory, TEXT("shards.json")), AssignmentObject);
+}
+
+bool FHoudiniBuildShardQueue::ReadShard(int32 ShardIndex, FHoudiniBuildShard& OutShard) const
+{
+	TSharedPtr<FJsonObject> AssignmentObject = ReadJson(FPaths::Combine(Directory, TEXT("shards.json")));
+	const TSharedPtr<FJsonObject>* ActorsObject = nullptr;
+	if (!AssignmentObject || !AssignmentObject->TryGetObjectField(TEXT("actors"), ActorsObject))
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: FHoudiniBuildShardQueue::ReadShard(): No shard assignment in %s."), *Directory);
+		return false;
+	}
+
+	OutShard = FHoudiniBuildShard();
+	OutShard.Index = ShardIndex;
+	OutShard.Count = AssignmentObject->GetIntegerField(TEXT("count"));
+	for (const TPair<FString, TSharedPtr<FJsonValue>>& ActorShard : (*ActorsObject)->Values)
+	{
+		if (ActorShard.Value.IsValid() && static_cast<int32>(ActorShard.Value->AsNumber()) == ShardIndex)
+		{
+			OutShard.Actors.Add(FSoftObjectPath(ActorShard.Key));
+		}
+	}
+
+	return OutShard.IsValid();
+}
+
+void FHoudiniBuildShardQueue::ReleaseNode(const FString& ManagerName, int32 NodeIndex) const
+{
+	WriteFile(GetNodePath(ManagerName, NodeIndex, TEXT("released")), TArray<uint8>());
+}
+
+bool FHoudiniBuildShardQueue::IsNodeReleased(const FString& ManagerName, int32 NodeIndex) const
+{
+	return IFileManager::Get().FileExists(*GetNodePath(ManagerName, NodeIndex, TEXT("released")));
+}
+
+bool FHoudiniBuildShardQueue::WritePackages(int32 ShardIndex, TConstArrayView<FString> PackageNames) const
+{
+	TArray<TSharedPtr<FJsonValue>> PackageValues;
+	for (const FString& PackageName : PackageNames)
+	{
+		PackageValues.Add(MakeShared<FJsonValueString>(PackageName));
+	}
+
+	TSharedRef<FJsonObject> PackagesObject = MakeShared<FJsonObject>();
+	PackagesObject->SetArrayField(TEXT("packages"), PackageValues);
+	
+	return WriteJson(FPaths::Combine(Directory, FString::Printf(TEXT("packages.shard_%d.json"), ShardIndex)), PackagesObject);
+}
+
+bool FHoudiniBuildShardQueue::ReadPackages(int32 ShardIndex, TArray<FString>& OutPackageNames) const
+{
+	const FString Path = FPaths::Combine(Directory, FString::Printf(TEXT("packages.shard_%d.json"), ShardIndex));
+	if (!IFileManager::Get().FileExists(*Path))
+	{
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> PackagesObject = ReadJson(Path);
+	return PackagesObject && PackagesObject->TryGetStringArrayField(TEXT("packages"), OutPackageNames);
+}
+
+void FHoudiniBuildShardQueue::ReleaseSaves() const
+{
+	WriteFile(FPaths::Combine(Directory, TEXT("save")), TArray<uint8>());
+}
+
+bool FHoudiniBuildShardQueue::AreSavesReleased() const
+{
+	return IFileManager::Get().FileExists(*FPaths::Combine(Directory, TEXT("save")));
+}
+
+void FHoudiniBuildShardQueue::Abort() const
+{
+	WriteFile(FPaths::Combine(Directory, TEXT("abort")), TArray<uint8>());
+}
+
+bool FHoudiniBuildShardQueue::IsAborted() const
+{
+	return IFileManager::Get().FileExists(*FPaths::Combine(Directory, TEXT("abort")));
+}
+
+bool FHoudiniBuildShardQueue::WriteNodeReport(const FString& ManagerName, int32 NodeIndex, int32 ShardIndex, const TSharedRef<FJsonObject>& Report) const
+{
+	return WriteJson(GetNodePath(ManagerName, NodeIndex, FString::Printf(TEXT("shard_%d.json"), ShardIndex)), Report);
+}
+
+TSharedPtr<FJsonObject> FHoudiniBuildShardQueue::ReadNodeReport(const FString& ManagerName, int32 NodeIndex, int32 ShardIndex) const
+{
+	const FString Path = GetNodePath(ManagerName, NodeIndex, FString::Printf(TEXT("shard_%d.json"), ShardIndex));
+	if (!IFileManager::Get().FileExists(*Path))
+	{
+		return nullptr;
+	}
+	
+	return ReadJson(Path);
+}
+
+bool FHoudiniBuildShardQueue::WriteHistory(const FString& ManagerName, int32 ShardIndex, const FHoudiniBuildHistory& History) const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	FObjectAndNameAsStringProxyArchive Archive(Writer, false);
+	FHoudiniBuildHistory::StaticStruct()->SerializeItem(Archive, const_cast<FHoudiniBuildHistory*>(&History), nullptr);
+
+	return WriteFile(FPaths::Combine(Directory, ManagerName, FString::Printf(TEXT("history.shard_%d.bin"), ShardIndex)), Bytes);
+}
+
+bool FHoudiniBuildShardQueue::ReadHistory(const FString& ManagerName, int32 ShardIndex, FHoudiniBuildHistory& OutHistory) const
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *FPaths::Combine(Directory, ManagerName, FString::Printf(TEXT("history.shard_%d.bin"), ShardIndex))))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+	FObjectAndNameAsStringProxyArchive Archive(Reader, true);
+	FHoudiniBuildHistory::StaticStruct()->SerializeItem(Archive, &OutHistory, nullptr);
+	
+	return !Reader.IsError();
+}
+
+bool FHoudiniBuildShardQueue::WriteReport(const TSharedRef<FJsonObject>& Report) const
+{
+	return WriteJson(FPaths::Combine(Directory, TEXT("report.json")), Report);
+}
+
+FString FHoudiniBuildShardQueue::GetNodePath(const FString& ManagerName, int32 NodeIndex, const FString& Suffix) const
+{
+	return FPaths::Combine(Directory, ManagerName, FString::Printf(TEXT("node_%d.%s"), NodeIndex, *Suffix));
+}
+
+bool FHoudiniBuildShardQueue::WriteFile(const FString& Path, const TArray<uint8>& Bytes) const
+{
+	const FString TempPath = Path + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(Bytes, *TempPath) || !IFileManager::Get().Move(*Path, *TempPath, true))
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: FHoudiniBuildShardQueue::WriteFile(): Failed to write %s."), *Path);
+		return false;
+	}
+
+	return true;
+}
+
+bool FHoudiniBuildShardQueue::WriteJson(const FString& Path, const TSharedRef<FJsonObject>& JsonObject) const
+{
+	FString JsonString;
+	TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&JsonString);
+	if (!FJsonSerializer::Serialize(JsonObject, JsonWriter))
+	{
+		return false;
+	}
+
+	FTCHARToUTF8 Utf8String(*JsonString);
+	return WriteFile(Path, TArray<uint8>(reinterpret_cast<const uint8*>(Utf8String.Get()), Utf8String.Length()));
+}
+
+TSharedPtr<FJsonObject> FHoudiniBuildShardQueue::ReadJson(const FString& Path) const
+{
+	FString JsonString;
+	if (!FFileHelper::LoadFileToString(JsonString, *Path))
+	{
+		return nullptr;
+	}
+
+	TSharedPtr<FJsonObject> JsonObject;
+	TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(JsonString);
+	if (!FJsonSerializer::Deserialize(JsonReader, JsonObject))
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: FHoudiniBuildShardQueue::ReadJson(): Failed to parse %s."), *Path);
+		return nullptr;
+	}
+
+	return JsonObject;
+}
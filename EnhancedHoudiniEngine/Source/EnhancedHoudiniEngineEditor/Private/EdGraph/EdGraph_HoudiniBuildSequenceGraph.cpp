@@ -541,9 +541,37 @@ UHoudiniBuildSequenceGraph* UEdGraph_HoudiniBuildSequenceGraph::GetBuildSequence
 	return CastChecked<UHoudiniBuildSequenceGraph>(GetOuter());
 }
 
+void UEdGraph_HoudiniBuildSequenceGraph::GatherTopology(TSet<TPair<const UAutomationGraphNode*, const UAutomationGraphNode*>>& OutEdges)
+{
+	UHoudiniBuildSequenceGraph* SequenceGraph = GetBuildSequenceGraph();
+
+	// Root nodes are recorded as edges from nullptr.
+	for (const UAutomationGraphNode* RootNode : SequenceGraph->RootNodes)
+	{
+		OutEdges.Add(TPair<const UAutomationGraphNode*, const UAutomationGraphNode*>(nullptr, RootNode));
+	}
+	
+	for (TObjectPtr<UEdGraphNode> Node : Nodes)
+	{
+		auto* SequenceGraphNode = Cast<UEdNode_HoudiniBuildSequenceNode>(Node);
+		if (!SequenceGraphNode || !SequenceGraphNode->SequenceNode)
+		{
+			continue;
+		}
+
+		for (const UAutomationGraphNode* ChildNode : SequenceGraphNode->SequenceNode->ChildNodes)
+		{
+			OutEdges.Add(TPair<const UAutomationGraphNode*, const UAutomationGraphNode*>(SequenceGraphNode->SequenceNode, ChildNode));
+		}
+	}
+}
+
 void UEdGraph_HoudiniBuildSequenceGraph::RebuildSequenceGraph()
 {
 	UHoudiniBuildSequenceGraph* SequenceGraph = GetBuildSequenceGraph();
+
+	TSet<TPair<const UAutomationGraphNode*, const UAutomationGraphNode*>> OldTopology;
+	GatherTopology(OldTopology);
 	
 	SequenceGraph->RootNodes.Empty();
 	
@@ -644,6 +672,16 @@ void UEdGraph_HoudiniBuildSequenceGraph::RebuildSequenceGraph()
 			SequenceGraph->RootNodes.Add(SequenceNode);
 		}
 	}
+
+	// Most calls here come from edits that don't touch the topology (renames, moves, etc.), so only throw away the
+	// compiled plan when the edges actually changed.
+	TSet<TPair<const UAutomationGraphNode*, const UAutomationGraphNode*>> NewTopology;
+	GatherTopology(NewTopology);
+	
+	if (OldTopology.Num() != NewTopology.Num() || !OldTopology.Includes(NewTopology))
+	{
+		SequenceGraph->InvalidatePlan();
+	}
 }
 
 #undef LOCTEXT_NAMESPACE
\ No newline at end of file
@@ -0,0 +1,101 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Engine/HoudiniEngineEditorCookSession.h"
+
+#include "EHEEditorLoggingDefs.h"
+#include "HoudiniAssetActor.h"
+#include "Async/Async.h"
+#include "Foundation/HoudiniBuildSequenceNode.h"
+#include "HoudiniEngine/Private/HoudiniApi.h"
+#include "HoudiniEngine/Private/HoudiniEngine.h"
+#include "HoudiniEngineRuntime/Private/HoudiniAssetComponent.h"
+
+static TAutoConsoleVariable<float> CVarHoudiniCookSessionHeartbeatTimeoutSec(
+	TEXT("houdini.CookSessions.HeartbeatTimeoutSec"),
+	10.0f,
+	TEXT("How long the Houdini Engine session has to answer a heartbeat before it counts as missed.")
+);
+
+bool FHoudiniEngineEditorCookSession::IsAlive() const
+{
+	const double TimeNow = FPlatformTime::Seconds();
+	if (Probe.IsValid())
+	{
+		if (!Probe->bDone)
+		{
+			// A call that is stuck can't be cancelled, so no new probe is started until it returns.
+			return TimeNow - Probe->TimeStarted < CVarHoudiniCookSessionHeartbeatTimeoutSec.GetValueOnGameThread();
+		}
+		bLastProbeAlive = Probe->bAlive;
+		Probe.Reset();
+	}
+
+	const HAPI_Session* Session = FHoudiniEngine::Get().GetSession();
+	if (!Session)
+	{
+		return false;
+	}
+	
+	// A round trip to the server, so a server that is stuck doesn't answer.
+	Probe = MakeShared<FProbe, ESPMode::ThreadSafe>();
+	Probe->TimeStarted = TimeNow;
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [Probe = Probe, SessionCopy = *Session]()
+	{
+		Probe->bAlive = FHoudiniApi::IsSessionValid(&SessionCopy) == HAPI_RESULT_SUCCESS;
+		Probe->bDone = true;
+	});
+	return bLastProbeAlive;
+}
+
+bool FHoudiniEngineEditorCookSession::Restart(TConstArrayView<UHoudiniBuildWorkItem*> Interrupted)
+{
+	if (!FHoudiniEngine::Get().RestartSession())
+	{
+		UE_LOG(LogEHEEditor, Error, TEXT("error: FHoudiniEngineEditorCookSession::Restart(): Failed to restart the Houdini Engine session."));
+		return false;
+	}
+
+	// A probe of the old session may still be stuck, and has nothing to say about the new one.
+	Probe.Reset();
+	bLastProbeAlive = true;
+
+	// Their nodes lived in the old session, so they have to be instantiated again before they can cook.
+	for (UHoudiniBuildWorkItem* WorkItem : Interrupted)
+	{
+		AHoudiniAssetActor* AssetActor = WorkItem ? WorkItem->GetAssetActor().Get() : nullptr;
+		if (UHoudiniAssetComponent* AssetComponent = AssetActor ? AssetActor->GetHoudiniAssetComponent() : nullptr)
+		{
+			AssetComponent->MarkAsNeedInstantiation();
+		}
+	}
+	return true;
+}
@@ -32,10 +32,13 @@
 #include "EnhancedHoudiniEngineEditorModule.h"
 
 #include "AssetToolsModule.h"
+#include "AutomationNodes/CookPDGNode.h"
 #include "EHEEditorLoggingDefs.h"
 #include "EdGraph/HoudiniBuildSequenceGraphNodeFactory.h"
 #include "Editor/HoudiniBuildSequenceGraphEditorStyle.h"
 #include "Engine/AssetTypeActions_HoudiniBuildManagerBlueprint.h"
+#include "Engine/HoudiniEngineEditorCookSession.h"
+#include "Foundation/HoudiniBuildSequenceGraph.h"
 #include "Logging/LogMacros.h"
 
 #define LOCTEXT_NAMESPACE "FEnhancedHoudiniEngineModule"
@@ -57,6 +60,10 @@ void FEnhancedHoudiniEngineEditorModule::StartupModule()
 	);
 	TSharedRef<IAssetTypeActions> BuildManagerBlueprintAction = MakeShareable(new FAssetTypeActions_HoudiniBuildManagerBlueprint(BuildManagerAssetCategoryBit));
 	RegisterAssetTypeAction(AssetTools, BuildManagerBlueprintAction);
+
+	// Editor-only pieces of the runtime module: the PDG node, and the Houdini Engine session heartbeat/restart.
+	UHoudiniBuildSequenceGraph::RegisterNodeType(UAGN_CookPDG::StaticClass(), LOCTEXT("HBSG_NewNodeCategory_Houdini", "Houdini"));
+	FHoudiniEngineCookSession::SetFactory([]() { return MakeShared<FHoudiniEngineEditorCookSession>(); });
 }
 
 void FEnhancedHoudiniEngineEditorModule::ShutdownModule()
@@ -64,6 +71,9 @@ void FEnhancedHoudiniEngineEditorModule::ShutdownModule()
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
 	UE_LOG(LogEHEEditor, Log, TEXT("Shutting down EnhancedHoudiniEngineEditorModule."));
+
+	FHoudiniEngineCookSession::SetFactory(nullptr);
+	UHoudiniBuildSequenceGraph::UnregisterNodeType(UAGN_CookPDG::StaticClass());
 	
 	if (BSGNodeFactory.IsValid())
 	{
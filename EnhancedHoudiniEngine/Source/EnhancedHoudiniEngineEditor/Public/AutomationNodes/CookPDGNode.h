@@ -0,0 +1,126 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Foundation/HoudiniBuildSequenceNode.h"
+
+#include "CookPDGNode.generated.h"
+
+class UHoudiniPDGAssetLink;
+class UTOPNetwork;
+class UTOPNode;
+
+// Work item counts of a TOP network cook, summed over all of its TOP nodes.
+struct FHoudiniPDGProgress
+{
+	int32 NumWorkItems = 0;
+	int32 NumCooking = 0;
+	int32 NumCooked = 0;
+	int32 NumFailed = 0;
+
+	// Result objects of auto-loaded TOP nodes that are waiting to load, loading or loaded, and the ones that are loaded.
+	int32 NumOutputs = 0;
+	int32 NumOutputsLoaded = 0;
+};
+
+UCLASS()
+class UHoudiniBuildWorkItem_CookPDG : public UHoudiniBuildWorkItem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnDeadlineReached(int32 ForBuildSerial, bool bFailDeadline) override;
+	virtual void BeginDestroy() override;
+
+	// Returns false if this work item hasn't started a PDG cook yet.
+	bool GetPDGProgress(FHoudiniPDGProgress& OutProgress) const;
+
+protected:
+	virtual bool BuildInternal(UHoudiniAssetComponent* AssetComponent) override;
+	virtual void OnHoudiniAssetPostProcess(UHoudiniAssetComponent* AssetComponent, bool Succeeded) override;
+
+	bool StartPDGCook(UHoudiniAssetComponent* AssetComponent);
+	void OnTOPNetworkCooked(UHoudiniPDGAssetLink* InAssetLink, UTOPNetwork* InTOPNetwork, bool bAnyWorkItemsFailed);
+	void OnWorkResultObjectLoaded(UHoudiniPDGAssetLink* InAssetLink, UTOPNode* InTOPNode, int32 WorkItemHAPIIndex, int32 WorkItemResultInfoIndex);
+	void FinishIfOutputsLoaded();
+	void UnbindPDGDelegates();
+
+	UPROPERTY()
+	TWeakObjectPtr<UHoudiniPDGAssetLink> AssetLink = nullptr;
+
+	UPROPERTY()
+	TWeakObjectPtr<UTOPNetwork> TOPNetwork = nullptr;
+
+	// The HDA has to be cooked once before its TOP networks are available.
+	bool bWaitingForHDACook = false;
+	bool bNetworkCooked = false;
+
+	FDelegateHandle PostTOPNetworkCookDelegateHandle;
+	FDelegateHandle WorkResultObjectLoadedDelegateHandle;
+};
+
+// Cooks a TOP network of each HDA through PDG. The work items of the network are scheduled by the TOP network's own
+// scheduler (usually the local scheduler), so they run in parallel in separate Houdini processes.
+//
+// Lives in the editor module, since the PDG manager is part of the editor-only HoudiniEngine module. The editor module
+// adds it to the sequence graph's node menu (see UHoudiniBuildSequenceGraph::RegisterNodeType).
+UCLASS(meta=( DisplayName="Cook PDG"))
+class ENHANCEDHOUDINIENGINEEDITOR_API UAGN_CookPDG : public UHoudiniBuildSequenceNode
+{
+	GENERATED_BODY()
+
+public:
+	UAGN_CookPDG(const FObjectInitializer& Initializer);
+
+	//~UAutomationGraphNode interface.
+	virtual FString GetMessageText() override;
+	//~End UAutomationGraphNode interface.
+
+	// The TOP network to cook. Uses the network selected on the HDA's PDG asset link when empty.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Build HDA")
+	FString TOPNetworkName;
+
+	// The TOP node to cook. Cooks the output node of the TOP network when empty.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Build HDA")
+	FString TOPNodeName;
+
+	// Dirty the TOP network before cooking, so every PDG work item is cooked again instead of reusing earlier results.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Build HDA")
+	bool bDirtyBeforeCook = false;
+
+	// Load the results of the cooked TOP node into the level. The node doesn't finish until they are all loaded.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Build HDA")
+	bool bLoadOutputs = true;
+
+	// Count a TOP network cook with failed PDG work items as a success.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Build HDA")
+	bool bAllowFailedWorkItems = false;
+};
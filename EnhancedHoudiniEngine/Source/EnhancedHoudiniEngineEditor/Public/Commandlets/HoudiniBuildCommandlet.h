@@ -0,0 +1,133 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Commandlets/Commandlet.h"
+
+#include "HoudiniBuildCommandlet.generated.h"
+
+class AHoudiniBuildManager;
+class FHoudiniBuildShardQueue;
+class UAutomationGraphNode;
+class UWorld;
+enum class EHoudiniBuildShardNodes : uint8;
+
+/**
+ * Runs Houdini build managers without the editor UI, e.g. on a build machine:
+ *
+ * UnrealEditor-Cmd <Project>.uproject -run=HoudiniBuild -Map=/Game/Maps/MyMap -unattended -nullrhi
+ *
+ * -Map=         The map to build.
+ * -Maps=        Several maps to build one after the other, separated by '+'.
+ * -MapList=     A text file with a map to build on each line, optionally followed by the build manager to run in it.
+ * -Manager=     Name or label of the build manager to run. Defaults to every build manager in the map.
+ * -Graph=       Run this sequence graph with a transient build manager instead of the ones placed in the map.
+ * -TimeoutSec=  Give up (and fail) if the build hasn't finished after this many seconds. Defaults to no limit.
+ * -NoSave       Don't save the packages dirtied by the build.
+ * -SaveDuringRun Save the packages of each node as soon as it finishes, instead of all at the end.
+ * -Resume       Skip the work that an interrupted run already finished (see FHoudiniBuildJournal).
+ *
+ * -Workers=     Split the build across this many worker processes (see below).
+ * -ShardBy=     Cell (default) or ActorPath. How actors are grouped before being spread across workers.
+ * -ShardCellSize=  Grid cell size used by -ShardBy=Cell. Defaults to 25600, the default world partition cell size.
+ *
+ * With -Workers, this process becomes the coordinator of a split build. It assigns the HDA actors to shards, starts
+ * one worker process per shard and lets each node start in the workers only once every worker finished the node's
+ * parents. Workers only run the nodes that build HDA actors. The other nodes run in the coordinator, before the
+ * workers start (and saved, so the workers see them) or after they are done (with the map loaded again, so they see
+ * what the workers saved). A node that comes between two HDA nodes can't run in either, so such graphs can't be
+ * split. Workers save their own actors, once the coordinator has checked that no two of them are about to save the
+ * same package, and don't save during the run. The coordinator merges their reports and build histories. Split builds
+ * need a map that uses one file per actor.
+ *
+ * -Streaming   Build a world partition map one region at a time (see below).
+ * -StreamCellSize=  Size of a region. Defaults to 51200.
+ * -StreamOrder=  Snake (default) or Rows.
+ * -MaxMemoryMB=  Fail instead of loading another region while the process uses more than this.
+ * -Prefetch     Load the next region while the current one cooks.
+ *
+ * With -Streaming, the build is first planned from the actor descriptors, and then only one region is loaded at a time.
+ * Each region's planned actors and the actors they take as input are loaded, built, saved and then unloaded again
+ * before moving on to the next. Regions without planned actors are never loaded. As with -Workers, the nodes that don't
+ * build HDA actors run once before the first region and once after the last one, so they must not come between nodes
+ * that do, and they only see what is loaded outside of the regions. Build managers must not be spatially loaded.
+ *
+ * When building several maps, the next map's dependencies and HDAs are loaded in the background while the current map
+ * builds. A map that fails doesn't stop the maps after it.
+ *
+ * Returns 0 if every build manager finished without errors, 1 otherwise.
+ */
+UCLASS()
+class UHoudiniBuildCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UHoudiniBuildCommandlet();
+	
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	int32 BuildMap(const FString& MapPath, const FString& ManagerName, const FString& NextMapPath, const FString& Params);
+	void PreloadMap(const FString& MapPath);
+	void OnPackagePreloaded(const FName& PackageName, UPackage* Package, EAsyncLoadingResult::Type Result);
+	
+	bool StartHoudiniEngine() const;
+	TArray<AHoudiniBuildManager*> FindBuildManagers(UWorld* World, const FString& ManagerName, const FString& GraphPath) const;
+	bool WaitForBuildManagers(UWorld* World, TConstArrayView<AHoudiniBuildManager*> BuildManagers) const;
+	bool SaveBuild(UWorld* World, TConstArrayView<AHoudiniBuildManager*> BuildManagers) const;
+	TArray<UPackage*> GetPackagesToSave(UWorld* World, TConstArrayView<AHoudiniBuildManager*> BuildManagers) const;
+
+	// Streaming builds. Like split builds, the nodes that don't build HDA actors run once before and once after the regions.
+	int32 RunStreaming(UWorld* World, TConstArrayView<AHoudiniBuildManager*> BuildManagers, const FString& Params);
+
+	// Split builds.
+	struct FCoordinatedManager;
+	int32 RunCoordinator(UWorld* World, TConstArrayView<AHoudiniBuildManager*> BuildManagers, const FString& MapPath, const FString& ManagerName, const FString& Params);
+	bool RunSharedNodes(UWorld* World, TConstArrayView<AHoudiniBuildManager*> BuildManagers, EHoudiniBuildShardNodes Nodes);
+	void FindResumePhase(TConstArrayView<AHoudiniBuildManager*> BuildManagers, int32 NumShards, bool& bOutRunSharedNodesBefore, bool& bOutRunShards) const;
+	bool RunWorkers(TArray<FCoordinatedManager>& Managers, int32 NumWorkers, const FString& MapPath, const FString& ManagerName, const FString& Params);
+	bool CheckWorkerSaves(int32 NumWorkers, bool& bOutConflict) const;
+	bool StartWorker(TConstArrayView<AHoudiniBuildManager*> BuildManagers, int32 ShardIndex);
+	bool WaitForSaveRelease(TConstArrayView<UPackage*> Packages) const;
+	void OnWorkerNodeEnded(AHoudiniBuildManager* BuildManager, int32 NodeIndex, UAutomationGraphNode* GraphNode, int32 ShardIndex) const;
+
+	// Packages of the next map that finished preloading.
+	UPROPERTY()
+	TArray<TObjectPtr<UPackage>> PreloadedPackages;
+
+	TSharedPtr<FHoudiniBuildShardQueue> ShardQueue;
+	int32 WorkerIndex = INDEX_NONE;
+	double TimeoutSec = 0.0;
+	bool bSave = true;
+	bool bSaveDuringRun = false;
+	bool bResume = false;
+};
@@ -0,0 +1,82 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Dom/JsonObject.h"
+
+struct FHoudiniBuildHistory;
+struct FHoudiniBuildShard;
+
+// The directory the coordinator and the workers of a split build talk through. Every message is a file, written under a
+// temporary name and then moved into place, so that the other side never reads half of one.
+//
+// Coordinator -> workers: which shard every actor belongs to, which nodes may start, whether they may save, and whether
+// to give up.
+// Workers -> coordinator: a report for each node that ended, the packages they are about to save, and the build
+// history recorded by each build manager.
+class FHoudiniBuildShardQueue
+{
+public:
+	explicit FHoudiniBuildShardQueue(const FString& InDirectory);
+
+	const FString& GetDirectory() const { return Directory; }
+	FString GetLogPath(int32 ShardIndex) const;
+
+	bool WriteAssignment(int32 Count, const TMap<FSoftObjectPath, int32>& Assignment) const;
+	bool ReadShard(int32 ShardIndex, FHoudiniBuildShard& OutShard) const;
+
+	void ReleaseNode(const FString& ManagerName, int32 NodeIndex) const;
+	bool IsNodeReleased(const FString& ManagerName, int32 NodeIndex) const;
+
+	bool WritePackages(int32 ShardIndex, TConstArrayView<FString> PackageNames) const;
+	bool ReadPackages(int32 ShardIndex, TArray<FString>& OutPackageNames) const;
+	void ReleaseSaves() const;
+	bool AreSavesReleased() const;
+
+	void Abort() const;
+	bool IsAborted() const;
+
+	bool WriteNodeReport(const FString& ManagerName, int32 NodeIndex, int32 ShardIndex, const TSharedRef<FJsonObject>& Report) const;
+	TSharedPtr<FJsonObject> ReadNodeReport(const FString& ManagerName, int32 NodeIndex, int32 ShardIndex) const;
+
+	bool WriteHistory(const FString& ManagerName, int32 ShardIndex, const FHoudiniBuildHistory& History) const;
+	bool ReadHistory(const FString& ManagerName, int32 ShardIndex, FHoudiniBuildHistory& OutHistory) const;
+
+	bool WriteReport(const TSharedRef<FJsonObject>& Report) const;
+
+protected:
+	FString GetNodePath(const FString& ManagerName, int32 NodeIndex, const FString& Suffix) const;
+	bool WriteFile(const FString& Path, const TArray<uint8>& Bytes) const;
+	bool WriteJson(const FString& Path, const TSharedRef<FJsonObject>& JsonObject) const;
+	TSharedPtr<FJsonObject> ReadJson(const FString& Path) const;
+
+	FString Directory;
+};
@@ -151,4 +151,8 @@ class UEdGraph_HoudiniBuildSequenceGraph : public UEdGraph
 public:
 	UHoudiniBuildSequenceGraph* GetBuildSequenceGraph();
 	void RebuildSequenceGraph();
+
+protected:
+	// Collects every parent -> child edge of the runtime graph, plus nullptr -> root for each root node.
+	void GatherTopology(TSet<TPair<const UAutomationGraphNode*, const UAutomationGraphNode*>>& OutEdges);
 };
@@ -0,0 +1,61 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "Foundation/HoudiniCookSession.h"
+
+#include <atomic>
+
+// The cook session managed by the Houdini Engine plugin, with the heartbeat and restart that need the editor-only
+// Houdini Engine module. Installed as the FHoudiniEngineCookSession factory on startup.
+//
+// The heartbeat asks the server whether the session is valid on a worker thread, since a stuck server never answers.
+// Each heartbeat reports the answer to the previous probe, or that the session is dead if that probe has been waiting
+// longer than houdini.CookSessions.HeartbeatTimeoutSec.
+class ENHANCEDHOUDINIENGINEEDITOR_API FHoudiniEngineEditorCookSession : public FHoudiniEngineCookSession
+{
+public:
+	virtual bool IsAlive() const override;
+	virtual bool Restart(TConstArrayView<UHoudiniBuildWorkItem*> Interrupted) override;
+
+protected:
+	// Shared with the worker thread, which may still be waiting on the server long after the session gave up on it.
+	struct FProbe
+	{
+		std::atomic<bool> bDone = false;
+		std::atomic<bool> bAlive = false;
+		double TimeStarted = 0.0;
+	};
+
+	mutable TSharedPtr<FProbe, ESPMode::ThreadSafe> Probe;
+	mutable bool bLastProbeAlive = true;
+};
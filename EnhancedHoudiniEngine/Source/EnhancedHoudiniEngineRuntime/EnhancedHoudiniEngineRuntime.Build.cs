@@ -82,7 +82,9 @@ public class EnhancedHoudiniEngineRuntime : ModuleRules
 			{
 				"CoreUObject",
 				"Engine",
+				"Json",
 				"Landscape",
+				"MeshDescription",
 				"Slate",
 				"SlateCore",
 			}
@@ -38,6 +38,7 @@
 UAGN_ClearLandscapeLayers::UAGN_ClearLandscapeLayers(const FObjectInitializer& Initializer): Super(Initializer)
 {
 	Title = FText::FromString("ClearLandscapeLayers");
+	bSkipWhenInputsUnchanged = false; // the nodes after this one expect to paint onto cleared layers.
 }
 
 bool UAGN_ClearLandscapeLayers::Activate()
@@ -86,4 +86,5 @@ bool UAGN_ConsoleCommandBase::Activate()
 UAGN_ConsoleCommand::UAGN_ConsoleCommand(const FObjectInitializer& Initializer) : Super(Initializer)
 {
 	Title = FText::FromString("Console Command");
+	bSkipWhenInputsUnchanged = false; // arbitrary commands can have side effects that don't depend on their inputs.
 }
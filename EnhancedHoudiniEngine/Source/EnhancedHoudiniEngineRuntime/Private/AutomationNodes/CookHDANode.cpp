@@ -30,6 +30,7 @@
 // ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "AutomationNodes/CookHDANode.h"
+#include "Foundation/HoudiniCookCache.h"
 #include "HoudiniEngineRuntime/Private/HoudiniAssetComponent.h"
 
 bool UHoudiniBuildWorkItem_Cook::BuildInternal(UHoudiniAssetComponent* AssetComponent)
@@ -48,3 +49,13 @@ UAGN_CookHDA::UAGN_CookHDA(const FObjectInitializer& Initializer): Super(Initial
 	Title = FText::FromString("CookHDA");
 	WorkItemClass = UHoudiniBuildWorkItem_Cook::StaticClass();
 }
+
+bool UAGN_CookHDA::ShouldUseCookCache() const
+{
+	return bUseCookCache && FHoudiniCookCache::Get().IsEnabled();
+}
+
+UHoudiniAsset* UAGN_CookHDA::GetBatchWrapperAsset(UHoudiniAsset* HoudiniAsset) const
+{
+	return BatchWrapperAssets.FindRef(HoudiniAsset);
+}
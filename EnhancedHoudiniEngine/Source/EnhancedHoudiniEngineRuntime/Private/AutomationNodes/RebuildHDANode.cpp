@@ -30,6 +30,7 @@
 // ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "AutomationNodes/RebuildHDANode.h"
+#include "EHERuntimeLoggingDefs.h"
 #include "HoudiniEngineRuntime/Private/HoudiniAssetComponent.h"
 
 bool UHoudiniBuildWorkItem_Rebuild::BuildInternal(UHoudiniAssetComponent* AssetComponent)
@@ -39,7 +40,17 @@ bool UHoudiniBuildWorkItem_Rebuild::BuildInternal(UHoudiniAssetComponent* AssetC
 		return false;
 	}
 
-	AssetComponent->MarkAsNeedRebuild();
+	auto* RebuildNode = Cast<UAGN_RebuildHDA>(Owner);
+	bDowngradedToCook = RebuildNode && RebuildNode->bSmartRebuild && IsDefinitionUnchanged();
+	if (bDowngradedToCook)
+	{
+		UE_LOG(LogEHERuntime, Verbose, TEXT("UHoudiniBuildWorkItem_Rebuild: definition of %s is unchanged, cooking instead."), *GetNameSafe(ToBuild.Get()));
+		AssetComponent->MarkAsNeedCook();
+	}
+	else
+	{
+		AssetComponent->MarkAsNeedRebuild();
+	}
 	return true;
 }
 
@@ -48,3 +59,19 @@ UAGN_RebuildHDA::UAGN_RebuildHDA(const FObjectInitializer& Initializer): Super(I
 	Title = FText::FromString("RebuildHDA");
 	WorkItemClass = UHoudiniBuildWorkItem_Rebuild::StaticClass();
 }
+
+FString UAGN_RebuildHDA::GetMessageText()
+{
+	int32 NumDowngraded = 0;
+	for (UHoudiniBuildWorkItem* WorkItem : WorkItems)
+	{
+		auto* RebuildWorkItem = Cast<UHoudiniBuildWorkItem_Rebuild>(WorkItem);
+		NumDowngraded += RebuildWorkItem && RebuildWorkItem->GetBuildState() == EEHEBuildState::Finished && RebuildWorkItem->WasDowngradedToCook() ? 1 : 0;
+	}
+
+	if (GetState() == EAutomationGraphNodeState::Finished && NumDowngraded > 0)
+	{
+		return FString::Printf(TEXT("%s\n%d/%d Cooked (Definition Unchanged)"), *Super::GetMessageText(), NumDowngraded, WorkItems.Num());
+	}
+	return Super::GetMessageText();
+}
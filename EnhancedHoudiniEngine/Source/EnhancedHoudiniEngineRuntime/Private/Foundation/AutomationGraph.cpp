@@ -31,24 +31,181 @@
 
 #include "Foundation/AutomationGraph.h"
 
-void UAutomationGraph::Reset()
+void FAutomationGraphPlan::Compile(const TArray<TObjectPtr<UAutomationGraphNode>>& RootNodes)
 {
-	TArray<TObjectPtr<UAutomationGraphNode>> NodeStack;
-	TSet<TObjectPtr<UAutomationGraphNode>> Visited;
-
-	NodeStack.Append(RootNodes);
+	*this = FAutomationGraphPlan();
+	
+	// Gather every node connected to the roots. Parents are followed as well, so a node with a parent that can't be
+	// reached from the roots (i.e. one that sits on a cycle) still ends up in the plan and gets caught below.
+	TArray<UAutomationGraphNode*> Discovered;
+	TMap<const UAutomationGraphNode*, int32> DiscoveredIndices;
+	TArray<UAutomationGraphNode*> NodeStack;
 
+	for (UAutomationGraphNode* RootNode : RootNodes)
+	{
+		NodeStack.Add(RootNode);
+	}
 	while (!NodeStack.IsEmpty())
 	{
-		TObjectPtr<UAutomationGraphNode> SequenceNode = NodeStack.Pop();
-
-		if (Visited.Contains(SequenceNode))
+		UAutomationGraphNode* GraphNode = NodeStack.Pop();
+		if (!GraphNode || DiscoveredIndices.Contains(GraphNode))
 		{
 			continue;
 		}
 
-		Visited.Add(SequenceNode);
-		SequenceNode->Reset();
-		NodeStack.Append(SequenceNode->ChildNodes);
+		DiscoveredIndices.Add(GraphNode, Discovered.Num());
+		Discovered.Add(GraphNode);
+		
+		for (UAutomationGraphNode* ChildNode : GraphNode->ChildNodes)
+		{
+			NodeStack.Add(ChildNode);
+		}
+		for (UAutomationGraphNode* ParentNode : GraphNode->ParentNodes)
+		{
+			NodeStack.Add(ParentNode);
+		}
+	}
+
+	const int32 NumNodes = Discovered.Num();
+	
+	// Edges are taken from ChildNodes only, and the parent lists are derived from them, so the two always agree.
+	TArray<TArray<int32>> DiscoveredChildren;
+	DiscoveredChildren.SetNum(NumNodes);
+	TArray<int32> DiscoveredInDegrees;
+	DiscoveredInDegrees.SetNumZeroed(NumNodes);
+	
+	for (int32 NodeIndex = 0; NodeIndex < NumNodes; ++NodeIndex)
+	{
+		for (UAutomationGraphNode* ChildNode : Discovered[NodeIndex]->ChildNodes)
+		{
+			const int32* ChildIndex = DiscoveredIndices.Find(ChildNode);
+			if (ChildIndex && !DiscoveredChildren[NodeIndex].Contains(*ChildIndex))
+			{
+				DiscoveredChildren[NodeIndex].Add(*ChildIndex);
+				DiscoveredInDegrees[*ChildIndex]++;
+			}
+		}
+	}
+
+	// Kahn's algorithm. Anything that never reaches an in-degree of zero is part of (or downstream of) a cycle.
+	TArray<int32> TopologicalOrder;
+	TopologicalOrder.Reserve(NumNodes);
+	TArray<int32> RemainingInDegrees = DiscoveredInDegrees;
+	
+	for (int32 NodeIndex = 0; NodeIndex < NumNodes; ++NodeIndex)
+	{
+		if (RemainingInDegrees[NodeIndex] == 0)
+		{
+			TopologicalOrder.Add(NodeIndex);
+		}
+	}
+	for (int32 OrderIndex = 0; OrderIndex < TopologicalOrder.Num(); ++OrderIndex)
+	{
+		for (int32 ChildIndex : DiscoveredChildren[TopologicalOrder[OrderIndex]])
+		{
+			if (--RemainingInDegrees[ChildIndex] == 0)
+			{
+				TopologicalOrder.Add(ChildIndex);
+			}
+		}
+	}
+
+	bHasCycle = TopologicalOrder.Num() != NumNodes;
+	if (bHasCycle)
+	{
+		// Keep the plan complete so it can still be inspected, the leftovers just go at the end.
+		for (int32 NodeIndex = 0; NodeIndex < NumNodes; ++NodeIndex)
+		{
+			if (RemainingInDegrees[NodeIndex] > 0)
+			{
+				TopologicalOrder.Add(NodeIndex);
+			}
+		}
+	}
+
+	// Re-index everything so that plan indices follow the topological order.
+	TArray<int32> PlanIndexByDiscovered;
+	PlanIndexByDiscovered.SetNumUninitialized(NumNodes);
+	for (int32 PlanIndex = 0; PlanIndex < NumNodes; ++PlanIndex)
+	{
+		PlanIndexByDiscovered[TopologicalOrder[PlanIndex]] = PlanIndex;
 	}
-}
\ No newline at end of file
+
+	Nodes.Reserve(NumNodes);
+	NodeIndices.Reserve(NumNodes);
+	InDegrees.SetNumUninitialized(NumNodes);
+	ChildOffsets.SetNumUninitialized(NumNodes + 1);
+	ParentOffsets.SetNumZeroed(NumNodes + 1);
+
+	ChildOffsets[0] = 0;
+	for (int32 PlanIndex = 0; PlanIndex < NumNodes; ++PlanIndex)
+	{
+		const int32 DiscoveredIndex = TopologicalOrder[PlanIndex];
+		
+		Nodes.Add(Discovered[DiscoveredIndex]);
+		NodeIndices.Add(Discovered[DiscoveredIndex], PlanIndex);
+		InDegrees[PlanIndex] = DiscoveredInDegrees[DiscoveredIndex];
+		if (InDegrees[PlanIndex] == 0)
+		{
+			RootIndices.Add(PlanIndex);
+		}
+
+		for (int32 ChildDiscoveredIndex : DiscoveredChildren[DiscoveredIndex])
+		{
+			const int32 ChildPlanIndex = PlanIndexByDiscovered[ChildDiscoveredIndex];
+			ChildIndices.Add(ChildPlanIndex);
+			ParentOffsets[ChildPlanIndex + 1]++;
+		}
+		ChildOffsets[PlanIndex + 1] = ChildIndices.Num();
+	}
+
+	// Transpose the child lists into parent lists.
+	for (int32 PlanIndex = 0; PlanIndex < NumNodes; ++PlanIndex)
+	{
+		ParentOffsets[PlanIndex + 1] += ParentOffsets[PlanIndex];
+	}
+	ParentIndices.SetNumUninitialized(ChildIndices.Num());
+	TArray<int32> ParentCursors(ParentOffsets.GetData(), NumNodes);
+	for (int32 PlanIndex = 0; PlanIndex < NumNodes; ++PlanIndex)
+	{
+		for (int32 ChildPlanIndex : GetChildren(PlanIndex))
+		{
+			ParentIndices[ParentCursors[ChildPlanIndex]++] = PlanIndex;
+		}
+	}
+}
+
+int32 FAutomationGraphPlan::IndexOf(const UAutomationGraphNode* GraphNode) const
+{
+	const int32* NodeIndex = NodeIndices.Find(GraphNode);
+	return NodeIndex ? *NodeIndex : INDEX_NONE;
+}
+
+void UAutomationGraph::Reset()
+{
+	TSharedRef<const FAutomationGraphPlan> Plan = GetPlan();
+	for (UAutomationGraphNode* GraphNode : Plan->Nodes)
+	{
+		GraphNode->Reset();
+	}
+}
+
+TSharedRef<const FAutomationGraphPlan> UAutomationGraph::GetPlan()
+{
+	if (!CachedPlan.IsValid())
+	{
+		TSharedRef<FAutomationGraphPlan> NewPlan = MakeShared<FAutomationGraphPlan>();
+		NewPlan->Compile(RootNodes);
+		CachedPlan = NewPlan;
+	}
+
+	return CachedPlan.ToSharedRef();
+}
+
+#if WITH_EDITOR
+void UAutomationGraph::PostEditUndo()
+{
+	Super::PostEditUndo();
+	InvalidatePlan();
+}
+#endif
@@ -43,8 +43,8 @@ bool UAutomationGraphNode::CanActivate()
 		return true;
 	}
 
-	// Note: This is a bit inefficient since we will most likely be calling CanActivate() on multiple children pointing
-	//       to the same parent. At some point it might be worth setting up some kind of caching for the parent State.
+	// Note: This scans every parent. The build manager doesn't use this, it counts down the remaining parents of each
+	//       node using the graph's compiled FAutomationGraphPlan instead.
 	for (TObjectPtr<UAutomationGraphNode> ParentNode : ParentNodes)
 	{
 		if (ParentNode->GetState() != EAutomationGraphNodeState::Finished)
@@ -85,6 +85,7 @@ void UAutomationGraphNode::Reset()
 
 void UAutomationGraphNode::SetState(EAutomationGraphNodeState NewState)
 {
+	const bool bStateChanged = NodeState != NewState;
 	NodeState = NewState;
 
 	switch (NodeState)
@@ -93,9 +94,11 @@ void UAutomationGraphNode::SetState(EAutomationGraphNodeState NewState)
 	case EAutomationGraphNodeState::Standby:
 		TimeStarted = 0.0;
 		TimeFinished = 0.0;
+		bFinishedUpToDate = false;
 		break;
 	case EAutomationGraphNodeState::Active:
 		TimeStarted = FPlatformTime::Seconds();
+		bFinishedUpToDate = false;
 		break;
 	case EAutomationGraphNodeState::Finished:
 	case EAutomationGraphNodeState::Error:
@@ -105,6 +108,23 @@ void UAutomationGraphNode::SetState(EAutomationGraphNodeState NewState)
 	default:
 		break;
 	}
+
+	if (bStateChanged)
+	{
+		OnStateChanged.Broadcast(this, NodeState);
+	}
+}
+
+void UAutomationGraphNode::FinishUpToDate()
+{
+	if (NodeState != EAutomationGraphNodeState::Standby)
+	{
+		return;
+	}
+
+	TimeStarted = FPlatformTime::Seconds();
+	bFinishedUpToDate = true;
+	SetState(EAutomationGraphNodeState::Finished);
 }
 
 FLinearColor UAutomationGraphNode::GetStateColor()
@@ -138,6 +158,10 @@ FString UAutomationGraphNode::GetMessageText()
 		ActiveTime = FPlatformTime::Seconds() - TimeStarted;
 		return FString::Printf(TEXT("Active for %.2lf Seconds"), ActiveTime); 
 	case EAutomationGraphNodeState::Finished:
+		if (bFinishedUpToDate)
+		{
+			return FString("Up To Date.");
+		}
 		TotalTime = TimeFinished - TimeStarted;
 		return FString::Printf(TEXT("Finished in %.2lf Seconds"), TotalTime); 
 	case EAutomationGraphNodeState::Expired:
@@ -0,0 +1,327 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/HoudiniAssetActorIndex.h"
+
+#include "EHERuntimeLoggingDefs.h"
+#include "HoudiniAssetActor.h"
+#include "Engine/Level.h"
+#include "HoudiniEngineRuntime/Private/HoudiniAssetComponent.h"
+
+#if WITH_EDITOR
+#include "Engine/Engine.h"
+#endif
+
+UHoudiniAssetActorIndex* UHoudiniAssetActorIndex::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UHoudiniAssetActorIndex>() : nullptr;
+}
+
+void UHoudiniAssetActorIndex::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UWorld* World = GetWorld();
+	ActorSpawnedHandle = World->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &ThisClass::OnActorSpawned));
+	ActorDestroyedHandle = World->AddOnActorDestroyedHandler(FOnActorDestroyed::FDelegate::CreateUObject(this, &ThisClass::OnActorDestroyed));
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &ThisClass::OnLevelChanged);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &ThisClass::OnLevelChanged);
+	
+#if WITH_EDITOR
+	// Editor operations (placing, pasting, deleting actors) don't always go through the world spawn/destroy handlers.
+	if (GEngine)
+	{
+		LevelActorAddedHandle = GEngine->OnLevelActorAdded().AddUObject(this, &ThisClass::UpdateActor);
+		LevelActorDeletedHandle = GEngine->OnLevelActorDeleted().AddUObject(this, &ThisClass::RemoveActor);
+	}
+	ObjectPropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddUObject(this, &ThisClass::OnObjectPropertyChanged);
+#endif
+}
+
+void UHoudiniAssetActorIndex::Deinitialize()
+{
+	if (UWorld* World = GetWorld())
+	{
+		World->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+		World->RemoveOnActorDestroyedHandler(ActorDestroyedHandle);
+	}
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+	
+#if WITH_EDITOR
+	if (GEngine)
+	{
+		GEngine->OnLevelActorAdded().Remove(LevelActorAddedHandle);
+		GEngine->OnLevelActorDeleted().Remove(LevelActorDeletedHandle);
+	}
+	FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(ObjectPropertyChangedHandle);
+#endif
+
+	Invalidate();
+	Super::Deinitialize();
+}
+
+TArray<AHoudiniAssetActor*> UHoudiniAssetActorIndex::GetActorsWithTag(FName ActorTag)
+{
+	EnsureBuilt();
+	
+	TArray<AHoudiniAssetActor*> ToReturn;
+	if (const TSet<TWeakObjectPtr<AHoudiniAssetActor>>* TaggedActors = ActorsByTag.Find(ActorTag))
+	{
+		ToReturn.Reserve(TaggedActors->Num());
+		for (const TWeakObjectPtr<AHoudiniAssetActor>& WeakActor : *TaggedActors)
+		{
+			// Tags can be changed from code without any event firing, so double check before handing the actor out.
+			AHoudiniAssetActor* AssetActor = WeakActor.Get();
+			if (IsValid(AssetActor) && AssetActor->Tags.Contains(ActorTag))
+			{
+				ToReturn.Add(AssetActor);
+			}
+		}
+	}
+
+	return ToReturn;
+}
+
+TArray<AHoudiniAssetActor*> UHoudiniAssetActorIndex::GetActorsOfAsset(const UHoudiniAsset* AssetType)
+{
+	EnsureBuilt();
+	
+	TArray<AHoudiniAssetActor*> ToReturn;
+	if (const TSet<TWeakObjectPtr<AHoudiniAssetActor>>* AssetActors = ActorsByAsset.Find(TObjectKey<UHoudiniAsset>(AssetType)))
+	{
+		ToReturn.Reserve(AssetActors->Num());
+		for (const TWeakObjectPtr<AHoudiniAssetActor>& WeakActor : *AssetActors)
+		{
+			AHoudiniAssetActor* AssetActor = WeakActor.Get();
+			UHoudiniAssetComponent* AssetComponent = IsValid(AssetActor) ? AssetActor->GetHoudiniAssetComponent() : nullptr;
+			if (AssetComponent && AssetComponent->GetHoudiniAsset() == AssetType)
+			{
+				ToReturn.Add(AssetActor);
+			}
+		}
+	}
+
+	return ToReturn;
+}
+
+void UHoudiniAssetActorIndex::UpdateActor(AActor* Actor)
+{
+	auto* AssetActor = Cast<AHoudiniAssetActor>(Actor);
+	if (!AssetActor || !bIsBuilt)
+	{
+		// If the index hasn't been built yet, the actor will be picked up by the initial scan.
+		return;
+	}
+	if (AssetActor->GetWorld() != GetWorld())
+	{
+		return;
+	}
+
+	RemoveActor(AssetActor);
+	if (IsValid(AssetActor))
+	{
+		AddEntry(AssetActor, MakeEntry(AssetActor));
+	}
+}
+
+void UHoudiniAssetActorIndex::RemoveActor(AActor* Actor)
+{
+	auto* AssetActor = Cast<AHoudiniAssetActor>(Actor);
+	if (!AssetActor)
+	{
+		return;
+	}
+
+	FHoudiniAssetActorIndexEntry Entry;
+	if (!Entries.RemoveAndCopyValue(AssetActor, Entry))
+	{
+		return;
+	}
+
+	for (FName ActorTag : Entry.Tags)
+	{
+		if (TSet<TWeakObjectPtr<AHoudiniAssetActor>>* TaggedActors = ActorsByTag.Find(ActorTag))
+		{
+			TaggedActors->Remove(AssetActor);
+		}
+	}
+	if (TSet<TWeakObjectPtr<AHoudiniAssetActor>>* AssetActors = ActorsByAsset.Find(Entry.Asset))
+	{
+		AssetActors->Remove(AssetActor);
+	}
+}
+
+void UHoudiniAssetActorIndex::Invalidate()
+{
+	Entries.Empty();
+	ActorsByTag.Empty();
+	ActorsByAsset.Empty();
+	bIsBuilt = false;
+}
+
+void UHoudiniAssetActorIndex::EnsureBuilt()
+{
+	if (bIsBuilt)
+	{
+		return;
+	}
+
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	const double TimeStarted = FPlatformTime::Seconds();
+	
+	// Reading actors and their components isn't safe off the game thread, so this is one pass over every level. It only
+	// has to happen once per world, after that the index is kept up to date by the world and editor events.
+	bIsBuilt = true;
+	
+	int32 NumActors = 0;
+	for (ULevel* Level : World->GetLevels())
+	{
+		if (!Level)
+		{
+			continue;
+		}
+		for (AActor* Actor : Level->Actors)
+		{
+			auto* AssetActor = Cast<AHoudiniAssetActor>(Actor);
+			if (IsValid(AssetActor))
+			{
+				AddEntry(AssetActor, MakeEntry(AssetActor));
+				NumActors++;
+			}
+		}
+	}
+
+	UE_LOG(LogEHERuntime, Log, TEXT("Indexed %d houdini asset actors in %.2lf seconds."), NumActors, FPlatformTime::Seconds() - TimeStarted);
+}
+
+void UHoudiniAssetActorIndex::AddEntry(AHoudiniAssetActor* AssetActor, FHoudiniAssetActorIndexEntry&& Entry)
+{
+	for (FName ActorTag : Entry.Tags)
+	{
+		ActorsByTag.FindOrAdd(ActorTag).Add(AssetActor);
+	}
+	if (Entry.Asset != TObjectKey<UHoudiniAsset>())
+	{
+		ActorsByAsset.FindOrAdd(Entry.Asset).Add(AssetActor);
+	}
+
+	Entries.Add(AssetActor, MoveTemp(Entry));
+}
+
+FHoudiniAssetActorIndexEntry UHoudiniAssetActorIndex::MakeEntry(AHoudiniAssetActor* AssetActor)
+{
+	FHoudiniAssetActorIndexEntry Entry;
+	Entry.Tags = AssetActor->Tags;
+
+	UHoudiniAssetComponent* AssetComponent = AssetActor->GetHoudiniAssetComponent();
+	if (AssetComponent)
+	{
+		Entry.Asset = TObjectKey<UHoudiniAsset>(AssetComponent->GetHoudiniAsset());
+	}
+
+	return Entry;
+}
+
+void UHoudiniAssetActorIndex::OnActorSpawned(AActor* Actor)
+{
+	UpdateActor(Actor);
+}
+
+void UHoudiniAssetActorIndex::OnActorDestroyed(AActor* Actor)
+{
+	RemoveActor(Actor);
+}
+
+void UHoudiniAssetActorIndex::OnLevelChanged(ULevel* Level, UWorld* World)
+{
+	if (World != GetWorld() || !Level || !bIsBuilt)
+	{
+		return;
+	}
+
+	// Streaming levels come and go as a whole, so just index (or drop) their actors directly.
+	const bool bLevelAdded = World->GetLevels().Contains(Level);
+	for (AActor* Actor : Level->Actors)
+	{
+		if (bLevelAdded)
+		{
+			UpdateActor(Actor);
+		}
+		else
+		{
+			RemoveActor(Actor);
+		}
+	}
+}
+
+#if WITH_EDITOR
+void UHoudiniAssetActorIndex::OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent)
+{
+	if (!bIsBuilt)
+	{
+		return;
+	}
+	
+	// Covers both tag edits on the actor and asset changes on its houdini asset component.
+	if (auto* AssetActor = Cast<AHoudiniAssetActor>(Object))
+	{
+		UpdateActor(AssetActor);
+	}
+	else if (auto* AssetComponent = Cast<UHoudiniAssetComponent>(Object))
+	{
+		UpdateActor(AssetComponent->GetOwner());
+	}
+}
+#endif
+
+// CONSOLE COMMANDS ----------------------------------------------------------------------------------------------------
+FAutoConsoleCommandWithWorldAndArgs GHoudiniBuildManagerRebuildActorIndexCmd(
+	TEXT("houdini.BuildManager.RebuildActorIndex"),
+	TEXT("Throws away the houdini asset actor index used by HoudiniBuildManagers. It is rebuilt on the next run."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(
+		[](const TArray<FString>& Args, UWorld* World)
+		{
+			if (UHoudiniAssetActorIndex* ActorIndex = UHoudiniAssetActorIndex::Get(World))
+			{
+				ActorIndex->Invalidate();
+			}
+		}
+	)
+);
+
+// END CONSOLE COMMANDS ------------------------------------------------------------------------------------------------
\ No newline at end of file
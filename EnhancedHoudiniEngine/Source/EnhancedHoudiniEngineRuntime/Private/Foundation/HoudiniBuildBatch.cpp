@@ -0,0 +1,403 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/HoudiniBuildBatch.h"
+
+#include "EHERuntimeLoggingDefs.h"
+#include "HoudiniAssetActor.h"
+#include "Components/StaticMeshComponent.h"
+#include "Dom/JsonObject.h"
+#include "Engine/StaticMesh.h"
+#include "Foundation/HoudiniBuildInputs.h"
+#include "Foundation/HoudiniBuildSequenceNode.h"
+#include "Foundation/HoudiniCookCache.h"
+#include "HoudiniEngineRuntime/Private/HoudiniAssetComponent.h"
+#include "HoudiniEngineRuntime/Private/HoudiniOutput.h"
+#include "HoudiniEngineRuntime/Private/HoudiniParameter.h"
+#include "HoudiniEngineRuntime/Private/HoudiniParameterChoice.h"
+#include "HoudiniEngineRuntime/Private/HoudiniParameterColor.h"
+#include "HoudiniEngineRuntime/Private/HoudiniParameterFloat.h"
+#include "HoudiniEngineRuntime/Private/HoudiniParameterInt.h"
+#include "HoudiniEngineRuntime/Private/HoudiniParameterString.h"
+#include "HoudiniEngineRuntime/Private/HoudiniParameterToggle.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	const TCHAR* InstanceTableParameterName = TEXT("eh_batch_instances");
+	const TCHAR* OutputNameAttribute = TEXT("unreal_output_name");
+
+	FString GetOutputName(int32 InstanceIndex)
+	{
+		return FString::Printf(TEXT("eh_batch_%d"), InstanceIndex);
+	}
+
+	TSharedPtr<FJsonValue> MakeNumberArray(std::initializer_list<double> Numbers)
+	{
+		TArray<TSharedPtr<FJsonValue>> Values;
+		for (double Number : Numbers)
+		{
+			Values.Add(MakeShared<FJsonValueNumber>(Number));
+		}
+		return MakeShared<FJsonValueArray>(Values);
+	}
+
+	// Writes the value of every parameter of AssetComponent by name. Returns false if one of them can't be written.
+	bool WriteParameters(UHoudiniAssetComponent* AssetComponent, FJsonObject& OutParameters)
+	{
+		for (int32 ParameterIndex = 0; ParameterIndex < AssetComponent->GetNumParameters(); ++ParameterIndex)
+		{
+			UHoudiniParameter* Parameter = AssetComponent->GetParameterAt(ParameterIndex);
+			if (!Parameter)
+			{
+				continue;
+			}
+
+			TArray<TSharedPtr<FJsonValue>> Values;
+			switch (Parameter->GetParameterType())
+			{
+			case EHoudiniParameterType::Float:
+			{
+				UHoudiniParameterFloat* FloatParameter = CastChecked<UHoudiniParameterFloat>(Parameter);
+				for (int32 ValueIndex = 0; ValueIndex < FloatParameter->GetNumberOfValues(); ++ValueIndex)
+				{
+					Values.Add(MakeShared<FJsonValueNumber>(FloatParameter->GetValue(ValueIndex).Get(0.0f)));
+				}
+				break;
+			}
+			case EHoudiniParameterType::Int:
+			{
+				UHoudiniParameterInt* IntParameter = CastChecked<UHoudiniParameterInt>(Parameter);
+				for (int32 ValueIndex = 0; ValueIndex < IntParameter->GetNumberOfValues(); ++ValueIndex)
+				{
+					Values.Add(MakeShared<FJsonValueNumber>(IntParameter->GetValue(ValueIndex).Get(0)));
+				}
+				break;
+			}
+			case EHoudiniParameterType::String:
+			{
+				UHoudiniParameterString* StringParameter = CastChecked<UHoudiniParameterString>(Parameter);
+				for (int32 ValueIndex = 0; ValueIndex < StringParameter->GetNumberOfValues(); ++ValueIndex)
+				{
+					Values.Add(MakeShared<FJsonValueString>(StringParameter->GetValueAt(ValueIndex)));
+				}
+				break;
+			}
+			case EHoudiniParameterType::Toggle:
+			{
+				UHoudiniParameterToggle* ToggleParameter = CastChecked<UHoudiniParameterToggle>(Parameter);
+				for (int32 ValueIndex = 0; ValueIndex < ToggleParameter->GetTupleSize(); ++ValueIndex)
+				{
+					Values.Add(MakeShared<FJsonValueNumber>(ToggleParameter->GetValueAt(ValueIndex) ? 1 : 0));
+				}
+				break;
+			}
+			case EHoudiniParameterType::IntChoice:
+			{
+				UHoudiniParameterChoice* ChoiceParameter = CastChecked<UHoudiniParameterChoice>(Parameter);
+				Values.Add(MakeShared<FJsonValueNumber>(ChoiceParameter->GetIntValue(ChoiceParameter->GetIntValueIndex())));
+				break;
+			}
+			case EHoudiniParameterType::StringChoice:
+			{
+				UHoudiniParameterChoice* ChoiceParameter = CastChecked<UHoudiniParameterChoice>(Parameter);
+				Values.Add(MakeShared<FJsonValueString>(ChoiceParameter->GetStringValue()));
+				break;
+			}
+			case EHoudiniParameterType::Color:
+			{
+				const FLinearColor Color = CastChecked<UHoudiniParameterColor>(Parameter)->GetColorValue();
+				Values = MakeNumberArray({ Color.R, Color.G, Color.B, Color.A })->AsArray();
+				break;
+			}
+			case EHoudiniParameterType::Button:
+			case EHoudiniParameterType::ButtonStrip:
+			case EHoudiniParameterType::Folder:
+			case EHoudiniParameterType::FolderList:
+			case EHoudiniParameterType::Input:
+			case EHoudiniParameterType::Label:
+			case EHoudiniParameterType::Separator:
+				// These don't hold a value.
+				continue;
+			default:
+				// Ramps, multiparms, asset references... would need a richer table than the wrapper can take.
+				return false;
+			}
+
+			OutParameters.SetArrayField(Parameter->GetParameterName(), Values);
+		}
+		return true;
+	}
+}
+
+bool UHoudiniBuildBatch::CanBatch(AHoudiniAssetActor* AssetActor)
+{
+	UHoudiniAssetComponent* AssetComponent = IsValid(AssetActor) ? AssetActor->GetHoudiniAssetComponent() : nullptr;
+	if (!AssetComponent || !AssetComponent->GetHoudiniAsset())
+	{
+		return false;
+	}
+
+	// The table only carries parameter values. Anything plugged into an input would have to go through it as well.
+	TArray<UObject*> InputObjects;
+	FHoudiniBuildInputs::GetInputObjects(AssetComponent, InputObjects);
+	if (!InputObjects.IsEmpty())
+	{
+		return false;
+	}
+
+	FJsonObject Parameters;
+	return WriteParameters(AssetComponent, Parameters);
+}
+
+void UHoudiniBuildBatch::Initialize(UHoudiniAsset* InWrapperAsset, TConstArrayView<UHoudiniBuildWorkItem*> InWorkItems)
+{
+	WrapperAsset = InWrapperAsset;
+	WorkItems.Reset();
+	for (UHoudiniBuildWorkItem* WorkItem : InWorkItems)
+	{
+		WorkItems.Add(WorkItem);
+		WorkItem->SetBatch(this);
+	}
+}
+
+bool UHoudiniBuildBatch::Start()
+{
+	UHoudiniBuildWorkItem* Leader = GetLeader();
+	UHoudiniBuildSequenceNode* Owner = Leader ? Leader->GetOwner() : nullptr;
+	if (!Owner || !WrapperAsset)
+	{
+		return false;
+	}
+
+	bool bSpawned = false;
+	AHoudiniAssetActor* NewWrapperActor = Owner->AcquireBatchWrapperActor(Leader->GetWorld(), WrapperAsset, bSpawned);
+	UHoudiniAssetComponent* WrapperComponent = NewWrapperActor ? NewWrapperActor->GetHoudiniAssetComponent() : nullptr;
+	if (!WrapperComponent)
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildBatch::Start() failed to create a wrapper actor for %s"), *WrapperAsset->GetName());
+		return false;
+	}
+
+	WrapperActor = NewWrapperActor;
+	bWaitingForInstantiation = bSpawned;
+	PostOutputProcessingDelegateHandle = WrapperComponent->GetOnPostOutputProcessingDelegate().AddUObject(this, &ThisClass::OnWrapperPostProcess);
+
+	if (!bWaitingForInstantiation && !SetInstanceTable(WrapperComponent))
+	{
+		ReleaseWrapperActor();
+		return false;
+	}
+
+	bStarted = true;
+	UE_LOG(LogEHERuntime, Verbose, TEXT("UHoudiniBuildBatch: cooking %d actors in one cook of %s."), WorkItems.Num(), *WrapperAsset->GetName());
+	return true;
+}
+
+void UHoudiniBuildBatch::BeginDestroy()
+{
+	AHoudiniAssetActor* CurrentWrapperActor = WrapperActor.Get();
+	UHoudiniAssetComponent* WrapperComponent = CurrentWrapperActor ? CurrentWrapperActor->GetHoudiniAssetComponent() : nullptr;
+	if (WrapperComponent && PostOutputProcessingDelegateHandle.IsValid())
+	{
+		WrapperComponent->GetOnPostOutputProcessingDelegate().Remove(PostOutputProcessingDelegateHandle);
+		PostOutputProcessingDelegateHandle.Reset();
+	}
+	
+	Super::BeginDestroy();
+}
+
+bool UHoudiniBuildBatch::SetInstanceTable(UHoudiniAssetComponent* WrapperComponent)
+{
+	UHoudiniParameterString* TableParameter = Cast<UHoudiniParameterString>(WrapperComponent->FindParameterByName(InstanceTableParameterName));
+	if (!TableParameter)
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildBatch::SetInstanceTable() wrapper HDA %s has no '%s' string parameter"), *GetNameSafe(WrapperAsset), InstanceTableParameterName);
+		return false;
+	}
+
+	TArray<TSharedPtr<FJsonValue>> Entries;
+	for (int32 InstanceIndex = 0; InstanceIndex < WorkItems.Num(); ++InstanceIndex)
+	{
+		AHoudiniAssetActor* AssetActor = WorkItems[InstanceIndex] ? WorkItems[InstanceIndex]->GetAssetActor().Get() : nullptr;
+		UHoudiniAssetComponent* AssetComponent = AssetActor ? AssetActor->GetHoudiniAssetComponent() : nullptr;
+		TSharedRef<FJsonObject> Parameters = MakeShared<FJsonObject>();
+		if (!AssetComponent || !WriteParameters(AssetComponent, *Parameters))
+		{
+			UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildBatch::SetInstanceTable() can't write the parameters of %s"), *GetNameSafe(AssetActor));
+			return false;
+		}
+
+		const FTransform Transform = AssetComponent->GetComponentTransform();
+		const FVector Translation = Transform.GetTranslation();
+		const FQuat Rotation = Transform.GetRotation();
+		const FVector Scale = Transform.GetScale3D();
+		TSharedRef<FJsonObject> TransformObject = MakeShared<FJsonObject>();
+		TransformObject->SetField(TEXT("translate"), MakeNumberArray({ Translation.X, Translation.Y, Translation.Z }));
+		TransformObject->SetField(TEXT("rotate"), MakeNumberArray({ Rotation.X, Rotation.Y, Rotation.Z, Rotation.W }));
+		TransformObject->SetField(TEXT("scale"), MakeNumberArray({ Scale.X, Scale.Y, Scale.Z }));
+
+		TSharedRef<FJsonObject> Entry = MakeShared<FJsonObject>();
+		Entry->SetNumberField(TEXT("index"), InstanceIndex);
+		Entry->SetStringField(TEXT("output_name"), GetOutputName(InstanceIndex));
+		Entry->SetStringField(TEXT("actor"), AssetActor->GetName());
+		Entry->SetObjectField(TEXT("transform"), TransformObject);
+		Entry->SetObjectField(TEXT("parms"), Parameters);
+		Entries.Add(MakeShared<FJsonValueObject>(Entry));
+	}
+
+	FString Table;
+	TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Table);
+	if (!FJsonSerializer::Serialize(Entries, Writer))
+	{
+		return false;
+	}
+
+	TableParameter->SetValueAt(Table, 0);
+	TableParameter->MarkChanged(true);
+	WrapperComponent->MarkAsNeedCook();
+	return true;
+}
+
+void UHoudiniBuildBatch::OnWrapperPostProcess(UHoudiniAssetComponent* WrapperComponent, bool bSucceeded)
+{
+	UHoudiniBuildWorkItem* Leader = GetLeader();
+	if (!Leader || Leader->GetBuildState() != EEHEBuildState::Building)
+	{
+		// The leader expired or failed while the wrapper was cooking. Nobody is waiting for the result anymore.
+		ReleaseWrapperActor();
+		return;
+	}
+
+	if (bWaitingForInstantiation)
+	{
+		bWaitingForInstantiation = false;
+		if (bSucceeded && SetInstanceTable(WrapperComponent))
+		{
+			return;
+		}
+		bSucceeded = false;
+	}
+
+	Split(WrapperComponent, bSucceeded);
+}
+
+void UHoudiniBuildBatch::Split(UHoudiniAssetComponent* WrapperComponent, bool bSucceeded)
+{
+	TMap<FString, UStaticMesh*> Results;
+	if (bSucceeded)
+	{
+		for (int32 OutputIndex = 0; OutputIndex < WrapperComponent->GetNumOutputs(); ++OutputIndex)
+		{
+			UHoudiniOutput* Output = WrapperComponent->GetOutputAt(OutputIndex);
+			if (!Output)
+			{
+				continue;
+			}
+			
+			for (auto& OutputObjectPair : Output->GetOutputObjects())
+			{
+				const FHoudiniOutputObject& OutputObject = OutputObjectPair.Value;
+				const FString* OutputName = OutputObject.CachedAttributes.Find(OutputNameAttribute);
+				if (!OutputName)
+				{
+					continue;
+				}
+
+				UStaticMesh* StaticMesh = Cast<UStaticMesh>(OutputObject.OutputObject);
+				for (int32 ComponentIndex = 0; !StaticMesh && ComponentIndex < OutputObject.OutputComponents.Num(); ++ComponentIndex)
+				{
+					UStaticMeshComponent* StaticMeshComponent = Cast<UStaticMeshComponent>(OutputObject.OutputComponents[ComponentIndex]);
+					StaticMesh = StaticMeshComponent ? StaticMeshComponent->GetStaticMesh() : nullptr;
+				}
+				if (StaticMesh)
+				{
+					Results.Add(*OutputName, StaticMesh);
+				}
+			}
+		}
+	}
+	else
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildBatch::Split() batched cook of %s failed, cooking its actors one by one"), *GetNameSafe(WrapperAsset));
+	}
+
+	// Everything is copied out before the wrapper goes back to the node, since the next batch may reuse it right away.
+	TArray<bool> Copied;
+	Copied.SetNumZeroed(WorkItems.Num());
+	for (int32 InstanceIndex = 0; InstanceIndex < WorkItems.Num(); ++InstanceIndex)
+	{
+		UHoudiniBuildWorkItem* WorkItem = WorkItems[InstanceIndex];
+		AHoudiniAssetActor* AssetActor = WorkItem ? WorkItem->GetAssetActor().Get() : nullptr;
+		UStaticMesh* Result = Results.FindRef(GetOutputName(InstanceIndex));
+		const bool bCanFinish = WorkItem && WorkItem->GetBuildState() == (InstanceIndex == 0 ? EEHEBuildState::Building : EEHEBuildState::Standby);
+		Copied[InstanceIndex] = bCanFinish && Result && AssetActor && FHoudiniCookCache::CopyStaticMesh(Result, AssetActor->GetHoudiniAssetComponent());
+	}
+	ReleaseWrapperActor();
+
+	// The leader goes last, since it finishing hands the work items that are left back to the node.
+	for (int32 InstanceIndex = 1; InstanceIndex < WorkItems.Num(); ++InstanceIndex)
+	{
+		if (Copied[InstanceIndex])
+		{
+			WorkItems[InstanceIndex]->FinishFromBatch();
+		}
+	}
+
+	UHoudiniBuildWorkItem* Leader = GetLeader();
+	if (Copied[0])
+	{
+		Leader->FinishFromBatch();
+	}
+	else
+	{
+		Leader->BuildUnbatched();
+	}
+}
+
+void UHoudiniBuildBatch::ReleaseWrapperActor()
+{
+	AHoudiniAssetActor* CurrentWrapperActor = WrapperActor.Get();
+	UHoudiniAssetComponent* WrapperComponent = CurrentWrapperActor ? CurrentWrapperActor->GetHoudiniAssetComponent() : nullptr;
+	if (WrapperComponent && PostOutputProcessingDelegateHandle.IsValid())
+	{
+		WrapperComponent->GetOnPostOutputProcessingDelegate().Remove(PostOutputProcessingDelegateHandle);
+	}
+	PostOutputProcessingDelegateHandle.Reset();
+
+	UHoudiniBuildWorkItem* Leader = GetLeader();
+	if (CurrentWrapperActor && Leader && Leader->GetOwner())
+	{
+		Leader->GetOwner()->ReleaseBatchWrapperActor(CurrentWrapperActor);
+	}
+	WrapperActor.Reset();
+}
@@ -0,0 +1,287 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/HoudiniBuildDescriptorPlan.h"
+
+#include "EHERuntimeLoggingDefs.h"
+#include "EngineUtils.h"
+#include "HoudiniAssetActor.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Foundation/AutomationGraph.h"
+#include "Foundation/HoudiniBuildHistory.h"
+#include "Foundation/HoudiniBuildInputs.h"
+#include "Foundation/HoudiniBuildSequenceNode.h"
+#include "HoudiniEngineRuntime/Private/HoudiniAsset.h"
+#include "HoudiniEngineRuntime/Private/HoudiniAssetComponent.h"
+
+#if WITH_EDITOR
+#include "WorldPartition/WorldPartition.h"
+#include "WorldPartition/WorldPartitionActorDescInstance.h"
+#include "WorldPartition/WorldPartitionHelpers.h"
+#endif
+
+namespace
+{
+	FHoudiniBuildPlannedActor MakeLoadedActor(AHoudiniAssetActor* AssetActor)
+	{
+		UHoudiniAssetComponent* AssetComponent = AssetActor->GetHoudiniAssetComponent();
+		
+		FHoudiniBuildPlannedActor PlannedActor;
+		PlannedActor.ActorPath = FSoftObjectPath(AssetActor);
+		PlannedActor.HoudiniAssetPath = FSoftObjectPath(AssetComponent ? AssetComponent->GetHoudiniAsset() : nullptr);
+		PlannedActor.Tags = AssetActor->Tags;
+		PlannedActor.Bounds = AssetActor->GetComponentsBoundingBox(true);
+		PlannedActor.bIsLoaded = true;
+
+		TArray<UObject*> InputObjects;
+		FHoudiniBuildInputs::GetInputObjects(AssetComponent, InputObjects);
+		for (UObject* InputObject : InputObjects)
+		{
+			const AActor* InputActor = Cast<AActor>(InputObject);
+			if (!InputActor && InputObject)
+			{
+				InputActor = InputObject->GetTypedOuter<AActor>();
+			}
+			if (InputActor && InputActor != AssetActor)
+			{
+				PlannedActor.InputBounds += InputActor->GetComponentsBoundingBox(true);
+			}
+		}
+		return PlannedActor;
+	}
+
+	// The HDA an unloaded actor instantiates is a hard dependency of the actor's package.
+	FSoftObjectPath FindHoudiniAsset(IAssetRegistry& AssetRegistry, FName ActorPackage, TMap<FName, FSoftObjectPath>& HoudiniAssetsByPackage)
+	{
+		TArray<FName> Dependencies;
+		AssetRegistry.GetDependencies(ActorPackage, Dependencies, UE::AssetRegistry::EDependencyCategory::Package, UE::AssetRegistry::EDependencyQuery::Hard);
+		
+		for (FName Dependency : Dependencies)
+		{
+			FSoftObjectPath* HoudiniAssetPath = HoudiniAssetsByPackage.Find(Dependency);
+			if (!HoudiniAssetPath)
+			{
+				HoudiniAssetPath = &HoudiniAssetsByPackage.Add(Dependency);
+				
+				TArray<FAssetData> Assets;
+				AssetRegistry.GetAssetsByPackageName(Dependency, Assets);
+				for (const FAssetData& AssetData : Assets)
+				{
+					if (AssetData.AssetClassPath == UHoudiniAsset::StaticClass()->GetClassPathName())
+					{
+						*HoudiniAssetPath = AssetData.GetSoftObjectPath();
+						break;
+					}
+				}
+			}
+
+			if (HoudiniAssetPath->IsValid())
+			{
+				return *HoudiniAssetPath;
+			}
+		}
+
+		return FSoftObjectPath();
+	}
+}
+
+bool FHoudiniBuildDescriptorPlan::Build(UWorld* World, const TSharedRef<const FAutomationGraphPlan>& InGraphPlan, const FHoudiniBuildHistory& History)
+{
+	const double TimeStarted = FPlatformTime::Seconds();
+	*this = FHoudiniBuildDescriptorPlan();
+	GraphPlan = InGraphPlan;
+	
+	if (!World)
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: FHoudiniBuildDescriptorPlan::Build(): Expected a valid world."));
+		return false;
+	}
+	if (InGraphPlan->bHasCycle)
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: FHoudiniBuildDescriptorPlan::Build(): A cycle exists in the build graph."));
+		return false;
+	}
+
+#if WITH_EDITOR
+	if (UWorldPartition* WorldPartition = World->GetWorldPartition())
+	{
+		IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+		TMap<FName, FSoftObjectPath> HoudiniAssetsByPackage;
+		
+		FWorldPartitionHelpers::ForEachActorDescInstance<AHoudiniAssetActor>(WorldPartition, [this, WorldPartition, &AssetRegistry, &HoudiniAssetsByPackage](const FWorldPartitionActorDescInstance* ActorDescInstance)
+		{
+			// Loaded actors may have changes that aren't in their descriptor yet.
+			if (auto* AssetActor = ActorDescInstance->IsLoaded() ? Cast<AHoudiniAssetActor>(ActorDescInstance->GetActor()) : nullptr)
+			{
+				Actors.Add(MakeLoadedActor(AssetActor));
+				return true;
+			}
+
+			FHoudiniBuildPlannedActor& PlannedActor = Actors.AddDefaulted_GetRef();
+			PlannedActor.ActorPath = ActorDescInstance->GetActorSoftPath();
+			PlannedActor.HoudiniAssetPath = FindHoudiniAsset(AssetRegistry, ActorDescInstance->GetActorPackage(), HoudiniAssetsByPackage);
+			PlannedActor.Tags = ActorDescInstance->GetActorDesc()->GetTags();
+			PlannedActor.Bounds = ActorDescInstance->GetEditorBounds();
+			
+			// Actors plugged into an input are references of the actor.
+			for (const FGuid& ReferenceGuid : ActorDescInstance->GetActorDesc()->GetReferences())
+			{
+				if (const FWorldPartitionActorDescInstance* ReferenceDescInstance = WorldPartition->GetActorDescInstance(ReferenceGuid))
+				{
+					PlannedActor.InputBounds += ReferenceDescInstance->GetEditorBounds();
+				}
+			}
+			++NumUnloadedActors;
+			return true;
+		});
+	}
+	else
+#endif
+	{
+		for (TActorIterator<AHoudiniAssetActor> ActorItr(World); ActorItr; ++ActorItr)
+		{
+			Actors.Add(MakeLoadedActor(*ActorItr));
+		}
+	}
+
+	// Same precedence as AHoudiniBuildManager::InitializeNodes(): nodes in topological order, each taking the actors
+	// that match its tags and then the ones that match its asset types.
+	Nodes.SetNum(InGraphPlan->Num());
+	TArray<double> NodeFinishedSec;
+	NodeFinishedSec.SetNumZeroed(InGraphPlan->Num());
+	
+	for (int32 NodeIndex = 0; NodeIndex < InGraphPlan->Num(); ++NodeIndex)
+	{
+		UAutomationGraphNode* GraphNode = InGraphPlan->Nodes[NodeIndex];
+		FHoudiniBuildPlannedNode& PlannedNode = Nodes[NodeIndex];
+		PlannedNode.Node = GraphNode;
+
+		auto Claim = [this, NodeIndex, &PlannedNode](TFunctionRef<bool(const FHoudiniBuildPlannedActor&)> Matches)
+		{
+			for (int32 ActorIndex = 0; ActorIndex < Actors.Num(); ++ActorIndex)
+			{
+				FHoudiniBuildPlannedActor& PlannedActor = Actors[ActorIndex];
+				if (PlannedActor.NodeIndex == INDEX_NONE && Matches(PlannedActor))
+				{
+					PlannedActor.NodeIndex = NodeIndex;
+					PlannedNode.ActorIndices.Add(ActorIndex);
+				}
+			}
+		};
+		
+		if (auto* BuildSequenceNode = Cast<UHoudiniBuildSequenceNode>(GraphNode))
+		{
+			for (FName ActorTag : BuildSequenceNode->BuildInfo.ActorTags)
+			{
+				Claim([ActorTag](const FHoudiniBuildPlannedActor& PlannedActor) { return PlannedActor.Tags.Contains(ActorTag); });
+			}
+			for (UHoudiniAsset* AssetType : BuildSequenceNode->BuildInfo.AssetTypes)
+			{
+				const FSoftObjectPath AssetTypePath(AssetType);
+				Claim([&AssetTypePath](const FHoudiniBuildPlannedActor& PlannedActor) { return PlannedActor.HoudiniAssetPath == AssetTypePath; });
+			}
+		}
+
+		TArray<double> WorkItemEstimatesSec;
+		for (int32 ActorIndex : PlannedNode.ActorIndices)
+		{
+			FHoudiniBuildPlannedActor& PlannedActor = Actors[ActorIndex];
+			PlannedActor.EstimatedSec = History.EstimateActor(PlannedActor.ActorPath, PlannedActor.HoudiniAssetPath);
+			WorkItemEstimatesSec.Add(PlannedActor.EstimatedSec);
+			Bounds += PlannedActor.Bounds;
+		}
+		PlannedNode.EstimatedSec = History.EstimateNode(GraphNode, WorkItemEstimatesSec);
+
+		double ParentsFinishedSec = 0.0;
+		for (int32 ParentIndex : InGraphPlan->GetParents(NodeIndex))
+		{
+			ParentsFinishedSec = FMath::Max(ParentsFinishedSec, NodeFinishedSec[ParentIndex]);
+		}
+		NodeFinishedSec[NodeIndex] = ParentsFinishedSec + PlannedNode.EstimatedSec;
+		EstimatedSec = FMath::Max(EstimatedSec, NodeFinishedSec[NodeIndex]);
+	}
+
+	PlanningSec = FPlatformTime::Seconds() - TimeStarted;
+	return true;
+}
+
+int32 FHoudiniBuildDescriptorPlan::GetNumWorkItems() const
+{
+	int32 NumWorkItems = 0;
+	for (const FHoudiniBuildPlannedNode& PlannedNode : Nodes)
+	{
+		NumWorkItems += PlannedNode.ActorIndices.Num();
+	}
+	
+	return NumWorkItems;
+}
+
+TArray<int32> FHoudiniBuildDescriptorPlan::GetActorsInRegion(const FBox& Region) const
+{
+	TArray<int32> ActorIndices;
+	for (int32 ActorIndex = 0; ActorIndex < Actors.Num(); ++ActorIndex)
+	{
+		const FHoudiniBuildPlannedActor& PlannedActor = Actors[ActorIndex];
+		if (PlannedActor.NodeIndex == INDEX_NONE || !PlannedActor.Bounds.IsValid)
+		{
+			continue;
+		}
+
+		const FVector Center = PlannedActor.Bounds.GetCenter();
+		if (Center.X >= Region.Min.X && Center.X < Region.Max.X && Center.Y >= Region.Min.Y && Center.Y < Region.Max.Y)
+		{
+			ActorIndices.Add(ActorIndex);
+		}
+	}
+
+	return ActorIndices;
+}
+
+void FHoudiniBuildDescriptorPlan::Log() const
+{
+	UE_LOG(LogEHERuntime, Display, TEXT("Build plan: %d work items over %d HDA actors (%d unloaded), estimated %.1fs, planned in %.3fs."), GetNumWorkItems(), Actors.Num(), NumUnloadedActors, EstimatedSec, PlanningSec);
+	for (const FHoudiniBuildPlannedNode& PlannedNode : Nodes)
+	{
+		const UAutomationGraphNode* GraphNode = PlannedNode.Node.Get();
+		if (!GraphNode)
+		{
+			continue;
+		}
+
+		FBox NodeBounds(ForceInit);
+		for (int32 ActorIndex : PlannedNode.ActorIndices)
+		{
+			NodeBounds += Actors[ActorIndex].Bounds;
+		}
+		
+		UE_LOG(LogEHERuntime, Display, TEXT("    %s: %d work items, estimated %.1fs, bounds %s"), *GraphNode->Title.ToString(), PlannedNode.ActorIndices.Num(), PlannedNode.EstimatedSec, *NodeBounds.ToString());
+	}
+}
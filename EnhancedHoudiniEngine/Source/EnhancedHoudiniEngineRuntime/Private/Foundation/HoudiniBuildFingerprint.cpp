@@ -0,0 +1,418 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/HoudiniBuildFingerprint.h"
+
+#include "EHERuntimeLoggingDefs.h"
+#include "HoudiniAssetActor.h"
+#include "Async/ParallelFor.h"
+#include "Foundation/HoudiniBuildInputs.h"
+#include "HAL/FileManager.h"
+#include "HoudiniEngineRuntime/Private/HoudiniAsset.h"
+#include "HoudiniEngineRuntime/Private/HoudiniAssetComponent.h"
+#include "HoudiniEngineRuntime/Private/HoudiniInput.h"
+#include "HoudiniEngineRuntime/Private/HoudiniInputObject.h"
+#include "HoudiniEngineRuntime/Private/HoudiniParameter.h"
+#include "Misc/PackageName.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/ArchiveUObject.h"
+
+namespace
+{
+	// Everything we need from an actor, gathered on the game thread so the hashing itself can run on any thread.
+	struct FFingerprintSource
+	{
+		bool bValid = false;
+		
+		// Inputs that point at actors placed in the world make the cook depend on where the actor is.
+		bool bWorldDependent = false;
+		FTransform Transform;
+
+		// Files whose content goes into the fingerprint: the HDA definition first, then input asset packages. Content
+		// hashes (rather than timestamps) keep fingerprints comparable between machines, which the cook cache relies on.
+		TArray<int32> FileIndices;
+
+		// Objects owned by the actor (parameters, inputs) or placed in the world (input actors), hashed by value.
+		TArray<UObject*> ObjectsToHash;
+
+		// ObjectsToHash, serialized on the game thread. Only these bytes are touched by the hashing threads.
+		TArray<uint8> SerializedObjects;
+	};
+
+	// The per-instance bookkeeping HE keeps on parameters and inputs: ids of the Houdini nodes created for this instance,
+	// and GUIDs. Inherited properties are shared with subclasses, so listing them on the base class covers every kind of
+	// parameter and input object.
+	const TSet<const FProperty*>& GetInstanceStateProperties()
+	{
+		static const TSet<const FProperty*> InstanceStateProperties = []()
+		{
+			const TPair<UClass*, const TCHAR*> PropertyNames[] =
+			{
+				{ UHoudiniParameter::StaticClass(), TEXT("NodeId") },
+				{ UHoudiniParameter::StaticClass(), TEXT("ParmId") },
+				{ UHoudiniInput::StaticClass(), TEXT("AssetNodeId") },
+				{ UHoudiniInput::StaticClass(), TEXT("InputNodeId") },
+				{ UHoudiniInput::StaticClass(), TEXT("CreatedDataNodeIds") },
+				{ UHoudiniInputObject::StaticClass(), TEXT("InputNodeId") },
+				{ UHoudiniInputObject::StaticClass(), TEXT("InputObjectNodeId") },
+				{ UHoudiniInputObject::StaticClass(), TEXT("Guid") },
+			};
+
+			TSet<const FProperty*> Properties;
+			for (const TPair<UClass*, const TCHAR*>& PropertyName : PropertyNames)
+			{
+				if (const FProperty* Property = FindFProperty<FProperty>(PropertyName.Key, PropertyName.Value))
+				{
+					Properties.Add(Property);
+				}
+				else
+				{
+					// Identical instances will no longer share equivalence keys, which is safe but slower.
+					UE_LOG(LogEHERuntime, Warning, TEXT("warning: FHoudiniBuildFingerprint: %s has no property %s."), *PropertyName.Key->GetName(), PropertyName.Value);
+				}
+			}
+			return Properties;
+		}();
+		return InstanceStateProperties;
+	}
+
+	// Serializes objects (and the subobjects they own) into a byte stream, like FArchiveObjectCrc32 does before taking
+	// its CRC. References to objects outside of the one being serialized are written as paths, so the bytes are stable
+	// between runs. Can optionally ignore the per-instance bookkeeping HE keeps on parameters and inputs (Houdini node
+	// ids, GUIDs), so identical instances of an HDA serialize the same.
+	class FFingerprintWriter : public FArchiveUObject
+	{
+	public:
+		FFingerprintWriter(TArray<uint8>& InBytes, bool bInIgnoreInstanceState)
+			: Bytes(InBytes)
+			, bIgnoreInstanceState(bInIgnoreInstanceState)
+		{
+			SetIsSaving(true);
+			SetIsPersistent(true);
+			ArIgnoreOuterRef = true;
+		}
+
+		void SerializeObject(UObject* Object)
+		{
+			if (!Object)
+			{
+				int32 Null = 0;
+				*this << Null;
+				return;
+			}
+			
+			RootObject = Object;
+			ObjectsToSerialize.Add(Object);
+			for (int32 ObjectIndex = 0; ObjectIndex < ObjectsToSerialize.Num(); ++ObjectIndex)
+			{
+				ObjectsToSerialize[ObjectIndex]->Serialize(*this);
+			}
+			ObjectsToSerialize.Reset();
+			RootObject = nullptr;
+		}
+
+		virtual void Serialize(void* Data, int64 Length) override
+		{
+			Bytes.Append(static_cast<const uint8*>(Data), Length);
+		}
+
+		virtual FArchive& operator<<(FName& Name) override
+		{
+			FString NameString = Name.ToString();
+			return *this << NameString;
+		}
+
+		virtual FArchive& operator<<(UObject*& Object) override
+		{
+			if (Object && Object != RootObject && Object->IsIn(RootObject))
+			{
+				// Owned subobjects (HE input objects, curve points...) are part of the object's state.
+				if (!ObjectsToSerialize.Contains(Object))
+				{
+					ObjectsToSerialize.Add(Object);
+				}
+			}
+			
+			FString PathName = GetPathNameSafe(Object);
+			return *this << PathName;
+		}
+
+		virtual bool ShouldSkipProperty(const FProperty* InProperty) const override
+		{
+			if (InProperty->HasAnyPropertyFlags(CPF_Transient | CPF_DuplicateTransient | CPF_NonPIEDuplicateTransient))
+			{
+				return true;
+			}
+			return bIgnoreInstanceState && GetInstanceStateProperties().Contains(InProperty);
+		}
+
+		virtual FString GetArchiveName() const override { return TEXT("FFingerprintWriter"); }
+
+	private:
+		TArray<uint8>& Bytes;
+		bool bIgnoreInstanceState = false;
+		UObject* RootObject = nullptr;
+		TArray<UObject*> ObjectsToSerialize;
+	};
+
+	// HDA files and input packages rarely change between (or during) runs, so their hashes are kept until the file on
+	// disk changes.
+	struct FCachedFileHash
+	{
+		FFileStatData StatData;
+		FString Hash;
+	};
+
+	TMap<FString, FCachedFileHash>& GetFileHashCache()
+	{
+		static TMap<FString, FCachedFileHash> FileHashCache;
+		return FileHashCache;
+	}
+
+	struct FFingerprintFiles
+	{
+		TArray<FString> Files;
+		TMap<FString, int32> FileIndices;
+
+		int32 Add(const FString& File)
+		{
+			if (const int32* FileIndex = FileIndices.Find(File))
+			{
+				return *FileIndex;
+			}
+			return FileIndices.Add(File, Files.Add(File));
+		}
+	};
+	
+	bool AddInputObjectVersion(UObject* InputObject, FFingerprintSource& Source, FFingerprintFiles& Files)
+	{
+		if (!InputObject)
+		{
+			return true;
+		}
+		
+		if (AActor* InputActor = InputObject->IsA<AActor>() ? Cast<AActor>(InputObject) : InputObject->GetTypedOuter<AActor>())
+		{
+			Source.bWorldDependent = true;
+			Source.ObjectsToHash.Add(InputActor);
+			return true;
+		}
+
+		UPackage* Package = InputObject->GetPackage();
+		if (!Package || Package->IsDirty())
+		{
+			// Unsaved changes can't be versioned from disk.
+			return false;
+		}
+
+		FString PackageFilename;
+		if (!FPackageName::TryConvertLongPackageNameToFilename(Package->GetName(), PackageFilename, FPackageName::GetAssetPackageExtension()))
+		{
+			return false;
+		}
+
+		Source.FileIndices.Add(Files.Add(FPaths::ConvertRelativePathToFull(PackageFilename)));
+		return true;
+	}
+
+	// Hashes every file, reusing cached hashes for files that haven't changed on disk. Files that can't be read get an
+	// empty hash.
+	void HashFiles(const TArray<FString>& Files, TArray<FString>& OutHashes)
+	{
+		TMap<FString, FCachedFileHash>& FileHashCache = GetFileHashCache();
+		TArray<FFileStatData> FileStats;
+		TArray<int32> FilesToHash;
+		OutHashes.Reset();
+		OutHashes.SetNum(Files.Num());
+		FileStats.SetNum(Files.Num());
+		for (int32 FileIndex = 0; FileIndex < Files.Num(); ++FileIndex)
+		{
+			FileStats[FileIndex] = IFileManager::Get().GetStatData(*Files[FileIndex]);
+			if (!FileStats[FileIndex].bIsValid)
+			{
+				continue;
+			}
+			
+			const FCachedFileHash* CachedHash = FileHashCache.Find(Files[FileIndex]);
+			if (CachedHash && CachedHash->StatData.ModificationTime == FileStats[FileIndex].ModificationTime && CachedHash->StatData.FileSize == FileStats[FileIndex].FileSize)
+			{
+				OutHashes[FileIndex] = CachedHash->Hash;
+			}
+			else
+			{
+				FilesToHash.Add(FileIndex);
+			}
+		}
+		
+		ParallelFor(FilesToHash.Num(), [&Files, &OutHashes, &FilesToHash](int32 ToHashIndex)
+		{
+			const int32 FileIndex = FilesToHash[ToHashIndex];
+			const FMD5Hash FileHash = FMD5Hash::HashFile(*Files[FileIndex]);
+			if (FileHash.IsValid())
+			{
+				OutHashes[FileIndex] = LexToString(FileHash);
+			}
+		});
+		
+		for (int32 FileIndex : FilesToHash)
+		{
+			if (!OutHashes[FileIndex].IsEmpty())
+			{
+				FileHashCache.Add(Files[FileIndex], FCachedFileHash{FileStats[FileIndex], OutHashes[FileIndex]});
+			}
+		}
+	}
+
+	void ComputeDigests(TConstArrayView<AHoudiniAssetActor*> AssetActors, bool bEquivalenceKeys, TArray<FString>& OutDigests)
+	{
+		check(IsInGameThread());
+		
+		OutDigests.Reset();
+		OutDigests.SetNum(AssetActors.Num());
+
+		TArray<FFingerprintSource> Sources;
+		Sources.SetNum(AssetActors.Num());
+
+		// The same HDA (and often the same input assets) is usually shared by many actors, so each file is only hashed once.
+		FFingerprintFiles Files;
+	
+		for (int32 ActorIndex = 0; ActorIndex < AssetActors.Num(); ++ActorIndex)
+		{
+			AHoudiniAssetActor* AssetActor = AssetActors[ActorIndex];
+			UHoudiniAssetComponent* AssetComponent = IsValid(AssetActor) ? AssetActor->GetHoudiniAssetComponent() : nullptr;
+			UHoudiniAsset* HoudiniAsset = AssetComponent ? AssetComponent->GetHoudiniAsset() : nullptr;
+			if (!HoudiniAsset)
+			{
+				continue;
+			}
+		
+			FFingerprintSource& Source = Sources[ActorIndex];
+			Source.bValid = true;
+			Source.Transform = AssetComponent->GetComponentTransform();
+			Source.FileIndices.Add(Files.Add(FPaths::ConvertRelativePathToFull(HoudiniAsset->GetAssetFileName())));
+		
+			for (int32 ParameterIndex = 0; ParameterIndex < AssetComponent->GetNumParameters(); ++ParameterIndex)
+			{
+				Source.ObjectsToHash.Add(AssetComponent->GetParameterAt(ParameterIndex));
+			}
+			for (int32 InputIndex = 0; InputIndex < AssetComponent->GetNumInputs(); ++InputIndex)
+			{
+				Source.ObjectsToHash.Add(AssetComponent->GetInputAt(InputIndex));
+			}
+		
+			TArray<UObject*> InputObjects;
+			FHoudiniBuildInputs::GetInputObjects(AssetComponent, InputObjects);
+			for (UObject* InputObject : InputObjects)
+			{
+				Source.bValid &= AddInputObjectVersion(InputObject, Source, Files);
+			}
+		}
+
+		// UObjects are only safe to serialize on the game thread. The (much more expensive) hashing of the result runs in
+		// parallel below.
+		for (FFingerprintSource& Source : Sources)
+		{
+			if (!Source.bValid || (bEquivalenceKeys && Source.bWorldDependent))
+			{
+				continue;
+			}
+			
+			FFingerprintWriter Writer(Source.SerializedObjects, bEquivalenceKeys);
+			for (UObject* Object : Source.ObjectsToHash)
+			{
+				Writer.SerializeObject(Object);
+			}
+		}
+
+		TArray<FString> FileHashes;
+		HashFiles(Files.Files, FileHashes);
+
+		ParallelFor(Sources.Num(), [&Sources, &FileHashes, &OutDigests, bEquivalenceKeys](int32 ActorIndex)
+		{
+			const FFingerprintSource& Source = Sources[ActorIndex];
+			if (!Source.bValid || (bEquivalenceKeys && Source.bWorldDependent))
+			{
+				return;
+			}
+
+			FSHA1 Sha;
+			if (bEquivalenceKeys)
+			{
+				// Keeps equivalence keys from ever matching a fingerprint.
+				Sha.UpdateWithString(TEXT("Instance"), 8);
+			}
+			for (int32 FileIndex : Source.FileIndices)
+			{
+				const FString& FileHash = FileHashes[FileIndex];
+				if (FileHash.IsEmpty())
+				{
+					return;
+				}
+				Sha.UpdateWithString(*FileHash, FileHash.Len());
+			}
+		
+			Sha.Update(Source.SerializedObjects.GetData(), Source.SerializedObjects.Num());
+
+			if (!bEquivalenceKeys)
+			{
+				const FString TransformString = Source.Transform.ToString();
+				Sha.UpdateWithString(*TransformString, TransformString.Len());
+			}
+
+			Sha.Final();
+			FSHAHash Hash;
+			Sha.GetHash(Hash.Hash);
+			OutDigests[ActorIndex] = Hash.ToString();
+		});
+	}
+}
+
+void FHoudiniBuildFingerprint::Compute(TConstArrayView<AHoudiniAssetActor*> AssetActors, TArray<FString>& OutFingerprints)
+{
+	ComputeDigests(AssetActors, false, OutFingerprints);
+}
+
+void FHoudiniBuildFingerprint::ComputeEquivalenceKeys(TConstArrayView<AHoudiniAssetActor*> AssetActors, TArray<FString>& OutKeys)
+{
+	ComputeDigests(AssetActors, true, OutKeys);
+}
+
+FString FHoudiniBuildFingerprint::HashDefinitionFile(UHoudiniAsset* HoudiniAsset)
+{
+	if (!HoudiniAsset)
+	{
+		return FString();
+	}
+
+	TArray<FString> FileHashes;
+	HashFiles({ FPaths::ConvertRelativePathToFull(HoudiniAsset->GetAssetFileName()) }, FileHashes);
+	return FileHashes[0];
+}
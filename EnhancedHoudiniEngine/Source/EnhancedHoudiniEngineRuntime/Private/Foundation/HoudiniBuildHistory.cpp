@@ -0,0 +1,297 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/HoudiniBuildHistory.h"
+
+#include "HoudiniAssetActor.h"
+#include "Foundation/HoudiniBuildSequenceNode.h"
+#include "Foundation/HoudiniBuildShard.h"
+#include "HoudiniEngineRuntime/Private/HoudiniAssetComponent.h"
+
+namespace
+{
+	// Weight of the newest sample in the moving average.
+	constexpr double kDurationSmoothing = 0.3;
+
+	// Used for work items we know nothing about, not even their asset.
+	constexpr double kDefaultWorkItemEstimateSec = 5.0;
+
+	// Estimates that move less than this (relative) aren't worth dirtying the level for.
+	constexpr double kDurationChangeTolerance = 0.1;
+
+	UHoudiniAsset* GetHoudiniAsset(AHoudiniAssetActor* AssetActor)
+	{
+		UHoudiniAssetComponent* AssetComponent = AssetActor ? AssetActor->GetHoudiniAssetComponent() : nullptr;
+		return AssetComponent ? AssetComponent->GetHoudiniAsset() : nullptr;
+	}
+}
+
+bool FHoudiniBuildDurationRecord::AddSample(double DurationSec)
+{
+	const bool bHadSamples = HasSamples();
+	const double PreviousSec = AverageSec;
+	
+	AverageSec = bHadSamples ? FMath::Lerp(AverageSec, DurationSec, kDurationSmoothing) : DurationSec;
+	NumSamples++;
+	
+	return !bHadSamples || FMath::Abs(AverageSec - PreviousSec) > PreviousSec * kDurationChangeTolerance;
+}
+
+void FHoudiniBuildHistory::RecordWorkItem(UHoudiniBuildWorkItem* WorkItem, double DurationSec)
+{
+	AHoudiniAssetActor* AssetActor = WorkItem ? WorkItem->GetAssetActor().Get() : nullptr;
+	if (!AssetActor)
+	{
+		return;
+	}
+
+	SetChanged(Actors.FindOrAdd(AssetActor).Duration.AddSample(DurationSec));
+	if (UHoudiniAsset* HoudiniAsset = GetHoudiniAsset(AssetActor))
+	{
+		SetChanged(Assets.FindOrAdd(HoudiniAsset).AddSample(DurationSec));
+	}
+}
+
+void FHoudiniBuildHistory::RecordNode(UAutomationGraphNode* GraphNode, double DurationSec)
+{
+	if (GraphNode)
+	{
+		SetChanged(Nodes.FindOrAdd(GraphNode).AddSample(DurationSec));
+	}
+}
+
+void FHoudiniBuildHistory::RecordFingerprint(UHoudiniBuildWorkItem* WorkItem, const FString& Fingerprint)
+{
+	AHoudiniAssetActor* AssetActor = WorkItem ? WorkItem->GetAssetActor().Get() : nullptr;
+	if (!AssetActor)
+	{
+		return;
+	}
+
+	if (Fingerprint.IsEmpty())
+	{
+		// Nothing to forget if we never built it.
+		if (FHoudiniBuildActorRecord* ActorRecord = Actors.Find(AssetActor); ActorRecord && !ActorRecord->Fingerprint.IsEmpty())
+		{
+			ActorRecord->Fingerprint.Empty();
+			SetChanged(true);
+		}
+		return;
+	}
+
+	FString& RecordedFingerprint = Actors.FindOrAdd(AssetActor).Fingerprint;
+	SetChanged(RecordedFingerprint != Fingerprint);
+	RecordedFingerprint = Fingerprint;
+}
+
+FString FHoudiniBuildHistory::GetFingerprint(UHoudiniBuildWorkItem* WorkItem) const
+{
+	AHoudiniAssetActor* AssetActor = WorkItem ? WorkItem->GetAssetActor().Get() : nullptr;
+	const FHoudiniBuildActorRecord* ActorRecord = AssetActor ? Actors.Find(AssetActor) : nullptr;
+	return ActorRecord ? ActorRecord->Fingerprint : FString();
+}
+
+void FHoudiniBuildHistory::RecordOutputHash(UHoudiniBuildWorkItem* WorkItem, const FString& OutputHash)
+{
+	AHoudiniAssetActor* AssetActor = WorkItem ? WorkItem->GetAssetActor().Get() : nullptr;
+	if (AssetActor)
+	{
+		FString& RecordedOutputHash = Actors.FindOrAdd(AssetActor).OutputHash;
+		SetChanged(RecordedOutputHash != OutputHash);
+		RecordedOutputHash = OutputHash;
+	}
+}
+
+FString FHoudiniBuildHistory::GetOutputHash(UHoudiniBuildWorkItem* WorkItem) const
+{
+	AHoudiniAssetActor* AssetActor = WorkItem ? WorkItem->GetAssetActor().Get() : nullptr;
+	const FHoudiniBuildActorRecord* ActorRecord = AssetActor ? Actors.Find(AssetActor) : nullptr;
+	return ActorRecord ? ActorRecord->OutputHash : FString();
+}
+
+int32 FHoudiniBuildHistory::UpdateDefinition(UHoudiniAsset* HoudiniAsset, const FString& FileHash)
+{
+	if (!HoudiniAsset || FileHash.IsEmpty())
+	{
+		return INDEX_NONE;
+	}
+
+	FHoudiniBuildDefinitionRecord& DefinitionRecord = Definitions.FindOrAdd(HoudiniAsset);
+	if (DefinitionRecord.FileHash != FileHash)
+	{
+		DefinitionRecord.FileHash = FileHash;
+		DefinitionRecord.Version++;
+		SetChanged(true);
+	}
+	return DefinitionRecord.Version;
+}
+
+void FHoudiniBuildHistory::RecordDefinitionVersion(UHoudiniBuildWorkItem* WorkItem, int32 DefinitionVersion)
+{
+	AHoudiniAssetActor* AssetActor = WorkItem ? WorkItem->GetAssetActor().Get() : nullptr;
+	if (AssetActor)
+	{
+		int32& RecordedDefinitionVersion = Actors.FindOrAdd(AssetActor).DefinitionVersion;
+		SetChanged(RecordedDefinitionVersion != DefinitionVersion);
+		RecordedDefinitionVersion = DefinitionVersion;
+	}
+}
+
+int32 FHoudiniBuildHistory::GetDefinitionVersion(UHoudiniBuildWorkItem* WorkItem) const
+{
+	AHoudiniAssetActor* AssetActor = WorkItem ? WorkItem->GetAssetActor().Get() : nullptr;
+	const FHoudiniBuildActorRecord* ActorRecord = AssetActor ? Actors.Find(AssetActor) : nullptr;
+	return ActorRecord ? ActorRecord->DefinitionVersion : INDEX_NONE;
+}
+
+double FHoudiniBuildHistory::EstimateWorkItem(UHoudiniBuildWorkItem* WorkItem) const
+{
+	AHoudiniAssetActor* AssetActor = WorkItem ? WorkItem->GetAssetActor().Get() : nullptr;
+	if (!AssetActor)
+	{
+		return 0.0;
+	}
+
+	return EstimateActor(FSoftObjectPath(AssetActor), FSoftObjectPath(GetHoudiniAsset(AssetActor)));
+}
+
+double FHoudiniBuildHistory::EstimateActor(const FSoftObjectPath& ActorPath, const FSoftObjectPath& HoudiniAssetPath) const
+{
+	if (const FHoudiniBuildActorRecord* ActorRecord = Actors.Find(TSoftObjectPtr<AHoudiniAssetActor>(ActorPath)); ActorRecord && ActorRecord->Duration.HasSamples())
+	{
+		return ActorRecord->Duration.AverageSec;
+	}
+	if (const FHoudiniBuildDurationRecord* AssetRecord = Assets.Find(TSoftObjectPtr<UHoudiniAsset>(HoudiniAssetPath)); AssetRecord && AssetRecord->HasSamples())
+	{
+		return AssetRecord->AverageSec;
+	}
+
+	return kDefaultWorkItemEstimateSec;
+}
+
+double FHoudiniBuildHistory::EstimateNode(UAutomationGraphNode* GraphNode) const
+{
+	TArray<double> WorkItemEstimatesSec;
+	if (auto* BuildSequenceNode = Cast<UHoudiniBuildSequenceNode>(GraphNode))
+	{
+		for (UHoudiniBuildWorkItem* WorkItem : BuildSequenceNode->GetWorkItems())
+		{
+			WorkItemEstimatesSec.Add(EstimateWorkItem(WorkItem));
+		}
+	}
+
+	return EstimateNode(GraphNode, WorkItemEstimatesSec);
+}
+
+double FHoudiniBuildHistory::EstimateNode(UAutomationGraphNode* GraphNode, TConstArrayView<double> WorkItemEstimatesSec) const
+{
+	if (!GraphNode)
+	{
+		return 0.0;
+	}
+
+	if (const FHoudiniBuildDurationRecord* NodeRecord = Nodes.Find(GraphNode); NodeRecord && NodeRecord->HasSamples())
+	{
+		return NodeRecord->AverageSec;
+	}
+
+	auto* BuildSequenceNode = Cast<UHoudiniBuildSequenceNode>(GraphNode);
+	if (!BuildSequenceNode || WorkItemEstimatesSec.IsEmpty())
+	{
+		return 0.0;
+	}
+
+	// Never built as a whole before: assume the work items spread evenly over the in-flight window, but the node can
+	// never be quicker than its slowest work item.
+	double TotalSec = 0.0;
+	double LongestSec = 0.0;
+	for (const double EstimateSec : WorkItemEstimatesSec)
+	{
+		TotalSec += EstimateSec;
+		LongestSec = FMath::Max(LongestSec, EstimateSec);
+	}
+
+	const int32 NumWorkItems = WorkItemEstimatesSec.Num();
+	const int32 MaxInFlight = BuildSequenceNode->BuildInfo.MaxInFlightWorkItems;
+	const int32 Parallelism = MaxInFlight > 0 ? FMath::Min(MaxInFlight, NumWorkItems) : NumWorkItems;
+
+	return FMath::Max(LongestSec, TotalSec / Parallelism);
+}
+
+void FHoudiniBuildHistory::MergeShard(const FHoudiniBuildHistory& ShardHistory, const FHoudiniBuildShard& Shard)
+{
+	for (const TPair<TSoftObjectPtr<AHoudiniAssetActor>, FHoudiniBuildActorRecord>& ActorRecord : ShardHistory.Actors)
+	{
+		if (Shard.Actors.Contains(ActorRecord.Key.ToSoftObjectPath()))
+		{
+			Actors.Add(ActorRecord.Key, ActorRecord.Value);
+		}
+	}
+
+	auto MergeDurations = [](auto& Records, const auto& ShardRecords)
+	{
+		for (const auto& ShardRecord : ShardRecords)
+		{
+			FHoudiniBuildDurationRecord& Record = Records.FindOrAdd(ShardRecord.Key);
+			if (ShardRecord.Value.NumSamples > Record.NumSamples)
+			{
+				Record = ShardRecord.Value;
+			}
+		}
+	};
+	MergeDurations(Assets, ShardHistory.Assets);
+	MergeDurations(Nodes, ShardHistory.Nodes);
+
+	for (const TPair<TSoftObjectPtr<UHoudiniAsset>, FHoudiniBuildDefinitionRecord>& DefinitionRecord : ShardHistory.Definitions)
+	{
+		FHoudiniBuildDefinitionRecord& Record = Definitions.FindOrAdd(DefinitionRecord.Key);
+		if (DefinitionRecord.Value.Version > Record.Version)
+		{
+			Record = DefinitionRecord.Value;
+		}
+	}
+}
+
+void FHoudiniBuildHistory::Empty()
+{
+	Actors.Empty();
+	Assets.Empty();
+	Nodes.Empty();
+	Definitions.Empty();
+	bChanged = true;
+}
+
+bool FHoudiniBuildHistory::ConsumeChanges()
+{
+	const bool bWasChanged = bChanged;
+	bChanged = false;
+	return bWasChanged;
+}
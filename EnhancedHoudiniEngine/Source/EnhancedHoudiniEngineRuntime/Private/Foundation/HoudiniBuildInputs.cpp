@@ -0,0 +1,82 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/HoudiniBuildInputs.h"
+
+#include "HoudiniAssetActor.h"
+#include "HoudiniEngineRuntime/Private/HoudiniAssetComponent.h"
+#include "HoudiniEngineRuntime/Private/HoudiniInput.h"
+#include "HoudiniEngineRuntime/Private/HoudiniInputObject.h"
+
+void FHoudiniBuildInputs::GetInputObjects(UHoudiniAssetComponent* AssetComponent, TArray<UObject*>& OutInputObjects)
+{
+	if (!AssetComponent)
+	{
+		return;
+	}
+	
+	for (int32 InputIndex = 0; InputIndex < AssetComponent->GetNumInputs(); ++InputIndex)
+	{
+		UHoudiniInput* Input = AssetComponent->GetInputAt(InputIndex);
+		if (!Input)
+		{
+			continue;
+		}
+
+		for (int32 ObjectIndex = 0; ObjectIndex < Input->GetNumberOfInputObjects(); ++ObjectIndex)
+		{
+			UHoudiniInputObject* InputObject = Input->GetHoudiniInputObjectAt(ObjectIndex);
+			if (UObject* Object = InputObject ? InputObject->GetObject() : nullptr)
+			{
+				OutInputObjects.Add(Object);
+			}
+		}
+	}
+}
+
+AHoudiniAssetActor* FHoudiniBuildInputs::FindAssetActor(UObject* InputObject)
+{
+	if (!InputObject)
+	{
+		return nullptr;
+	}
+	
+	if (auto* AssetActor = Cast<AHoudiniAssetActor>(InputObject))
+	{
+		return AssetActor;
+	}
+	if (auto* ActorComponent = Cast<UActorComponent>(InputObject))
+	{
+		return Cast<AHoudiniAssetActor>(ActorComponent->GetOwner());
+	}
+	
+	return InputObject->GetTypedOuter<AHoudiniAssetActor>();
+}
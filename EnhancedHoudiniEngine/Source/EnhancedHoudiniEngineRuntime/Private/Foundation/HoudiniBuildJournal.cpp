@@ -0,0 +1,194 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/HoudiniBuildJournal.h"
+
+#include "EHERuntimeLoggingDefs.h"
+#include "HoudiniAssetActor.h"
+#include "Foundation/AutomationGraphNode.h"
+#include "Foundation/HoudiniBuildSequenceNode.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace
+{
+	const TCHAR* JournalRunRecord = TEXT("run");
+	const TCHAR* JournalItemRecord = TEXT("item");
+	const TCHAR* JournalNodeRecord = TEXT("node");
+}
+
+FHoudiniBuildJournal::~FHoudiniBuildJournal()
+{
+	Close(false);
+}
+
+bool FHoudiniBuildJournal::Open(const FString& InFilename, const FString& RunKey, bool bResume)
+{
+	Close(false);
+	Filename = InFilename;
+	
+	FString CompleteRecords;
+	const bool bResuming = bResume && Load(RunKey, CompleteRecords);
+	if (bResume && !bResuming)
+	{
+		UE_LOG(LogEHERuntime, Log, TEXT("FHoudiniBuildJournal: nothing to resume in %s, starting over."), *Filename);
+	}
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(Filename), true);
+	FileHandle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Filename));
+	if (!FileHandle)
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: FHoudiniBuildJournal::Open(): Failed to open %s."), *Filename);
+		return false;
+	}
+
+	// When resuming, the journal is written again without the record the interrupted run was halfway through, since
+	// appending to it would glue the first new record onto that one.
+	return bResuming ? Append(CompleteRecords.LeftChop(1)) : Append(FString::Printf(TEXT("%s\t%s"), JournalRunRecord, *RunKey));
+}
+
+void FHoudiniBuildJournal::Close(bool bDelete)
+{
+	FileHandle.Reset();
+	WorkItems.Empty();
+	Nodes.Empty();
+	
+	if (bDelete && !Filename.IsEmpty())
+	{
+		IFileManager::Get().Delete(*Filename, false, false, true);
+	}
+}
+
+void FHoudiniBuildJournal::RecordWorkItem(UHoudiniBuildWorkItem* WorkItem)
+{
+	AHoudiniAssetActor* AssetActor = WorkItem ? WorkItem->GetAssetActor().Get() : nullptr;
+	if (!IsOpen() || !AssetActor)
+	{
+		return;
+	}
+
+	const FString ActorPath = FSoftObjectPath(AssetActor).ToString();
+	Append(FString::Printf(TEXT("%s\t%s\t%s\t%s\t%s"), JournalItemRecord, *WorkItem->GetOwner()->GetPathName(), *ActorPath, *WorkItem->GetFingerprint(), *WorkItem->GetOutputHash()));
+}
+
+void FHoudiniBuildJournal::RecordNode(UAutomationGraphNode* GraphNode, bool bUnchangedOutput)
+{
+	if (!IsOpen() || !GraphNode)
+	{
+		return;
+	}
+
+	Append(FString::Printf(TEXT("%s\t%s\t%d"), JournalNodeRecord, *GraphNode->GetPathName(), bUnchangedOutput ? 1 : 0));
+}
+
+const FHoudiniBuildJournalItem* FHoudiniBuildJournal::FindWorkItem(const UHoudiniBuildWorkItem* WorkItem) const
+{
+	const AHoudiniAssetActor* AssetActor = WorkItem ? WorkItem->GetAssetActor().Get() : nullptr;
+	if (WorkItems.IsEmpty() || !AssetActor)
+	{
+		return nullptr;
+	}
+
+	return WorkItems.Find(MakeWorkItemKey(GetPathNameSafe(WorkItem->GetOwner()), FSoftObjectPath(AssetActor).ToString()));
+}
+
+const bool* FHoudiniBuildJournal::FindNode(const UAutomationGraphNode* GraphNode) const
+{
+	return GraphNode ? Nodes.Find(GraphNode->GetPathName()) : nullptr;
+}
+
+bool FHoudiniBuildJournal::Load(const FString& RunKey, FString& OutCompleteRecords)
+{
+	FString Contents;
+	if (!FFileHelper::LoadFileToString(Contents, *Filename))
+	{
+		return false;
+	}
+
+	TArray<FString> Lines;
+	Contents.ParseIntoArray(Lines, TEXT("\n"), false);
+	if (!Contents.EndsWith(TEXT("\n")) && !Lines.IsEmpty())
+	{
+		// The run was interrupted halfway through writing this one.
+		Lines.Pop();
+	}
+
+	for (int32 LineIndex = 0; LineIndex < Lines.Num(); ++LineIndex)
+	{
+		TArray<FString> Fields;
+		Lines[LineIndex].ParseIntoArray(Fields, TEXT("\t"), false);
+		if (Fields.IsEmpty())
+		{
+			continue;
+		}
+
+		if (LineIndex == 0)
+		{
+			if (Fields[0] != JournalRunRecord || Fields.Num() != 2 || Fields[1] != RunKey)
+			{
+				// A journal of another graph.
+				return false;
+			}
+		}
+		else if (Fields[0] == JournalItemRecord && Fields.Num() == 5)
+		{
+			WorkItems.Add(MakeWorkItemKey(Fields[1], Fields[2]), FHoudiniBuildJournalItem{Fields[3], Fields[4]});
+		}
+		else if (Fields[0] == JournalNodeRecord && Fields.Num() == 3)
+		{
+			Nodes.Add(Fields[1], Fields[2] == TEXT("1"));
+		}
+	}
+
+	UE_LOG(LogEHERuntime, Log, TEXT("FHoudiniBuildJournal: resuming from %s, %d work items and %d nodes were finished."), *Filename, WorkItems.Num(), Nodes.Num());
+	OutCompleteRecords = Contents.Left(Contents.Find(TEXT("\n"), ESearchCase::CaseSensitive, ESearchDir::FromEnd) + 1);
+	return !Lines.IsEmpty();
+}
+
+bool FHoudiniBuildJournal::Append(const FString& Record)
+{
+	const FTCHARToUTF8 Utf8Record(*(Record + TEXT("\n")));
+	if (!FileHandle->Write(reinterpret_cast<const uint8*>(Utf8Record.Get()), Utf8Record.Length()))
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: FHoudiniBuildJournal::Append(): Failed to write to %s."), *Filename);
+		return false;
+	}
+
+	// Has to be on disk before the run moves on, or it isn't a write-ahead log.
+	return FileHandle->Flush();
+}
+
+FString FHoudiniBuildJournal::MakeWorkItemKey(const FString& NodePath, const FString& ActorPath)
+{
+	return NodePath + TEXT("\t") + ActorPath;
+}
@@ -36,13 +36,46 @@
 #include "HoudiniAssetActor.h"
 #include "AutomationNodes/ClearLandscapeLayersNode.h"
 #include "AutomationNodes/ConsoleCommandNode.h"
+#include "Foundation/HoudiniAssetActorIndex.h"
+#include "Foundation/HoudiniBuildFingerprint.h"
+#include "Foundation/HoudiniBuildInputs.h"
 #include "Foundation/HoudiniBuildSequenceNode.h"
+#include "Foundation/HoudiniCookArbiter.h"
+#include "HAL/FileManager.h"
 #include "HoudiniEngineRuntime/Private/HoudiniAssetComponent.h"
+#include "Misc/Paths.h"
+
+static TAutoConsoleVariable<float> CVarHoudiniBuildManagerSaveBudgetSec(
+	TEXT("houdini.BuildManager.SaveBudgetSec"),
+	0.02f,
+	TEXT("How much of each tick a build manager spends saving finished packages, when it saves during a run.")
+);
+
+static TAutoConsoleVariable<bool> CVarHoudiniBuildManagerJournal(
+	TEXT("houdini.BuildManager.Journal"),
+	true,
+	TEXT("Journal what each run finishes to Saved/HoudiniBuild/Journal, so an interrupted run can be resumed.")
+);
+
+namespace
+{
+	// Heap predicate for ready nodes, so the node at the start of the longest remaining chain is activated first.
+	struct FLongestCriticalPathFirst
+	{
+		const TArray<double>& CriticalPathSec;
+
+		bool operator()(int32 A, int32 B) const
+		{
+			return CriticalPathSec[A] > CriticalPathSec[B];
+		}
+	};
+}
 
 AHoudiniBuildManager::AHoudiniBuildManager(const FObjectInitializer& Initializer): Super(Initializer)
 {
 	bNeedsInitializeGraph = true;
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false; // we only need to tick while there are timeouts pending.
 	bIsSpatiallyLoaded = false; // don't unload this actor.
 }
 
@@ -70,97 +103,141 @@ void AHoudiniBuildManager::Tick(float DeltaSeconds)
 
 void AHoudiniBuildManager::EditorTick(float DeltaSeconds)
 {
-	PollActiveNodes();
+	ProcessDeadlines(FPlatformTime::Seconds());
+	if (!SaveQueue.IsEmpty())
+	{
+		SaveQueue.Tick(CVarHoudiniBuildManagerSaveBudgetSec.GetValueOnGameThread());
+	}
+	if (!HeldNodes.IsEmpty())
+	{
+		for (int32 NodeIndex : HeldNodes)
+		{
+			ReadyNodes.HeapPush(NodeIndex, FLongestCriticalPathFirst{CriticalPathSec});
+		}
+		HeldNodes.Empty();
+		ProcessReadyNodes();
+	}
+	UpdateTickEnabled();
 }
 
-void AHoudiniBuildManager::Run()
+bool AHoudiniBuildManager::Run(bool bResume)
 {
-	if (!ActiveNodes.IsEmpty())
+	if (IsRunning())
 	{
 		UE_LOG(LogEHERuntime, Warning, TEXT("error: AHoudiniBuildManager::Build() tried to build but there are already nodes actively building."));
-		return;
+		return false;
+	}
+	if (!SequenceGraph)
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: AHoudiniBuildManager::Run(): Expected a valid sequence graph."));
+		return false;
+	}
+	if (!GetWorld() || GetWorld()->WorldType != EWorldType::Editor)
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: AHoudiniBuildManager::Run(): Builds can only run in an editor world."));
+		return false;
 	}
 
+	bRunFailed = false;
+
 	// Refresh the build order to make sure we have the most up to date list of actors.
-	InitializeNodes();
-	ActiveNodes.Append(SequenceGraph->RootNodes);
+	if (!InitializeNodes())
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: AHoudiniBuildManager::Run(): Failed to initialize the build graph, see above."));
+		bRunFailed = true;
+		return false;
+	}
+	if (CVarHoudiniBuildManagerJournal.GetValueOnGameThread() || bResume)
+	{
+		Journal.Open(GetJournalPath(), SequenceGraph->GetPathName(), bResume);
+	}
+	BindGraphEvents();
+	ComputeCriticalPaths();
+	
+	for (int32 RootIndex : RunPlan->RootIndices)
+	{
+		if (auto* BuildSequenceNode = Cast<UHoudiniBuildSequenceNode>(RunPlan->Nodes[RootIndex]))
+		{
+			BuildSequenceNode->NotifyParentNodesFinished();
+		}
+		ReadyNodes.HeapPush(RootIndex, FLongestCriticalPathFirst{CriticalPathSec});
+	}
+	ProcessReadyNodes();
+	UpdateTickEnabled();
+	return true;
 }
 
-void AHoudiniBuildManager::InitializeNodes()
+bool AHoudiniBuildManager::PlanFromDescriptors(FHoudiniBuildDescriptorPlan& OutPlan) const
+{
+	if (!SequenceGraph)
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: AHoudiniBuildManager::PlanFromDescriptors(): Expected a valid sequence graph."));
+		return false;
+	}
+
+	return OutPlan.Build(GetWorld(), SequenceGraph->GetPlan(), BuildHistory);
+}
+
+bool AHoudiniBuildManager::FlushSaves()
+{
+	const bool bSaved = SaveQueue.Flush();
+	if (SaveQueue.GetNumSaved() > 0 || SaveQueue.GetNumFailed() > 0)
+	{
+		UE_LOG(LogEHERuntime, Log, TEXT("AHoudiniBuildManager: %d packages saved during runs so far, %d failed."), SaveQueue.GetNumSaved(), SaveQueue.GetNumFailed());
+	}
+	
+	UpdateTickEnabled();
+	return bSaved;
+}
+
+bool AHoudiniBuildManager::InitializeNodes()
 {
 	UWorld* CurrentWorld = GetWorld();
 	if (!CurrentWorld || CurrentWorld->WorldType != EWorldType::Editor)
 	{
 		// If we aren't in the editor world, no point in doing anything.
-		return;
+		return false;
 	}
 
 	if (!SequenceGraph)
 	{
 		UE_LOG(LogEHERuntime, Error, TEXT("error: AHoudiniBuildManager::InitializeNodes(): Expected a valid sequence graph."));
-		return;
+		return false;
 	}
 
 	if (SequenceGraph->RootNodes.IsEmpty())
 	{
 		// Nothing to do...
-		return;
+		return true;
 	}
 
 	ResetSequenceGraph();
 	
-	TMap<UHoudiniAsset*, TSet<AHoudiniAssetActor*>> ActorsByAsset;
-	TMap<FName, TSet<AHoudiniAssetActor*>> ActorsByTag;
-	for (TActorIterator<AActor> ActorItr(CurrentWorld); ActorItr; ++ActorItr)
+	UHoudiniAssetActorIndex* ActorIndex = UHoudiniAssetActorIndex::Get(this);
+	if (!ActorIndex)
 	{
-		AActor* CurrentActor = *ActorItr;
-		auto* CurrentAssetActor = Cast<AHoudiniAssetActor>(CurrentActor);
-
-		if (!CurrentAssetActor)
-		{
-			continue;
-		}
-		
-		for (FName ActorTag : CurrentActor->Tags)
-		{
-			TSet<AHoudiniAssetActor*>& ActorSet = ActorsByTag.FindOrAdd(ActorTag);
-			ActorSet.Add(CurrentAssetActor);
-		}
-
-		UHoudiniAssetComponent* CurrentAssetComponenet = CurrentAssetActor->GetHoudiniAssetComponent();
-		if (CurrentAssetComponenet)
-		{
-			UHoudiniAsset* CurrentAsset = CurrentAssetComponenet->GetHoudiniAsset();
-			if (CurrentAsset)
-			{
-				TSet<AHoudiniAssetActor*>& ActorSet = ActorsByAsset.FindOrAdd(CurrentAsset);
-				ActorSet.Add(CurrentAssetActor);
-			}
-		}
+		UE_LOG(LogEHERuntime, Error, TEXT("error: AHoudiniBuildManager::InitializeNodes(): Expected a valid actor index."));
+		return false;
 	}
 	
-	TArray<FEHEBuildSequenceDFSNode> NodeStack;
-	TSet<TObjectPtr<UAutomationGraphNode>> Visited;
-	TSet<AHoudiniAssetActor*> AddedActors;
-	
-	for (TObjectPtr<UAutomationGraphNode> SequenceNode : SequenceGraph->RootNodes)
+	TSharedRef<const FAutomationGraphPlan> Plan = SequenceGraph->GetPlan();
+	if (Plan->bHasCycle)
 	{
-		NodeStack.Add(FEHEBuildSequenceDFSNode(SequenceNode));
+		UE_LOG(LogEHERuntime, Error, TEXT("Failed to construct final build order: A cycle exists in the build graph."))
+		ResetSequenceGraph();
+		return false;
 	}
-	while (!NodeStack.IsEmpty())
-	{
-		FEHEBuildSequenceDFSNode DFSNode = NodeStack.Pop();
-		TObjectPtr<UAutomationGraphNode> GraphNode = DFSNode.GraphNode;
-		TSet<TObjectPtr<UAutomationGraphNode>> Ancestors = DFSNode.Ancestors; // copy of this node's ancestors
+	
+	// Every node is still initialized after one fails, so all the failures get logged.
+	bool bAllNodesInitialized = true;
+	TSet<AHoudiniAssetActor*> AddedActors;
 
-		if (Visited.Contains(GraphNode))
-		{
-			continue;
-		}
-		
-		Visited.Add(GraphNode);
-		Ancestors.Add(GraphNode);
-		
+	// Definition versions are looked up once per asset, since hashing a library file isn't free.
+	TMap<UHoudiniAsset*, int32> DefinitionVersions;
+
+	// Nodes are visited in topological order, so ancestors always get the first pick of the actors.
+	for (UAutomationGraphNode* GraphNode : Plan->Nodes)
+	{
 		// Initialize Nodes Here ---------------------------------------------------------------------------------------
 		if (auto* BuildSequenceNode = Cast<UHoudiniBuildSequenceNode>(GraphNode))
 		{
@@ -168,34 +245,55 @@ void AHoudiniBuildManager::InitializeNodes()
 			
 			for (FName ActorTag : BuildSequenceNode->BuildInfo.ActorTags)
 			{
-				if (!ActorsByTag.Contains(ActorTag))
-				{
-					continue;
-				}
-
-				for (AHoudiniAssetActor* AssetActor : *ActorsByTag.Find(ActorTag))
+				for (AHoudiniAssetActor* AssetActor : ActorIndex->GetActorsWithTag(ActorTag))
 				{
 					if (!AddedActors.Contains(AssetActor))
 					{
-						NodeInitialized &= BuildSequenceNode->Add(AssetActor);
+						// Actors of other shards are still claimed, so that a later node doesn't pick them up instead.
+						if (Shard.Contains(AssetActor))
+						{
+							NodeInitialized &= BuildSequenceNode->Add(AssetActor);
+						}
 						AddedActors.Add(AssetActor);
 					}
 				}
 			}
 			for (UHoudiniAsset* AssetType : BuildSequenceNode->BuildInfo.AssetTypes)
 			{
-				if (!ActorsByAsset.Contains(AssetType))
+				for (AHoudiniAssetActor* AssetActor : ActorIndex->GetActorsOfAsset(AssetType))
 				{
-					continue;
+					if (!AddedActors.Contains(AssetActor))
+					{
+						// Actors of other shards are still claimed, so that a later node doesn't pick them up instead.
+						if (Shard.Contains(AssetActor))
+						{
+							NodeInitialized &= BuildSequenceNode->Add(AssetActor);
+						}
+						AddedActors.Add(AssetActor);
+					}
 				}
+			}
+			
+			for (UHoudiniBuildWorkItem* WorkItem : BuildSequenceNode->GetWorkItems())
+			{
+				WorkItem->SetPriority(BuildPriority);
+				WorkItem->SetLastBuiltFingerprint(BuildHistory.GetFingerprint(WorkItem));
+				WorkItem->SetLastOutputHash(BuildHistory.GetOutputHash(WorkItem));
 
-				for (AHoudiniAssetActor* AssetActor : *ActorsByAsset.Find(AssetType))
+				if (BuildSequenceNode->ReloadsDefinitions())
 				{
-					if (!AddedActors.Contains(AssetActor))
+					AHoudiniAssetActor* AssetActor = WorkItem->GetAssetActor().Get();
+					UHoudiniAssetComponent* AssetComponent = AssetActor ? AssetActor->GetHoudiniAssetComponent() : nullptr;
+					UHoudiniAsset* HoudiniAsset = AssetComponent ? AssetComponent->GetHoudiniAsset() : nullptr;
+					
+					int32* DefinitionVersion = DefinitionVersions.Find(HoudiniAsset);
+					if (!DefinitionVersion)
 					{
-						NodeInitialized &= BuildSequenceNode->Add(AssetActor);
-						AddedActors.Add(AssetActor);
+						DefinitionVersion = &DefinitionVersions.Add(HoudiniAsset, BuildHistory.UpdateDefinition(HoudiniAsset, FHoudiniBuildFingerprint::HashDefinitionFile(HoudiniAsset)));
 					}
+					
+					WorkItem->SetDefinitionVersion(*DefinitionVersion);
+					WorkItem->SetLastBuiltDefinitionVersion(BuildHistory.GetDefinitionVersion(WorkItem));
 				}
 			}
 			
@@ -207,53 +305,229 @@ void AHoudiniBuildManager::InitializeNodes()
 			else
 			{
 				UE_LOG(LogEHERuntime, Error, TEXT("error: AHoudiniBuildManager::InitializeNodes(): Failed to initialize HoudiniBuildSequenceNode."));
+				bAllNodesInitialized = false;
 			}
 		}
 		else if (auto* ClearLandscapeLayersNode = Cast<UAGN_ClearLandscapeLayers>(GraphNode))
 		{
 			ClearLandscapeLayersNode->Initialize(CurrentWorld);
+			bAllNodesInitialized &= ClearLandscapeLayersNode->GetState() != EAutomationGraphNodeState::Error;
 		}
 		else if (auto* ConsoleCommandNode = Cast<UAGN_ConsoleCommandBase>(GraphNode))
 		{
 			ConsoleCommandNode->Initialize(CurrentWorld);
+			bAllNodesInitialized &= ConsoleCommandNode->GetState() != EAutomationGraphNodeState::Error;
 		}
 		else
 		{
 			GraphNode->Ready();
 		}
 		// End Node Initialization -------------------------------------------------------------------------------------
-		
-		for (TObjectPtr<UAutomationGraphNode> ChildNode : GraphNode->ChildNodes)
+	}
+
+	// Now that every work item exists, work out which of them wait on which. Pipeline links come first, since they
+	// decide which work items wait for their parent nodes, and input dependencies must not form a cycle with them.
+	for (UAutomationGraphNode* GraphNode : Plan->Nodes)
+	{
+		if (auto* BuildSequenceNode = Cast<UHoudiniBuildSequenceNode>(GraphNode))
 		{
-			if (Ancestors.Contains(ChildNode))
-			{
-				UE_LOG(LogEHERuntime, Error, TEXT("Failed to construct final build order: A cycle exists in the build graph."))
-				ResetSequenceGraph();
-				return;
-			}
-			NodeStack.Add(FEHEBuildSequenceDFSNode(ChildNode, Ancestors));
+			BuildSequenceNode->LinkPipelinedWorkItems();
 		}
 	}
+	if (bDiscoverInputDependencies)
+	{
+		DiscoverInputDependencies(*Plan);
+	}
 
 	// Might remove this later, but keeping for now- for debug purposes
 	RefreshBuildPreview();
 	PrintBuildOrder();
+	return bAllNodesInitialized;
 }
 
-void AHoudiniBuildManager::RefreshBuildPreview()
+void AHoudiniBuildManager::DiscoverInputDependencies(const FAutomationGraphPlan& Plan)
 {
-	TArray<TObjectPtr<UAutomationGraphNode>> NodeQueue;
-	TSet<TObjectPtr<UAutomationGraphNode>> Visited;
+	// Which work item (and plan node) builds each actor, and which plan node each work item belongs to.
+	TMap<AHoudiniAssetActor*, TPair<UHoudiniBuildWorkItem*, int32>> WorkItemsByActor;
+	TMap<const UHoudiniBuildWorkItem*, int32> WorkItemIndices;
+	TArray<const UHoudiniBuildWorkItem*> WorkItems;
+	TArray<int32> WorkItemNodeIndices;
+	for (int32 NodeIndex = 0; NodeIndex < Plan.Num(); ++NodeIndex)
+	{
+		if (auto* BuildSequenceNode = Cast<UHoudiniBuildSequenceNode>(Plan.Nodes[NodeIndex]))
+		{
+			for (UHoudiniBuildWorkItem* WorkItem : BuildSequenceNode->GetWorkItems())
+			{
+				if (!WorkItem)
+				{
+					continue;
+				}
+				
+				WorkItemIndices.Add(WorkItem, WorkItems.Add(WorkItem));
+				WorkItemNodeIndices.Add(NodeIndex);
+				if (AHoudiniAssetActor* AssetActor = WorkItem->GetAssetActor().Get())
+				{
+					WorkItemsByActor.Add(AssetActor, TPair<UHoudiniBuildWorkItem*, int32>(WorkItem, NodeIndex));
+				}
+			}
+		}
+	}
 
-	NodeQueue.Append(SequenceGraph->RootNodes);
-	Visited.Append(SequenceGraph->RootNodes);
+	// What a work item waits for isn't just its dependencies: work items wait for their node to start (unless a
+	// pipeline link lets them go early), a node starts once its parent nodes have finished, and a node finishes once all
+	// of its work items have. A new dependency is only safe if none of these lead from the downstream work item back to
+	// the upstream one. Vertices are the work items, followed by a start and a finish vertex for every plan node.
+	const int32 NumWorkItems = WorkItems.Num();
+	auto NodeStart = [NumWorkItems](int32 NodeIndex) { return NumWorkItems + 2 * NodeIndex; };
+	auto NodeFinish = [NumWorkItems](int32 NodeIndex) { return NumWorkItems + 2 * NodeIndex + 1; };
+	
+	TArray<TArray<int32>> NodeBarrierWorkItems;
+	NodeBarrierWorkItems.SetNum(Plan.Num());
+	for (int32 WorkItemIndex = 0; WorkItemIndex < NumWorkItems; ++WorkItemIndex)
+	{
+		const int32 NodeIndex = WorkItemNodeIndices[WorkItemIndex];
+		const UHoudiniBuildSequenceNode* BuildSequenceNode = CastChecked<UHoudiniBuildSequenceNode>(Plan.Nodes[NodeIndex]);
+		if (!BuildSequenceNode->IsPipelined() || WorkItems[WorkItemIndex]->WaitsForParentNodes())
+		{
+			NodeBarrierWorkItems[NodeIndex].Add(WorkItemIndex);
+		}
+	}
+	
+	auto CanReach = [&](const UHoudiniBuildWorkItem* From, const UHoudiniBuildWorkItem* To)
+	{
+		const int32 Target = WorkItemIndices[To];
+		TBitArray<> Visited(false, NumWorkItems + 2 * Plan.Num());
+		TArray<int32> ToVisit = { WorkItemIndices[From] };
+		Visited[ToVisit[0]] = true;
+		
+		auto Visit = [&Visited, &ToVisit](int32 Vertex)
+		{
+			if (!Visited[Vertex])
+			{
+				Visited[Vertex] = true;
+				ToVisit.Add(Vertex);
+			}
+		};
+		
+		while (!ToVisit.IsEmpty())
+		{
+			const int32 Vertex = ToVisit.Pop(EAllowShrinking::No);
+			if (Vertex == Target)
+			{
+				return true;
+			}
+			
+			if (Vertex < NumWorkItems)
+			{
+				Visit(NodeFinish(WorkItemNodeIndices[Vertex]));
+				for (const UHoudiniBuildWorkItem* Dependent : WorkItems[Vertex]->GetDependents())
+				{
+					if (const int32* DependentIndex = WorkItemIndices.Find(Dependent))
+					{
+						Visit(*DependentIndex);
+					}
+				}
+			}
+			else if ((Vertex - NumWorkItems) % 2 == 0)
+			{
+				const int32 NodeIndex = (Vertex - NumWorkItems) / 2;
+				Visit(NodeFinish(NodeIndex));
+				for (int32 WorkItemIndex : NodeBarrierWorkItems[NodeIndex])
+				{
+					Visit(WorkItemIndex);
+				}
+			}
+			else
+			{
+				for (int32 ChildIndex : Plan.GetChildren((Vertex - NumWorkItems) / 2))
+				{
+					Visit(NodeStart(ChildIndex));
+				}
+			}
+		}
+		return false;
+	};
 
-	while (!NodeQueue.IsEmpty())
+	// Descendants[A][B] is set if node B can only start after node A.
+	TArray<TBitArray<>> Descendants;
+	Descendants.SetNum(Plan.Num());
+	for (int32 NodeIndex = Plan.Num() - 1; NodeIndex >= 0; --NodeIndex)
 	{
-		// Unfortunately UE doesn't have a good queue implementation, so for now just use the inefficient RemoveAt(0)
-		TObjectPtr<UAutomationGraphNode> GraphNode = NodeQueue[0];
-		NodeQueue.RemoveAt(0);
+		Descendants[NodeIndex].Init(false, Plan.Num());
+		for (int32 ChildIndex : Plan.GetChildren(NodeIndex))
+		{
+			Descendants[NodeIndex][ChildIndex] = true;
+			Descendants[NodeIndex].CombineWithBitwiseOR(Descendants[ChildIndex], EBitwiseOperatorFlags::MaintainSize);
+		}
+	}
 
+	int32 NumWithinNodes = 0;
+	int32 NumAcrossNodes = 0;
+	int32 NumIgnored = 0;
+	for (const TPair<AHoudiniAssetActor*, TPair<UHoudiniBuildWorkItem*, int32>>& Downstream : WorkItemsByActor)
+	{
+		AHoudiniAssetActor* DownstreamActor = Downstream.Key;
+		UHoudiniBuildWorkItem* DownstreamWorkItem = Downstream.Value.Key;
+		const int32 DownstreamNodeIndex = Downstream.Value.Value;
+		
+		TArray<UObject*> InputObjects;
+		FHoudiniBuildInputs::GetInputObjects(DownstreamActor->GetHoudiniAssetComponent(), InputObjects);
+		
+		TSet<AHoudiniAssetActor*> UpstreamActors;
+		for (UObject* InputObject : InputObjects)
+		{
+			AHoudiniAssetActor* UpstreamActor = FHoudiniBuildInputs::FindAssetActor(InputObject);
+			if (UpstreamActor && UpstreamActor != DownstreamActor)
+			{
+				UpstreamActors.Add(UpstreamActor);
+			}
+		}
+
+		for (AHoudiniAssetActor* UpstreamActor : UpstreamActors)
+		{
+			const TPair<UHoudiniBuildWorkItem*, int32>* Upstream = WorkItemsByActor.Find(UpstreamActor);
+			if (!Upstream)
+			{
+				// Not built by this graph, so whatever it has now is what we get.
+				continue;
+			}
+			
+			UHoudiniBuildWorkItem* UpstreamWorkItem = Upstream->Key;
+			const int32 UpstreamNodeIndex = Upstream->Value;
+
+			if (Descendants[DownstreamNodeIndex][UpstreamNodeIndex])
+			{
+				UE_LOG(LogEHERuntime, Warning, TEXT("warning: AHoudiniBuildManager: %s takes %s as input, but the graph builds %s (%s) before %s (%s). %s will use stale input."),
+					*DownstreamActor->GetName(), *UpstreamActor->GetName(),
+					*DownstreamActor->GetName(), *Plan.Nodes[DownstreamNodeIndex]->Title.ToString(),
+					*UpstreamActor->GetName(), *Plan.Nodes[UpstreamNodeIndex]->Title.ToString(),
+					*DownstreamActor->GetName());
+				NumIgnored++;
+				continue;
+			}
+			if (CanReach(DownstreamWorkItem, UpstreamWorkItem))
+			{
+				UE_LOG(LogEHERuntime, Warning, TEXT("warning: AHoudiniBuildManager: %s and %s wait for each other (through their inputs, pipeline links or the graph). Ignoring the input of %s."),
+					*DownstreamActor->GetName(), *UpstreamActor->GetName(), *DownstreamActor->GetName());
+				NumIgnored++;
+				continue;
+			}
+
+			DownstreamWorkItem->AddDependency(UpstreamWorkItem);
+			(UpstreamNodeIndex == DownstreamNodeIndex ? NumWithinNodes : NumAcrossNodes)++;
+		}
+	}
+
+	UE_LOG(LogEHERuntime, Log, TEXT("AHoudiniBuildManager: found %d input dependencies within nodes and %d across nodes (%d ignored)."), NumWithinNodes, NumAcrossNodes, NumIgnored);
+}
+
+void AHoudiniBuildManager::RefreshBuildPreview()
+{
+	// The plan is already in topological order, which is a valid build order.
+	TSharedRef<const FAutomationGraphPlan> Plan = SequenceGraph->GetPlan();
+	
+	for (UAutomationGraphNode* GraphNode : Plan->Nodes)
+	{
 		// Uncomment for testing
 		/*
 		if (auto* SequenceNode = Cast<UHoudiniBuildSequenceNode>(GraphNode))
@@ -266,79 +540,527 @@ void AHoudiniBuildManager::RefreshBuildPreview()
 				}
 			}
 		}*/
+	}
+}
+
+void AHoudiniBuildManager::BindGraphEvents()
+{
+	UnbindGraphEvents();
+
+	RunPlan = SequenceGraph->GetPlan();
+	RemainingParents = RunPlan->InDegrees;
+	NodeOutputUnchanged.Init(false, RunPlan->Num());
+	Shard.GetNodesToRun(*RunPlan, NodeRunsInShard);
 
-		for (TObjectPtr<UAutomationGraphNode> ChildNode : GraphNode->ChildNodes)
+	for (UAutomationGraphNode* GraphNode : RunPlan->Nodes)
+	{
+		BoundNodes.Add(GraphNode);
+		
+		GraphNode->OnStateChanged.AddUObject(this, &ThisClass::OnNodeStateChanged);
+		if (auto* BuildSequenceNode = Cast<UHoudiniBuildSequenceNode>(GraphNode))
 		{
-			if (!Visited.Contains(ChildNode))
+			BuildSequenceNode->OnWorkItemStateChangedDelegate.AddUObject(this, &ThisClass::OnWorkItemStateChanged);
+			BuildSequenceNode->SetJournal(Journal.IsOpen() ? &Journal : nullptr);
+		}
+	}
+
+	if (bSaveDuringRun)
+	{
+		UPackage::PackageMarkedDirtyEvent.AddUObject(this, &ThisClass::OnPackageMarkedDirty);
+	}
+}
+
+void AHoudiniBuildManager::UnbindGraphEvents()
+{
+	for (TObjectPtr<UAutomationGraphNode> GraphNode : BoundNodes)
+	{
+		if (!GraphNode)
+		{
+			continue;
+		}
+
+		GraphNode->OnStateChanged.RemoveAll(this);
+		if (auto* BuildSequenceNode = Cast<UHoudiniBuildSequenceNode>(GraphNode))
+		{
+			BuildSequenceNode->OnWorkItemStateChangedDelegate.RemoveAll(this);
+			BuildSequenceNode->SetJournal(nullptr);
+		}
+	}
+
+	// Anything still in here was dirtied by a node that didn't finish, and is left for whoever saves the level.
+	UPackage::PackageMarkedDirtyEvent.RemoveAll(this);
+	DirtiedPackages.Empty();
+
+	BoundNodes.Empty();
+	RunPlan.Reset();
+	RemainingParents.Empty();
+	NodeOutputUnchanged.Empty();
+	NodeRunsInShard.Empty();
+	CriticalPathSec.Empty();
+	NodeTimeStarted.Empty();
+}
+
+void AHoudiniBuildManager::ComputeCriticalPaths()
+{
+	const int32 NumNodes = RunPlan.IsValid() ? RunPlan->Num() : 0;
+	CriticalPathSec.SetNumZeroed(NumNodes);
+	NodeTimeStarted.SetNumZeroed(NumNodes);
+
+	// Children always come after their parents in the plan, so walking it backwards sees every child first.
+	double LongestPathSec = 0.0;
+	for (int32 NodeIndex = NumNodes - 1; NodeIndex >= 0; --NodeIndex)
+	{
+		double DownstreamSec = 0.0;
+		for (int32 ChildIndex : RunPlan->GetChildren(NodeIndex))
+		{
+			DownstreamSec = FMath::Max(DownstreamSec, CriticalPathSec[ChildIndex]);
+		}
+
+		UAutomationGraphNode* GraphNode = RunPlan->Nodes[NodeIndex];
+		CriticalPathSec[NodeIndex] = BuildHistory.EstimateNode(GraphNode) + DownstreamSec;
+		LongestPathSec = FMath::Max(LongestPathSec, CriticalPathSec[NodeIndex]);
+
+		if (auto* BuildSequenceNode = Cast<UHoudiniBuildSequenceNode>(GraphNode))
+		{
+			for (UHoudiniBuildWorkItem* WorkItem : BuildSequenceNode->GetWorkItems())
 			{
-				NodeQueue.Add(ChildNode);
-				Visited.Add(ChildNode);
+				WorkItem->SetCriticalPath(BuildHistory.EstimateWorkItem(WorkItem) + DownstreamSec);
 			}
+			BuildSequenceNode->SortWorkItemsByCriticalPath();
 		}
 	}
+
+	UE_LOG(LogEHERuntime, Log, TEXT("AHoudiniBuildManager: estimated critical path is %.1lf seconds."), LongestPathSec);
 }
 
-void AHoudiniBuildManager::PollActiveNodes()
+void AHoudiniBuildManager::OnNodeStateChanged(UAutomationGraphNode* GraphNode, EAutomationGraphNodeState NewState)
 {
-	double TimeDelta = FPlatformTime::Seconds() - LastTimePolled;
-	if (TimeDelta < kBuildPollRateSec)
+	if (!ActiveNodes.Contains(GraphNode))
 	{
+		// Not something we started (or it was cancelled).
 		return;
 	}
 	
-	TSet<TObjectPtr<UAutomationGraphNode>> ToAdd;
-	TSet<TObjectPtr<UAutomationGraphNode>> ToRemove;
-	
-	for(TObjectPtr<UAutomationGraphNode> CurrentNode : ActiveNodes)
 	{
-		if (!CurrentNode)
-		{
-			UE_LOG(LogEHERuntime, Error, TEXT("error: AHoudiniBuildManager::Tick() BuildNode is invalid."));
-			ToRemove.Add(CurrentNode);
-			continue;
-		}
-
-		EAutomationGraphNodeState NodeState = CurrentNode->GetState();
+		// Notifying children can finish nodes synchronously, which calls back in here. Make sure none of those nested
+		// calls end the run while we are still walking the plan.
+		TGuardValue<bool> HandlingGuard(bHandlingNodeStateChange, true);
 		
-		switch (NodeState)
+		const int32 NodeIndex = RunPlan.IsValid() ? RunPlan->IndexOf(GraphNode) : INDEX_NONE;
+	
+		switch (NewState)
 		{
 		case EAutomationGraphNodeState::Active:
-			continue;
-		case EAutomationGraphNodeState::Standby:
-			CurrentNode->Activate();
-			continue;
+			if (NodeIndex != INDEX_NONE)
+			{
+				QueuePipelinedChildren(NodeIndex);
+			}
+			break;
 		case EAutomationGraphNodeState::Finished:
-			for (UAutomationGraphNode* ChildNode : CurrentNode->ChildNodes)
+			ActiveNodes.Remove(GraphNode);
+			if (NodeIndex != INDEX_NONE)
 			{
-				if (ChildNode->CanActivate())
+				// Nodes skipped because the interrupted run finished them changed whatever they changed back then.
+				// Nodes run by another process may have changed anything, as far as this one knows.
+				const bool* bJournaledUnchanged = GraphNode->WasFinishedUpToDate() ? Journal.FindNode(GraphNode) : nullptr;
+				NodeOutputUnchanged[NodeIndex] = NodeRunsInShard[NodeIndex] && (bJournaledUnchanged ? *bJournaledUnchanged : GraphNode->HasUnchangedOutput());
+				Journal.RecordNode(GraphNode, NodeOutputUnchanged[NodeIndex]);
+				if (!GraphNode->WasFinishedUpToDate())
+				{
+					BuildHistory.RecordNode(GraphNode, FPlatformTime::Seconds() - NodeTimeStarted[NodeIndex]);
+					MarkDirtyIfHistoryChanged();
+				}
+				QueueDirtiedPackages(NodeIndex, true);
+			
+				for (int32 ChildIndex : RunPlan->GetChildren(NodeIndex))
 				{
-					if (ChildNode->Activate())
+					if (--RemainingParents[ChildIndex] == 0)
 					{
-						ToAdd.Add(ChildNode);
+						if (auto* ChildSequenceNode = Cast<UHoudiniBuildSequenceNode>(RunPlan->Nodes[ChildIndex]))
+						{
+							// Pipelined children may already be running, and can now start the work items that were
+							// waiting for the whole parent.
+							ChildSequenceNode->NotifyParentNodesFinished();
+						}
+						ReadyNodes.HeapPush(ChildIndex, FLongestCriticalPathFirst{CriticalPathSec});
 					}
 				}
+				QueuePipelinedChildren(NodeIndex);
 			}
-			
-			ToRemove.Add(CurrentNode);
-			continue;
+			break;
 		case EAutomationGraphNodeState::Expired:
 		case EAutomationGraphNodeState::Error:
-			ToRemove.Add(CurrentNode);
-			continue;
+			ActiveNodes.Remove(GraphNode);
+			bRunFailed = true;
+
+			// Packages already saved stay saved, but whatever is still waiting may be half built by now.
+			SaveQueue.Reset();
+			if (NodeIndex != INDEX_NONE)
+			{
+				QueueDirtiedPackages(NodeIndex, false);
+				
+				// Pipelined children that already started would otherwise wait forever for this node.
+				for (int32 ChildIndex : RunPlan->GetChildren(NodeIndex))
+				{
+					UAutomationGraphNode* ChildNode = RunPlan->Nodes[ChildIndex];
+					if (ChildNode->GetState() == EAutomationGraphNodeState::Active)
+					{
+						UE_LOG(LogEHERuntime, Error, TEXT("error: AHoudiniBuildManager: stopping %s because a parent node failed."), *ChildNode->Title.ToString());
+						ChildNode->SetState(EAutomationGraphNodeState::Error);
+					}
+				}
+			}
+			break;
 		default:
-			UE_LOG(LogEHERuntime, Error, TEXT("error: AHoudiniBuildManager::Tick() unexpected build state: %s."), *UEnum::GetValueAsString(NodeState));
-			ToRemove.Add(CurrentNode);
+			UE_LOG(LogEHERuntime, Error, TEXT("error: AHoudiniBuildManager::OnNodeStateChanged() unexpected build state: %s."), *UEnum::GetValueAsString(NewState));
+			ActiveNodes.Remove(GraphNode);
+			break;
+		}
+
+		if (NewState != EAutomationGraphNodeState::Active && NodeIndex != INDEX_NONE)
+		{
+			OnNodeEndedDelegate.Broadcast(this, NodeIndex, GraphNode);
+		}
+	}
+
+	// Children that just became ready are started right away, instead of waiting for the next tick.
+	ProcessReadyNodes();
+	UpdateTickEnabled();
+}
+
+void AHoudiniBuildManager::OnWorkItemStateChanged(UHoudiniBuildWorkItem* WorkItem, EEHEBuildState NewState)
+{
+	if (!WorkItem || !WorkItem->GetOwner())
+	{
+		return;
+	}
+
+	// The node keeps a work item with a retry pending in flight. It's submitted again from here once its backoff is over.
+	if ((NewState == EEHEBuildState::Error || NewState == EEHEBuildState::Expired) && WorkItem->IsRetryPending())
+	{
+		const double BackoffSec = WorkItem->GetOwner()->BuildInfo.RetryPolicy.GetBackoffSec(WorkItem->GetNumRetries());
+		UE_LOG(LogEHERuntime, Warning, TEXT("warning: %s %s on attempt %d, retrying in %.1lf seconds."), *GetNameSafe(WorkItem->GetAssetActor().Get()), NewState == EEHEBuildState::Expired ? TEXT("expired") : TEXT("failed"), WorkItem->GetNumAttempts(), BackoffSec);
+		
+		Deadlines.HeapPush(FEHEBuildDeadline{FPlatformTime::Seconds() + BackoffSec, WorkItem, WorkItem->GetBuildSerial(), false, true});
+		UpdateTickEnabled();
+		return;
+	}
+	if (WorkItem->IsSimulated() && NewState != EEHEBuildState::Building)
+	{
+		// Nothing was actually built, so there is nothing to remember.
+		return;
+	}
+	if (NewState == EEHEBuildState::Finished && (WorkItem->GetBuildDuration() > 0.0 || WorkItem->WasRestoredFromJournal()))
+	{
+		// Journaled before the node gets to react, so it's on disk before anything downstream starts.
+		Journal.RecordWorkItem(WorkItem);
+		
+		// Restoring from the cook cache or the journal, copying an identical instance or sharing a batched cook says
+		// nothing about how long a cook takes.
+		if (!WorkItem->WasRestoredFromCache() && !WorkItem->WasRestoredFromJournal() && !WorkItem->WasCopiedFromRepresentative() && !WorkItem->WasCookedInBatch())
+		{
+			BuildHistory.RecordWorkItem(WorkItem, WorkItem->GetBuildDuration());
+		}
+		BuildHistory.RecordFingerprint(WorkItem, WorkItem->GetFingerprint());
+		BuildHistory.RecordOutputHash(WorkItem, WorkItem->GetOutputHash());
+		if (WorkItem->GetOwner()->ReloadsDefinitions())
+		{
+			BuildHistory.RecordDefinitionVersion(WorkItem, WorkItem->GetDefinitionVersion());
+		}
+		MarkDirtyIfHistoryChanged();
+		return;
+	}
+	if (NewState == EEHEBuildState::Error || NewState == EEHEBuildState::Expired)
+	{
+		// A failed build leaves the actor in an unknown state, so it must be built again next time.
+		BuildHistory.RecordFingerprint(WorkItem, FString());
+		if (WorkItem->GetOwner()->ReloadsDefinitions())
+		{
+			BuildHistory.RecordDefinitionVersion(WorkItem, INDEX_NONE);
+		}
+		MarkDirtyIfHistoryChanged();
+		return;
+	}
+	if (NewState != EEHEBuildState::Building)
+	{
+		return;
+	}
+
+	const FHoudiniBuildSequenceInfo& BuildInfo = WorkItem->GetOwner()->BuildInfo;
+	const double TimeStarted = WorkItem->GetTimeStarted();
+	
+	// Retries get longer timeouts, in case the last attempt was only just too slow.
+	const double TimeoutScale = BuildInfo.RetryPolicy.GetTimeoutScale(WorkItem->GetNumRetries());
+	
+	Deadlines.HeapPush(FEHEBuildDeadline{TimeStarted + BuildInfo.BuildWarnTimeoutSec * TimeoutScale, WorkItem, WorkItem->GetBuildSerial(), false});
+	Deadlines.HeapPush(FEHEBuildDeadline{TimeStarted + BuildInfo.BuildFailTimeoutSec * TimeoutScale, WorkItem, WorkItem->GetBuildSerial(), true});
+	
+	UpdateTickEnabled();
+}
+
+void AHoudiniBuildManager::OnPackageMarkedDirty(UPackage* Package, bool bWasDirty)
+{
+	if (!Package || !RunPlan.IsValid() || Package->HasAnyFlags(RF_Transient) || Package == GetTransientPackage())
+	{
+		return;
+	}
+
+	// The map and the build manager are saved at the end of the run, saving them halfway is just slow.
+	if (Package == GetPackage() || (GetWorld() && Package == GetWorld()->GetPackage()))
+	{
+		return;
+	}
+	
+	// Packages holding the outputs of a cook belong to the node that submitted it, which may be another manager's.
+	UHoudiniCookArbiter* Arbiter = UHoudiniCookArbiter::Get(this);
+	if (UHoudiniBuildWorkItem* WorkItem = Arbiter ? Arbiter->FindBuildingWorkItem(Package) : nullptr)
+	{
+		const int32 NodeIndex = RunPlan->IndexOf(WorkItem->GetOwner());
+		if (NodeIndex != INDEX_NONE && ActiveNodes.Contains(WorkItem->GetOwner()))
+		{
+			DirtiedPackages.FindOrAdd(Package).AddUnique(NodeIndex);
+		}
+		return;
+	}
+	
+	// Otherwise several nodes can be building at once, and there's no telling which one this came from.
+	TArray<int32>& NodeIndices = DirtiedPackages.FindOrAdd(Package);
+	for (UAutomationGraphNode* GraphNode : ActiveNodes)
+	{
+		const int32 NodeIndex = RunPlan->IndexOf(GraphNode);
+		if (NodeIndex != INDEX_NONE)
+		{
+			NodeIndices.AddUnique(NodeIndex);
+		}
+	}
+}
+
+void AHoudiniBuildManager::QueueDirtiedPackages(int32 NodeIndex, bool bSave)
+{
+	int32 NumQueued = 0;
+	for (auto It = DirtiedPackages.CreateIterator(); It; ++It)
+	{
+		if (It->Value.Remove(NodeIndex) == 0 || !It->Value.IsEmpty())
+		{
 			continue;
 		}
+
+		// Packages touched by a failed node may be half built. Once the run has failed, nothing more is saved.
+		if (bSave && !bRunFailed)
+		{
+			SaveQueue.Enqueue(It->Key.Get());
+			++NumQueued;
+		}
+		It.RemoveCurrent();
+	}
+
+	if (NumQueued > 0)
+	{
+		UE_LOG(LogEHERuntime, Verbose, TEXT("AHoudiniBuildManager: queued %d packages from %s for saving."), NumQueued, *RunPlan->Nodes[NodeIndex]->Title.ToString());
+	}
+}
+
+void AHoudiniBuildManager::ProcessReadyNodes()
+{
+	// Activating a node can finish it (and ready its children) synchronously, so guard against re-entry and just let
+	// the outer loop pick up anything that gets appended.
+	if (bProcessingReadyNodes)
+	{
+		return;
+	}
+	TGuardValue<bool> ProcessingGuard(bProcessingReadyNodes, true);
+
+	while (!ReadyNodes.IsEmpty() && RunPlan.IsValid())
+	{
+		int32 NodeIndex = INDEX_NONE;
+		ReadyNodes.HeapPop(NodeIndex, FLongestCriticalPathFirst{CriticalPathSec});
+		
+		UAutomationGraphNode* GraphNode = RunPlan->Nodes[NodeIndex];
+		if (!GraphNode)
+		{
+			UE_LOG(LogEHERuntime, Error, TEXT("error: AHoudiniBuildManager::ProcessReadyNodes() GraphNode is invalid."));
+			continue;
+		}
+		if (GraphNode->GetState() == EAutomationGraphNodeState::Uninitialized)
+		{
+			// It failed to initialize, so it and everything after it can't run.
+			UE_LOG(LogEHERuntime, Error, TEXT("error: AHoudiniBuildManager::ProcessReadyNodes(): %s was never initialized."), *GraphNode->Title.ToString());
+			bRunFailed = true;
+			continue;
+		}
+		if (GraphNode->GetState() != EAutomationGraphNodeState::Standby)
+		{
+			// Already started early as a pipelined child, and maybe already done.
+			continue;
+		}
+		if (CanStartNodeDelegate.IsBound() && !CanStartNodeDelegate.Execute(this, NodeIndex))
+		{
+			HeldNodes.AddUnique(NodeIndex);
+			continue;
+		}
+
+		ActiveNodes.Add(GraphNode);
+		NodeTimeStarted[NodeIndex] = FPlatformTime::Seconds();
+
+		if (!NodeRunsInShard[NodeIndex])
+		{
+			// Another process of a split build runs it.
+			GraphNode->FinishUpToDate();
+			continue;
+		}
+
+		// Nodes that don't cook HDAs run again when resuming, even if the interrupted run finished them, since there is
+		// no telling whether what they changed was saved. HDA nodes are resumed work item by work item instead.
+		if (CanCutOff(NodeIndex))
+		{
+			GraphNode->FinishUpToDate();
+			continue;
+		}
+		if (!GraphNode->Activate() && GraphNode->GetState() == EAutomationGraphNodeState::Standby)
+		{
+			UE_LOG(LogEHERuntime, Error, TEXT("error: AHoudiniBuildManager::ProcessReadyNodes() failed to activate node."));
+			ActiveNodes.Remove(GraphNode);
+		}
+	}
+
+	ReadyNodes.Empty();
+}
+
+bool AHoudiniBuildManager::CanStartPipelined(int32 NodeIndex) const
+{
+	auto* BuildSequenceNode = Cast<UHoudiniBuildSequenceNode>(RunPlan->Nodes[NodeIndex]);
+	if (!BuildSequenceNode || !BuildSequenceNode->IsPipelined() || BuildSequenceNode->GetState() != EAutomationGraphNodeState::Standby)
+	{
+		return false;
+	}
+
+	// Nodes without work items finish as soon as they start, so they have to wait for their parents like any other.
+	if (BuildSequenceNode->GetWorkItems().IsEmpty())
+	{
+		return false;
+	}
+
+	// HDA parents only have to have started, anything else has to be done.
+	for (int32 ParentIndex : RunPlan->GetParents(NodeIndex))
+	{
+		UAutomationGraphNode* ParentNode = RunPlan->Nodes[ParentIndex];
+		const EAutomationGraphNodeState ParentState = ParentNode->GetState();
+		
+		const bool bParentStarted = ParentState == EAutomationGraphNodeState::Active && ParentNode->IsA<UHoudiniBuildSequenceNode>();
+		if (ParentState != EAutomationGraphNodeState::Finished && !bParentStarted)
+		{
+			return false;
+		}
 	}
 
-	ActiveNodes.Append(ToAdd);
-	for(TObjectPtr<UAutomationGraphNode> RemoveNode : ToRemove)
+	return true;
+}
+
+void AHoudiniBuildManager::QueuePipelinedChildren(int32 NodeIndex)
+{
+	for (int32 ChildIndex : RunPlan->GetChildren(NodeIndex))
+	{
+		if (CanStartPipelined(ChildIndex))
+		{
+			ReadyNodes.HeapPush(ChildIndex, FLongestCriticalPathFirst{CriticalPathSec});
+		}
+	}
+}
+
+bool AHoudiniBuildManager::CanCutOff(int32 NodeIndex) const
+{
+	UAutomationGraphNode* GraphNode = RunPlan->Nodes[NodeIndex];
+	if (!GraphNode->bSkipWhenInputsUnchanged || !GraphNode->SupportsEarlyCutoff())
+	{
+		return false;
+	}
+
+	// Root nodes have no inputs to compare against.
+	TArrayView<const int32> ParentIndices = RunPlan->GetParents(NodeIndex);
+	if (ParentIndices.IsEmpty())
+	{
+		return false;
+	}
+	
+	for (int32 ParentIndex : ParentIndices)
+	{
+		if (!NodeOutputUnchanged[ParentIndex])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void AHoudiniBuildManager::ProcessDeadlines(double CurrentTime)
+{
+	while (!Deadlines.IsEmpty() && Deadlines.HeapTop().Time <= CurrentTime)
+	{
+		FEHEBuildDeadline Deadline;
+		Deadlines.HeapPop(Deadline);
+
+		// Deadlines for work items that already finished are simply dropped by the work item.
+		UHoudiniBuildWorkItem* WorkItem = Deadline.WorkItem.Get();
+		if (WorkItem && Deadline.bRetryDeadline)
+		{
+			WorkItem->OnRetryDeadlineReached(Deadline.BuildSerial);
+		}
+		else if (WorkItem)
+		{
+			WorkItem->OnDeadlineReached(Deadline.BuildSerial, Deadline.bFailDeadline);
+		}
+	}
+}
+
+void AHoudiniBuildManager::UpdateTickEnabled()
+{
+	if (ActiveNodes.IsEmpty() && HeldNodes.IsEmpty() && !bProcessingReadyNodes && !bHandlingNodeStateChange)
+	{
+		// The run is over, any remaining timeouts belong to work items that are no longer relevant. A failed run keeps
+		// its journal, so it can be resumed.
+		Deadlines.Empty();
+		if (Journal.IsOpen())
+		{
+			Journal.Close(!bRunFailed);
+		}
+		UnbindGraphEvents();
+	}
+
+	// Held back nodes are retried from the tick, and the save queue keeps draining after the run.
+	SetActorTickEnabled(!Deadlines.IsEmpty() || !HeldNodes.IsEmpty() || !SaveQueue.IsEmpty());
+}
+
+void AHoudiniBuildManager::MarkDirtyIfHistoryChanged()
+{
+	if (BuildHistory.ConsumeChanges())
+	{
+		MarkPackageDirty();
+	}
+}
+
+FString AHoudiniBuildManager::GetJournalPath() const
+{
+	FString JournalName = FPaths::MakeValidFileName(GetPathName(), TEXT('_'));
+	if (Shard.IsValid())
 	{
-		ActiveNodes.Remove(RemoveNode);
+		JournalName += FString::Printf(TEXT(".shard_%d"), Shard.Index);
 	}
+	else if (Shard.Nodes == EHoudiniBuildShardNodes::SharedNodesBefore)
+	{
+		JournalName += TEXT(".before_shards");
+	}
+	else if (Shard.Nodes == EHoudiniBuildShardNodes::SharedNodesAfter)
+	{
+		JournalName += TEXT(".after_shards");
+	}
+	
+	return FPaths::ProjectSavedDir() / TEXT("HoudiniBuild/Journal") / JournalName + TEXT(".journal");
+}
 
-	LastTimePolled = FPlatformTime::Seconds();
+bool AHoudiniBuildManager::HasJournal() const
+{
+	return IFileManager::Get().FileExists(*GetJournalPath());
 }
 
 void AHoudiniBuildManager::ResetSequenceGraph()
@@ -351,8 +1073,49 @@ void AHoudiniBuildManager::ResetSequenceGraph()
 
 void AHoudiniBuildManager::Cancel()
 {
+	// Take this run's work items back from the cook arbiter, so they don't hold on to cook slots or get started later.
+	if (UHoudiniCookArbiter* CookArbiter = UHoudiniCookArbiter::Get(this))
+	{
+		for (UAutomationGraphNode* GraphNode : ActiveNodes)
+		{
+			auto* BuildSequenceNode = Cast<UHoudiniBuildSequenceNode>(GraphNode);
+			if (!BuildSequenceNode)
+			{
+				continue;
+			}
+			for (UHoudiniBuildWorkItem* WorkItem : BuildSequenceNode->GetWorkItems())
+			{
+				CookArbiter->Withdraw(WorkItem);
+			}
+		}
+	}
+	
+	// Nothing will be retried anymore, so whatever waits on a pending retry gets the failure now. Collected first, since
+	// giving up on a retry fails the work items depending on it right away.
+	TArray<TWeakObjectPtr<UHoudiniBuildWorkItem>> PendingRetries;
+	for (const FEHEBuildDeadline& Deadline : Deadlines)
+	{
+		if (Deadline.bRetryDeadline)
+		{
+			PendingRetries.Add(Deadline.WorkItem);
+		}
+	}
+	for (const TWeakObjectPtr<UHoudiniBuildWorkItem>& WorkItem : PendingRetries)
+	{
+		if (WorkItem.IsValid() && WorkItem->IsRetryPending())
+		{
+			WorkItem->Abandon();
+		}
+	}
+	
 	ActiveNodes.Empty();
-	LastTimePolled = 0.0;
+	ReadyNodes.Empty();
+	HeldNodes.Empty();
+	Deadlines.Empty();
+	SaveQueue.Reset();
+	Journal.Close(false);
+	UnbindGraphEvents();
+	SetActorTickEnabled(false);
 }
 
 
@@ -409,4 +1172,49 @@ FAutoConsoleCommandWithWorldAndArgs GHoudiniBuildManagerBuildAllCmd(
 	)
 );
 
+FAutoConsoleCommandWithWorldAndArgs GHoudiniBuildManagerResumeAllCmd(
+	TEXT("houdini.BuildManager.ResumeAll"),
+	TEXT("Resumes the interrupted runs of all HoudiniBuildManagers in the scene, skipping what they already finished."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(
+		[](const TArray<FString>& Args, UWorld* World)
+		{
+			if (!World || World->WorldType != EWorldType::Editor)
+			{
+				// If we aren't in the editor world, no point in doing anything.
+				return;
+			}
+
+			for (TActorIterator<AHoudiniBuildManager> ActorItr(World); ActorItr; ++ActorItr)
+			{
+				ActorItr->Run(true);
+			}
+		}
+	)
+);
+
+FAutoConsoleCommandWithWorldAndArgs GHoudiniBuildManagerPlanCmd(
+	TEXT("houdini.BuildManager.Plan"),
+	TEXT("Prints what every HoudiniBuildManager in the scene would build, including actors that aren't loaded."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(
+		[](const TArray<FString>& Args, UWorld* World)
+		{
+			if (!World || World->WorldType != EWorldType::Editor)
+			{
+				// If we aren't in the editor world, no point in doing anything.
+				return;
+			}
+
+			for (TActorIterator<AHoudiniBuildManager> ActorItr(World); ActorItr; ++ActorItr)
+			{
+				FHoudiniBuildDescriptorPlan Plan;
+				if (ActorItr->PlanFromDescriptors(Plan))
+				{
+					UE_LOG(LogEHERuntime, Display, TEXT("%s:"), *ActorItr->GetActorNameOrLabel());
+					Plan.Log();
+				}
+			}
+		}
+	)
+);
+
 // END CONSOLE COMMANDS ------------------------------------------------------------------------------------------------
\ No newline at end of file
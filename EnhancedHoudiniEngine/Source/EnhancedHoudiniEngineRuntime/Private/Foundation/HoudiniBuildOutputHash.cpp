@@ -0,0 +1,339 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/HoudiniBuildOutputHash.h"
+
+#include "LandscapeInfo.h"
+#include "LandscapeLayerInfoObject.h"
+#include "LandscapeProxy.h"
+#include "MeshDescription.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "HoudiniEngineRuntime/Private/HoudiniAssetComponent.h"
+#include "HoudiniEngineRuntime/Private/HoudiniOutput.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/ArchiveObjectCrc32.h"
+#include "Serialization/MemoryWriter.h"
+
+#if WITH_EDITOR
+#include "LandscapeEdit.h"
+#endif
+
+namespace
+{
+	void HashValue(FSHA1& Sha, const uint32 Value)
+	{
+		Sha.Update(reinterpret_cast<const uint8*>(&Value), sizeof(Value));
+	}
+
+	void HashString(FSHA1& Sha, const FString& String)
+	{
+		Sha.UpdateWithString(*String, String.Len());
+	}
+	
+	void HashStaticMesh(FSHA1& Sha, UStaticMesh* StaticMesh)
+	{
+#if WITH_EDITOR
+		// The mesh description is the actual geometry HE wrote, without any of the derived (render/collision) data.
+		for (int32 LODIndex = 0; LODIndex < StaticMesh->GetNumSourceModels(); ++LODIndex)
+		{
+			FMeshDescription* MeshDescription = StaticMesh->GetMeshDescription(LODIndex);
+			if (!MeshDescription)
+			{
+				continue;
+			}
+
+			TArray<uint8> Bytes;
+			FMemoryWriter Writer(Bytes);
+			Writer << *MeshDescription;
+			Sha.Update(Bytes.GetData(), Bytes.Num());
+		}
+#endif
+
+		// Materials, collision settings, etc.
+		HashValue(Sha, FArchiveObjectCrc32().Crc32(StaticMesh));
+	}
+
+	void HashInstances(FSHA1& Sha, UInstancedStaticMeshComponent* InstancedComponent)
+	{
+		HashString(Sha, GetPathNameSafe(InstancedComponent->GetStaticMesh()));
+		
+		for (int32 InstanceIndex = 0; InstanceIndex < InstancedComponent->GetInstanceCount(); ++InstanceIndex)
+		{
+			FTransform InstanceTransform;
+			InstancedComponent->GetInstanceTransform(InstanceIndex, InstanceTransform, true);
+			HashString(Sha, InstanceTransform.ToString());
+		}
+	}
+
+	void HashLandscapeRegion(FSHA1& Sha, ALandscapeProxy* LandscapeProxy, const FIntRect& Region)
+	{
+		HashString(Sha, LandscapeProxy->GetActorTransform().ToString());
+		HashString(Sha, Region.ToString());
+
+#if WITH_EDITOR
+		ULandscapeInfo* LandscapeInfo = LandscapeProxy->GetLandscapeInfo();
+		if (!LandscapeInfo)
+		{
+			return;
+		}
+
+		// Only the region the HDA wrote to is read back, which is a small part of most landscapes. Reads go through the
+		// landscape's current edit layer, like the cook cache.
+		const int32 NumSamples = (Region.Width() + 1) * (Region.Height() + 1);
+		FLandscapeEditDataInterface LandscapeEdit(LandscapeInfo);
+		
+		TArray<uint16> Heights;
+		Heights.SetNumZeroed(NumSamples);
+		LandscapeEdit.GetHeightDataFast(Region.Min.X, Region.Min.Y, Region.Max.X, Region.Max.Y, Heights.GetData(), 0);
+		Sha.Update(reinterpret_cast<const uint8*>(Heights.GetData()), Heights.Num() * Heights.GetTypeSize());
+
+		TArray<ULandscapeLayerInfoObject*> LayerInfos;
+		for (const FLandscapeInfoLayerSettings& LayerSettings : LandscapeInfo->Layers)
+		{
+			if (LayerSettings.LayerInfoObj)
+			{
+				LayerInfos.Add(LayerSettings.LayerInfoObj);
+			}
+		}
+		LayerInfos.Sort([](const ULandscapeLayerInfoObject& A, const ULandscapeLayerInfoObject& B)
+		{
+			return A.LayerName.LexicalLess(B.LayerName);
+		});
+		
+		TArray<uint8> Weights;
+		for (ULandscapeLayerInfoObject* LayerInfo : LayerInfos)
+		{
+			Weights.Reset();
+			Weights.SetNumZeroed(NumSamples);
+			LandscapeEdit.GetWeightDataFast(LayerInfo, Region.Min.X, Region.Min.Y, Region.Max.X, Region.Max.Y, Weights.GetData(), 0);
+			HashString(Sha, LayerInfo->LayerName.ToString());
+			Sha.Update(Weights.GetData(), Weights.Num());
+		}
+#endif
+	}
+
+	void HashOutputObject(FSHA1& Sha, UObject* Object, TMap<ALandscapeProxy*, FIntRect>& OutLandscapeRegions)
+	{
+		if (!IsValid(Object))
+		{
+			return;
+		}
+		
+		if (auto* StaticMesh = Cast<UStaticMesh>(Object))
+		{
+			HashStaticMesh(Sha, StaticMesh);
+		}
+		else if (auto* InstancedComponent = Cast<UInstancedStaticMeshComponent>(Object))
+		{
+			HashInstances(Sha, InstancedComponent);
+		}
+		else if (Object->IsA<ALandscapeProxy>())
+		{
+			FHoudiniBuildOutputHash::AddLandscapeRegions(Object, OutLandscapeRegions);
+		}
+		else
+		{
+			FHoudiniBuildOutputHash::AddLandscapeRegions(Object, OutLandscapeRegions);
+			HashValue(Sha, FArchiveObjectCrc32().Crc32(Object));
+		}
+	}
+}
+
+void FHoudiniBuildOutputHash::FindReferencedLandscapes(UObject* Object, TSet<ALandscapeProxy*>& OutLandscapes)
+{
+	for (TFieldIterator<FObjectPropertyBase> PropertyIt(Object->GetClass()); PropertyIt; ++PropertyIt)
+	{
+		if (!PropertyIt->PropertyClass || !PropertyIt->PropertyClass->IsChildOf(ALandscapeProxy::StaticClass()))
+		{
+			continue;
+		}
+
+		for (int32 ArrayIndex = 0; ArrayIndex < PropertyIt->ArrayDim; ++ArrayIndex)
+		{
+			UObject* Referenced = PropertyIt->GetObjectPropertyValue_InContainer(Object, ArrayIndex);
+			if (auto* LandscapeProxy = Cast<ALandscapeProxy>(Referenced))
+			{
+				OutLandscapes.Add(LandscapeProxy);
+			}
+		}
+	}
+}
+
+void FHoudiniBuildOutputHash::AddLandscapeRegions(UObject* Object, TMap<ALandscapeProxy*, FIntRect>& InOutRegions)
+{
+	auto AddRegion = [&InOutRegions](ALandscapeProxy* LandscapeProxy, FIntRect Region)
+	{
+		FIntRect LandscapeExtent;
+		if (!GetLandscapeExtent(LandscapeProxy, LandscapeExtent))
+		{
+			return;
+		}
+		if (Region.Max.X < LandscapeExtent.Min.X || Region.Min.X > LandscapeExtent.Max.X || Region.Max.Y < LandscapeExtent.Min.Y || Region.Min.Y > LandscapeExtent.Max.Y)
+		{
+			return;
+		}
+		Region.Clip(LandscapeExtent);
+		
+		if (FIntRect* ExistingRegion = InOutRegions.Find(LandscapeProxy))
+		{
+			ExistingRegion->Union(Region);
+		}
+		else
+		{
+			InOutRegions.Add(LandscapeProxy, Region);
+		}
+	};
+	
+	if (auto* LayerOutput = Cast<UHoudiniLandscapeTargetLayerOutput>(Object))
+	{
+		ALandscapeProxy* LandscapeProxy = LayerOutput->LandscapeProxy;
+		if (!LandscapeProxy)
+		{
+			LandscapeProxy = LayerOutput->Landscape;
+		}
+		if (!IsValid(LandscapeProxy))
+		{
+			return;
+		}
+
+		// Layers of a landscape the HDA created don't record extents, they cover all of it.
+		const FHoudiniExtents& Extents = LayerOutput->Extents;
+		const bool bHasExtents = Extents.Min.X <= Extents.Max.X && Extents.Min.Y <= Extents.Max.Y;
+		AddRegion(LandscapeProxy, bHasExtents ? FIntRect(Extents.Min, Extents.Max) : FIntRect(MIN_int32, MIN_int32, MAX_int32, MAX_int32));
+		return;
+	}
+
+	TSet<ALandscapeProxy*> Landscapes;
+	if (auto* LandscapeProxy = Cast<ALandscapeProxy>(Object))
+	{
+		Landscapes.Add(LandscapeProxy);
+	}
+	else
+	{
+		FindReferencedLandscapes(Object, Landscapes);
+	}
+	for (ALandscapeProxy* LandscapeProxy : Landscapes)
+	{
+		AddRegion(LandscapeProxy, FIntRect(MIN_int32, MIN_int32, MAX_int32, MAX_int32));
+	}
+}
+
+bool FHoudiniBuildOutputHash::GetLandscapeExtent(ALandscapeProxy* LandscapeProxy, FIntRect& OutExtent)
+{
+	ULandscapeInfo* LandscapeInfo = LandscapeProxy ? LandscapeProxy->GetLandscapeInfo() : nullptr;
+	return LandscapeInfo && LandscapeInfo->GetLandscapeExtent(OutExtent.Min.X, OutExtent.Min.Y, OutExtent.Max.X, OutExtent.Max.Y);
+}
+
+FString FHoudiniBuildOutputHash::Compute(UHoudiniAssetComponent* AssetComponent)
+{
+	if (!AssetComponent)
+	{
+		return FString();
+	}
+	
+	FSHA1 Sha;
+	TMap<ALandscapeProxy*, FIntRect> LandscapeRegions;
+	
+	for (int32 OutputIndex = 0; OutputIndex < AssetComponent->GetNumOutputs(); ++OutputIndex)
+	{
+		UHoudiniOutput* Output = AssetComponent->GetOutputAt(OutputIndex);
+		if (!Output)
+		{
+			continue;
+		}
+
+		HashValue(Sha, static_cast<uint32>(Output->GetType()));
+		for (auto& OutputObjectPair : Output->GetOutputObjects())
+		{
+			FHoudiniOutputObject& OutputObject = OutputObjectPair.Value;
+			
+			HashOutputObject(Sha, OutputObject.OutputObject, LandscapeRegions);
+			for (UObject* OutputComponent : OutputObject.OutputComponents)
+			{
+				HashOutputObject(Sha, OutputComponent, LandscapeRegions);
+			}
+		}
+	}
+
+	// Several outputs can write to the same landscape, so each one is only hashed once, over the union of the regions
+	// they wrote. Sorted, since map order isn't stable from one cook to the next.
+	LandscapeRegions.KeySort([](const ALandscapeProxy& A, const ALandscapeProxy& B)
+	{
+		return A.GetPathName() < B.GetPathName();
+	});
+	for (const TPair<ALandscapeProxy*, FIntRect>& LandscapeRegion : LandscapeRegions)
+	{
+		HashLandscapeRegion(Sha, LandscapeRegion.Key, LandscapeRegion.Value);
+	}
+
+	Sha.Final();
+	FSHAHash Hash;
+	Sha.GetHash(Hash.Hash);
+	return Hash.ToString();
+}
+
+bool FHoudiniBuildOutputHash::AreOutputsPresent(UHoudiniAssetComponent* AssetComponent, const FString& LastOutputHash)
+{
+	if (!AssetComponent || LastOutputHash.IsEmpty())
+	{
+		return false;
+	}
+
+	int32 NumOutputObjects = 0;
+	for (int32 OutputIndex = 0; OutputIndex < AssetComponent->GetNumOutputs(); ++OutputIndex)
+	{
+		UHoudiniOutput* Output = AssetComponent->GetOutputAt(OutputIndex);
+		if (!Output)
+		{
+			continue;
+		}
+
+		for (auto& OutputObjectPair : Output->GetOutputObjects())
+		{
+			const FHoudiniOutputObject& OutputObject = OutputObjectPair.Value;
+			bool bHasObject = IsValid(OutputObject.OutputObject);
+			for (UObject* OutputComponent : OutputObject.OutputComponents)
+			{
+				bHasObject |= IsValid(OutputComponent);
+			}
+			if (!bHasObject)
+			{
+				return false;
+			}
+			NumOutputObjects++;
+		}
+	}
+
+	// Hashing a component without outputs is cheap, and tells apart a cook that produced nothing from outputs that were
+	// cleared since.
+	return NumOutputObjects > 0 || Compute(AssetComponent) == LastOutputHash;
+}
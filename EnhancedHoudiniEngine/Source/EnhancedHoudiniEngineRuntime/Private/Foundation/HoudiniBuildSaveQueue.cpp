@@ -0,0 +1,118 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/HoudiniBuildSaveQueue.h"
+
+#include "EHERuntimeLoggingDefs.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+
+static TAutoConsoleVariable<int32> CVarHoudiniBuildSaveQueueSize(
+	TEXT("houdini.BuildManager.SaveQueueSize"),
+	64,
+	TEXT("How many packages can wait to be saved during a run before they are saved right away.")
+);
+
+void FHoudiniBuildSaveQueue::Enqueue(UPackage* Package)
+{
+	if (!Package || Packages.Contains(Package))
+	{
+		return;
+	}
+
+	Packages.Add(Package);
+	while (Packages.Num() > FMath::Max(1, CVarHoudiniBuildSaveQueueSize.GetValueOnGameThread()))
+	{
+		SaveNext();
+	}
+}
+
+void FHoudiniBuildSaveQueue::Tick(double BudgetSec)
+{
+	const double EndTime = FPlatformTime::Seconds() + BudgetSec;
+	do
+	{
+		SaveNext();
+	}
+	while (!Packages.IsEmpty() && FPlatformTime::Seconds() < EndTime);
+}
+
+bool FHoudiniBuildSaveQueue::Flush()
+{
+	const int32 NumFailedBefore = NumFailed;
+	while (!Packages.IsEmpty())
+	{
+		SaveNext();
+	}
+	UPackage::WaitForAsyncFileWrites();
+	
+	return NumFailed == NumFailedBefore;
+}
+
+void FHoudiniBuildSaveQueue::Reset()
+{
+	Packages.Empty();
+}
+
+bool FHoudiniBuildSaveQueue::SaveNext()
+{
+	if (Packages.IsEmpty())
+	{
+		return false;
+	}
+
+	UPackage* Package = Packages[0].Get();
+	Packages.RemoveAt(0);
+	if (!Package || !Package->IsDirty())
+	{
+		// Unloaded, or saved by someone else in the meantime.
+		return true;
+	}
+
+#if WITH_EDITOR
+	const FString Extension = Package->ContainsMap() ? FPackageName::GetMapPackageExtension() : FPackageName::GetAssetPackageExtension();
+	const FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(), Extension);
+
+	FSavePackageArgs SaveArgs;
+	SaveArgs.TopLevelFlags = RF_Standalone;
+	SaveArgs.SaveFlags = SAVE_Async | SAVE_NoError;
+	if (UPackage::Save(Package, nullptr, *Filename, SaveArgs).IsSuccessful())
+	{
+		++NumSaved;
+		return true;
+	}
+#endif
+
+	UE_LOG(LogEHERuntime, Error, TEXT("error: FHoudiniBuildSaveQueue::SaveNext(): Failed to save %s."), *Package->GetName());
+	++NumFailed;
+	return false;
+}
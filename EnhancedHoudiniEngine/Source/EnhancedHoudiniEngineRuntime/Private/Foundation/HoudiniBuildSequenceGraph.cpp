@@ -71,4 +71,37 @@ UHoudiniBuildSequenceGraph::UHoudiniBuildSequenceGraph(const FObjectInitializer&
 	});
 }
 
+TArray<FAutomationGraphSupportedNodeInfo> UHoudiniBuildSequenceGraph::GetSupportedNodeInfo()
+{
+	TArray<FAutomationGraphSupportedNodeInfo> Result = SupportedNodeInfo;
+	for (const FAutomationGraphSupportedNodeInfo& Info : GetRegisteredNodeInfo())
+	{
+		if (Info.NodeType)
+		{
+			Result.Add(Info);
+		}
+	}
+	return Result;
+}
+
+void UHoudiniBuildSequenceGraph::RegisterNodeType(TSubclassOf<UAutomationGraphNode> NodeType, const FText& Category)
+{
+	UnregisterNodeType(NodeType);
+	GetRegisteredNodeInfo().Add(FAutomationGraphSupportedNodeInfo{NodeType, Category});
+}
+
+void UHoudiniBuildSequenceGraph::UnregisterNodeType(TSubclassOf<UAutomationGraphNode> NodeType)
+{
+	GetRegisteredNodeInfo().RemoveAll([NodeType](const FAutomationGraphSupportedNodeInfo& Info)
+	{
+		return Info.NodeType == NodeType;
+	});
+}
+
+TArray<FAutomationGraphSupportedNodeInfo>& UHoudiniBuildSequenceGraph::GetRegisteredNodeInfo()
+{
+	static TArray<FAutomationGraphSupportedNodeInfo> RegisteredNodeInfo;
+	return RegisteredNodeInfo;
+}
+
 #undef LOCTEXT_NAMESPACE
\ No newline at end of file
@@ -33,20 +33,50 @@
 
 #include "EHERuntimeLoggingDefs.h"
 #include "HoudiniAssetActor.h"
+#include "LandscapeProxy.h"
+#include "Engine/World.h"
+#include "Foundation/HoudiniBuildBatch.h"
+#include "Foundation/HoudiniBuildFingerprint.h"
+#include "Foundation/HoudiniBuildJournal.h"
 #include "Foundation/HoudiniBuildManager.h"
+#include "Foundation/HoudiniBuildOutputHash.h"
+#include "Foundation/HoudiniCookArbiter.h"
+#include "Foundation/HoudiniCookCache.h"
 #include "HoudiniEngineRuntime/Private/HoudiniAssetComponent.h"
+#include "HoudiniEngineRuntime/Private/HoudiniOutput.h"
+
+bool FHoudiniBuildRetryPolicy::CanRetry(EEHEBuildState FailedState, int32 NumRetries) const
+{
+	if (NumRetries + 1 >= MaxAttempts)
+	{
+		return false;
+	}
+	
+	return (FailedState == EEHEBuildState::Error && bRetryErrors) || (FailedState == EEHEBuildState::Expired && bRetryExpired);
+}
+
+double FHoudiniBuildRetryPolicy::GetBackoffSec(int32 NumRetries) const
+{
+	const double Backoff = BackoffSec * FMath::Pow(FMath::Max(BackoffMultiplier, 1.0), NumRetries);
+	return MaxBackoffSec > 0.0 ? FMath::Min(Backoff, MaxBackoffSec) : Backoff;
+}
+
+double FHoudiniBuildRetryPolicy::GetTimeoutScale(int32 NumRetries) const
+{
+	return FMath::Pow(FMath::Max(TimeoutMultiplier, 1.0), NumRetries);
+}
 
 bool UHoudiniBuildWorkItem::Initialize(UHoudiniBuildSequenceNode* NewOwner, AHoudiniAssetActor* AssetActor)
 {
 	if (!NewOwner || !AssetActor || !AssetActor->GetHoudiniAssetComponent())
 	{
-		BuildState = EEHEBuildState::Error;
+		SetBuildState(EEHEBuildState::Error);
 		return false;
 	}
 
 	Owner = NewOwner;
 	ToBuild = TWeakObjectPtr<AHoudiniAssetActor>(AssetActor);
-	BuildState = EEHEBuildState::Standby;
+	SetBuildState(EEHEBuildState::Standby);
 
 	return true;
 }
@@ -56,6 +86,7 @@ bool UHoudiniBuildWorkItem::Build()
 	if (BuildState == EEHEBuildState::Uninitialized)
 	{
 		UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildWorkItem::Build() attempted to build uninitialized work item"));
+		SetBuildState(EEHEBuildState::Error);
 		return false;
 	}
 	if (BuildState == EEHEBuildState::Building)
@@ -67,6 +98,7 @@ bool UHoudiniBuildWorkItem::Build()
 	if (!ToBuild.IsValid())
 	{
 		UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildWorkItem::Build() HoudiniAsset is invalid"));
+		SetBuildState(EEHEBuildState::Error);
 		return false;
 	}
 
@@ -74,217 +106,1339 @@ bool UHoudiniBuildWorkItem::Build()
 	if (!AssetComponent)
 	{
 		UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildWorkItem::Build() HoudiniAssetComponent is invalid"));
+		SetBuildState(EEHEBuildState::Error);
 		return false;
 	}
 
 	BuildStarted();
 
-	auto& OnPostOutputProcessingDelegate = AssetComponent->GetOnPostOutputProcessingDelegate();
-	if (!OnPostOutputProcessingDelegate.IsBoundToObject(this))
+	// A cook cache hit finishes right here, without going through Houdini at all.
+	if (Owner && Owner->ShouldUseCookCache() && FHoudiniCookCache::Get().Restore(Fingerprint, AssetComponent))
+	{
+		bRestoredFromCache = true;
+		OutputHash = FHoudiniBuildOutputHash::Compute(AssetComponent);
+		SetBuildState(EEHEBuildState::Finished);
+		return true;
+	}
+
+	// The leader of a batch cooks every work item in it at once. If that can't start, it cooks by itself and the rest
+	// of the batch goes back to the node once it's done.
+	if (Batch && Batch->GetLeader() == this && Batch->Start())
 	{
-		PostOutputProcessingDelegateHande = OnPostOutputProcessingDelegate.AddUObject(this, &ThisClass::OnHoudiniAssetPostProcess);
+		return true;
 	}
 
-	return BuildInternal(AssetComponent);
+	return BuildUnbatched();
 }
 
-void UHoudiniBuildWorkItem::BeginDestroy()
+bool UHoudiniBuildWorkItem::BuildUnbatched()
 {
-	if (ToBuild.IsValid())
+	UHoudiniAssetComponent* AssetComponent = ToBuild.IsValid() ? ToBuild->GetHoudiniAssetComponent() : nullptr;
+	if (!AssetComponent)
 	{
-		UHoudiniAssetComponent* AssetComponent = ToBuild.Get()->GetHoudiniAssetComponent();
-		if (AssetComponent)
-		{
-			auto& OnPostOutputProcessingDelegate = AssetComponent->GetOnPostOutputProcessingDelegate();
-			if (PostOutputProcessingDelegateHande.IsValid())
-			{
-				OnPostOutputProcessingDelegate.Remove(PostOutputProcessingDelegateHande);
-				PostOutputProcessingDelegateHande.Reset();
-			}
-		}
+		UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildWorkItem::BuildUnbatched() HoudiniAssetComponent is invalid"));
+		SetBuildState(EEHEBuildState::Error);
+		return false;
 	}
 	
-	Super::BeginDestroy();
+	// Bound for this build only, so a cook left over from an earlier build (e.g. one that expired and is now being
+	// retried) can't finish it.
+	UnbindPostProcess();
+	PostOutputProcessingDelegateHande = AssetComponent->GetOnPostOutputProcessingDelegate().AddUObject(this, &ThisClass::OnHoudiniAssetPostProcessForBuild, BuildSerial);
+
+	if (!BuildInternal(AssetComponent))
+	{
+		SetBuildState(EEHEBuildState::Error);
+		return false;
+	}
+
+	return true;
 }
 
-EEHEBuildState UHoudiniBuildWorkItem::GetBuildState()
+void UHoudiniBuildWorkItem::FinishAsDuplicate(EEHEBuildState LeaderState)
 {
-	if (!ToBuild.IsValid())
+	if (BuildState != EEHEBuildState::Standby)
+	{
+		return;
+	}
+
+	SetBuildState(LeaderState);
+}
+
+bool UHoudiniBuildWorkItem::IsUpToDate() const
+{
+	if (Fingerprint.IsEmpty() || Fingerprint != LastBuiltFingerprint)
+	{
+		return false;
+	}
+
+	UHoudiniAssetComponent* AssetComponent = ToBuild.IsValid() ? ToBuild->GetHoudiniAssetComponent() : nullptr;
+	return FHoudiniBuildOutputHash::AreOutputsPresent(AssetComponent, LastOutputHash);
+}
+
+bool UHoudiniBuildWorkItem::OwnsPackage(const UPackage* Package) const
+{
+	AHoudiniAssetActor* AssetActor = ToBuild.Get();
+	if (!Package || !AssetActor)
+	{
+		return false;
+	}
+	if (AssetActor->GetPackage() == Package)
+	{
+		return true;
+	}
+
+	UHoudiniAssetComponent* AssetComponent = AssetActor->GetHoudiniAssetComponent();
+	if (!AssetComponent)
 	{
-		UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildWorkItem::GetBuildState() asset is invalid"));
-		BuildState = EEHEBuildState::Error;
+		return false;
 	}
-	else if (BuildState == EEHEBuildState::Building)
+	
+	const FString& TemporaryCookFolder = AssetComponent->TemporaryCookFolder.Path;
+	if (!TemporaryCookFolder.IsEmpty() && Package->GetName().StartsWith(TemporaryCookFolder / TEXT("")))
 	{
-		double TimeDelta = FPlatformTime::Seconds() - TimeStarted;
+		return true;
+	}
 
-		if (TimeDelta >= Owner->BuildInfo.BuildFailTimeoutSec)
+	// Outputs that live in their own package, e.g. actors spawned by the cook and landscapes it wrote to.
+	auto IsInPackage = [Package](UObject* Object)
+	{
+		if (!Object)
 		{
-			// TODO(): Double check that GetFullName is descriptive enough for debugging.
-			UE_LOG(LogEHERuntime, Error, TEXT("error: houdini asset %s has been building for %.2lf seconds"), *ToBuild.Get()->GetFullName(), TimeDelta);
-			BuildState = EEHEBuildState::Expired;
+			return false;
 		}
-		else if (TimeDelta >= Owner->BuildInfo.BuildWarnTimeoutSec)
+		if (Object->GetPackage() == Package)
 		{
-			UE_LOG(LogEHERuntime, Warning, TEXT("warning: houdini asset %s has been building for %.2lf seconds"), *ToBuild.Get()->GetFullName(), TimeDelta);
+			return true;
+		}
+		
+		TSet<ALandscapeProxy*> Landscapes;
+		FHoudiniBuildOutputHash::FindReferencedLandscapes(Object, Landscapes);
+		for (ALandscapeProxy* LandscapeProxy : Landscapes)
+		{
+			if (LandscapeProxy->GetPackage() == Package)
+			{
+				return true;
+			}
+		}
+		return false;
+	};
+	for (int32 OutputIndex = 0; OutputIndex < AssetComponent->GetNumOutputs(); ++OutputIndex)
+	{
+		UHoudiniOutput* Output = AssetComponent->GetOutputAt(OutputIndex);
+		if (!Output)
+		{
+			continue;
 		}
-	}
-
-	return BuildState;
-}
 
-void UHoudiniBuildWorkItem::BuildStarted()
-{
-	BuildState = EEHEBuildState::Building;
-	TimeStarted = FPlatformTime::Seconds();
+		for (auto& OutputObjectPair : Output->GetOutputObjects())
+		{
+			const FHoudiniOutputObject& OutputObject = OutputObjectPair.Value;
+			if (IsInPackage(OutputObject.OutputObject) || OutputObject.OutputComponents.ContainsByPredicate(IsInPackage))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
 }
 
-void UHoudiniBuildWorkItem::OnHoudiniAssetPostProcess(UHoudiniAssetComponent* AssetComponent, bool Succeeded)
+void UHoudiniBuildWorkItem::FinishUpToDate()
 {
-	if (BuildState != EEHEBuildState::Building)
+	if (BuildState != EEHEBuildState::Standby)
 	{
-		// not an error since some other system may have decided to build this asset.
 		return;
 	}
+
+	UE_LOG(LogEHERuntime, Verbose, TEXT("UHoudiniBuildWorkItem: %s is up to date, skipping."), *GetNameSafe(ToBuild.Get()));
 	
-	if (Succeeded)
+	// Nothing was cooked, so the outputs are still the ones from the last build.
+	OutputHash = LastOutputHash;
+	SetBuildState(EEHEBuildState::Finished);
+}
+
+bool UHoudiniBuildWorkItem::FinishFromRepresentative(UHoudiniBuildWorkItem* Representative)
+{
+	if (BuildState != EEHEBuildState::Standby || !Representative || !Representative->ToBuild.IsValid() || !ToBuild.IsValid())
 	{
-		// TODO(): Vanilla HE does not expose any information about if this asset finished with error or not. Update this
-		//         section if SideFx ever adds something similar to my custom AssetComponent->MostRecentCookState flag.
-		BuildState = EEHEBuildState::Finished;
+		return false;
 	}
-	else
+
+	UHoudiniAssetComponent* RepresentativeComponent = Representative->ToBuild->GetHoudiniAssetComponent();
+	UHoudiniAssetComponent* AssetComponent = ToBuild->GetHoudiniAssetComponent();
+	if (!FHoudiniCookCache::CopyOutputs(RepresentativeComponent, AssetComponent))
 	{
-		UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildWorkItem::OnHoudiniAssetPostProcess() houdini asset failed to build"));
-		BuildState = EEHEBuildState::Error;
+		return false;
 	}
+
+	UE_LOG(LogEHERuntime, Verbose, TEXT("UHoudiniBuildWorkItem: %s copied the outputs of %s."), *GetNameSafe(ToBuild.Get()), *GetNameSafe(Representative->ToBuild.Get()));
+	return FinishWithCopiedOutputs(bCopiedFromRepresentative);
 }
 
-UHoudiniBuildSequenceNode::UHoudiniBuildSequenceNode(const FObjectInitializer& Initializer): Super(Initializer)
+void UHoudiniBuildWorkItem::FinishFromBatch()
 {
-	Title = FText::FromString("Build HDA");
-	WorkItemClass = UHoudiniBuildWorkItem::StaticClass();
+	if (FinishWithCopiedOutputs(bCookedInBatch) && Owner && Owner->ShouldUseCookCache())
+	{
+		FHoudiniCookCache::Get().Store(Fingerprint, ToBuild->GetHoudiniAssetComponent());
+	}
 }
 
-
-bool UHoudiniBuildSequenceNode::Add(AHoudiniAssetActor* AssetActor)
+bool UHoudiniBuildWorkItem::FinishWithCopiedOutputs(bool& bCopiedFlag)
 {
-	if (GetState() != EAutomationGraphNodeState::Uninitialized && GetState() != EAutomationGraphNodeState::Standby)
+	// Goes through Building like any other build, so the result is recorded the same way.
+	if (BuildState == EEHEBuildState::Standby)
 	{
-		return false;
+		BuildStarted();
 	}
-	
-	auto* NewWorkItem = NewObject<UHoudiniBuildWorkItem>(this, WorkItemClass);
-	if(!NewWorkItem->Initialize(this, AssetActor))
+	if (BuildState != EEHEBuildState::Building || !ToBuild.IsValid())
 	{
-		UE_LOG(LogEHERuntime, Error, TEXT("error: failed to initilize HoudiniBuildWorkItem"));
 		return false;
 	}
 
-	WorkItems.Add(NewWorkItem);
+	// Set after BuildStarted(), which clears it.
+	bCopiedFlag = true;
+	OutputHash = FHoudiniBuildOutputHash::Compute(ToBuild->GetHoudiniAssetComponent());
+	SetBuildState(EEHEBuildState::Finished);
 	return true;
 }
 
-bool UHoudiniBuildSequenceNode::Activate()
+bool UHoudiniBuildWorkItem::FinishFromJournal(const FString& JournaledOutputHash)
 {
-	if (GetState() == EAutomationGraphNodeState::Uninitialized)
+	UHoudiniAssetComponent* AssetComponent = ToBuild.IsValid() ? ToBuild->GetHoudiniAssetComponent() : nullptr;
+	if (BuildState != EEHEBuildState::Standby || !AssetComponent || JournaledOutputHash.IsEmpty())
 	{
-		UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildSequenceNode::Activate() attempted to build uninitialized sequence node"));
 		return false;
 	}
-	if (GetState() == EAutomationGraphNodeState::Active)
+
+	// The journal is written as soon as a build finishes, but its outputs only outlived the interrupted run if they
+	// were saved.
+	if (FHoudiniBuildOutputHash::Compute(AssetComponent) != JournaledOutputHash)
 	{
-		UE_LOG(LogEHERuntime, Warning, TEXT("error: UHoudiniBuildSequenceNode::Activate() attempted to build sequence node already in progress"));
+		UE_LOG(LogEHERuntime, Log, TEXT("UHoudiniBuildWorkItem: %s was built by the interrupted run, but its outputs weren't saved."), *GetNameSafe(ToBuild.Get()));
 		return false;
 	}
 
-	SetState(EAutomationGraphNodeState::Active);
-	
-	for (TObjectPtr<UHoudiniBuildWorkItem> WorkItem : WorkItems)
+	UE_LOG(LogEHERuntime, Verbose, TEXT("UHoudiniBuildWorkItem: %s was built by the interrupted run, skipping."), *GetNameSafe(ToBuild.Get()));
+	bRestoredFromJournal = true;
+	OutputHash = JournaledOutputHash;
+	SetBuildState(EEHEBuildState::Finished);
+	return true;
+}
+
+void UHoudiniBuildWorkItem::BeginExternalBuild(bool bInSimulated)
+{
+	if (BuildState != EEHEBuildState::Standby)
 	{
-		if (!WorkItem)
-		{
-			UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildSequenceNode::Activate() invalid work item"));
-			return false;
-		}
+		UE_LOG(LogEHERuntime, Warning, TEXT("error: UHoudiniBuildWorkItem::BeginExternalBuild() work item is not waiting to be built"));
+		return;
+	}
+
+	BuildStarted();
+	bSimulated = bInSimulated;
+}
+
+void UHoudiniBuildWorkItem::CompleteExternalBuild(bool bSucceeded)
+{
+	if (BuildState != EEHEBuildState::Building)
+	{
+		return;
+	}
+
+	SetBuildState(bSucceeded ? EEHEBuildState::Finished : EEHEBuildState::Error);
+}
+
+void UHoudiniBuildWorkItem::AddDependency(UHoudiniBuildWorkItem* Upstream)
+{
+	if (!Upstream || Upstream == this || Upstream->Dependents.Contains(this))
+	{
+		return;
+	}
+
+	Upstream->Dependents.Add(this);
+	NumDependencies++;
+	if (Upstream->GetBuildState() != EEHEBuildState::Finished)
+	{
+		NumPendingDependencies++;
+	}
+}
 
-		if(!WorkItem->Build())
+void UHoudiniBuildWorkItem::Abandon()
+{
+	if (bRetryPending)
+	{
+		// Already failed, everyone waiting on the retry just has to be told it isn't coming.
+		bRetryPending = false;
+		if (Arbiter.IsValid())
 		{
-			return false;
+			Arbiter->OnRetryAbandoned(this);
 		}
+		NotifyDependents(false);
+		return;
+	}
+	
+	if (BuildState == EEHEBuildState::Standby)
+	{
+		SetBuildState(EEHEBuildState::Error);
 	}
+}
 
-	return true;
+void UHoudiniBuildWorkItem::Interrupt()
+{
+	if (BuildState != EEHEBuildState::Building)
+	{
+		return;
+	}
+
+	// Bumping the serial drops the timeouts and stand-in cooks of the interrupted build.
+	BuildSerial++;
+	bSimulated = false;
+	SetBuildState(EEHEBuildState::Standby);
 }
 
-void UHoudiniBuildSequenceNode::Reset()
+void UHoudiniBuildWorkItem::PrepareRetry()
 {
-	WorkItems.Empty();
-	SetState(EAutomationGraphNodeState::Uninitialized); // require initialization every time we run.
+	if (!bRetryPending)
+	{
+		return;
+	}
+
+	NumRetries++;
+	bRetryPending = false;
+	bSimulated = false;
+	SetBuildState(EEHEBuildState::Standby);
 }
 
-EAutomationGraphNodeState UHoudiniBuildSequenceNode::GetState()
+bool UHoudiniBuildWorkItem::IsReadyToSubmit(bool bParentNodesFinished) const
 {
-	bFinishedWithError = false;
-	
-	if (WorkItems.Num() == 0)
+	return BuildState == EEHEBuildState::Standby && NumPendingDependencies == 0 && (!bWaitForParentNodes || bParentNodesFinished);
+}
+
+void UHoudiniBuildWorkItem::OnDependencyFinished()
+{
+	NumPendingDependencies--;
+	if (NumPendingDependencies == 0 && Owner)
+	{
+		Owner->OnWorkItemReady(this);
+	}
+}
+
+void UHoudiniBuildWorkItem::OnDependencyFailed()
+{
+	if (BuildState != EEHEBuildState::Standby)
+	{
+		return;
+	}
+
+	UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildWorkItem: %s can't be built because a work item it depends on failed."), *GetNameSafe(ToBuild.Get()));
+	SetBuildState(EEHEBuildState::Error);
+}
+
+void UHoudiniBuildWorkItem::BeginDestroy()
+{
+	UnbindPostProcess();
+	Super::BeginDestroy();
+}
+
+void UHoudiniBuildWorkItem::UnbindPostProcess()
+{
+	if (!PostOutputProcessingDelegateHande.IsValid())
 	{
-		SetState(EAutomationGraphNodeState::Uninitialized);
-		return Super::GetState();
+		return;
 	}
 	
-	if (Super::GetState() == EAutomationGraphNodeState::Active)
+	if (UHoudiniAssetComponent* AssetComponent = ToBuild.IsValid() ? ToBuild.Get()->GetHoudiniAssetComponent() : nullptr)
 	{
-		int NumFinished = 0;
-		
-		for (TObjectPtr<UHoudiniBuildWorkItem> WorkItem : WorkItems)
-		{
-			if (!WorkItem)
-			{
-				UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildSequenceNode::GetBuildState() invalid work item"));
-				SetState(EAutomationGraphNodeState::Error);
-				return Super::GetState();
-			}
-			
-			EEHEBuildState WorkItemState = WorkItem->GetBuildState();
-			switch (WorkItemState)
-			{
-			case EEHEBuildState::Building:
-				break;
-			case EEHEBuildState::Finished:
-				NumFinished++;
-				break;
-			// TODO(): Add this back in if vanilla HE ever supports it.
-			/*case EEHEBuildState::FinishedWithError:
-				NumFinished++;
-				bFinishedWithError = true;
-				break;*/
-			case EEHEBuildState::Expired:
-				SetState(EAutomationGraphNodeState::Expired);
-				return Super::GetState();
-			case EEHEBuildState::Standby:
-			case EEHEBuildState::Error:
-			default:
-				SetState(EAutomationGraphNodeState::Error);
-				return Super::GetState();
-			}
-		}
+		AssetComponent->GetOnPostOutputProcessingDelegate().Remove(PostOutputProcessingDelegateHande);
+	}
+	PostOutputProcessingDelegateHande.Reset();
+}
 
-		if (NumFinished == WorkItems.Num())
-		{
-			SetState(EAutomationGraphNodeState::Finished);
-		}
+UWorld* UHoudiniBuildWorkItem::GetWorld() const
+{
+	return ToBuild.IsValid() ? ToBuild->GetWorld() : nullptr;
+}
+
+void UHoudiniBuildWorkItem::OnDeadlineReached(int32 ForBuildSerial, bool bFailDeadline)
+{
+	if (BuildState != EEHEBuildState::Building || ForBuildSerial != BuildSerial)
+	{
+		// This deadline belongs to a build that has already completed.
+		return;
 	}
 	
-	return Super::GetState();
+	if (!ToBuild.IsValid())
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildWorkItem::OnDeadlineReached() asset is invalid"));
+		SetBuildState(EEHEBuildState::Error);
+		return;
+	}
+
+	double TimeDelta = FPlatformTime::Seconds() - TimeStarted;
+	if (bFailDeadline)
+	{
+		// TODO(): Double check that GetFullName is descriptive enough for debugging.
+		UE_LOG(LogEHERuntime, Error, TEXT("error: houdini asset %s has been building for %.2lf seconds"), *ToBuild.Get()->GetFullName(), TimeDelta);
+		SetBuildState(EEHEBuildState::Expired);
+	}
+	else
+	{
+		UE_LOG(LogEHERuntime, Warning, TEXT("warning: houdini asset %s has been building for %.2lf seconds"), *ToBuild.Get()->GetFullName(), TimeDelta);
+	}
 }
 
-FString UHoudiniBuildSequenceNode::GetMessageText()
+void UHoudiniBuildWorkItem::OnRetryDeadlineReached(int32 ForBuildSerial)
 {
-	if (GetState() == EAutomationGraphNodeState::Finished && bFinishedWithError)
+	if (!bRetryPending || ForBuildSerial != BuildSerial)
 	{
-		double TotalTime = TimeFinished - TimeStarted;
-		return FString::Printf(TEXT("Finished in %.2lf Seconds (with errors)"), TotalTime); 
+		// Given up on, or already retried.
+		return;
+	}
+
+	if (Owner)
+	{
+		Owner->RetryWorkItem(this);
+	}
+}
+
+void UHoudiniBuildWorkItem::BuildStarted()
+{
+	TimeStarted = FPlatformTime::Seconds();
+	BuildDurationSec = 0.0;
+	bRestoredFromCache = false;
+	bCopiedFromRepresentative = false;
+	bCookedInBatch = false;
+	bRestoredFromJournal = false;
+	bSimulated = false;
+	OutputHash.Empty();
+	BuildSerial++;
+	SetBuildState(EEHEBuildState::Building);
+}
+
+void UHoudiniBuildWorkItem::SetBuildState(EEHEBuildState NewState)
+{
+	if (BuildState == NewState)
+	{
+		return;
+	}
+
+	if (BuildState == EEHEBuildState::Building && NewState == EEHEBuildState::Finished)
+	{
+		BuildDurationSec = FPlatformTime::Seconds() - TimeStarted;
+	}
+
+	// Only builds that actually ran are retried. Work items failed before they started (e.g. because something they
+	// depend on failed) wouldn't do any better the second time around. Decided before anyone is told about the
+	// failure, so the arbiter, the node and the build manager all see the same thing.
+	bRetryPending = BuildState == EEHEBuildState::Building && Owner && Owner->BuildInfo.RetryPolicy.CanRetry(NewState, NumRetries);
+	if (BuildState == EEHEBuildState::Building)
+	{
+		// Whatever the cook reports from now on is for a build that is already over.
+		UnbindPostProcess();
+	}
+	BuildState = NewState;
+
+	if (Arbiter.IsValid())
+	{
+		Arbiter->OnWorkItemStateChanged(this, NewState);
+	}
+	if (Owner)
+	{
+		Owner->OnWorkItemStateChanged(this, NewState);
+	}
+
+	if ((NewState == EEHEBuildState::Finished || NewState == EEHEBuildState::Error || NewState == EEHEBuildState::Expired) && !bRetryPending)
+	{
+		NotifyDependents(NewState == EEHEBuildState::Finished);
+	}
+}
+
+void UHoudiniBuildWorkItem::NotifyDependents(bool bSucceeded)
+{
+	// Copied, since waking a dependent can lead to all sorts of things happening synchronously.
+	const TArray<TObjectPtr<UHoudiniBuildWorkItem>> DependentsToNotify = Dependents;
+	for (UHoudiniBuildWorkItem* Dependent : DependentsToNotify)
+	{
+		if (!Dependent)
+		{
+			continue;
+		}
+		
+		if (bSucceeded)
+		{
+			Dependent->OnDependencyFinished();
+		}
+		else
+		{
+			Dependent->OnDependencyFailed();
+		}
+	}
+}
+
+void UHoudiniBuildWorkItem::OnHoudiniAssetPostProcessForBuild(UHoudiniAssetComponent* AssetComponent, bool Succeeded, int32 ForBuildSerial)
+{
+	if (ForBuildSerial == BuildSerial)
+	{
+		OnHoudiniAssetPostProcess(AssetComponent, Succeeded);
+	}
+}
+
+void UHoudiniBuildWorkItem::OnHoudiniAssetPostProcess(UHoudiniAssetComponent* AssetComponent, bool Succeeded)
+{
+	if (BuildState != EEHEBuildState::Building)
+	{
+		// not an error since some other system may have decided to build this asset.
+		return;
+	}
+	
+	if (Succeeded)
+	{
+		// TODO(): Vanilla HE does not expose any information about if this asset finished with error or not. Update this
+		//         section if SideFx ever adds something similar to my custom AssetComponent->MostRecentCookState flag.
+		OutputHash = FHoudiniBuildOutputHash::Compute(AssetComponent);
+		if (Owner && Owner->ShouldUseCookCache())
+		{
+			FHoudiniCookCache::Get().Store(Fingerprint, AssetComponent);
+		}
+		SetBuildState(EEHEBuildState::Finished);
+	}
+	else
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildWorkItem::OnHoudiniAssetPostProcess() houdini asset failed to build"));
+		SetBuildState(EEHEBuildState::Error);
+	}
+}
+
+UHoudiniBuildSequenceNode::UHoudiniBuildSequenceNode(const FObjectInitializer& Initializer): Super(Initializer)
+{
+	Title = FText::FromString("Build HDA");
+	WorkItemClass = UHoudiniBuildWorkItem::StaticClass();
+}
+
+
+bool UHoudiniBuildSequenceNode::Add(AHoudiniAssetActor* AssetActor)
+{
+	if (GetState() != EAutomationGraphNodeState::Uninitialized && GetState() != EAutomationGraphNodeState::Standby)
+	{
+		return false;
+	}
+	
+	auto* NewWorkItem = NewObject<UHoudiniBuildWorkItem>(this, WorkItemClass);
+	if(!NewWorkItem->Initialize(this, AssetActor))
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: failed to initilize HoudiniBuildWorkItem"));
+		return false;
+	}
+
+	WorkItems.Add(NewWorkItem);
+	return true;
+}
+
+bool UHoudiniBuildSequenceNode::Activate()
+{
+	if (GetState() == EAutomationGraphNodeState::Uninitialized)
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildSequenceNode::Activate() attempted to build uninitialized sequence node"));
+		return false;
+	}
+	if (GetState() == EAutomationGraphNodeState::Active)
+	{
+		UE_LOG(LogEHERuntime, Warning, TEXT("error: UHoudiniBuildSequenceNode::Activate() attempted to build sequence node already in progress"));
+		return false;
+	}
+	if (WorkItems.IsEmpty())
+	{
+		// None of the actors are in this run (or this shard of it). The node still has to finish so its children run.
+		FinishUpToDate();
+		return true;
+	}
+
+	NumFinished = 0;
+	NumUpToDate = 0;
+	NumResumed = 0;
+	NumUnchangedOutputs = 0;
+	NumInFlight = 0;
+	NextWorkItemIndex = 0;
+	bFinishedWithError = false;
+	Representatives.Reset();
+	WaitingOnRepresentative.Reset();
+	NumWaitingOnRepresentative = 0;
+	NumDeduplicated = 0;
+	NumWaitingOnBatch = 0;
+	NumBatches = 0;
+	NumCookedInBatch = 0;
+	NumRetries = 0;
+	RetriedWorkItems.Reset();
+	Unbatchable.Reset();
+	for (UHoudiniBuildWorkItem* WorkItem : WorkItems)
+	{
+		if (WorkItem)
+		{
+			WorkItem->SetBatch(nullptr);
+			WorkItem->ResetRetries();
+		}
+	}
+
+	// Work items still waiting on upstream work are queued later, from OnWorkItemReady().
+	ReadyWorkItems.Reset();
+	for (TObjectPtr<UHoudiniBuildWorkItem> WorkItem : WorkItems)
+	{
+		if (!WorkItem || WorkItem->IsReadyToSubmit(bParentNodesFinished))
+		{
+			ReadyWorkItems.Add(WorkItem);
+		}
+	}
+
+	// Fingerprints are taken when work items are queued rather than when the run starts, so they see the results of
+	// everything upstream.
+	if (ShouldFingerprintWorkItems())
+	{
+		UpdateFingerprints(ReadyWorkItems);
+	}
+	
+	SetState(EAutomationGraphNodeState::Active);
+
+	return SubmitQueuedWorkItems();
+}
+
+bool UHoudiniBuildSequenceNode::SubmitQueuedWorkItems()
+{
+	// Work items can finish synchronously while we are submitting, which calls back in here. The outer loop will pick
+	// up the freed slots, so there is nothing to do for the nested call.
+	if (bSubmittingWorkItems)
+	{
+		return true;
+	}
+	TGuardValue<bool> SubmittingGuard(bSubmittingWorkItems, true);
+	
+	const int32 MaxInFlight = BuildInfo.MaxInFlightWorkItems > 0 ? BuildInfo.MaxInFlightWorkItems : WorkItems.Num();
+	
+	while (GetState() == EAutomationGraphNodeState::Active && NumInFlight - NumWaitingOnRepresentative - NumWaitingOnBatch < MaxInFlight && NextWorkItemIndex < ReadyWorkItems.Num())
+	{
+		TObjectPtr<UHoudiniBuildWorkItem> WorkItem = ReadyWorkItems[NextWorkItemIndex++];
+		if (!WorkItem)
+		{
+			UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildSequenceNode::SubmitQueuedWorkItems() invalid work item"));
+			SetState(EAutomationGraphNodeState::Error);
+			return false;
+		}
+
+		if (const FHoudiniBuildJournalItem* JournaledWorkItem = FindJournaledWorkItem(WorkItem))
+		{
+			// Put in flight first, since finishing it takes it back out. If the interrupted run's outputs are gone it
+			// isn't finished, so it's taken back out here and built normally.
+			NumInFlight++;
+			NumResumed++;
+			if (WorkItem->FinishFromJournal(JournaledWorkItem->OutputHash))
+			{
+				continue;
+			}
+			NumInFlight--;
+			NumResumed--;
+		}
+
+		if (ShouldSkipUnchangedActors() && WorkItem->IsUpToDate())
+		{
+			// Counted as in flight so its (immediate) finish is accounted for like any other work item.
+			NumInFlight++;
+			NumUpToDate++;
+			WorkItem->FinishUpToDate();
+
+			// Its outputs are as good as a fresh cook, so identical instances can copy them.
+			if (ShouldDeduplicateInstances() && !WorkItem->GetEquivalenceKey().IsEmpty())
+			{
+				Representatives.FindOrAdd(WorkItem->GetEquivalenceKey(), WorkItem);
+			}
+			continue;
+		}
+
+		if (ShouldDeduplicateInstances() && TryDeduplicate(WorkItem))
+		{
+			continue;
+		}
+
+		TryBatch(WorkItem);
+
+		// Work items go through the world's cook arbiter, which may hold on to them until a cook slot is free.
+		UHoudiniCookArbiter* CookArbiter = UHoudiniCookArbiter::Get(WorkItem);
+		
+		NumInFlight++;
+		
+		// A build that fails right away can still be retried, in which case it stays in flight.
+		if(!(CookArbiter ? CookArbiter->Submit(WorkItem) : WorkItem->Build()) && !WorkItem->IsRetryPending())
+		{
+			NumInFlight--;
+			SetState(EAutomationGraphNodeState::Error);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const FHoudiniBuildJournalItem* UHoudiniBuildSequenceNode::FindJournaledWorkItem(const UHoudiniBuildWorkItem* WorkItem) const
+{
+	const FHoudiniBuildJournalItem* JournaledWorkItem = Journal ? Journal->FindWorkItem(WorkItem) : nullptr;
+	if (!JournaledWorkItem)
+	{
+		return nullptr;
+	}
+
+	// An actor that was edited since has to be built again. Without a fingerprint there is no telling, so it's built
+	// again too.
+	const FString& Fingerprint = WorkItem->GetFingerprint();
+	return !Fingerprint.IsEmpty() && JournaledWorkItem->Fingerprint == Fingerprint ? JournaledWorkItem : nullptr;
+}
+
+bool UHoudiniBuildSequenceNode::TryDeduplicate(UHoudiniBuildWorkItem* WorkItem)
+{
+	const FString& EquivalenceKey = WorkItem->GetEquivalenceKey();
+	if (EquivalenceKey.IsEmpty())
+	{
+		return false;
+	}
+
+	UHoudiniBuildWorkItem* Representative = Representatives.FindRef(EquivalenceKey);
+	if (!Representative)
+	{
+		// The first of its kind gets cooked.
+		Representatives.Add(EquivalenceKey, WorkItem);
+		return false;
+	}
+
+	switch (Representative->GetBuildState())
+	{
+	case EEHEBuildState::Finished:
+		NumInFlight++;
+		if (WorkItem->FinishFromRepresentative(Representative))
+		{
+			NumDeduplicated++;
+			return true;
+		}
+		NumInFlight--;
+		return false;
+	case EEHEBuildState::Standby:
+	case EEHEBuildState::Building:
+		NumInFlight++;
+		NumWaitingOnRepresentative++;
+		WaitingOnRepresentative.FindOrAdd(EquivalenceKey).Add(WorkItem);
+		return true;
+	default:
+		return false;
+	}
+}
+
+void UHoudiniBuildSequenceNode::ReleaseWaitingOnRepresentative(UHoudiniBuildWorkItem* Representative)
+{
+	TArray<UHoudiniBuildWorkItem*> Waiting;
+	if (!Representative || !WaitingOnRepresentative.RemoveAndCopyValue(Representative->GetEquivalenceKey(), Waiting))
+	{
+		return;
+	}
+
+	for (UHoudiniBuildWorkItem* WorkItem : Waiting)
+	{
+		NumWaitingOnRepresentative--;
+		if (GetState() != EAutomationGraphNodeState::Active)
+		{
+			continue;
+		}
+		
+		if (WorkItem->FinishFromRepresentative(Representative))
+		{
+			NumDeduplicated++;
+			continue;
+		}
+
+		// The outputs didn't fit (e.g. the actor was never cooked before), so it gets a cook of its own.
+		NumInFlight--;
+		WorkItem->SetEquivalenceKey(FString());
+		ReadyWorkItems.Add(WorkItem);
+	}
+}
+
+void UHoudiniBuildSequenceNode::TryBatch(UHoudiniBuildWorkItem* WorkItem)
+{
+	const int32 MaxBatchSize = GetMaxBatchSize();
+	if (MaxBatchSize < 2 || WorkItem->GetBatch() || Unbatchable.Contains(WorkItem))
+	{
+		return;
+	}
+
+	AHoudiniAssetActor* AssetActor = WorkItem->GetAssetActor().Get();
+	UHoudiniAssetComponent* AssetComponent = AssetActor ? AssetActor->GetHoudiniAssetComponent() : nullptr;
+	UHoudiniAsset* HoudiniAsset = AssetComponent ? AssetComponent->GetHoudiniAsset() : nullptr;
+	UHoudiniAsset* WrapperAsset = HoudiniAsset ? GetBatchWrapperAsset(HoudiniAsset) : nullptr;
+	if (!WrapperAsset || !UHoudiniBuildBatch::CanBatch(AssetActor))
+	{
+		return;
+	}
+
+	auto IsBatchable = [this, HoudiniAsset](UHoudiniBuildWorkItem* Candidate)
+	{
+		if (!Candidate || Candidate->GetBuildState() != EEHEBuildState::Standby || Candidate->GetBatch() || Unbatchable.Contains(Candidate))
+		{
+			return false;
+		}
+		if ((ShouldSkipUnchangedActors() && Candidate->IsUpToDate()) || FindJournaledWorkItem(Candidate))
+		{
+			return false;
+		}
+		
+		// Leave work items that an identical instance is already being cooked for to deduplication.
+		if (ShouldDeduplicateInstances() && !Candidate->GetEquivalenceKey().IsEmpty() && Representatives.Contains(Candidate->GetEquivalenceKey()))
+		{
+			return false;
+		}
+
+		AHoudiniAssetActor* CandidateActor = Candidate->GetAssetActor().Get();
+		UHoudiniAssetComponent* CandidateComponent = CandidateActor ? CandidateActor->GetHoudiniAssetComponent() : nullptr;
+		return CandidateComponent && CandidateComponent->GetHoudiniAsset() == HoudiniAsset && UHoudiniBuildBatch::CanBatch(CandidateActor);
+	};
+
+	// Members are taken out of the queue. They are finished by the batch, or queued again if it can't finish them.
+	TArray<UHoudiniBuildWorkItem*> Batched = { WorkItem };
+	for (int32 ReadyIndex = NextWorkItemIndex; ReadyIndex < ReadyWorkItems.Num() && Batched.Num() < MaxBatchSize;)
+	{
+		UHoudiniBuildWorkItem* Candidate = ReadyWorkItems[ReadyIndex];
+		if (!IsBatchable(Candidate))
+		{
+			ReadyIndex++;
+			continue;
+		}
+
+		Batched.Add(Candidate);
+		ReadyWorkItems.RemoveAt(ReadyIndex);
+		if (ShouldDeduplicateInstances() && !Candidate->GetEquivalenceKey().IsEmpty())
+		{
+			Representatives.Add(Candidate->GetEquivalenceKey(), Candidate);
+		}
+	}
+
+	if (Batched.Num() < 2)
+	{
+		return;
+	}
+
+	UHoudiniBuildBatch* Batch = NewObject<UHoudiniBuildBatch>(this);
+	Batch->Initialize(WrapperAsset, Batched);
+	NumInFlight += Batched.Num() - 1;
+	NumWaitingOnBatch += Batched.Num() - 1;
+}
+
+void UHoudiniBuildSequenceNode::ReleaseBatch(UHoudiniBuildWorkItem* Leader)
+{
+	UHoudiniBuildBatch* Batch = Leader ? Leader->GetBatch() : nullptr;
+	if (!Batch || Batch->GetLeader() != Leader)
+	{
+		return;
+	}
+
+	bool bAnyCookedInBatch = false;
+	for (UHoudiniBuildWorkItem* WorkItem : Batch->GetWorkItems())
+	{
+		if (!WorkItem)
+		{
+			continue;
+		}
+		
+		WorkItem->SetBatch(nullptr);
+		bAnyCookedInBatch |= WorkItem->WasCookedInBatch();
+		if (WorkItem == Leader || WorkItem->GetBuildState() != EEHEBuildState::Standby)
+		{
+			continue;
+		}
+
+		// Its result couldn't be taken from the batch, so it gets a cook of its own. If the batch never ran (e.g. the
+		// leader was restored from the cook cache), it can still go into another one.
+		NumWaitingOnBatch--;
+		NumInFlight--;
+		if (Batch->WasStarted())
+		{
+			Unbatchable.Add(WorkItem);
+		}
+		if (GetState() == EAutomationGraphNodeState::Active)
+		{
+			ReadyWorkItems.Add(WorkItem);
+		}
+	}
+	NumBatches += bAnyCookedInBatch ? 1 : 0;
+}
+
+AHoudiniAssetActor* UHoudiniBuildSequenceNode::AcquireBatchWrapperActor(UWorld* World, UHoudiniAsset* WrapperAsset, bool& bOutSpawned)
+{
+	bOutSpawned = false;
+	if (!World || !WrapperAsset)
+	{
+		return nullptr;
+	}
+	
+	for (int32 WrapperIndex = 0; WrapperIndex < IdleBatchWrapperActors.Num(); ++WrapperIndex)
+	{
+		AHoudiniAssetActor* WrapperActor = IdleBatchWrapperActors[WrapperIndex].Get();
+		UHoudiniAssetComponent* WrapperComponent = WrapperActor ? WrapperActor->GetHoudiniAssetComponent() : nullptr;
+		if (WrapperComponent && WrapperComponent->GetHoudiniAsset() == WrapperAsset && WrapperActor->GetWorld() == World)
+		{
+			IdleBatchWrapperActors.RemoveAtSwap(WrapperIndex);
+			return WrapperActor;
+		}
+	}
+
+	// Wrappers only live while this node runs, so they must never be saved with the level.
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+	AHoudiniAssetActor* WrapperActor = World->SpawnActor<AHoudiniAssetActor>(SpawnParameters);
+	UHoudiniAssetComponent* WrapperComponent = WrapperActor ? WrapperActor->GetHoudiniAssetComponent() : nullptr;
+	if (!WrapperComponent)
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniBuildSequenceNode::AcquireBatchWrapperActor() failed to spawn a wrapper actor"));
+		if (WrapperActor)
+		{
+			WrapperActor->Destroy();
+		}
+		return nullptr;
+	}
+
+#if WITH_EDITOR
+	WrapperActor->SetActorLabel(FString::Printf(TEXT("EHE_Batch_%s"), *WrapperAsset->GetName()));
+#endif
+	WrapperComponent->SetHoudiniAsset(WrapperAsset);
+	WrapperComponent->MarkAsNeedInstantiation();
+	BatchWrapperActors.Add(WrapperActor);
+	bOutSpawned = true;
+	return WrapperActor;
+}
+
+void UHoudiniBuildSequenceNode::ReleaseBatchWrapperActor(AHoudiniAssetActor* WrapperActor)
+{
+	if (WrapperActor && BatchWrapperActors.Contains(WrapperActor))
+	{
+		IdleBatchWrapperActors.AddUnique(WrapperActor);
+	}
+}
+
+void UHoudiniBuildSequenceNode::DestroyBatchWrapperActors()
+{
+	for (const TWeakObjectPtr<AHoudiniAssetActor>& WrapperActor : BatchWrapperActors)
+	{
+		if (WrapperActor.IsValid())
+		{
+			WrapperActor->Destroy();
+		}
+	}
+	BatchWrapperActors.Empty();
+	IdleBatchWrapperActors.Empty();
+}
+
+bool UHoudiniBuildSequenceNode::HasUnchangedOutput()
+{
+	return GetState() == EAutomationGraphNodeState::Finished && NumUnchangedOutputs == WorkItems.Num();
+}
+
+void UHoudiniBuildSequenceNode::UpdateFingerprints(TConstArrayView<TObjectPtr<UHoudiniBuildWorkItem>> ToUpdate)
+{
+	TArray<AHoudiniAssetActor*> AssetActors;
+	AssetActors.Reserve(ToUpdate.Num());
+	for (UHoudiniBuildWorkItem* WorkItem : ToUpdate)
+	{
+		AssetActors.Add(WorkItem ? WorkItem->GetAssetActor().Get() : nullptr);
+	}
+
+	TArray<FString> Fingerprints;
+	FHoudiniBuildFingerprint::Compute(AssetActors, Fingerprints);
+
+	TArray<FString> EquivalenceKeys;
+	if (ShouldDeduplicateInstances())
+	{
+		FHoudiniBuildFingerprint::ComputeEquivalenceKeys(AssetActors, EquivalenceKeys);
+	}
+	
+	for (int32 WorkItemIndex = 0; WorkItemIndex < ToUpdate.Num(); ++WorkItemIndex)
+	{
+		if (ToUpdate[WorkItemIndex])
+		{
+			ToUpdate[WorkItemIndex]->SetFingerprint(Fingerprints[WorkItemIndex]);
+			ToUpdate[WorkItemIndex]->SetEquivalenceKey(EquivalenceKeys.IsValidIndex(WorkItemIndex) ? EquivalenceKeys[WorkItemIndex] : FString());
+		}
+	}
+}
+
+void UHoudiniBuildSequenceNode::LinkPipelinedWorkItems()
+{
+	if (!IsPipelined())
+	{
+		return;
+	}
+
+	auto IsLinkTag = [this](FName ActorTag)
+	{
+		return !BuildInfo.PipelineLinkTagPrefix.IsEmpty() && ActorTag.ToString().StartsWith(BuildInfo.PipelineLinkTagPrefix);
+	};
+
+	TMap<AHoudiniAssetActor*, UHoudiniBuildWorkItem*> UpstreamByActor;
+	TMap<FName, TArray<UHoudiniBuildWorkItem*>> UpstreamByLinkTag;
+	for (UAutomationGraphNode* ParentNode : ParentNodes)
+	{
+		auto* ParentSequenceNode = Cast<UHoudiniBuildSequenceNode>(ParentNode);
+		if (!ParentSequenceNode)
+		{
+			continue;
+		}
+
+		for (UHoudiniBuildWorkItem* UpstreamWorkItem : ParentSequenceNode->GetWorkItems())
+		{
+			AHoudiniAssetActor* UpstreamActor = UpstreamWorkItem ? UpstreamWorkItem->GetAssetActor().Get() : nullptr;
+			if (!UpstreamActor)
+			{
+				continue;
+			}
+
+			UpstreamByActor.Add(UpstreamActor, UpstreamWorkItem);
+			for (FName ActorTag : UpstreamActor->Tags)
+			{
+				if (IsLinkTag(ActorTag))
+				{
+					UpstreamByLinkTag.FindOrAdd(ActorTag).Add(UpstreamWorkItem);
+				}
+			}
+		}
+	}
+
+	TMap<AHoudiniAssetActor*, TArray<AHoudiniAssetActor*>> ExplicitLinks;
+	for (const FHoudiniBuildPipelineLink& PipelineLink : BuildInfo.PipelineLinks)
+	{
+		AHoudiniAssetActor* UpstreamActor = PipelineLink.UpstreamActor.Get();
+		AHoudiniAssetActor* DownstreamActor = PipelineLink.DownstreamActor.Get();
+		if (UpstreamActor && DownstreamActor)
+		{
+			ExplicitLinks.FindOrAdd(DownstreamActor).Add(UpstreamActor);
+		}
+	}
+
+	int32 NumLinked = 0;
+	for (UHoudiniBuildWorkItem* WorkItem : WorkItems)
+	{
+		AHoudiniAssetActor* AssetActor = WorkItem ? WorkItem->GetAssetActor().Get() : nullptr;
+		if (!AssetActor)
+		{
+			continue;
+		}
+
+		if (const TArray<AHoudiniAssetActor*>* UpstreamActors = ExplicitLinks.Find(AssetActor))
+		{
+			for (AHoudiniAssetActor* UpstreamActor : *UpstreamActors)
+			{
+				if (UHoudiniBuildWorkItem** UpstreamWorkItem = UpstreamByActor.Find(UpstreamActor))
+				{
+					WorkItem->AddDependency(*UpstreamWorkItem);
+				}
+				else
+				{
+					UE_LOG(LogEHERuntime, Warning, TEXT("warning: UHoudiniBuildSequenceNode::LinkPipelinedWorkItems() %s is linked to %s, which isn't built by a parent node."), *AssetActor->GetName(), *UpstreamActor->GetName());
+				}
+			}
+		}
+		for (FName ActorTag : AssetActor->Tags)
+		{
+			if (!IsLinkTag(ActorTag))
+			{
+				continue;
+			}
+			if (const TArray<UHoudiniBuildWorkItem*>* UpstreamWorkItems = UpstreamByLinkTag.Find(ActorTag))
+			{
+				for (UHoudiniBuildWorkItem* UpstreamWorkItem : *UpstreamWorkItems)
+				{
+					WorkItem->AddDependency(UpstreamWorkItem);
+				}
+			}
+		}
+
+		WorkItem->SetWaitForParentNodes(!WorkItem->HasDependencies());
+		NumLinked += WorkItem->HasDependencies() ? 1 : 0;
+	}
+
+	UE_LOG(LogEHERuntime, Log, TEXT("%s: %d/%d work items are pipelined, the rest wait for the parent nodes."), *Title.ToString(), NumLinked, WorkItems.Num());
+}
+
+void UHoudiniBuildSequenceNode::NotifyParentNodesFinished()
+{
+	bParentNodesFinished = true;
+	if (GetState() != EAutomationGraphNodeState::Active)
+	{
+		// Activate() will pick up everything that is ready.
+		return;
+	}
+
+	TArray<TObjectPtr<UHoudiniBuildWorkItem>> NewlyReady;
+	for (TObjectPtr<UHoudiniBuildWorkItem> WorkItem : WorkItems)
+	{
+		// Batch members were taken out of the queue, but are already taken care of.
+		if (WorkItem && WorkItem->IsReadyToSubmit(true) && !ReadyWorkItems.Contains(WorkItem) && !WorkItem->GetBatch())
+		{
+			NewlyReady.Add(WorkItem);
+		}
+	}
+
+	if (ShouldFingerprintWorkItems())
+	{
+		UpdateFingerprints(NewlyReady);
+	}
+	ReadyWorkItems.Append(NewlyReady);
+	SubmitQueuedWorkItems();
+}
+
+void UHoudiniBuildSequenceNode::OnWorkItemReady(UHoudiniBuildWorkItem* WorkItem)
+{
+	if (GetState() != EAutomationGraphNodeState::Active || !WorkItem || !WorkItem->IsReadyToSubmit(bParentNodesFinished))
+	{
+		return;
+	}
+
+	TArray<TObjectPtr<UHoudiniBuildWorkItem>> NewlyReady = { WorkItem };
+	if (ShouldFingerprintWorkItems())
+	{
+		UpdateFingerprints(NewlyReady);
+	}
+	ReadyWorkItems.Add(WorkItem);
+	SubmitQueuedWorkItems();
+}
+
+void UHoudiniBuildSequenceNode::SortWorkItemsByCriticalPath()
+{
+	if (GetState() == EAutomationGraphNodeState::Active)
+	{
+		UE_LOG(LogEHERuntime, Warning, TEXT("warning: UHoudiniBuildSequenceNode::SortWorkItemsByCriticalPath() can't reorder work items while building."));
+		return;
+	}
+	
+	WorkItems.StableSort([](const TObjectPtr<UHoudiniBuildWorkItem>& A, const TObjectPtr<UHoudiniBuildWorkItem>& B)
+	{
+		return A->GetCriticalPath() > B->GetCriticalPath();
+	});
+}
+
+void UHoudiniBuildSequenceNode::Ready()
+{
+	bParentNodesFinished = false;
+	Super::Ready();
+}
+
+void UHoudiniBuildSequenceNode::Reset()
+{
+	WorkItems.Empty();
+	NumFinished = 0;
+	NumUpToDate = 0;
+	NumResumed = 0;
+	NumUnchangedOutputs = 0;
+	NumInFlight = 0;
+	NextWorkItemIndex = 0;
+	ReadyWorkItems.Empty();
+	Representatives.Empty();
+	WaitingOnRepresentative.Empty();
+	NumWaitingOnRepresentative = 0;
+	NumDeduplicated = 0;
+	NumWaitingOnBatch = 0;
+	NumBatches = 0;
+	NumCookedInBatch = 0;
+	NumRetries = 0;
+	RetriedWorkItems.Empty();
+	Unbatchable.Empty();
+	DestroyBatchWrapperActors();
+	bParentNodesFinished = false;
+	SetState(EAutomationGraphNodeState::Uninitialized); // require initialization every time we run.
+}
+
+void UHoudiniBuildSequenceNode::SetState(EAutomationGraphNodeState NewState)
+{
+	const bool bFailed = GetState() != NewState && (NewState == EAutomationGraphNodeState::Error || NewState == EAutomationGraphNodeState::Expired);
+	
+	Super::SetState(NewState);
+
+	// Batches can't be running anymore once the node has stopped, whatever the reason.
+	if (NewState == EAutomationGraphNodeState::Finished || NewState == EAutomationGraphNodeState::Error || NewState == EAutomationGraphNodeState::Expired)
+	{
+		DestroyBatchWrapperActors();
+	}
+
+	if (bFailed || (NewState == EAutomationGraphNodeState::Finished && !RetriedWorkItems.IsEmpty()))
+	{
+		LogRetriedWorkItems();
+	}
+
+	// Work items in other nodes may be waiting on work items that this node will now never submit.
+	if (bFailed)
+	{
+		for (UHoudiniBuildWorkItem* WorkItem : WorkItems)
+		{
+			if (WorkItem)
+			{
+				WorkItem->Abandon();
+			}
+		}
+	}
+}
+
+void UHoudiniBuildSequenceNode::OnWorkItemStateChanged(UHoudiniBuildWorkItem* WorkItem, EEHEBuildState NewState)
+{
+	OnWorkItemStateChangedDelegate.Broadcast(WorkItem, NewState);
+	
+	if (GetState() != EAutomationGraphNodeState::Active)
+	{
+		return;
+	}
+	
+	switch (NewState)
+	{
+	case EEHEBuildState::Building:
+		break;
+	case EEHEBuildState::Standby:
+		// Interrupted (see UHoudiniBuildWorkItem::Interrupt) and about to be submitted again. Still counts as in flight.
+		break;
+	case EEHEBuildState::Finished:
+		NumFinished++;
+		NumInFlight--;
+		NumUnchangedOutputs += WorkItem && WorkItem->HasUnchangedOutput() ? 1 : 0;
+		NumCookedInBatch += WorkItem && WorkItem->WasCookedInBatch() ? 1 : 0;
+		if (WorkItem && WorkItem->GetBatch() && WorkItem->GetBatch()->GetLeader() != WorkItem)
+		{
+			NumWaitingOnBatch--;
+		}
+		
+		// Identical instances finish synchronously in here, which can finish this node.
+		ReleaseWaitingOnRepresentative(WorkItem);
+		if (GetState() != EAutomationGraphNodeState::Active)
+		{
+			break;
+		}
+		ReleaseBatch(WorkItem);
+		
+		if (NumFinished == WorkItems.Num())
+		{
+			SetState(EAutomationGraphNodeState::Finished);
+		}
+		else
+		{
+			SubmitQueuedWorkItems();
+		}
+		break;
+	// TODO(): Add this back in if vanilla HE ever supports it.
+	/*case EEHEBuildState::FinishedWithError:
+		NumFinished++;
+		bFinishedWithError = true;
+		break;*/
+	case EEHEBuildState::Expired:
+	case EEHEBuildState::Error:
+		if (WorkItem && WorkItem->IsRetryPending())
+		{
+			// Still counts as in flight. The build manager submits it again once its backoff is over.
+			NumRetries++;
+			RetriedWorkItems.AddUnique(WorkItem);
+			
+			// A batch can't be picked up halfway through. The rest of it goes back in the queue, and the leader is
+			// retried on its own.
+			if (WorkItem->GetBatch() && WorkItem->GetBatch()->GetLeader() == WorkItem)
+			{
+				ReleaseBatch(WorkItem);
+				SubmitQueuedWorkItems();
+			}
+			break;
+		}
+		SetState(NewState == EEHEBuildState::Expired ? EAutomationGraphNodeState::Expired : EAutomationGraphNodeState::Error);
+		break;
+	default:
+		SetState(EAutomationGraphNodeState::Error);
+		break;
+	}
+}
+
+void UHoudiniBuildSequenceNode::RetryWorkItem(UHoudiniBuildWorkItem* WorkItem)
+{
+	if (!WorkItem || !WorkItem->IsRetryPending())
+	{
+		return;
+	}
+	if (GetState() != EAutomationGraphNodeState::Active)
+	{
+		WorkItem->Abandon();
+		return;
+	}
+
+	UE_LOG(LogEHERuntime, Log, TEXT("UHoudiniBuildSequenceNode: retrying %s (attempt %d of %d)."), *GetNameSafe(WorkItem->GetAssetActor().Get()), WorkItem->GetNumAttempts() + 1, BuildInfo.RetryPolicy.MaxAttempts);
+	
+	WorkItem->PrepareRetry();
+	UHoudiniCookArbiter* CookArbiter = UHoudiniCookArbiter::Get(WorkItem);
+	if (!(CookArbiter ? CookArbiter->Submit(WorkItem) : WorkItem->Build()) && !WorkItem->IsRetryPending())
+	{
+		NumInFlight--;
+		SetState(EAutomationGraphNodeState::Error);
+	}
+}
+
+void UHoudiniBuildSequenceNode::LogRetriedWorkItems() const
+{
+	FString Retried;
+	for (const UHoudiniBuildWorkItem* WorkItem : RetriedWorkItems)
+	{
+		if (!WorkItem)
+		{
+			continue;
+		}
+		
+		const EEHEBuildState BuildState = WorkItem->GetBuildState();
+		Retried += FString::Printf(
+			TEXT("\n  %s: %d attempts, %s"),
+			*GetNameSafe(WorkItem->GetAssetActor().Get()),
+			WorkItem->GetNumAttempts(),
+			BuildState == EEHEBuildState::Finished ? TEXT("finished") : BuildState == EEHEBuildState::Expired ? TEXT("expired") : TEXT("failed")
+		);
+	}
+	if (Retried.IsEmpty())
+	{
+		return;
+	}
+	
+	UE_LOG(LogEHERuntime, Log, TEXT("%s: %d work items needed retries (%d retries in total):%s"), *Title.ToString(), RetriedWorkItems.Num(), NumRetries, *Retried);
+}
+
+FString UHoudiniBuildSequenceNode::GetMessageText()
+{
+	if (GetState() == EAutomationGraphNodeState::Finished && bFinishedWithError)
+	{
+		double TotalTime = TimeFinished - TimeStarted;
+		return FString::Printf(TEXT("Finished in %.2lf Seconds (with errors)"), TotalTime); 
+	}
+	if (GetState() == EAutomationGraphNodeState::Active)
+	{
+		FString Progress = FString::Printf(TEXT("%s\n%d/%d Finished, %d Building, %d Queued"), *Super::GetMessageText(), NumFinished, WorkItems.Num(), NumInFlight, GetNumQueued());
+		if (NumRetries > 0)
+		{
+			Progress += FString::Printf(TEXT(", %d Retries"), NumRetries);
+		}
+		return Progress;
+	}
+	if (GetState() == EAutomationGraphNodeState::Finished && (NumUpToDate > 0 || NumResumed > 0 || NumDeduplicated > 0 || NumCookedInBatch > 0 || NumRetries > 0))
+	{
+		FString Summary = Super::GetMessageText();
+		if (NumUpToDate > 0)
+		{
+			Summary += FString::Printf(TEXT("\n%d/%d Up To Date"), NumUpToDate, WorkItems.Num());
+		}
+		if (NumResumed > 0)
+		{
+			Summary += FString::Printf(TEXT("\n%d/%d Resumed"), NumResumed, WorkItems.Num());
+		}
+		if (NumDeduplicated > 0)
+		{
+			Summary += FString::Printf(TEXT("\n%d Cooks Avoided (Identical Instances)"), NumDeduplicated);
+		}
+		if (NumCookedInBatch > 0)
+		{
+			Summary += FString::Printf(TEXT("\n%d/%d Cooked In %d Batches"), NumCookedInBatch, WorkItems.Num(), NumBatches);
+		}
+		if (NumRetries > 0)
+		{
+			Summary += FString::Printf(TEXT("\n%d/%d Needed %d Retries"), RetriedWorkItems.Num(), WorkItems.Num(), NumRetries);
+		}
+		return Summary;
 	}
 
 	return Super::GetMessageText();
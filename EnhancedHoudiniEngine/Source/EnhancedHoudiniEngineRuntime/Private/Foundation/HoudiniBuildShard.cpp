@@ -0,0 +1,242 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/HoudiniBuildShard.h"
+
+#include "HoudiniAssetActor.h"
+#include "Foundation/AutomationGraph.h"
+#include "Foundation/HoudiniBuildInputs.h"
+#include "Foundation/HoudiniBuildSequenceNode.h"
+
+namespace
+{
+	bool IsActorNode(const FAutomationGraphPlan& Plan, int32 NodeIndex)
+	{
+		return Plan.Nodes[NodeIndex] && Plan.Nodes[NodeIndex]->IsA<UHoudiniBuildSequenceNode>();
+	}
+
+	// For each node of the plan, whether a node that builds HDA actors comes before it, and whether one comes after it.
+	void FindActorNodeOrder(const FAutomationGraphPlan& Plan, TArray<bool>& OutAfterActorNode, TArray<bool>& OutBeforeActorNode)
+	{
+		const int32 NumNodes = Plan.Num();
+		OutAfterActorNode.Init(false, NumNodes);
+		OutBeforeActorNode.Init(false, NumNodes);
+
+		// Parents always come before their children in the plan.
+		for (int32 NodeIndex = 0; NodeIndex < NumNodes; ++NodeIndex)
+		{
+			for (int32 ParentIndex : Plan.GetParents(NodeIndex))
+			{
+				OutAfterActorNode[NodeIndex] |= OutAfterActorNode[ParentIndex] || IsActorNode(Plan, ParentIndex);
+			}
+		}
+		for (int32 NodeIndex = NumNodes - 1; NodeIndex >= 0; --NodeIndex)
+		{
+			for (int32 ChildIndex : Plan.GetChildren(NodeIndex))
+			{
+				OutBeforeActorNode[NodeIndex] |= OutBeforeActorNode[ChildIndex] || IsActorNode(Plan, ChildIndex);
+			}
+		}
+	}
+}
+
+bool FHoudiniBuildShard::Contains(const AActor* Actor) const
+{
+	if (!IsValid())
+	{
+		return true;
+	}
+
+	return Actor && Actors.Contains(FSoftObjectPath(Actor));
+}
+
+void FHoudiniBuildShard::GetNodesToRun(const FAutomationGraphPlan& Plan, TArray<bool>& OutRunsNode) const
+{
+	TArray<bool> AfterActorNode;
+	TArray<bool> BeforeActorNode;
+	FindActorNodeOrder(Plan, AfterActorNode, BeforeActorNode);
+
+	OutRunsNode.Init(false, Plan.Num());
+	for (int32 NodeIndex = 0; NodeIndex < Plan.Num(); ++NodeIndex)
+	{
+		const bool bActorNode = IsActorNode(Plan, NodeIndex);
+		switch (Nodes)
+		{
+		case EHoudiniBuildShardNodes::All:
+			OutRunsNode[NodeIndex] = true;
+			break;
+		case EHoudiniBuildShardNodes::ActorNodes:
+			OutRunsNode[NodeIndex] = bActorNode;
+			break;
+		case EHoudiniBuildShardNodes::SharedNodesBefore:
+			OutRunsNode[NodeIndex] = !bActorNode && !AfterActorNode[NodeIndex];
+			break;
+		case EHoudiniBuildShardNodes::SharedNodesAfter:
+			OutRunsNode[NodeIndex] = !bActorNode && AfterActorNode[NodeIndex];
+			break;
+		}
+	}
+}
+
+TArray<int32> FHoudiniBuildShard::FindInterleavedSharedNodes(const FAutomationGraphPlan& Plan)
+{
+	TArray<bool> AfterActorNode;
+	TArray<bool> BeforeActorNode;
+	FindActorNodeOrder(Plan, AfterActorNode, BeforeActorNode);
+
+	TArray<int32> Interleaved;
+	for (int32 NodeIndex = 0; NodeIndex < Plan.Num(); ++NodeIndex)
+	{
+		if (!IsActorNode(Plan, NodeIndex) && AfterActorNode[NodeIndex] && BeforeActorNode[NodeIndex])
+		{
+			Interleaved.Add(NodeIndex);
+		}
+	}
+	return Interleaved;
+}
+
+TMap<FSoftObjectPath, int32> FHoudiniBuildShard::Assign(TConstArrayView<AHoudiniAssetActor*> AssetActors, int32 Count, EHoudiniBuildShardKey Key, double CellSize)
+{
+	TMap<FSoftObjectPath, int32> Assignment;
+	if (Count < 1)
+	{
+		return Assignment;
+	}
+
+	// Sorted so that every process that runs this gets the same answer.
+	TArray<AHoudiniAssetActor*> SortedActors;
+	for (AHoudiniAssetActor* AssetActor : AssetActors)
+	{
+		if (AssetActor)
+		{
+			SortedActors.Add(AssetActor);
+		}
+	}
+	SortedActors.Sort([](const AHoudiniAssetActor& A, const AHoudiniAssetActor& B) { return A.GetPathName() < B.GetPathName(); });
+
+	TMap<const AHoudiniAssetActor*, int32> ActorIndices;
+	for (int32 ActorIndex = 0; ActorIndex < SortedActors.Num(); ++ActorIndex)
+	{
+		ActorIndices.Add(SortedActors[ActorIndex], ActorIndex);
+	}
+
+	// Union-find over the actors. Everything that ends up under the same root goes to the same shard.
+	TArray<int32> Roots;
+	Roots.SetNumUninitialized(SortedActors.Num());
+	for (int32 ActorIndex = 0; ActorIndex < SortedActors.Num(); ++ActorIndex)
+	{
+		Roots[ActorIndex] = ActorIndex;
+	}
+	auto FindRoot = [&Roots](int32 ActorIndex)
+	{
+		while (Roots[ActorIndex] != ActorIndex)
+		{
+			Roots[ActorIndex] = Roots[Roots[ActorIndex]];
+			ActorIndex = Roots[ActorIndex];
+		}
+		return ActorIndex;
+	};
+	auto Union = [&Roots, &FindRoot](int32 A, int32 B)
+	{
+		A = FindRoot(A);
+		B = FindRoot(B);
+		if (A != B)
+		{
+			// The lower index wins, so the result doesn't depend on the order we see the pairs in.
+			Roots[FMath::Max(A, B)] = FMath::Min(A, B);
+		}
+	};
+
+	if (Key == EHoudiniBuildShardKey::Cell && CellSize > 0.0)
+	{
+		TMap<FIntVector, int32> FirstActorInCell;
+		for (int32 ActorIndex = 0; ActorIndex < SortedActors.Num(); ++ActorIndex)
+		{
+			const FVector Location = SortedActors[ActorIndex]->GetActorLocation();
+			const FIntVector Cell(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize), 0);
+			if (const int32* FirstActor = FirstActorInCell.Find(Cell))
+			{
+				Union(*FirstActor, ActorIndex);
+			}
+			else
+			{
+				FirstActorInCell.Add(Cell, ActorIndex);
+			}
+		}
+	}
+
+	for (int32 ActorIndex = 0; ActorIndex < SortedActors.Num(); ++ActorIndex)
+	{
+		TArray<UObject*> InputObjects;
+		FHoudiniBuildInputs::GetInputObjects(SortedActors[ActorIndex]->GetHoudiniAssetComponent(), InputObjects);
+		for (UObject* InputObject : InputObjects)
+		{
+			const int32* UpstreamIndex = ActorIndices.Find(FHoudiniBuildInputs::FindAssetActor(InputObject));
+			if (UpstreamIndex)
+			{
+				Union(*UpstreamIndex, ActorIndex);
+			}
+		}
+	}
+
+	TMap<int32, TArray<int32>> Groups;
+	for (int32 ActorIndex = 0; ActorIndex < SortedActors.Num(); ++ActorIndex)
+	{
+		Groups.FindOrAdd(FindRoot(ActorIndex)).Add(ActorIndex);
+	}
+
+	// Biggest groups first, each to whichever shard has the fewest actors so far.
+	TArray<TArray<int32>> SortedGroups;
+	Groups.GenerateValueArray(SortedGroups);
+	SortedGroups.Sort([](const TArray<int32>& A, const TArray<int32>& B) { return A.Num() != B.Num() ? A.Num() > B.Num() : A[0] < B[0]; });
+	
+	TArray<int32> ShardSizes;
+	ShardSizes.SetNumZeroed(Count);
+	for (const TArray<int32>& Group : SortedGroups)
+	{
+		int32 SmallestShard = 0;
+		for (int32 ShardIndex = 1; ShardIndex < Count; ++ShardIndex)
+		{
+			if (ShardSizes[ShardIndex] < ShardSizes[SmallestShard])
+			{
+				SmallestShard = ShardIndex;
+			}
+		}
+
+		ShardSizes[SmallestShard] += Group.Num();
+		for (int32 ActorIndex : Group)
+		{
+			Assignment.Add(FSoftObjectPath(SortedActors[ActorIndex]), SmallestShard);
+		}
+	}
+
+	return Assignment;
+}
@@ -0,0 +1,818 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/HoudiniCookArbiter.h"
+
+#include "EHERuntimeLoggingDefs.h"
+#include "HoudiniAssetActor.h"
+#include "Foundation/HoudiniBuildInputs.h"
+#include "Foundation/HoudiniBuildSequenceNode.h"
+#include "Foundation/HoudiniCookSession.h"
+#include "HoudiniEngineRuntime/Private/HoudiniAssetComponent.h"
+
+static TAutoConsoleVariable<int32> CVarHoudiniMaxConcurrentCooks(
+	TEXT("houdini.BuildManager.MaxConcurrentCooks"),
+	32,
+	TEXT("Maximum number of HDA work items building at the same time across every HoudiniBuildManager in a world. 0 means no limit.")
+);
+
+static TAutoConsoleVariable<FString> CVarHoudiniCookSessionBackend(
+	TEXT("houdini.CookSessions.Backend"),
+	TEXT("HoudiniEngine"),
+	TEXT("What cooks work items: \"HoudiniEngine\" (the Houdini Engine plugin's session) or \"StandIn\" (simulated cooks, for testing the scheduler without Houdini)."),
+	ECVF_Cheat
+);
+
+static TAutoConsoleVariable<int32> CVarHoudiniCookSessionCount(
+	TEXT("houdini.CookSessions.Count"),
+	1,
+	TEXT("Number of cook sessions in the pool. Only the StandIn backend uses this: the HoudiniEngine backend always has a single session, so it doesn't cook HDAs in parallel.")
+);
+
+static TAutoConsoleVariable<int32> CVarHoudiniCookSessionMaxFailures(
+	TEXT("houdini.CookSessions.MaxConsecutiveFailures"),
+	3,
+	TEXT("A cook session that fails this many work items in a row is taken out of the pool for a while. 0 disables health tracking.")
+);
+
+static TAutoConsoleVariable<float> CVarHoudiniCookSessionCooldownSec(
+	TEXT("houdini.CookSessions.UnhealthyCooldownSec"),
+	30.0f,
+	TEXT("How long an unhealthy cook session is kept out of the pool.")
+);
+
+static TAutoConsoleVariable<float> CVarHoudiniCookSessionHeartbeatSec(
+	TEXT("houdini.CookSessions.HeartbeatSec"),
+	5.0f,
+	TEXT("How often cook sessions with work items cooking are checked for being alive. 0 disables session recovery.")
+);
+
+static TAutoConsoleVariable<int32> CVarHoudiniCookSessionHeartbeatMisses(
+	TEXT("houdini.CookSessions.MaxMissedHeartbeats"),
+	2,
+	TEXT("A cook session that misses this many heartbeats in a row is considered lost, and is restarted.")
+);
+
+static TAutoConsoleVariable<int32> CVarHoudiniCookSessionMaxRestarts(
+	TEXT("houdini.CookSessions.MaxRestarts"),
+	3,
+	TEXT("How many times each cook session is restarted before the work items cooking in it are failed instead.")
+);
+
+FString FHoudiniCookArbiterProgress::ToString() const
+{
+	FString Recovery;
+	if (NumSessionRestarts > 0)
+	{
+		Recovery = FString::Printf(TEXT(", %d session restarts (%d resubmitted, %.1lf seconds lost)"), NumSessionRestarts, NumResubmitted, LostSec);
+	}
+	if (NumRetried > 0)
+	{
+		Recovery += FString::Printf(TEXT(", %d retried (%d waiting)"), NumRetried, NumAwaitingRetry);
+	}
+	
+	return FString::Printf(
+		TEXT("%d queued, %d building, %d finished, %d failed, %d deduplicated, %d/%d sessions healthy%s"),
+		NumQueued,
+		NumBuilding,
+		NumFinished,
+		NumFailed,
+		NumDeduplicated,
+		NumHealthySessions,
+		NumSessions,
+		*Recovery
+	);
+}
+
+bool FHoudiniCookSessionState::HasCapacity() const
+{
+	const int32 Capacity = Session ? Session->GetCapacity() : 0;
+	return Session && (Capacity <= 0 || NumBuilding < Capacity);
+}
+
+UHoudiniCookArbiter* UHoudiniCookArbiter::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UHoudiniCookArbiter>() : nullptr;
+}
+
+void UHoudiniCookArbiter::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	HeartbeatTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickHeartbeat));
+}
+
+void UHoudiniCookArbiter::Deinitialize()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(HeartbeatTickerHandle);
+	Super::Deinitialize();
+}
+
+bool UHoudiniCookArbiter::Submit(UHoudiniBuildWorkItem* WorkItem)
+{
+	if (!WorkItem || !WorkItem->GetAssetActor().IsValid())
+	{
+		UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniCookArbiter::Submit() invalid work item"));
+		return false;
+	}
+
+	PruneAwaitingRetry();
+	if (!bBatchActive)
+	{
+		bBatchActive = true;
+		BatchStartTime = FPlatformTime::Seconds();
+		BatchProgress = FHoudiniCookArbiterProgress();
+		FinishedByActor.Empty();
+	}
+
+	WorkItem->SetArbiter(this);
+	Enqueue(FHoudiniCookArbiterEntry{WorkItem, WorkItem->GetPriority(), WorkItem->GetCriticalPath(), NextSequence++});
+	Dispatch();
+	FinishBatchIfIdle();
+
+	// A build that failed right away but will be retried hasn't failed yet.
+	return WorkItem->GetBuildState() != EEHEBuildState::Error || WorkItem->IsRetryPending();
+}
+
+void UHoudiniCookArbiter::OnWorkItemStateChanged(UHoudiniBuildWorkItem* WorkItem, EEHEBuildState NewState)
+{
+	if (NewState != EEHEBuildState::Finished && NewState != EEHEBuildState::Expired && NewState != EEHEBuildState::Error)
+	{
+		return;
+	}
+	if (!Building.Contains(WorkItem))
+	{
+		// Followers and queued items are completed by us, so there is nothing to do for them here.
+		return;
+	}
+
+	Building.Remove(WorkItem);
+	
+	int32 SessionIndex = INDEX_NONE;
+	if (SessionByWorkItem.RemoveAndCopyValue(WorkItem, SessionIndex))
+	{
+		OnSessionCookCompleted(SessionIndex, NewState == EEHEBuildState::Finished);
+	}
+
+	if (WorkItem->IsRetryPending())
+	{
+		// Stays the leader for its actor, its followers get the result of the retry.
+		BatchProgress.NumRetried++;
+		AwaitingRetry.Add(WorkItem);
+	}
+	else
+	{
+		CompleteLeader(WorkItem, NewState);
+	}
+	Dispatch();
+	FinishBatchIfIdle();
+}
+
+void UHoudiniCookArbiter::Withdraw(UHoudiniBuildWorkItem* WorkItem)
+{
+	if (!WorkItem)
+	{
+		return;
+	}
+	
+	const TWeakObjectPtr<AHoudiniAssetActor> AssetActor = WorkItem->GetAssetActor();
+	for (TPair<TWeakObjectPtr<UHoudiniBuildWorkItem>, TArray<TWeakObjectPtr<UHoudiniBuildWorkItem>>>& Followers : FollowersByLeader)
+	{
+		Followers.Value.Remove(WorkItem);
+	}
+	if (TArray<FHoudiniCookArbiterEntry>* Blocked = BlockedByActor.Find(AssetActor))
+	{
+		Blocked->RemoveAll([WorkItem](const FHoudiniCookArbiterEntry& Entry) { return Entry.WorkItem == WorkItem; });
+		if (Blocked->IsEmpty())
+		{
+			BlockedByActor.Remove(AssetActor);
+		}
+	}
+	
+	const int32 QueueIndex = Queue.IndexOfByPredicate([WorkItem](const FHoudiniCookArbiterEntry& Entry) { return Entry.WorkItem == WorkItem; });
+	if (QueueIndex != INDEX_NONE)
+	{
+		Queue.HeapRemoveAt(QueueIndex);
+	}
+	AwaitingRetry.Remove(WorkItem);
+
+	int32 SessionIndex = INDEX_NONE;
+	if (SessionByWorkItem.RemoveAndCopyValue(WorkItem, SessionIndex) && Sessions.IsValidIndex(SessionIndex))
+	{
+		Sessions[SessionIndex].NumBuilding--;
+	}
+	if (Building.Remove(WorkItem) > 0)
+	{
+		WorkItem->Interrupt();
+	}
+	
+	if (LeaderByActor.FindRef(AssetActor) == WorkItem)
+	{
+		ReleaseActor(AssetActor, WorkItem);
+	}
+	Dispatch();
+	FinishBatchIfIdle();
+}
+
+void UHoudiniCookArbiter::OnRetryAbandoned(UHoudiniBuildWorkItem* WorkItem)
+{
+	if (!WorkItem || AwaitingRetry.Remove(WorkItem) == 0)
+	{
+		return;
+	}
+
+	CompleteLeader(WorkItem, WorkItem->GetBuildState());
+	Dispatch();
+	FinishBatchIfIdle();
+}
+
+UHoudiniBuildWorkItem* UHoudiniCookArbiter::FindBuildingWorkItem(const UPackage* Package) const
+{
+	for (const TWeakObjectPtr<UHoudiniBuildWorkItem>& WorkItem : Building)
+	{
+		if (WorkItem.IsValid() && WorkItem->OwnsPackage(Package))
+		{
+			return WorkItem.Get();
+		}
+	}
+	return nullptr;
+}
+
+FHoudiniCookArbiterProgress UHoudiniCookArbiter::GetProgress() const
+{
+	FHoudiniCookArbiterProgress Progress = BatchProgress;
+	
+	Progress.NumQueued = Queue.Num();
+	for (const TPair<TWeakObjectPtr<AHoudiniAssetActor>, TArray<FHoudiniCookArbiterEntry>>& Blocked : BlockedByActor)
+	{
+		Progress.NumQueued += Blocked.Value.Num();
+	}
+	Progress.NumBuilding = Building.Num();
+	Progress.NumAwaitingRetry = AwaitingRetry.Num();
+	
+	const double TimeNow = FPlatformTime::Seconds();
+	Progress.NumSessions = Sessions.Num();
+	for (const FHoudiniCookSessionState& SessionState : Sessions)
+	{
+		Progress.NumHealthySessions += SessionState.IsHealthy(TimeNow) ? 1 : 0;
+	}
+
+	return Progress;
+}
+
+void UHoudiniCookArbiter::Enqueue(const FHoudiniCookArbiterEntry& Entry)
+{
+	UHoudiniBuildWorkItem* WorkItem = Entry.WorkItem.Get();
+	if (!WorkItem)
+	{
+		return;
+	}
+	
+	TWeakObjectPtr<AHoudiniAssetActor> AssetActor = WorkItem->GetAssetActor();
+	
+	if (UHoudiniBuildWorkItem* Leader = LeaderByActor.FindRef(AssetActor).Get())
+	{
+		if (Leader == WorkItem)
+		{
+			// A retry. It kept the actor while waiting out its backoff.
+			AwaitingRetry.Remove(WorkItem);
+			Queue.HeapPush(Entry);
+		}
+		else if (IsSameBuild(Leader->GetClass(), Leader->GetFingerprint(), WorkItem))
+		{
+			// Someone else already asked for exactly this, just wait for their result.
+			FollowersByLeader.FindOrAdd(Leader).Add(WorkItem);
+		}
+		else
+		{
+			BlockedByActor.FindOrAdd(AssetActor).Add(Entry);
+		}
+		return;
+	}
+
+	const FHoudiniCookArbiterFinished* Finished = FinishedByActor.Find(AssetActor);
+	if (Finished && IsSameBuild(Finished->WorkItemClass.Get(), Finished->Fingerprint, WorkItem))
+	{
+		// Already built during this batch.
+		BatchProgress.NumDeduplicated++;
+		WorkItem->FinishAsDuplicate(EEHEBuildState::Finished);
+		return;
+	}
+
+	LeaderByActor.Add(AssetActor, WorkItem);
+	Queue.HeapPush(Entry);
+}
+
+void UHoudiniCookArbiter::Dispatch()
+{
+	// Starting a work item can complete it synchronously, which calls back in here.
+	if (bDispatching)
+	{
+		return;
+	}
+	TGuardValue<bool> DispatchingGuard(bDispatching, true);
+
+	UpdateSessionPool();
+	
+	const int32 MaxConcurrentCooks = CVarHoudiniMaxConcurrentCooks.GetValueOnGameThread();
+	const double TimeNow = FPlatformTime::Seconds();
+	
+	// Entries whose session is busy. They go back in the queue afterwards, so work for other sessions can go ahead.
+	TArray<FHoudiniCookArbiterEntry> Deferred;
+	
+	while (!Queue.IsEmpty() && (MaxConcurrentCooks <= 0 || Building.Num() < MaxConcurrentCooks))
+	{
+		if (!Sessions.ContainsByPredicate([](const FHoudiniCookSessionState& SessionState) { return SessionState.HasCapacity(); }))
+		{
+			break;
+		}
+		
+		FHoudiniCookArbiterEntry Entry;
+		Queue.HeapPop(Entry);
+
+		UHoudiniBuildWorkItem* WorkItem = Entry.WorkItem.Get();
+		if (!WorkItem || !IsStillWanted(WorkItem))
+		{
+			// The run that submitted this was reset, hand the actor to whoever is waiting on it.
+			ReleaseActor(WorkItem ? WorkItem->GetAssetActor() : TWeakObjectPtr<AHoudiniAssetActor>(), WorkItem);
+			continue;
+		}
+
+		TArray<FObjectKey> AffinityKeys;
+		GetAffinityKeys(WorkItem, AffinityKeys);
+		const int32 SessionIndex = ChooseSession(AffinityKeys, TimeNow);
+		if (SessionIndex == INDEX_NONE)
+		{
+			Deferred.Add(Entry);
+			continue;
+		}
+		
+		for (const FObjectKey& AffinityKey : AffinityKeys)
+		{
+			SessionByAffinityKey.Add(AffinityKey, SessionIndex);
+		}
+
+		Building.Add(WorkItem);
+		SessionByWorkItem.Add(WorkItem, SessionIndex);
+		Sessions[SessionIndex].NumBuilding++;
+		
+		// On failure, the work item moves into the error state, which completes it through OnWorkItemStateChanged.
+		Sessions[SessionIndex].Session->Start(WorkItem);
+	}
+
+	for (const FHoudiniCookArbiterEntry& Entry : Deferred)
+	{
+		Queue.HeapPush(Entry);
+	}
+}
+
+void UHoudiniCookArbiter::UpdateSessionPool()
+{
+	FString Backend = CVarHoudiniCookSessionBackend.GetValueOnGameThread();
+	int32 NumSessions = FMath::Max(CVarHoudiniCookSessionCount.GetValueOnGameThread(), 1);
+
+	// Stand-in cooks finish without building anything, so a real build must never end up with them.
+#if UE_BUILD_SHIPPING
+	const bool bAllowStandIn = false;
+#else
+	const bool bAllowStandIn = !IsRunningCommandlet();
+#endif
+	const bool bStandInRequested = Backend.Equals(TEXT("StandIn"), ESearchCase::IgnoreCase);
+	if (!bStandInRequested || !bAllowStandIn)
+	{
+		Backend = TEXT("HoudiniEngine");
+		NumSessions = 1;
+	}
+
+	// The pool can only be swapped out while nothing is cooking in it.
+	if ((Backend == SessionBackend && NumSessions == Sessions.Num()) || !Building.IsEmpty())
+	{
+		return;
+	}
+
+	if (bStandInRequested && !bAllowStandIn)
+	{
+		UE_LOG(LogEHERuntime, Warning, TEXT("warning: stand-in cook sessions are for testing only, and can't be used in commandlets or shipping builds. Using the Houdini Engine session instead."));
+	}
+
+	if (Backend == TEXT("HoudiniEngine") && CVarHoudiniCookSessionCount.GetValueOnGameThread() > 1)
+	{
+		UE_LOG(LogEHERuntime, Warning, TEXT("warning: the Houdini Engine plugin only drives one session, ignoring houdini.CookSessions.Count. HDAs are cooked in a single session."));
+	}
+	
+	Sessions.Reset();
+	SessionByAffinityKey.Empty();
+	SessionBackend = Backend;
+	for (int32 SessionIndex = 0; SessionIndex < NumSessions; ++SessionIndex)
+	{
+		FHoudiniCookSessionState& SessionState = Sessions.AddDefaulted_GetRef();
+		if (Backend == TEXT("StandIn"))
+		{
+			SessionState.Session = MakeShared<FHoudiniStandInCookSession>(SessionIndex);
+		}
+		else
+		{
+			SessionState.Session = FHoudiniEngineCookSession::Create();
+		}
+	}
+
+	UE_LOG(LogEHERuntime, Log, TEXT("Houdini cook arbiter: using %d %s cook session(s)."), NumSessions, *Backend);
+}
+
+void UHoudiniCookArbiter::GetAffinityKeys(UHoudiniBuildWorkItem* WorkItem, TArray<FObjectKey>& OutAffinityKeys) const
+{
+	AHoudiniAssetActor* AssetActor = WorkItem->GetAssetActor().Get();
+	if (!AssetActor)
+	{
+		return;
+	}
+	
+	// Keyed by the actor itself too, so HDAs that take this one as input end up on the same session.
+	OutAffinityKeys.Add(FObjectKey(AssetActor));
+	
+	TArray<UObject*> InputObjects;
+	FHoudiniBuildInputs::GetInputObjects(AssetActor->GetHoudiniAssetComponent(), InputObjects);
+	for (UObject* InputObject : InputObjects)
+	{
+		AHoudiniAssetActor* InputAssetActor = FHoudiniBuildInputs::FindAssetActor(InputObject);
+		OutAffinityKeys.AddUnique(FObjectKey(InputAssetActor ? InputAssetActor : InputObject));
+	}
+}
+
+int32 UHoudiniCookArbiter::ChooseSession(TConstArrayView<FObjectKey> AffinityKeys, double TimeNow) const
+{
+	for (const FObjectKey& AffinityKey : AffinityKeys)
+	{
+		const int32* AffinitySession = SessionByAffinityKey.Find(AffinityKey);
+		if (AffinitySession && Sessions.IsValidIndex(*AffinitySession) && Sessions[*AffinitySession].IsHealthy(TimeNow))
+		{
+			// Wait for the session that already has the inputs rather than sending them somewhere else.
+			return Sessions[*AffinitySession].HasCapacity() ? *AffinitySession : INDEX_NONE;
+		}
+	}
+
+	// Least busy healthy session. If every session is unhealthy, carry on with them anyway rather than stalling.
+	const bool bAnyHealthy = Sessions.ContainsByPredicate([TimeNow](const FHoudiniCookSessionState& SessionState) { return SessionState.IsHealthy(TimeNow); });
+	int32 BestSession = INDEX_NONE;
+	for (int32 SessionIndex = 0; SessionIndex < Sessions.Num(); ++SessionIndex)
+	{
+		const FHoudiniCookSessionState& SessionState = Sessions[SessionIndex];
+		if ((bAnyHealthy && !SessionState.IsHealthy(TimeNow)) || !SessionState.HasCapacity())
+		{
+			continue;
+		}
+		if (BestSession == INDEX_NONE || SessionState.NumBuilding < Sessions[BestSession].NumBuilding)
+		{
+			BestSession = SessionIndex;
+		}
+	}
+	return BestSession;
+}
+
+void UHoudiniCookArbiter::OnSessionCookCompleted(int32 SessionIndex, bool bSucceeded)
+{
+	if (!Sessions.IsValidIndex(SessionIndex))
+	{
+		return;
+	}
+
+	FHoudiniCookSessionState& SessionState = Sessions[SessionIndex];
+	SessionState.NumBuilding--;
+	if (bSucceeded)
+	{
+		SessionState.NumFinished++;
+		SessionState.ConsecutiveFailures = 0;
+		return;
+	}
+
+	SessionState.NumFailed++;
+	SessionState.ConsecutiveFailures++;
+	
+	const int32 MaxConsecutiveFailures = CVarHoudiniCookSessionMaxFailures.GetValueOnGameThread();
+	if (MaxConsecutiveFailures > 0 && SessionState.ConsecutiveFailures >= MaxConsecutiveFailures && Sessions.Num() > 1)
+	{
+		const float CooldownSec = CVarHoudiniCookSessionCooldownSec.GetValueOnGameThread();
+		UE_LOG(LogEHERuntime, Warning, TEXT("warning: cook session %s failed %d work items in a row, taking it out of the pool for %.0f seconds."), *SessionState.Session->GetName(), SessionState.ConsecutiveFailures, CooldownSec);
+		SessionState.ConsecutiveFailures = 0;
+		SessionState.UnhealthyUntil = FPlatformTime::Seconds() + CooldownSec;
+	}
+}
+
+bool UHoudiniCookArbiter::TickHeartbeat(float DeltaTime)
+{
+	const float HeartbeatSec = CVarHoudiniCookSessionHeartbeatSec.GetValueOnGameThread();
+	const double TimeNow = FPlatformTime::Seconds();
+	if (HeartbeatSec <= 0.0f || Building.IsEmpty() || TimeNow - LastHeartbeatTime < HeartbeatSec)
+	{
+		return true;
+	}
+	LastHeartbeatTime = TimeNow;
+
+	// Idle sessions aren't asked, a session with nothing to cook can't hold anything up.
+	const int32 MaxMissedHeartbeats = FMath::Max(CVarHoudiniCookSessionHeartbeatMisses.GetValueOnGameThread(), 1);
+	for (int32 SessionIndex = 0; SessionIndex < Sessions.Num(); ++SessionIndex)
+	{
+		FHoudiniCookSessionState& SessionState = Sessions[SessionIndex];
+		if (SessionState.NumBuilding <= 0 || SessionState.Session->IsAlive())
+		{
+			SessionState.MissedHeartbeats = 0;
+			continue;
+		}
+		
+		if (++SessionState.MissedHeartbeats >= MaxMissedHeartbeats)
+		{
+			RecoverSession(SessionIndex);
+		}
+	}
+
+	return true;
+}
+
+void UHoudiniCookArbiter::RecoverSession(int32 SessionIndex)
+{
+	FHoudiniCookSessionState& SessionState = Sessions[SessionIndex];
+	SessionState.MissedHeartbeats = 0;
+
+	TArray<UHoudiniBuildWorkItem*> Interrupted;
+	for (const TPair<TWeakObjectPtr<UHoudiniBuildWorkItem>, int32>& WorkItemSession : SessionByWorkItem)
+	{
+		if (WorkItemSession.Value == SessionIndex && WorkItemSession.Key.IsValid())
+		{
+			Interrupted.Add(WorkItemSession.Key.Get());
+		}
+	}
+
+	const FString SessionName = SessionState.Session->GetName();
+	const bool bCanRestart = SessionState.NumRestarts < CVarHoudiniCookSessionMaxRestarts.GetValueOnGameThread();
+	UE_LOG(LogEHERuntime, Warning, TEXT("warning: cook session %s stopped answering with %d work items cooking%s."), *SessionName, Interrupted.Num(), bCanRestart ? TEXT(", restarting it") : TEXT(""));
+	
+	if (!bCanRestart || !SessionState.Session->Restart(Interrupted))
+	{
+		// Failing them goes through OnWorkItemStateChanged like any other failed cook. The session sits out a cooldown,
+		// so if there are other sessions the rest of the queue goes there.
+		SessionState.UnhealthyUntil = FPlatformTime::Seconds() + CVarHoudiniCookSessionCooldownSec.GetValueOnGameThread();
+		for (UHoudiniBuildWorkItem* WorkItem : Interrupted)
+		{
+			UE_LOG(LogEHERuntime, Error, TEXT("error: UHoudiniCookArbiter::RecoverSession(): %s was lost with cook session %s."), *GetNameSafe(WorkItem->GetAssetActor().Get()), *SessionName);
+			WorkItem->CompleteExternalBuild(false);
+		}
+		return;
+	}
+
+	SessionState.NumRestarts++;
+	BatchProgress.NumSessionRestarts++;
+
+	const double TimeNow = FPlatformTime::Seconds();
+	int32 NumResubmitted = 0;
+	double LostSec = 0.0;
+	for (UHoudiniBuildWorkItem* WorkItem : Interrupted)
+	{
+		if (WorkItem->GetBuildState() != EEHEBuildState::Building)
+		{
+			continue;
+		}
+		
+		// A batch can't be picked up halfway through, so its leader fails like any other failed cook.
+		if (WorkItem->GetBatch())
+		{
+			WorkItem->CompleteExternalBuild(false);
+			continue;
+		}
+
+		Building.Remove(WorkItem);
+		if (SessionByWorkItem.Remove(WorkItem) > 0 && Sessions.IsValidIndex(SessionIndex))
+		{
+			Sessions[SessionIndex].NumBuilding--;
+		}
+		
+		LostSec += TimeNow - WorkItem->GetTimeStarted();
+		WorkItem->Interrupt();
+		NumResubmitted++;
+		
+		// Still the leader for its actor, so it goes straight back in the queue.
+		Queue.HeapPush(FHoudiniCookArbiterEntry{WorkItem, WorkItem->GetPriority(), WorkItem->GetCriticalPath(), NextSequence++});
+	}
+	BatchProgress.NumResubmitted += NumResubmitted;
+	BatchProgress.LostSec += LostSec;
+
+	UE_LOG(LogEHERuntime, Log, TEXT("Houdini cook arbiter: restarted %s, resubmitting %d work items (%.1lf seconds of cooking lost)."), *SessionName, NumResubmitted, LostSec);
+	Dispatch();
+}
+
+bool UHoudiniCookArbiter::KillSession(int32 SessionIndex)
+{
+	UpdateSessionPool();
+	return Sessions.IsValidIndex(SessionIndex) && Sessions[SessionIndex].Session->Kill();
+}
+
+FString UHoudiniCookArbiter::GetSessionStatusString() const
+{
+	const double TimeNow = FPlatformTime::Seconds();
+	
+	FString Status;
+	for (const FHoudiniCookSessionState& SessionState : Sessions)
+	{
+		Status += FString::Printf(
+			TEXT("\n  %s: %d building, %d finished, %d failed, %s"),
+			*SessionState.Session->GetName(),
+			SessionState.NumBuilding,
+			SessionState.NumFinished,
+			SessionState.NumFailed,
+			SessionState.IsHealthy(TimeNow) ? TEXT("healthy") : TEXT("unhealthy")
+		);
+	}
+	return Status;
+}
+
+void UHoudiniCookArbiter::CompleteLeader(UHoudiniBuildWorkItem* Leader, EEHEBuildState FinalState)
+{
+	TWeakObjectPtr<AHoudiniAssetActor> AssetActor = Leader->GetAssetActor();
+	
+	if (FinalState == EEHEBuildState::Finished)
+	{
+		BatchProgress.NumFinished++;
+		FinishedByActor.Add(AssetActor, FHoudiniCookArbiterFinished{Leader->GetClass(), Leader->GetFingerprint()});
+	}
+	else
+	{
+		BatchProgress.NumFailed++;
+	}
+
+	TArray<TWeakObjectPtr<UHoudiniBuildWorkItem>> Followers;
+	FollowersByLeader.RemoveAndCopyValue(Leader, Followers);
+	LeaderByActor.Remove(AssetActor);
+	
+	for (TWeakObjectPtr<UHoudiniBuildWorkItem> Follower : Followers)
+	{
+		if (Follower.IsValid())
+		{
+			BatchProgress.NumDeduplicated++;
+			Follower->FinishAsDuplicate(FinalState);
+		}
+	}
+
+	ReleaseActor(AssetActor, nullptr);
+}
+
+void UHoudiniCookArbiter::ReleaseActor(const TWeakObjectPtr<AHoudiniAssetActor>& AssetActor, UHoudiniBuildWorkItem* Leader)
+{
+	TArray<FHoudiniCookArbiterEntry> ToEnqueue;
+	
+	if (Leader)
+	{
+		// A leader that is dropped without building passes the actor on to its followers.
+		TArray<TWeakObjectPtr<UHoudiniBuildWorkItem>> Followers;
+		FollowersByLeader.RemoveAndCopyValue(Leader, Followers);
+		LeaderByActor.Remove(AssetActor);
+
+		for (TWeakObjectPtr<UHoudiniBuildWorkItem> Follower : Followers)
+		{
+			if (Follower.IsValid())
+			{
+				ToEnqueue.Add(FHoudiniCookArbiterEntry{Follower, Follower->GetPriority(), Follower->GetCriticalPath(), NextSequence++});
+			}
+		}
+	}
+
+	TArray<FHoudiniCookArbiterEntry> Blocked;
+	if (BlockedByActor.RemoveAndCopyValue(AssetActor, Blocked))
+	{
+		ToEnqueue.Append(Blocked);
+	}
+
+	for (const FHoudiniCookArbiterEntry& Entry : ToEnqueue)
+	{
+		Enqueue(Entry);
+	}
+}
+
+bool UHoudiniCookArbiter::IsSameBuild(UClass* WorkItemClass, const FString& Fingerprint, const UHoudiniBuildWorkItem* WorkItem)
+{
+	return WorkItemClass == WorkItem->GetClass() && !Fingerprint.IsEmpty() && Fingerprint == WorkItem->GetFingerprint();
+}
+
+bool UHoudiniCookArbiter::IsStillWanted(UHoudiniBuildWorkItem* WorkItem) const
+{
+	UHoudiniBuildSequenceNode* Owner = WorkItem->GetOwner();
+	
+	return Owner
+		&& Owner->GetState() == EAutomationGraphNodeState::Active
+		&& WorkItem->GetBuildState() == EEHEBuildState::Standby
+		&& WorkItem->GetAssetActor().IsValid();
+}
+
+void UHoudiniCookArbiter::PruneAwaitingRetry()
+{
+	TArray<UHoudiniBuildWorkItem*> Abandoned;
+	for (auto It = AwaitingRetry.CreateIterator(); It; ++It)
+	{
+		UHoudiniBuildWorkItem* WorkItem = It->Get();
+		UHoudiniBuildSequenceNode* Owner = WorkItem ? WorkItem->GetOwner() : nullptr;
+		if (WorkItem && WorkItem->IsRetryPending() && Owner && Owner->GetState() == EAutomationGraphNodeState::Active)
+		{
+			continue;
+		}
+		
+		It.RemoveCurrent();
+		if (WorkItem)
+		{
+			Abandoned.Add(WorkItem);
+		}
+	}
+
+	for (UHoudiniBuildWorkItem* WorkItem : Abandoned)
+	{
+		CompleteLeader(WorkItem, WorkItem->GetBuildState());
+	}
+}
+
+void UHoudiniCookArbiter::FinishBatchIfIdle()
+{
+	PruneAwaitingRetry();
+	if (!bBatchActive || !IsIdle())
+	{
+		return;
+	}
+
+	bBatchActive = false;
+	FollowersByLeader.Empty();
+	LeaderByActor.Empty();
+	SessionByAffinityKey.Empty();
+	
+	UE_LOG(
+		LogEHERuntime,
+		Log,
+		TEXT("Houdini cook arbiter finished in %.2lf seconds: %s"),
+		FPlatformTime::Seconds() - BatchStartTime,
+		*GetProgress().ToString()
+	);
+}
+
+// CONSOLE COMMANDS ----------------------------------------------------------------------------------------------------
+FAutoConsoleCommandWithWorldAndArgs GHoudiniBuildManagerStatusCmd(
+	TEXT("houdini.BuildManager.Status"),
+	TEXT("Prints the combined cook progress of every HoudiniBuildManager in the scene."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(
+		[](const TArray<FString>& Args, UWorld* World)
+		{
+			UHoudiniCookArbiter* CookArbiter = UHoudiniCookArbiter::Get(World);
+			if (!CookArbiter)
+			{
+				return;
+			}
+
+			UE_LOG(LogEHERuntime, Log, TEXT("Houdini cook arbiter: %s%s"), *CookArbiter->GetProgress().ToString(), *CookArbiter->GetSessionStatusString());
+		}
+	)
+);
+
+FAutoConsoleCommandWithWorldAndArgs GHoudiniCookSessionsKillCmd(
+	TEXT("houdini.CookSessions.Kill"),
+	TEXT("Kills a stand-in cook session (index, 0 by default), to test session recovery."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(
+		[](const TArray<FString>& Args, UWorld* World)
+		{
+			UHoudiniCookArbiter* CookArbiter = UHoudiniCookArbiter::Get(World);
+			if (!CookArbiter)
+			{
+				return;
+			}
+
+			const int32 SessionIndex = Args.IsEmpty() ? 0 : FCString::Atoi(*Args[0]);
+			if (!CookArbiter->KillSession(SessionIndex))
+			{
+				UE_LOG(LogEHERuntime, Warning, TEXT("warning: cook session %d can't be killed. Only stand-in sessions (houdini.CookSessions.Backend StandIn) can."), SessionIndex);
+			}
+		}
+	)
+);
+
+// END CONSOLE COMMANDS ------------------------------------------------------------------------------------------------
\ No newline at end of file
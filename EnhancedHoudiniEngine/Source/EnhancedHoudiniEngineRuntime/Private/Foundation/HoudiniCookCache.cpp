@@ -0,0 +1,937 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/HoudiniCookCache.h"
+
+#include "EHERuntimeLoggingDefs.h"
+#include "Landscape.h"
+#include "LandscapeInfo.h"
+#include "LandscapeLayerInfoObject.h"
+#include "LandscapeProxy.h"
+#include "MeshDescription.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Foundation/HoudiniBuildOutputHash.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "HAL/FileManager.h"
+#include "HoudiniEngineRuntime/Private/HoudiniAssetComponent.h"
+#include "HoudiniEngineRuntime/Private/HoudiniOutput.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+
+#if WITH_EDITOR
+#include "LandscapeEdit.h"
+#endif
+
+static TAutoConsoleVariable<bool> CVarHoudiniCookCacheEnable(
+	TEXT("houdini.CookCache.Enable"),
+	false,
+	TEXT("Restore HDA cook results from the cook cache instead of cooking, and store the results of new cooks in it.")
+);
+
+static TAutoConsoleVariable<FString> CVarHoudiniCookCacheLocalPath(
+	TEXT("houdini.CookCache.LocalPath"),
+	TEXT(""),
+	TEXT("Directory of the local cook cache. Defaults to Saved/HoudiniCookCache.")
+);
+
+static TAutoConsoleVariable<FString> CVarHoudiniCookCacheSharedPath(
+	TEXT("houdini.CookCache.SharedPath"),
+	TEXT(""),
+	TEXT("Directory of a cook cache shared between machines, e.g. on a network share. Empty to only use the local cache.")
+);
+
+static TAutoConsoleVariable<int32> CVarHoudiniCookCacheMaxLocalSizeMB(
+	TEXT("houdini.CookCache.MaxLocalSizeMB"),
+	10240,
+	TEXT("Size limit of the local cook cache. Least recently used entries are evicted past it. 0 means no limit.")
+);
+
+static TAutoConsoleVariable<int32> CVarHoudiniCookCacheMaxSharedSizeMB(
+	TEXT("houdini.CookCache.MaxSharedSizeMB"),
+	102400,
+	TEXT("Size limit of the shared cook cache. Least recently used entries are evicted past it. 0 means no limit.")
+);
+
+namespace
+{
+	constexpr uint32 CookCacheMagic = 0x43434845;
+	constexpr uint32 CookCacheVersion = 2;
+	const TCHAR* CookCacheExtension = TEXT(".ehecache");
+
+	enum class ECookCacheSlotType : uint8
+	{
+		// Objects whose state follows from the other outputs (mesh components, HE landscape wrappers...). Only their
+		// presence is checked.
+		Structural,
+		StaticMesh,
+		Instances,
+		Landscape,
+	};
+
+	// One output object, identified by where it sits in the outputs so cached data can be matched up with it.
+	struct FCookCacheSlot
+	{
+		FString Signature;
+		ECookCacheSlotType Type = ECookCacheSlotType::Structural;
+		UObject* Object = nullptr;
+
+		// For landscapes, the part the HDA wrote to (see FHoudiniBuildOutputHash::AddLandscapeRegions). Nothing outside of
+		// it is stored or restored, since other HDAs may own the rest of the landscape.
+		FIntRect LandscapeRegion;
+	};
+
+	int64 MegabytesToBytes(int32 Megabytes)
+	{
+		return static_cast<int64>(FMath::Max(Megabytes, 0)) * 1024 * 1024;
+	}
+
+	FString GetEntryPath(const FString& Directory, const FString& Fingerprint)
+	{
+		return Directory / Fingerprint.Left(2) / Fingerprint + CookCacheExtension;
+	}
+
+#if WITH_EDITOR
+	FString GetEngineVersionString()
+	{
+		// Mesh descriptions are serialized without custom versions, so entries are only valid for the engine that wrote them.
+		return FEngineVersion::Current().ToString(EVersionComponent::Patch);
+	}
+
+	// Returns false if Object is something we don't know how to cache.
+	bool AddSlot(const FString& Prefix, UObject* Object, TArray<FCookCacheSlot>& OutSlots, TMap<ALandscapeProxy*, FIntRect>& OutLandscapeRegions)
+	{
+		if (!IsValid(Object))
+		{
+			return true;
+		}
+
+		FCookCacheSlot Slot;
+		Slot.Signature = Prefix + TEXT(":") + Object->GetClass()->GetName();
+		Slot.Object = Object;
+		
+		if (Object->IsA<UStaticMesh>())
+		{
+			Slot.Type = ECookCacheSlotType::StaticMesh;
+		}
+		else if (Object->IsA<UInstancedStaticMeshComponent>())
+		{
+			Slot.Type = ECookCacheSlotType::Instances;
+		}
+		else if (Object->IsA<ALandscapeProxy>())
+		{
+			// Landscapes are added once all outputs have been gathered, since several outputs can share one.
+			FHoudiniBuildOutputHash::AddLandscapeRegions(Object, OutLandscapeRegions);
+			return true;
+		}
+		else if (!Object->IsA<UStaticMeshComponent>())
+		{
+			TMap<ALandscapeProxy*, FIntRect> ReferencedRegions;
+			FHoudiniBuildOutputHash::AddLandscapeRegions(Object, ReferencedRegions);
+			if (ReferencedRegions.IsEmpty())
+			{
+				return false;
+			}
+			for (const TPair<ALandscapeProxy*, FIntRect>& ReferencedRegion : ReferencedRegions)
+			{
+				if (FIntRect* ExistingRegion = OutLandscapeRegions.Find(ReferencedRegion.Key))
+				{
+					ExistingRegion->Union(ReferencedRegion.Value);
+				}
+				else
+				{
+					OutLandscapeRegions.Add(ReferencedRegion.Key, ReferencedRegion.Value);
+				}
+			}
+		}
+
+		OutSlots.Add(MoveTemp(Slot));
+		return true;
+	}
+
+	bool GatherSlots(UHoudiniAssetComponent* AssetComponent, TArray<FCookCacheSlot>& OutSlots)
+	{
+		TMap<ALandscapeProxy*, FIntRect> LandscapeRegions;
+		
+		for (int32 OutputIndex = 0; OutputIndex < AssetComponent->GetNumOutputs(); ++OutputIndex)
+		{
+			UHoudiniOutput* Output = AssetComponent->GetOutputAt(OutputIndex);
+			if (!Output)
+			{
+				continue;
+			}
+
+			for (auto& OutputObjectPair : Output->GetOutputObjects())
+			{
+				const FHoudiniOutputObjectIdentifier& Identifier = OutputObjectPair.Key;
+				const FHoudiniOutputObject& OutputObject = OutputObjectPair.Value;
+				const FString Prefix = FString::Printf(TEXT("%d/%d/%d/%d/%s"), OutputIndex, Identifier.ObjectId, Identifier.GeoId, Identifier.PartId, *Identifier.SplitIdentifier);
+				
+				if (!AddSlot(Prefix, OutputObject.OutputObject, OutSlots, LandscapeRegions))
+				{
+					return false;
+				}
+				for (int32 ComponentIndex = 0; ComponentIndex < OutputObject.OutputComponents.Num(); ++ComponentIndex)
+				{
+					if (!AddSlot(FString::Printf(TEXT("%s/%d"), *Prefix, ComponentIndex), OutputObject.OutputComponents[ComponentIndex], OutSlots, LandscapeRegions))
+					{
+						return false;
+					}
+				}
+			}
+		}
+
+		// Output objects live in maps, so their order isn't guaranteed to be the same from one cook to the next.
+		OutSlots.Sort([](const FCookCacheSlot& A, const FCookCacheSlot& B)
+		{
+			return A.Signature < B.Signature;
+		});
+
+		LandscapeRegions.KeySort([](const ALandscapeProxy& A, const ALandscapeProxy& B)
+		{
+			return A.GetPathName() < B.GetPathName();
+		});
+		int32 LandscapeIndex = 0;
+		for (const TPair<ALandscapeProxy*, FIntRect>& LandscapeRegion : LandscapeRegions)
+		{
+			FCookCacheSlot& Slot = OutSlots.AddDefaulted_GetRef();
+			Slot.Signature = FString::Printf(TEXT("Landscape/%d:%s"), LandscapeIndex++, *LandscapeRegion.Key->GetClass()->GetName());
+			Slot.Type = ECookCacheSlotType::Landscape;
+			Slot.Object = LandscapeRegion.Key;
+			Slot.LandscapeRegion = LandscapeRegion.Value;
+		}
+
+		return true;
+	}
+
+	int32 GetNumLandscapeSamples(const FIntRect& Extent)
+	{
+		return (Extent.Width() + 1) * (Extent.Height() + 1);
+	}
+
+	bool SaveSlot(FArchive& Ar, const FCookCacheSlot& Slot)
+	{
+		switch (Slot.Type)
+		{
+		case ECookCacheSlotType::StaticMesh:
+		{
+			UStaticMesh* StaticMesh = CastChecked<UStaticMesh>(Slot.Object);
+			int32 NumLODs = StaticMesh->GetNumSourceModels();
+			Ar << NumLODs;
+			for (int32 LODIndex = 0; LODIndex < NumLODs; ++LODIndex)
+			{
+				FMeshDescription* MeshDescription = StaticMesh->GetMeshDescription(LODIndex);
+				bool bHasMeshDescription = MeshDescription != nullptr;
+				Ar << bHasMeshDescription;
+				if (bHasMeshDescription)
+				{
+					Ar << *MeshDescription;
+				}
+			}
+
+			// HE sets up materials and simple collision from the cook too, and rebuilding from the mesh descriptions
+			// alone would lose them. Objects are written as paths.
+			FObjectAndNameAsStringProxyArchive ObjectAr(Ar, false);
+			TArray<FStaticMaterial> StaticMaterials = StaticMesh->GetStaticMaterials();
+			ObjectAr << StaticMaterials;
+			
+			UBodySetup* BodySetup = StaticMesh->GetBodySetup();
+			bool bHasBodySetup = BodySetup != nullptr;
+			ObjectAr << bHasBodySetup;
+			if (bHasBodySetup)
+			{
+				uint8 CollisionTraceFlag = static_cast<uint8>(BodySetup->CollisionTraceFlag.GetValue());
+				ObjectAr << CollisionTraceFlag;
+				FKAggregateGeom::StaticStruct()->SerializeItem(ObjectAr, &BodySetup->AggGeom, nullptr);
+			}
+			return !ObjectAr.IsError();
+		}
+		case ECookCacheSlotType::Instances:
+		{
+			UInstancedStaticMeshComponent* InstancedComponent = CastChecked<UInstancedStaticMeshComponent>(Slot.Object);
+			TArray<FTransform> InstanceTransforms;
+			InstanceTransforms.SetNum(InstancedComponent->GetInstanceCount());
+			for (int32 InstanceIndex = 0; InstanceIndex < InstanceTransforms.Num(); ++InstanceIndex)
+			{
+				InstancedComponent->GetInstanceTransform(InstanceIndex, InstanceTransforms[InstanceIndex], false);
+			}
+			Ar << InstanceTransforms;
+			return true;
+		}
+		case ECookCacheSlotType::Landscape:
+		{
+			ALandscapeProxy* LandscapeProxy = CastChecked<ALandscapeProxy>(Slot.Object);
+			ULandscapeInfo* LandscapeInfo = LandscapeProxy->GetLandscapeInfo();
+			FIntRect Extent = Slot.LandscapeRegion;
+			if (!LandscapeInfo)
+			{
+				return false;
+			}
+			Ar << Extent;
+
+			// Reads (and later writes) go through the landscape's current edit layer, which is the one HE just wrote to.
+			FLandscapeEditDataInterface LandscapeEdit(LandscapeInfo);
+			TArray<uint16> Heights;
+			Heights.SetNumZeroed(GetNumLandscapeSamples(Extent));
+			LandscapeEdit.GetHeightDataFast(Extent.Min.X, Extent.Min.Y, Extent.Max.X, Extent.Max.Y, Heights.GetData(), 0);
+			Ar << Heights;
+
+			TArray<ULandscapeLayerInfoObject*> LayerInfos;
+			for (const FLandscapeInfoLayerSettings& LayerSettings : LandscapeInfo->Layers)
+			{
+				if (LayerSettings.LayerInfoObj)
+				{
+					LayerInfos.Add(LayerSettings.LayerInfoObj);
+				}
+			}
+			
+			int32 NumLayers = LayerInfos.Num();
+			Ar << NumLayers;
+			for (ULandscapeLayerInfoObject* LayerInfo : LayerInfos)
+			{
+				FString LayerName = LayerInfo->LayerName.ToString();
+				TArray<uint8> Weights;
+				Weights.SetNumZeroed(GetNumLandscapeSamples(Extent));
+				LandscapeEdit.GetWeightDataFast(LayerInfo, Extent.Min.X, Extent.Min.Y, Extent.Max.X, Extent.Max.Y, Weights.GetData(), 0);
+				Ar << LayerName;
+				Ar << Weights;
+			}
+			return true;
+		}
+		default:
+			return true;
+		}
+	}
+
+	// Cached data for one slot, read and validated in full before anything is written to the outputs.
+	struct FStagedSlot
+	{
+		FCookCacheSlot Slot;
+		TArray<TOptional<FMeshDescription>> MeshDescriptions;
+		TArray<FStaticMaterial> StaticMaterials;
+		TOptional<TPair<ECollisionTraceFlag, FKAggregateGeom>> Collision;
+		TArray<FTransform> InstanceTransforms;
+		FIntRect LandscapeExtent;
+		TArray<uint16> Heights;
+		TArray<TPair<ULandscapeLayerInfoObject*, TArray<uint8>>> Weights;
+	};
+
+	bool StageSlot(FArchive& Ar, FStagedSlot& Staged)
+	{
+		switch (Staged.Slot.Type)
+		{
+		case ECookCacheSlotType::StaticMesh:
+		{
+			int32 NumLODs = 0;
+			Ar << NumLODs;
+			if (Ar.IsError() || NumLODs != CastChecked<UStaticMesh>(Staged.Slot.Object)->GetNumSourceModels())
+			{
+				return false;
+			}
+			
+			Staged.MeshDescriptions.SetNum(NumLODs);
+			for (TOptional<FMeshDescription>& MeshDescription : Staged.MeshDescriptions)
+			{
+				bool bHasMeshDescription = false;
+				Ar << bHasMeshDescription;
+				if (bHasMeshDescription)
+				{
+					Ar << MeshDescription.Emplace();
+				}
+			}
+
+			FObjectAndNameAsStringProxyArchive ObjectAr(Ar, true);
+			ObjectAr << Staged.StaticMaterials;
+			
+			bool bHasBodySetup = false;
+			ObjectAr << bHasBodySetup;
+			if (bHasBodySetup)
+			{
+				uint8 CollisionTraceFlag = 0;
+				ObjectAr << CollisionTraceFlag;
+				FKAggregateGeom AggGeom;
+				FKAggregateGeom::StaticStruct()->SerializeItem(ObjectAr, &AggGeom, nullptr);
+				Staged.Collision.Emplace(static_cast<ECollisionTraceFlag>(CollisionTraceFlag), MoveTemp(AggGeom));
+			}
+			return !ObjectAr.IsError();
+		}
+		case ECookCacheSlotType::Instances:
+		{
+			Ar << Staged.InstanceTransforms;
+			return !Ar.IsError();
+		}
+		case ECookCacheSlotType::Landscape:
+		{
+			ALandscapeProxy* LandscapeProxy = CastChecked<ALandscapeProxy>(Staged.Slot.Object);
+			ULandscapeInfo* LandscapeInfo = LandscapeProxy->GetLandscapeInfo();
+			Ar << Staged.LandscapeExtent;
+			if (Ar.IsError() || !LandscapeInfo || Staged.LandscapeExtent != Staged.Slot.LandscapeRegion)
+			{
+				// The HDA now writes somewhere else (e.g. it was moved).
+				return false;
+			}
+
+			const int32 NumSamples = GetNumLandscapeSamples(Staged.LandscapeExtent);
+			Ar << Staged.Heights;
+			if (Ar.IsError() || Staged.Heights.Num() != NumSamples)
+			{
+				return false;
+			}
+
+			int32 NumLayers = 0;
+			Ar << NumLayers;
+			for (int32 LayerIndex = 0; LayerIndex < NumLayers && !Ar.IsError(); ++LayerIndex)
+			{
+				FString LayerName;
+				TArray<uint8> Weights;
+				Ar << LayerName;
+				Ar << Weights;
+
+				ULandscapeLayerInfoObject* LayerInfo = LandscapeInfo->GetLayerInfoByName(FName(LayerName));
+				if (!LayerInfo || Weights.Num() != NumSamples)
+				{
+					return false;
+				}
+				Staged.Weights.Emplace(LayerInfo, MoveTemp(Weights));
+			}
+			return !Ar.IsError();
+		}
+		default:
+			return true;
+		}
+	}
+
+	void ApplySlot(FStagedSlot& Staged)
+	{
+		switch (Staged.Slot.Type)
+		{
+		case ECookCacheSlotType::StaticMesh:
+		{
+			UStaticMesh* StaticMesh = CastChecked<UStaticMesh>(Staged.Slot.Object);
+			for (int32 LODIndex = 0; LODIndex < Staged.MeshDescriptions.Num(); ++LODIndex)
+			{
+				if (Staged.MeshDescriptions[LODIndex].IsSet())
+				{
+					StaticMesh->CreateMeshDescription(LODIndex, MoveTemp(Staged.MeshDescriptions[LODIndex].GetValue()));
+					StaticMesh->CommitMeshDescription(LODIndex);
+				}
+			}
+			if (!Staged.StaticMaterials.IsEmpty())
+			{
+				StaticMesh->SetStaticMaterials(Staged.StaticMaterials);
+			}
+			if (Staged.Collision.IsSet())
+			{
+				if (!StaticMesh->GetBodySetup())
+				{
+					StaticMesh->CreateBodySetup();
+				}
+				UBodySetup* BodySetup = StaticMesh->GetBodySetup();
+				BodySetup->Modify();
+				BodySetup->CollisionTraceFlag = Staged.Collision->Key;
+				BodySetup->AggGeom = Staged.Collision->Value;
+				BodySetup->InvalidatePhysicsData();
+				BodySetup->CreatePhysicsMeshes();
+			}
+			StaticMesh->Build(true);
+			StaticMesh->PostEditChange();
+			StaticMesh->MarkPackageDirty();
+			break;
+		}
+		case ECookCacheSlotType::Instances:
+		{
+			UInstancedStaticMeshComponent* InstancedComponent = CastChecked<UInstancedStaticMeshComponent>(Staged.Slot.Object);
+			InstancedComponent->ClearInstances();
+			InstancedComponent->AddInstances(Staged.InstanceTransforms, false, false);
+			break;
+		}
+		case ECookCacheSlotType::Landscape:
+		{
+			ALandscapeProxy* LandscapeProxy = CastChecked<ALandscapeProxy>(Staged.Slot.Object);
+			const FIntRect& Extent = Staged.LandscapeExtent;
+			{
+				FLandscapeEditDataInterface LandscapeEdit(LandscapeProxy->GetLandscapeInfo());
+				LandscapeEdit.SetHeightData(Extent.Min.X, Extent.Min.Y, Extent.Max.X, Extent.Max.Y, Staged.Heights.GetData(), 0, true);
+				for (const TPair<ULandscapeLayerInfoObject*, TArray<uint8>>& LayerWeights : Staged.Weights)
+				{
+					// Written as is: the cached weights were already normalized by the cook that produced them.
+					LandscapeEdit.SetAlphaData(LayerWeights.Key, Extent.Min.X, Extent.Min.Y, Extent.Max.X, Extent.Max.Y, LayerWeights.Value.GetData(), 0, ELandscapeLayerPaintingRestriction::None, false, false);
+				}
+				LandscapeEdit.Flush();
+			}
+			
+			if (ALandscape* Landscape = LandscapeProxy->GetLandscapeActor())
+			{
+				Landscape->RequestLayersContentUpdateForceAll();
+			}
+			LandscapeProxy->MarkPackageDirty();
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	// Serializes every output of AssetComponent. Returns false if some of them can't be cached.
+	bool SerializeOutputs(const FString& Key, UHoudiniAssetComponent* AssetComponent, TArray<uint8>& OutBytes)
+	{
+		TArray<FCookCacheSlot> Slots;
+		if (!GatherSlots(AssetComponent, Slots))
+		{
+			return false;
+		}
+
+		FMemoryWriter Writer(OutBytes);
+		uint32 Magic = CookCacheMagic;
+		uint32 Version = CookCacheVersion;
+		FString EngineVersion = GetEngineVersionString();
+		FString EntryKey = Key;
+		int32 NumSlots = Slots.Num();
+		Writer << Magic << Version << EngineVersion << EntryKey << NumSlots;
+
+		for (const FCookCacheSlot& Slot : Slots)
+		{
+			TArray<uint8> Payload;
+			FMemoryWriter PayloadWriter(Payload);
+			if (!SaveSlot(PayloadWriter, Slot))
+			{
+				return false;
+			}
+
+			FString Signature = Slot.Signature;
+			uint8 Type = static_cast<uint8>(Slot.Type);
+			Writer << Signature << Type << Payload;
+		}
+		return true;
+	}
+
+	// Writes serialized outputs into the outputs of AssetComponent. Returns false (and leaves the outputs untouched) if
+	// they don't have the same layout.
+	bool RestoreOutputs(const FString& Key, const TArray<uint8>& Bytes, UHoudiniAssetComponent* AssetComponent)
+	{
+		TArray<FCookCacheSlot> Slots;
+		if (!GatherSlots(AssetComponent, Slots))
+		{
+			return false;
+		}
+		
+		FMemoryReader Reader(Bytes);
+		uint32 Magic = 0;
+		uint32 Version = 0;
+		FString EngineVersion;
+		FString EntryKey;
+		int32 NumSlots = 0;
+		Reader << Magic << Version << EngineVersion << EntryKey << NumSlots;
+		
+		bool bFits = !Reader.IsError() && Magic == CookCacheMagic && Version == CookCacheVersion && EngineVersion == GetEngineVersionString() && EntryKey == Key && NumSlots == Slots.Num();
+
+		TArray<FStagedSlot> StagedSlots;
+		StagedSlots.SetNum(bFits ? NumSlots : 0);
+		for (int32 SlotIndex = 0; SlotIndex < StagedSlots.Num() && bFits; ++SlotIndex)
+		{
+			FString Signature;
+			uint8 Type = 0;
+			TArray<uint8> Payload;
+			Reader << Signature << Type << Payload;
+			
+			FStagedSlot& Staged = StagedSlots[SlotIndex];
+			Staged.Slot = Slots[SlotIndex];
+			bFits = !Reader.IsError() && Signature == Staged.Slot.Signature && Type == static_cast<uint8>(Staged.Slot.Type);
+			if (bFits)
+			{
+				FMemoryReader PayloadReader(Payload);
+				bFits = StageSlot(PayloadReader, Staged);
+			}
+		}
+
+		if (!bFits)
+		{
+			return false;
+		}
+
+		for (FStagedSlot& Staged : StagedSlots)
+		{
+			ApplySlot(Staged);
+		}
+		AssetComponent->MarkPackageDirty();
+		return true;
+	}
+#endif
+}
+
+FHoudiniCookCache& FHoudiniCookCache::Get()
+{
+	static FHoudiniCookCache CookCache;
+	return CookCache;
+}
+
+bool FHoudiniCookCache::IsEnabled() const
+{
+	// Restoring outputs relies on editor-only data (mesh descriptions, landscape edit data).
+	return WITH_EDITOR && CVarHoudiniCookCacheEnable.GetValueOnGameThread();
+}
+
+bool FHoudiniCookCache::Restore(const FString& Fingerprint, UHoudiniAssetComponent* AssetComponent)
+{
+#if WITH_EDITOR
+	if (!IsEnabled() || Fingerprint.IsEmpty() || !AssetComponent)
+	{
+		return false;
+	}
+
+	TArray<uint8> Bytes;
+	if (!ReadEntry(Fingerprint, Bytes))
+	{
+		NumMisses++;
+		return false;
+	}
+
+	if (!RestoreOutputs(Fingerprint, Bytes, AssetComponent))
+	{
+		UE_LOG(LogEHERuntime, Verbose, TEXT("FHoudiniCookCache: the entry for %s doesn't fit the current outputs of %s."), *Fingerprint, *GetNameSafe(AssetComponent->GetOwner()));
+		NumMisses++;
+		return false;
+	}
+
+	UE_LOG(LogEHERuntime, Verbose, TEXT("FHoudiniCookCache: restored %s from %s."), *GetNameSafe(AssetComponent->GetOwner()), *Fingerprint);
+	NumHits++;
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool FHoudiniCookCache::Store(const FString& Fingerprint, UHoudiniAssetComponent* AssetComponent)
+{
+#if WITH_EDITOR
+	if (!IsEnabled() || Fingerprint.IsEmpty() || !AssetComponent)
+	{
+		return false;
+	}
+
+	TArray<uint8> Bytes;
+	if (!SerializeOutputs(Fingerprint, AssetComponent, Bytes))
+	{
+		UE_LOG(LogEHERuntime, Verbose, TEXT("FHoudiniCookCache: %s has outputs that can't be cached."), *GetNameSafe(AssetComponent->GetOwner()));
+		NumUncacheable++;
+		return false;
+	}
+
+	bool bStored = WriteEntry(GetLocalDirectory(), MegabytesToBytes(CVarHoudiniCookCacheMaxLocalSizeMB.GetValueOnGameThread()), Fingerprint, Bytes);
+	
+	const FString SharedDirectory = GetSharedDirectory();
+	if (!SharedDirectory.IsEmpty())
+	{
+		bStored |= WriteEntry(SharedDirectory, MegabytesToBytes(CVarHoudiniCookCacheMaxSharedSizeMB.GetValueOnGameThread()), Fingerprint, Bytes);
+	}
+
+	NumStores += bStored ? 1 : 0;
+	return bStored;
+#else
+	return false;
+#endif
+}
+
+bool FHoudiniCookCache::CopyOutputs(UHoudiniAssetComponent* From, UHoudiniAssetComponent* To)
+{
+#if WITH_EDITOR
+	if (!From || !To || From == To)
+	{
+		return false;
+	}
+
+	TArray<uint8> Bytes;
+	const FString Key = TEXT("Copy");
+	return SerializeOutputs(Key, From, Bytes) && RestoreOutputs(Key, Bytes, To);
+#else
+	return false;
+#endif
+}
+
+bool FHoudiniCookCache::CopyStaticMesh(UStaticMesh* From, UHoudiniAssetComponent* To)
+{
+#if WITH_EDITOR
+	if (!From || !To)
+	{
+		return false;
+	}
+
+	TArray<FCookCacheSlot> Slots;
+	if (!GatherSlots(To, Slots))
+	{
+		return false;
+	}
+
+	FStagedSlot Staged;
+	int32 NumStaticMeshes = 0;
+	for (const FCookCacheSlot& Slot : Slots)
+	{
+		if (Slot.Type == ECookCacheSlotType::StaticMesh)
+		{
+			Staged.Slot = Slot;
+			NumStaticMeshes++;
+		}
+		else if (Slot.Type != ECookCacheSlotType::Structural)
+		{
+			return false;
+		}
+	}
+	
+	UStaticMesh* StaticMesh = NumStaticMeshes == 1 ? CastChecked<UStaticMesh>(Staged.Slot.Object) : nullptr;
+	if (!StaticMesh || StaticMesh == From || StaticMesh->GetNumSourceModels() != From->GetNumSourceModels())
+	{
+		return false;
+	}
+
+	Staged.MeshDescriptions.SetNum(From->GetNumSourceModels());
+	for (int32 LODIndex = 0; LODIndex < Staged.MeshDescriptions.Num(); ++LODIndex)
+	{
+		if (const FMeshDescription* MeshDescription = From->GetMeshDescription(LODIndex))
+		{
+			Staged.MeshDescriptions[LODIndex].Emplace(*MeshDescription);
+		}
+	}
+
+	// The mesh descriptions refer to material slots by name, so the slots have to come along.
+	Staged.StaticMaterials = From->GetStaticMaterials();
+	if (UBodySetup* BodySetup = From->GetBodySetup())
+	{
+		Staged.Collision.Emplace(BodySetup->CollisionTraceFlag.GetValue(), BodySetup->AggGeom);
+	}
+	ApplySlot(Staged);
+	To->MarkPackageDirty();
+	return true;
+#else
+	return false;
+#endif
+}
+
+void FHoudiniCookCache::Trim()
+{
+	TrimDirectory(GetLocalDirectory(), MegabytesToBytes(CVarHoudiniCookCacheMaxLocalSizeMB.GetValueOnGameThread()));
+	
+	const FString SharedDirectory = GetSharedDirectory();
+	if (!SharedDirectory.IsEmpty())
+	{
+		TrimDirectory(SharedDirectory, MegabytesToBytes(CVarHoudiniCookCacheMaxSharedSizeMB.GetValueOnGameThread()));
+	}
+}
+
+FString FHoudiniCookCache::GetStatusString() const
+{
+	return FString::Printf(TEXT("Cook cache %s: %d hits, %d misses, %d stored, %d uncacheable. Local: %s Shared: %s"),
+		IsEnabled() ? TEXT("enabled") : TEXT("disabled"), NumHits, NumMisses, NumStores, NumUncacheable,
+		*GetLocalDirectory(), GetSharedDirectory().IsEmpty() ? TEXT("none") : *GetSharedDirectory());
+}
+
+FString FHoudiniCookCache::GetLocalDirectory() const
+{
+	const FString LocalPath = CVarHoudiniCookCacheLocalPath.GetValueOnGameThread();
+	return LocalPath.IsEmpty() ? FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() / TEXT("HoudiniCookCache")) : FPaths::ConvertRelativePathToFull(LocalPath);
+}
+
+FString FHoudiniCookCache::GetSharedDirectory() const
+{
+	const FString SharedPath = CVarHoudiniCookCacheSharedPath.GetValueOnGameThread();
+	return SharedPath.IsEmpty() ? FString() : FPaths::ConvertRelativePathToFull(SharedPath);
+}
+
+bool FHoudiniCookCache::ReadEntry(const FString& Fingerprint, TArray<uint8>& OutBytes)
+{
+	// Touching an entry on every hit is what makes eviction least recently used rather than least recently written.
+	const FString LocalEntryPath = GetEntryPath(GetLocalDirectory(), Fingerprint);
+	if (FFileHelper::LoadFileToArray(OutBytes, *LocalEntryPath, FILEREAD_Silent))
+	{
+		IFileManager::Get().SetTimeStamp(*LocalEntryPath, FDateTime::UtcNow());
+		return true;
+	}
+
+	const FString SharedDirectory = GetSharedDirectory();
+	if (SharedDirectory.IsEmpty())
+	{
+		return false;
+	}
+	
+	const FString SharedEntryPath = GetEntryPath(SharedDirectory, Fingerprint);
+	if (!FFileHelper::LoadFileToArray(OutBytes, *SharedEntryPath, FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	IFileManager::Get().SetTimeStamp(*SharedEntryPath, FDateTime::UtcNow());
+	WriteEntry(GetLocalDirectory(), MegabytesToBytes(CVarHoudiniCookCacheMaxLocalSizeMB.GetValueOnGameThread()), Fingerprint, OutBytes);
+	return true;
+}
+
+bool FHoudiniCookCache::WriteEntry(const FString& Directory, int64 MaxBytes, const FString& Fingerprint, const TArray<uint8>& Bytes)
+{
+	const FString EntryPath = GetEntryPath(Directory, Fingerprint);
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(EntryPath), true);
+
+	// Written under a unique name and moved into place, so other machines never read a partially written entry.
+	const FString TempPath = FString::Printf(TEXT("%s.%s.tmp"), *EntryPath, *FGuid::NewGuid().ToString());
+	if (!FFileHelper::SaveArrayToFile(Bytes, *TempPath))
+	{
+		UE_LOG(LogEHERuntime, Warning, TEXT("warning: FHoudiniCookCache failed to write %s"), *TempPath);
+		return false;
+	}
+	if (!IFileManager::Get().Move(*EntryPath, *TempPath, true, true))
+	{
+		UE_LOG(LogEHERuntime, Warning, TEXT("warning: FHoudiniCookCache failed to move %s into place"), *TempPath);
+		IFileManager::Get().Delete(*TempPath, false, false, true);
+		return false;
+	}
+
+	TrimIfNeeded(Directory, MaxBytes, Bytes.Num());
+	return true;
+}
+
+void FHoudiniCookCache::TrimIfNeeded(const FString& Directory, int64 MaxBytes, int64 BytesWritten)
+{
+	if (MaxBytes <= 0)
+	{
+		return;
+	}
+
+	// The first write of a session always trims, since the directory may have grown while we weren't looking.
+	int64* WrittenSinceTrim = BytesWrittenSinceTrim.Find(Directory);
+	if (WrittenSinceTrim)
+	{
+		*WrittenSinceTrim += BytesWritten;
+		if (*WrittenSinceTrim < MaxBytes / 20)
+		{
+			return;
+		}
+	}
+
+	BytesWrittenSinceTrim.Add(Directory, 0);
+	TrimDirectory(Directory, MaxBytes);
+}
+
+void FHoudiniCookCache::TrimDirectory(const FString& Directory, int64 MaxBytes)
+{
+	struct FEntryFile
+	{
+		FString Path;
+		int64 Size = 0;
+		FDateTime TimeStamp;
+	};
+	
+	TArray<FEntryFile> EntryFiles;
+	TArray<FString> StaleTempFiles;
+	int64 TotalBytes = 0;
+	
+	// Temp files older than this were left behind by a writer that didn't finish.
+	const FDateTime StaleTempTime = FDateTime::UtcNow() - FTimespan::FromHours(1.0);
+	
+	IFileManager::Get().IterateDirectoryStatRecursively(*Directory, [&](const TCHAR* Filename, const FFileStatData& StatData)
+	{
+		if (StatData.bIsDirectory)
+		{
+			return true;
+		}
+
+		const FString Path(Filename);
+		if (Path.EndsWith(CookCacheExtension))
+		{
+			EntryFiles.Add(FEntryFile{Path, StatData.FileSize, StatData.ModificationTime});
+			TotalBytes += StatData.FileSize;
+		}
+		else if (Path.EndsWith(TEXT(".tmp")) && StatData.ModificationTime < StaleTempTime)
+		{
+			StaleTempFiles.Add(Path);
+		}
+		return true;
+	});
+
+	for (const FString& StaleTempFile : StaleTempFiles)
+	{
+		IFileManager::Get().Delete(*StaleTempFile, false, false, true);
+	}
+
+	if (MaxBytes <= 0 || TotalBytes <= MaxBytes)
+	{
+		return;
+	}
+
+	EntryFiles.Sort([](const FEntryFile& A, const FEntryFile& B)
+	{
+		return A.TimeStamp < B.TimeStamp;
+	});
+
+	// Trimmed a bit below the limit, so the next few writes don't need another pass.
+	const int64 TargetBytes = MaxBytes - MaxBytes / 10;
+	int32 NumEvicted = 0;
+	for (const FEntryFile& EntryFile : EntryFiles)
+	{
+		if (TotalBytes <= TargetBytes)
+		{
+			break;
+		}
+		
+		if (IFileManager::Get().Delete(*EntryFile.Path, false, false, true))
+		{
+			TotalBytes -= EntryFile.Size;
+			NumEvicted++;
+		}
+	}
+
+	UE_LOG(LogEHERuntime, Log, TEXT("FHoudiniCookCache: evicted %d entries from %s, %lld MB left."), NumEvicted, *Directory, TotalBytes / (1024 * 1024));
+}
+
+// CONSOLE COMMANDS ----------------------------------------------------------------------------------------------------
+FAutoConsoleCommandWithWorldAndArgs GHoudiniCookCacheStatusCmd(
+	TEXT("houdini.CookCache.Status"),
+	TEXT("Prints the cook cache configuration and hit rate."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(
+		[](const TArray<FString>& Args, UWorld* World)
+		{
+			UE_LOG(LogEHERuntime, Display, TEXT("%s"), *FHoudiniCookCache::Get().GetStatusString());
+		}
+	)
+);
+
+FAutoConsoleCommandWithWorldAndArgs GHoudiniCookCacheTrimCmd(
+	TEXT("houdini.CookCache.Trim"),
+	TEXT("Evicts least recently used cook cache entries until the local and shared caches are within their size limits."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(
+		[](const TArray<FString>& Args, UWorld* World)
+		{
+			FHoudiniCookCache::Get().Trim();
+		}
+	)
+);
+
+// END CONSOLE COMMANDS ------------------------------------------------------------------------------------------------
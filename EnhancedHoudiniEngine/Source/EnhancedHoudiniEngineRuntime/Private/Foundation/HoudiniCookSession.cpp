@@ -0,0 +1,163 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/HoudiniCookSession.h"
+
+#include "EHERuntimeLoggingDefs.h"
+#include "HoudiniAssetActor.h"
+#include "Foundation/HoudiniBuildSequenceNode.h"
+
+static TAutoConsoleVariable<float> CVarHoudiniStandInCookSec(
+	TEXT("houdini.CookSessions.StandInCookSec"),
+	0.5f,
+	TEXT("How long a stand-in cook session takes to \"cook\" a work item.")
+);
+
+static TAutoConsoleVariable<float> CVarHoudiniStandInFailureRate(
+	TEXT("houdini.CookSessions.StandInFailureRate"),
+	0.0f,
+	TEXT("Fraction (0-1) of work items a stand-in cook session fails instead of finishing.")
+);
+
+static TAutoConsoleVariable<int32> CVarHoudiniStandInCapacity(
+	TEXT("houdini.CookSessions.StandInCapacity"),
+	1,
+	TEXT("Maximum number of work items each stand-in cook session cooks at the same time. 0 means no limit.")
+);
+
+void FHoudiniEngineCookSession::Start(UHoudiniBuildWorkItem* WorkItem)
+{
+	if (WorkItem)
+	{
+		WorkItem->Build();
+	}
+}
+
+TSharedRef<IHoudiniCookSession> FHoudiniEngineCookSession::Create()
+{
+	TFunction<TSharedRef<FHoudiniEngineCookSession>()>& Factory = GetFactory();
+	if (Factory)
+	{
+		return Factory();
+	}
+	return MakeShared<FHoudiniEngineCookSession>();
+}
+
+void FHoudiniEngineCookSession::SetFactory(TFunction<TSharedRef<FHoudiniEngineCookSession>()> InFactory)
+{
+	GetFactory() = MoveTemp(InFactory);
+}
+
+TFunction<TSharedRef<FHoudiniEngineCookSession>()>& FHoudiniEngineCookSession::GetFactory()
+{
+	static TFunction<TSharedRef<FHoudiniEngineCookSession>()> Factory;
+	return Factory;
+}
+
+FHoudiniStandInCookSession::FHoudiniStandInCookSession(int32 InSessionIndex)
+	: SessionIndex(InSessionIndex)
+{
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FHoudiniStandInCookSession::Tick));
+}
+
+FHoudiniStandInCookSession::~FHoudiniStandInCookSession()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+}
+
+int32 FHoudiniStandInCookSession::GetCapacity() const
+{
+	return FMath::Max(CVarHoudiniStandInCapacity.GetValueOnGameThread(), 0);
+}
+
+void FHoudiniStandInCookSession::Start(UHoudiniBuildWorkItem* WorkItem)
+{
+	if (!WorkItem)
+	{
+		return;
+	}
+
+	WorkItem->BeginExternalBuild(true);
+	Cooking.Add(FStandInCook{WorkItem, WorkItem->GetBuildSerial(), FPlatformTime::Seconds() + CVarHoudiniStandInCookSec.GetValueOnGameThread()});
+}
+
+bool FHoudiniStandInCookSession::Restart(TConstArrayView<UHoudiniBuildWorkItem*> Interrupted)
+{
+	// Whatever was cooking died with the session.
+	bKilled = false;
+	Cooking.Empty();
+	return true;
+}
+
+bool FHoudiniStandInCookSession::Kill()
+{
+	UE_LOG(LogEHERuntime, Log, TEXT("FHoudiniStandInCookSession: killed %s with %d work items cooking."), *GetName(), Cooking.Num());
+	bKilled = true;
+	return true;
+}
+
+bool FHoudiniStandInCookSession::Tick(float DeltaTime)
+{
+	if (bKilled)
+	{
+		// Hung: nothing finishes until the session is restarted.
+		return true;
+	}
+	
+	const double TimeNow = FPlatformTime::Seconds();
+	const float FailureRate = CVarHoudiniStandInFailureRate.GetValueOnGameThread();
+	
+	// Finishing a work item can start the next one synchronously, which adds to Cooking, so collect first.
+	TArray<FStandInCook> Finished;
+	for (int32 CookIndex = Cooking.Num() - 1; CookIndex >= 0; --CookIndex)
+	{
+		if (Cooking[CookIndex].FinishTime <= TimeNow)
+		{
+			Finished.Add(Cooking[CookIndex]);
+			Cooking.RemoveAt(CookIndex);
+		}
+	}
+
+	for (const FStandInCook& Cook : Finished)
+	{
+		UHoudiniBuildWorkItem* WorkItem = Cook.WorkItem.Get();
+		if (!WorkItem || WorkItem->GetBuildSerial() != Cook.BuildSerial)
+		{
+			continue;
+		}
+		
+		const bool bSucceeded = FMath::FRand() >= FailureRate;
+		UE_LOG(LogEHERuntime, Verbose, TEXT("FHoudiniStandInCookSession: %s %s %s."), *GetName(), bSucceeded ? TEXT("finished") : TEXT("failed"), *GetNameSafe(WorkItem->GetAssetActor().Get()));
+		WorkItem->CompleteExternalBuild(bSucceeded);
+	}
+
+	return true;
+}
@@ -0,0 +1,177 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "HoudiniAssetActor.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Foundation/HoudiniAssetActorIndex.h"
+#include "Foundation/HoudiniBuildManager.h"
+#include "Foundation/HoudiniBuildSequenceNode.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/HoudiniScopedCookSessionSettings.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	// An editor world with a build manager running two HDA nodes, Rocks then Trees, split into two shards. All the
+	// rocks are in the second shard, so the first shard has nothing to build for Rocks but still has to build Trees
+	// after it. Work items are built by a stand-in cook session.
+	struct FShardedBuildFixture
+	{
+		FShardedBuildFixture()
+		{
+			Settings.Set(TEXT("houdini.CookSessions.Backend"), TEXT("StandIn"));
+			Settings.Set(TEXT("houdini.CookSessions.Count"), TEXT("1"));
+			Settings.Set(TEXT("houdini.CookSessions.StandInFailureRate"), TEXT("0"));
+			Settings.Set(TEXT("houdini.CookSessions.StandInCookSec"), TEXT("0.05"));
+			Settings.Set(TEXT("houdini.BuildManager.Journal"), TEXT("0"));
+
+			World = UWorld::CreateWorld(EWorldType::Editor, false);
+			GEngine->CreateNewWorldContext(EWorldType::Editor).SetCurrentWorld(World);
+
+			BuildManager = World->SpawnActor<AHoudiniBuildManager>();
+			BuildManager->bDiscoverInputDependencies = false;
+
+			UHoudiniBuildSequenceGraph* SequenceGraph = NewObject<UHoudiniBuildSequenceGraph>(BuildManager);
+			Rocks = AddNode(SequenceGraph, TEXT("Rock"));
+			Trees = AddNode(SequenceGraph, TEXT("Tree"));
+			Rocks->ChildNodes.Add(Trees);
+			Trees->ParentNodes.Add(Rocks);
+			SequenceGraph->RootNodes.Add(Rocks);
+			SequenceGraph->InvalidatePlan();
+			BuildManager->SequenceGraph = SequenceGraph;
+
+			for (int32 ShardIndex = 0; ShardIndex < 2; ++ShardIndex)
+			{
+				Shards[ShardIndex].Index = ShardIndex;
+				Shards[ShardIndex].Count = 2;
+			}
+			Shards[0].Actors.Add(FSoftObjectPath(SpawnActor(TEXT("Tree"))));
+			Shards[0].Actors.Add(FSoftObjectPath(SpawnActor(TEXT("Tree"))));
+			Shards[1].Actors.Add(FSoftObjectPath(SpawnActor(TEXT("Rock"))));
+			Shards[1].Actors.Add(FSoftObjectPath(SpawnActor(TEXT("Rock"))));
+			Shards[1].Actors.Add(FSoftObjectPath(SpawnActor(TEXT("Tree"))));
+
+			// The actors were tagged after they were spawned, which the index doesn't hear about.
+			if (UHoudiniAssetActorIndex* ActorIndex = UHoudiniAssetActorIndex::Get(World))
+			{
+				ActorIndex->Invalidate();
+			}
+		}
+
+		~FShardedBuildFixture()
+		{
+			GEngine->DestroyWorldContext(World);
+			World->DestroyWorld(false);
+		}
+
+		UHoudiniBuildSequenceNode* AddNode(UHoudiniBuildSequenceGraph* SequenceGraph, FName ActorTag)
+		{
+			UHoudiniBuildSequenceNode* Node = NewObject<UHoudiniBuildSequenceNode>(SequenceGraph);
+			Node->Title = FText::FromName(ActorTag);
+			Node->BuildInfo.ActorTags.Add(ActorTag);
+			return Node;
+		}
+
+		AHoudiniAssetActor* SpawnActor(FName ActorTag)
+		{
+			AHoudiniAssetActor* AssetActor = World->SpawnActor<AHoudiniAssetActor>();
+			AssetActor->Tags.Add(ActorTag);
+			return AssetActor;
+		}
+
+		bool RunShard(int32 ShardIndex)
+		{
+			BuildManager->SetShard(Shards[ShardIndex]);
+			TimeStarted = FPlatformTime::Seconds();
+			return BuildManager->Run();
+		}
+
+		FScopedCookSessionSettings Settings;
+		UWorld* World = nullptr;
+		AHoudiniBuildManager* BuildManager = nullptr;
+		UHoudiniBuildSequenceNode* Rocks = nullptr;
+		UHoudiniBuildSequenceNode* Trees = nullptr;
+		FHoudiniBuildShard Shards[2];
+		int32 NumShardsRun = 0;
+		double TimeStarted = 0.0;
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHoudiniBuildShardEmptyNodeTest, "EnhancedHoudiniEngine.BuildShard.NodeWithoutActorsInShard", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FHoudiniBuildShardEmptyNodeTest::RunTest(const FString& Parameters)
+{
+	TSharedRef<FShardedBuildFixture> Fixture = MakeShared<FShardedBuildFixture>();
+	if (!TestTrue(TEXT("Started the first shard"), Fixture->RunShard(0)))
+	{
+		return false;
+	}
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Fixture]()
+	{
+		if (Fixture->BuildManager->IsRunning())
+		{
+			if (FPlatformTime::Seconds() - Fixture->TimeStarted > 10.0)
+			{
+				AddError(FString::Printf(TEXT("Timed out waiting for shard %d."), Fixture->NumShardsRun));
+				return true;
+			}
+			return false;
+		}
+
+		// A node with no actors in the shard is finished as up to date, which lets the nodes after it run.
+		const int32 ShardIndex = Fixture->NumShardsRun;
+		const int32 NumRocks[] = {0, 2};
+		const int32 NumTrees[] = {2, 1};
+		for (UHoudiniBuildSequenceNode* Node : {Fixture->Rocks, Fixture->Trees})
+		{
+			const int32 NumWorkItems = (Node == Fixture->Rocks ? NumRocks : NumTrees)[ShardIndex];
+			const FString What = FString::Printf(TEXT("Shard %d, %s"), ShardIndex, *Node->Title.ToString());
+			
+			TestEqual(What + TEXT(": work items"), Node->GetWorkItems().Num(), NumWorkItems);
+			TestEqual(What + TEXT(": state"), Node->GetState(), EAutomationGraphNodeState::Finished);
+			TestEqual(What + TEXT(": up to date"), Node->WasFinishedUpToDate(), NumWorkItems == 0);
+		}
+		TestFalse(FString::Printf(TEXT("Shard %d failed"), ShardIndex), Fixture->BuildManager->HasRunFailed());
+
+		if (++Fixture->NumShardsRun < 2)
+		{
+			// Latent commands only finish once this returns true, so the second shard is waited on by the next call.
+			return !TestTrue(TEXT("Started the second shard"), Fixture->RunShard(1));
+		}
+		return true;
+	}));
+	return true;
+}
+
+#endif
@@ -0,0 +1,181 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "HoudiniAssetActor.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Foundation/HoudiniBuildSequenceNode.h"
+#include "Foundation/HoudiniCookArbiter.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/HoudiniScopedCookSessionSettings.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	// A world with one HDA actor, and a node with a work item for it that is built by a single stand-in cook session.
+	struct FStandInCookFixture
+	{
+		explicit FStandInCookFixture(int32 MaxRestarts)
+		{
+			Settings.Set(TEXT("houdini.CookSessions.Backend"), TEXT("StandIn"));
+			Settings.Set(TEXT("houdini.CookSessions.Count"), TEXT("1"));
+			Settings.Set(TEXT("houdini.CookSessions.StandInFailureRate"), TEXT("0"));
+			Settings.Set(TEXT("houdini.CookSessions.HeartbeatSec"), TEXT("0.05"));
+			Settings.Set(TEXT("houdini.CookSessions.MaxMissedHeartbeats"), TEXT("1"));
+			Settings.Set(TEXT("houdini.CookSessions.MaxRestarts"), *FString::FromInt(MaxRestarts));
+
+			// Long enough that the first cook is still going when the session is killed.
+			Settings.Set(TEXT("houdini.CookSessions.StandInCookSec"), TEXT("60"));
+
+			World = UWorld::CreateWorld(EWorldType::Game, false);
+			GEngine->CreateNewWorldContext(EWorldType::Game).SetCurrentWorld(World);
+
+			AHoudiniAssetActor* AssetActor = World->SpawnActor<AHoudiniAssetActor>();
+			Node = NewObject<UHoudiniBuildSequenceNode>(World);
+			Node->AddToRoot();
+			if (Node->Add(AssetActor))
+			{
+				WorkItem = Node->GetWorkItems()[0];
+			}
+			Arbiter = UHoudiniCookArbiter::Get(World);
+		}
+
+		~FStandInCookFixture()
+		{
+			Node->RemoveFromRoot();
+			GEngine->DestroyWorldContext(World);
+			World->DestroyWorld(false);
+		}
+
+		// Starts the node the way the build manager starts a root node. The node submits its work item to the arbiter,
+		// which only builds work items of active nodes.
+		bool Start()
+		{
+			Node->Ready();
+			Node->NotifyParentNodesFinished();
+			return Node->Activate();
+		}
+
+		FScopedCookSessionSettings Settings;
+		UWorld* World = nullptr;
+		UHoudiniBuildSequenceNode* Node = nullptr;
+		UHoudiniBuildWorkItem* WorkItem = nullptr;
+		UHoudiniCookArbiter* Arbiter = nullptr;
+		double TimeStarted = FPlatformTime::Seconds();
+	};
+
+	// Keeps ticking until Predicate is true or the test has been waiting for too long.
+	bool WaitFor(FAutomationTestBase* Test, const FStandInCookFixture& Fixture, const TCHAR* What, TFunctionRef<bool()> Predicate)
+	{
+		if (Predicate())
+		{
+			return true;
+		}
+		if (FPlatformTime::Seconds() - Fixture.TimeStarted > 10.0)
+		{
+			Test->AddError(FString::Printf(TEXT("Timed out waiting for %s."), What));
+			return true;
+		}
+		return false;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHoudiniCookArbiterResubmitTest, "EnhancedHoudiniEngine.CookArbiter.ResubmitsAfterSessionDies", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FHoudiniCookArbiterResubmitTest::RunTest(const FString& Parameters)
+{
+	TSharedRef<FStandInCookFixture> Fixture = MakeShared<FStandInCookFixture>(1);
+	if (!TestNotNull(TEXT("Cook arbiter"), Fixture->Arbiter) || !TestNotNull(TEXT("Work item"), Fixture->WorkItem))
+	{
+		return false;
+	}
+
+	TestTrue(TEXT("Started"), Fixture->Start());
+	TestEqual(TEXT("Node active"), Fixture->Node->GetState(), EAutomationGraphNodeState::Active);
+	TestEqual(TEXT("Building before the session dies"), Fixture->WorkItem->GetBuildState(), EEHEBuildState::Building);
+	const int32 FirstBuildSerial = Fixture->WorkItem->GetBuildSerial();
+
+	TestTrue(TEXT("Killed the session"), Fixture->Arbiter->KillSession(0));
+	IConsoleManager::Get().FindConsoleVariable(TEXT("houdini.CookSessions.StandInCookSec"))->Set(TEXT("0.05"), ECVF_SetByCode);
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Fixture, FirstBuildSerial]()
+	{
+		if (!WaitFor(this, *Fixture, TEXT("the work item to be built again"), [&Fixture]() { return Fixture->WorkItem->GetBuildState() == EEHEBuildState::Finished; }))
+		{
+			return false;
+		}
+
+		const FHoudiniCookArbiterProgress Progress = Fixture->Arbiter->GetProgress();
+		TestEqual(TEXT("Session restarts"), Progress.NumSessionRestarts, 1);
+		TestEqual(TEXT("Resubmitted work items"), Progress.NumResubmitted, 1);
+		TestEqual(TEXT("Failed work items"), Progress.NumFailed, 0);
+		TestTrue(TEXT("Built again after the restart"), Fixture->WorkItem->GetBuildSerial() > FirstBuildSerial);
+		TestTrue(TEXT("Arbiter idle"), Fixture->Arbiter->IsIdle());
+		TestEqual(TEXT("Node finished"), Fixture->Node->GetState(), EAutomationGraphNodeState::Finished);
+		return true;
+	}));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHoudiniCookArbiterOutOfRestartsTest, "EnhancedHoudiniEngine.CookArbiter.FailsWhenOutOfRestarts", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FHoudiniCookArbiterOutOfRestartsTest::RunTest(const FString& Parameters)
+{
+	TSharedRef<FStandInCookFixture> Fixture = MakeShared<FStandInCookFixture>(0);
+	if (!TestNotNull(TEXT("Cook arbiter"), Fixture->Arbiter) || !TestNotNull(TEXT("Work item"), Fixture->WorkItem))
+	{
+		return false;
+	}
+
+	TestTrue(TEXT("Started"), Fixture->Start());
+	TestEqual(TEXT("Building before the session dies"), Fixture->WorkItem->GetBuildState(), EEHEBuildState::Building);
+	TestTrue(TEXT("Killed the session"), Fixture->Arbiter->KillSession(0));
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Fixture]()
+	{
+		if (!WaitFor(this, *Fixture, TEXT("the work item to fail"), [&Fixture]() { return Fixture->WorkItem->GetBuildState() == EEHEBuildState::Error; }))
+		{
+			return false;
+		}
+
+		const FHoudiniCookArbiterProgress Progress = Fixture->Arbiter->GetProgress();
+		TestEqual(TEXT("Session restarts"), Progress.NumSessionRestarts, 0);
+		TestEqual(TEXT("Resubmitted work items"), Progress.NumResubmitted, 0);
+		TestEqual(TEXT("Failed work items"), Progress.NumFailed, 1);
+		TestEqual(TEXT("Node failed"), Fixture->Node->GetState(), EAutomationGraphNodeState::Error);
+		return true;
+	}));
+	return true;
+}
+
+#endif
@@ -50,4 +50,34 @@ class ENHANCEDHOUDINIENGINERUNTIME_API UAGN_CookHDA : public UHoudiniBuildSequen
 
 public:
 	UAGN_CookHDA(const FObjectInitializer& Initializer);
+
+	virtual bool ShouldSkipUnchangedActors() const override { return bSkipUnchangedActors; }
+	virtual bool ShouldUseCookCache() const override;
+	virtual bool ShouldDeduplicateInstances() const override { return bDeduplicateIdenticalInstances; }
+	virtual UHoudiniAsset* GetBatchWrapperAsset(UHoudiniAsset* HoudiniAsset) const override;
+	virtual int32 GetMaxBatchSize() const override { return MaxBatchSize; }
+
+	// Skip actors whose HDA, parameters, inputs and transform are unchanged since their last successful build.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Build HDA")
+	bool bSkipUnchangedActors = true;
+
+	// Restore cook results from the cook cache when it is enabled (houdini.CookCache.Enable).
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Build HDA")
+	bool bUseCookCache = true;
+
+	// Cook only one of the actors that share an HDA, parameters and inputs, and copy its outputs to the others. Actors
+	// whose inputs point at other actors in the world are always cooked. Only enable this for HDAs whose result
+	// doesn't depend on where the actor is placed.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Build HDA")
+	bool bDeduplicateIdenticalInstances = false;
+
+	// Cook actors of these HDAs in batches, each batch in a single cook of the wrapper HDA they map to. Only actors
+	// without inputs that produce a single static mesh can be batched, see UHoudiniBuildBatch for what the wrapper HDA
+	// has to do. The other actors are cooked one by one.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Build HDA")
+	TMap<UHoudiniAsset*, UHoudiniAsset*> BatchWrapperAssets;
+
+	// Maximum number of actors cooked in one batch.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Build HDA", meta=(ClampMin=2))
+	int32 MaxBatchSize = 64;
 };
@@ -41,6 +41,12 @@ class UHoudiniBuildWorkItem_Rebuild : public UHoudiniBuildWorkItem
 
 public:
 	virtual bool BuildInternal(UHoudiniAssetComponent* AssetComponent) override;
+
+	// True if the last build only cooked, because the HDA definition hadn't changed.
+	bool WasDowngradedToCook() const { return bDowngradedToCook; }
+
+protected:
+	bool bDowngradedToCook = false;
 };
 
 UCLASS(meta=( DisplayName="Rebuild HDA"))
@@ -50,4 +56,12 @@ class ENHANCEDHOUDINIENGINERUNTIME_API UAGN_RebuildHDA : public UHoudiniBuildSeq
 
 public:
 	UAGN_RebuildHDA(const FObjectInitializer& Initializer);
+
+	virtual bool ReloadsDefinitions() const override { return true; }
+	virtual FString GetMessageText() override;
+
+	// Only rebuild actors whose HDA library file changed since they were last rebuilt, and cook the others. Rebuilding
+	// reloads the definition and re-instantiates the HDA, which is a lot slower than a cook.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Build HDA")
+	bool bSmartRebuild = true;
 };
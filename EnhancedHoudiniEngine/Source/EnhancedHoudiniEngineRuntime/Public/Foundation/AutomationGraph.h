@@ -47,6 +47,42 @@ public:
 	FText NewNodeMenuCategory;
 };
 
+// A flattened, index based copy of the graph topology. Nodes are stored in topological order, and a node's position in
+// Nodes is its index everywhere else in the plan. Adjacency is stored in compressed (offset + index) arrays so that
+// walking a node's parents or children never touches the UObjects.
+struct ENHANCEDHOUDINIENGINERUNTIME_API FAutomationGraphPlan
+{
+public:
+	void Compile(const TArray<TObjectPtr<UAutomationGraphNode>>& RootNodes);
+	
+	int32 Num() const { return Nodes.Num(); }
+	int32 IndexOf(const UAutomationGraphNode* GraphNode) const;
+	
+	TArrayView<const int32> GetChildren(int32 NodeIndex) const
+	{
+		return MakeArrayView(ChildIndices.GetData() + ChildOffsets[NodeIndex], ChildOffsets[NodeIndex + 1] - ChildOffsets[NodeIndex]);
+	}
+	TArrayView<const int32> GetParents(int32 NodeIndex) const
+	{
+		return MakeArrayView(ParentIndices.GetData() + ParentOffsets[NodeIndex], ParentOffsets[NodeIndex + 1] - ParentOffsets[NodeIndex]);
+	}
+
+	// Every node connected to the root nodes, in topological order (unless the graph has a cycle).
+	TArray<TObjectPtr<UAutomationGraphNode>> Nodes;
+	TMap<const UAutomationGraphNode*, int32> NodeIndices;
+	
+	TArray<int32> ChildOffsets;
+	TArray<int32> ChildIndices;
+	TArray<int32> ParentOffsets;
+	TArray<int32> ParentIndices;
+
+	// Number of parents for each node. A node may run once this many of its parents have finished.
+	TArray<int32> InDegrees;
+	TArray<int32> RootIndices;
+
+	bool bHasCycle = false;
+};
+
 UCLASS()
 class ENHANCEDHOUDINIENGINERUNTIME_API UAutomationGraph : public UObject
 {
@@ -56,6 +92,17 @@ public:
 	virtual TArray<FAutomationGraphSupportedNodeInfo> GetSupportedNodeInfo() { return SupportedNodeInfo; }
 	
 	virtual void Reset();
+
+	// Returns the compiled plan for the current topology, compiling it first if needed. The returned plan is immutable,
+	// so callers can hold on to it for the duration of a run even if the graph is edited in the meantime.
+	TSharedRef<const FAutomationGraphPlan> GetPlan();
+
+	// Must be called whenever RootNodes or the parents/children of any node change.
+	void InvalidatePlan() { CachedPlan.Reset(); }
+
+#if WITH_EDITOR
+	virtual void PostEditUndo() override;
+#endif
 	
 	UPROPERTY()
 	TArray<TObjectPtr<UAutomationGraphNode>> RootNodes;
@@ -67,4 +114,6 @@ public:
 protected:
 	UPROPERTY()
 	TArray<FAutomationGraphSupportedNodeInfo> SupportedNodeInfo;
+
+	TSharedPtr<const FAutomationGraphPlan> CachedPlan;
 };
\ No newline at end of file
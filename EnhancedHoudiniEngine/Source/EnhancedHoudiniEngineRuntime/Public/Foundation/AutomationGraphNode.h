@@ -44,6 +44,10 @@ enum class EAutomationGraphNodeState: uint8
 	Error
 };
 
+class UAutomationGraphNode;
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnAutomationGraphNodeStateChanged, UAutomationGraphNode* /* Node */, EAutomationGraphNodeState /* NewState */);
+
 // TODO(): Consider moving this to a separate plugin.
 UCLASS()
 class ENHANCEDHOUDINIENGINERUNTIME_API UAutomationGraphNode : public UObject
@@ -63,6 +67,16 @@ public:
 	// Text to push out to the UI.
 	virtual FString GetMessageText();
 
+	// Early cutoff: a node whose parents all produced exactly the same output as last time can be finished as up to
+	// date instead of running.
+	virtual bool SupportsEarlyCutoff() const { return true; }
+	virtual bool HasUnchangedOutput() { return bFinishedUpToDate; }
+	virtual void FinishUpToDate();
+	bool WasFinishedUpToDate() const { return bFinishedUpToDate; }
+
+	// Fires whenever this node transitions into a new state. Schedulers should bind to this rather than polling.
+	FOnAutomationGraphNodeStateChanged OnStateChanged;
+
 	UPROPERTY()
 	TArray<TObjectPtr<UAutomationGraphNode>> ParentNodes;
 
@@ -76,9 +90,15 @@ public:
 	UPROPERTY()
 	FText Title;
 
+	// Skip this node when everything upstream of it produced the same output as the previous run. Hidden on nodes that
+	// don't support early cutoff.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Early Cutoff")
+	bool bSkipWhenInputsUnchanged = true;
+
 protected:
 	double TimeStarted = 0.0;
 	double TimeFinished = 0.0;
+	bool bFinishedUpToDate = false;
 
 private:
 	EAutomationGraphNodeState NodeState = EAutomationGraphNodeState::Uninitialized;
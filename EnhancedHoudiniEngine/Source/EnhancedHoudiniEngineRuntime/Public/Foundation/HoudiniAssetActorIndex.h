@@ -0,0 +1,102 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+
+#include "HoudiniAssetActorIndex.generated.h"
+
+class AHoudiniAssetActor;
+class UHoudiniAsset;
+
+// What an actor was indexed under, so it can be removed again without searching every bucket.
+struct FHoudiniAssetActorIndexEntry
+{
+	TObjectKey<UHoudiniAsset> Asset;
+	TArray<FName> Tags;
+};
+
+// Keeps every AHoudiniAssetActor in a world indexed by UHoudiniAsset and by actor tag, so build managers don't have to
+// scan the whole world each time they run. The index is built once by scanning the level actor arrays on the game thread,
+// and is then kept current from actor added/removed and property change events.
+UCLASS()
+class ENHANCEDHOUDINIENGINERUNTIME_API UHoudiniAssetActorIndex : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UHoudiniAssetActorIndex* Get(const UObject* WorldContextObject);
+	
+	//~USubsystem interface.
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~End USubsystem interface.
+
+	TArray<AHoudiniAssetActor*> GetActorsWithTag(FName ActorTag);
+	TArray<AHoudiniAssetActor*> GetActorsOfAsset(const UHoudiniAsset* AssetType);
+
+	// Adds, updates or removes a single actor. Safe to call for actors that aren't Houdini asset actors.
+	void UpdateActor(AActor* Actor);
+	void RemoveActor(AActor* Actor);
+
+	// Throws away the index. It will be rebuilt on the next query.
+	void Invalidate();
+
+protected:
+	void EnsureBuilt();
+	void AddEntry(AHoudiniAssetActor* AssetActor, FHoudiniAssetActorIndexEntry&& Entry);
+	static FHoudiniAssetActorIndexEntry MakeEntry(AHoudiniAssetActor* AssetActor);
+
+	void OnActorSpawned(AActor* Actor);
+	void OnActorDestroyed(AActor* Actor);
+	void OnLevelChanged(ULevel* Level, UWorld* World);
+	
+#if WITH_EDITOR
+	void OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent);
+#endif
+
+	TMap<TWeakObjectPtr<AHoudiniAssetActor>, FHoudiniAssetActorIndexEntry> Entries;
+	TMap<FName, TSet<TWeakObjectPtr<AHoudiniAssetActor>>> ActorsByTag;
+	TMap<TObjectKey<UHoudiniAsset>, TSet<TWeakObjectPtr<AHoudiniAssetActor>>> ActorsByAsset;
+
+	bool bIsBuilt = false;
+
+	FDelegateHandle ActorSpawnedHandle;
+	FDelegateHandle ActorDestroyedHandle;
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+#if WITH_EDITOR
+	FDelegateHandle LevelActorAddedHandle;
+	FDelegateHandle LevelActorDeletedHandle;
+	FDelegateHandle ObjectPropertyChangedHandle;
+#endif
+};
@@ -0,0 +1,99 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "UObject/Object.h"
+
+#include "HoudiniBuildBatch.generated.h"
+
+class AHoudiniAssetActor;
+class UHoudiniAsset;
+class UHoudiniAssetComponent;
+class UHoudiniBuildWorkItem;
+
+// Cooks many actors of the same HDA in a single cook of a wrapper HDA, to avoid paying the fixed cost of a cook
+// (parameter upload, cook round trip, output translation) once per actor.
+//
+// The wrapper HDA gets a table of every actor in the batch through its "eh_batch_instances" string parameter: a JSON
+// array with, for each actor, its index, the output name to tag its geometry with, its transform (in Unreal units and
+// coordinates) and the values of its HDA parameters by name. The wrapper cooks each entry, packs its geometry in the
+// actor's local space, and tags it with a primitive "unreal_output_name" attribute set to the entry's output name. The
+// resulting meshes are then copied into the static mesh output of each actor.
+//
+// Only actors without input objects, whose parameters can all be written to the table, can be batched. Since results
+// are copied into existing outputs, an actor has to have been cooked once before and produce a single static mesh.
+// Anything that can't be copied is cooked on its own.
+UCLASS()
+class ENHANCEDHOUDINIENGINERUNTIME_API UHoudiniBuildBatch : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	static bool CanBatch(AHoudiniAssetActor* AssetActor);
+	
+	// The first work item is the leader, which builds the whole batch when the cook arbiter starts it.
+	void Initialize(UHoudiniAsset* InWrapperAsset, TConstArrayView<UHoudiniBuildWorkItem*> InWorkItems);
+
+	// Called by the leader when it starts building. Returns false if the batched cook couldn't be started, in which case
+	// the leader has to cook by itself.
+	bool Start();
+	bool WasStarted() const { return bStarted; }
+
+	UHoudiniBuildWorkItem* GetLeader() const { return WorkItems.IsEmpty() ? nullptr : WorkItems[0].Get(); }
+	const TArray<TObjectPtr<UHoudiniBuildWorkItem>>& GetWorkItems() const { return WorkItems; }
+
+	virtual void BeginDestroy() override;
+
+protected:
+	bool SetInstanceTable(UHoudiniAssetComponent* WrapperComponent);
+	void OnWrapperPostProcess(UHoudiniAssetComponent* WrapperComponent, bool bSucceeded);
+	
+	// Copies the wrapper's results to every work item in the batch and finishes them. The leader cooks by itself if its
+	// own result is missing.
+	void Split(UHoudiniAssetComponent* WrapperComponent, bool bSucceeded);
+	void ReleaseWrapperActor();
+
+	UPROPERTY()
+	TObjectPtr<UHoudiniAsset> WrapperAsset = nullptr;
+	
+	UPROPERTY()
+	TArray<TObjectPtr<UHoudiniBuildWorkItem>> WorkItems;
+
+	UPROPERTY()
+	TWeakObjectPtr<AHoudiniAssetActor> WrapperActor = nullptr;
+
+	bool bStarted = false;
+
+	// A newly spawned wrapper cooks once on its own before its parameters exist.
+	bool bWaitingForInstantiation = false;
+	FDelegateHandle PostOutputProcessingDelegateHandle;
+};
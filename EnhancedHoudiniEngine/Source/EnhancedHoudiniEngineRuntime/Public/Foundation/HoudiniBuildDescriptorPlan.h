@@ -0,0 +1,87 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+class UAutomationGraphNode;
+class UWorld;
+struct FAutomationGraphPlan;
+struct FHoudiniBuildHistory;
+
+// An HDA actor as the plan sees it. Unloaded actors are read from their world partition actor descriptor, and their
+// asset from the asset registry dependencies of their package.
+struct FHoudiniBuildPlannedActor
+{
+	FSoftObjectPath ActorPath;
+	FSoftObjectPath HoudiniAssetPath;
+	TArray<FName> Tags;
+	FBox Bounds = FBox(ForceInit);
+
+	// Where the actors this one takes as input are. Building it needs them loaded too.
+	FBox InputBounds = FBox(ForceInit);
+	bool bIsLoaded = false;
+
+	// The plan node that would build this actor, INDEX_NONE if none would.
+	int32 NodeIndex = INDEX_NONE;
+	double EstimatedSec = 0.0;
+};
+
+struct FHoudiniBuildPlannedNode
+{
+	TWeakObjectPtr<UAutomationGraphNode> Node;
+	TArray<int32> ActorIndices;
+	double EstimatedSec = 0.0;
+};
+
+// What a run of a build manager would do, worked out without loading any actors: which actors each node would build,
+// where they are and how long it would take. Used to preview and estimate builds of whole world partition maps, and to
+// only load the parts of the map that have work.
+struct ENHANCEDHOUDINIENGINERUNTIME_API FHoudiniBuildDescriptorPlan
+{
+	bool Build(UWorld* World, const TSharedRef<const FAutomationGraphPlan>& GraphPlan, const FHoudiniBuildHistory& History);
+
+	int32 GetNumWorkItems() const;
+	
+	// Planned actors whose bounds are centered in Region (only X and Y are considered).
+	TArray<int32> GetActorsInRegion(const FBox& Region) const;
+
+	void Log() const;
+
+	TSharedPtr<const FAutomationGraphPlan> GraphPlan;
+	TArray<FHoudiniBuildPlannedActor> Actors;
+	TArray<FHoudiniBuildPlannedNode> Nodes;
+
+	// Length of the longest chain of nodes.
+	double EstimatedSec = 0.0;
+	FBox Bounds = FBox(ForceInit);
+	int32 NumUnloadedActors = 0;
+	double PlanningSec = 0.0;
+};
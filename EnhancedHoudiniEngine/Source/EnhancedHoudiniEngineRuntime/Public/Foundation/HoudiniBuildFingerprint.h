@@ -0,0 +1,55 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+class AHoudiniAssetActor;
+class UHoudiniAsset;
+
+// A digest of everything that goes into cooking an HDA actor: the HDA definition file, the parameter values, the inputs
+// (and the objects they point at) and the actor transform. If the fingerprint matches the one recorded after the last
+// successful build, cooking the actor again would produce the same result.
+struct ENHANCEDHOUDINIENGINERUNTIME_API FHoudiniBuildFingerprint
+{
+	// Fingerprints every actor. Object state is serialized on the (calling) game thread, then HDA files and the
+	// serialized state are hashed in parallel. OutFingerprints lines up with AssetActors. Actors that can't be
+	// fingerprinted reliably (missing HDA file, unsaved input assets...) get an empty fingerprint, which never matches
+	// anything.
+	static void Compute(TConstArrayView<AHoudiniAssetActor*> AssetActors, TArray<FString>& OutFingerprints);
+
+	// Like Compute(), but leaves out the actor transform and HE's per-instance state, so actors of the same HDA with the
+	// same parameters and inputs get the same key. Actors with inputs that point at other actors in the world get an
+	// empty key, since their cook depends on where they are.
+	static void ComputeEquivalenceKeys(TConstArrayView<AHoudiniAssetActor*> AssetActors, TArray<FString>& OutKeys);
+
+	// Content hash of the HDA library file behind HoudiniAsset. Empty if the file can't be read.
+	static FString HashDefinitionFile(UHoudiniAsset* HoudiniAsset);
+};
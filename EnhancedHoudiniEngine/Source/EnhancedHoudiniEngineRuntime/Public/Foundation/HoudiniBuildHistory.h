@@ -0,0 +1,149 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "HoudiniBuildHistory.generated.h"
+
+class AHoudiniAssetActor;
+class UAutomationGraphNode;
+class UHoudiniAsset;
+class UHoudiniBuildWorkItem;
+struct FHoudiniBuildShard;
+
+USTRUCT()
+struct ENHANCEDHOUDINIENGINERUNTIME_API FHoudiniBuildDurationRecord
+{
+	GENERATED_BODY()
+
+	// Exponential moving average, so one outlier cook doesn't throw the estimate off for good.
+	UPROPERTY(VisibleAnywhere)
+	double AverageSec = 0.0;
+
+	UPROPERTY(VisibleAnywhere)
+	int32 NumSamples = 0;
+
+	// Returns true if the estimate moved enough to be worth saving.
+	bool AddSample(double DurationSec);
+	bool HasSamples() const { return NumSamples > 0; }
+};
+
+USTRUCT()
+struct ENHANCEDHOUDINIENGINERUNTIME_API FHoudiniBuildActorRecord
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere)
+	FHoudiniBuildDurationRecord Duration;
+
+	// Fingerprint of the actor at its last successful build. Empty if the last build failed.
+	UPROPERTY(VisibleAnywhere)
+	FString Fingerprint;
+
+	// Hash of the outputs of the last successful build.
+	UPROPERTY(VisibleAnywhere)
+	FString OutputHash;
+
+	// Version of the HDA definition (see FHoudiniBuildDefinitionRecord) the actor was last rebuilt with.
+	UPROPERTY(VisibleAnywhere)
+	int32 DefinitionVersion = INDEX_NONE;
+};
+
+USTRUCT()
+struct ENHANCEDHOUDINIENGINERUNTIME_API FHoudiniBuildDefinitionRecord
+{
+	GENERATED_BODY()
+
+	// Content hash of the HDA library file when it was last seen.
+	UPROPERTY(VisibleAnywhere)
+	FString FileHash;
+
+	// Bumped every time the library file hash changes.
+	UPROPERTY(VisibleAnywhere)
+	int32 Version = 0;
+};
+
+// What a build manager remembers about previous runs. Saved with the manager (and so with the level), and used to
+// estimate how long the next run of each node and work item will take.
+USTRUCT()
+struct ENHANCEDHOUDINIENGINERUNTIME_API FHoudiniBuildHistory
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere)
+	TMap<TSoftObjectPtr<AHoudiniAssetActor>, FHoudiniBuildActorRecord> Actors;
+
+	// Fallback for actors that have never been built: the average over every actor of the same asset.
+	UPROPERTY(VisibleAnywhere)
+	TMap<TSoftObjectPtr<UHoudiniAsset>, FHoudiniBuildDurationRecord> Assets;
+
+	UPROPERTY(VisibleAnywhere)
+	TMap<TSoftObjectPtr<UAutomationGraphNode>, FHoudiniBuildDurationRecord> Nodes;
+
+	UPROPERTY(VisibleAnywhere)
+	TMap<TSoftObjectPtr<UHoudiniAsset>, FHoudiniBuildDefinitionRecord> Definitions;
+
+	void RecordWorkItem(UHoudiniBuildWorkItem* WorkItem, double DurationSec);
+	void RecordNode(UAutomationGraphNode* GraphNode, double DurationSec);
+	void RecordFingerprint(UHoudiniBuildWorkItem* WorkItem, const FString& Fingerprint);
+	FString GetFingerprint(UHoudiniBuildWorkItem* WorkItem) const;
+	void RecordOutputHash(UHoudiniBuildWorkItem* WorkItem, const FString& OutputHash);
+	FString GetOutputHash(UHoudiniBuildWorkItem* WorkItem) const;
+
+	// Returns the current definition version of HoudiniAsset, bumping it if FileHash differs from the last one seen.
+	// Returns INDEX_NONE if FileHash is empty.
+	int32 UpdateDefinition(UHoudiniAsset* HoudiniAsset, const FString& FileHash);
+	void RecordDefinitionVersion(UHoudiniBuildWorkItem* WorkItem, int32 DefinitionVersion);
+	int32 GetDefinitionVersion(UHoudiniBuildWorkItem* WorkItem) const;
+
+	double EstimateWorkItem(UHoudiniBuildWorkItem* WorkItem) const;
+	double EstimateNode(UAutomationGraphNode* GraphNode) const;
+
+	// Same as above, for actors that may not be loaded.
+	double EstimateActor(const FSoftObjectPath& ActorPath, const FSoftObjectPath& HoudiniAssetPath) const;
+	double EstimateNode(UAutomationGraphNode* GraphNode, TConstArrayView<double> WorkItemEstimatesSec) const;
+
+	// Takes over what a shard of a split build recorded: everything about the shard's own actors, and whichever
+	// asset, node and definition records have seen more samples.
+	void MergeShard(const FHoudiniBuildHistory& ShardHistory, const FHoudiniBuildShard& Shard);
+
+	void Empty();
+
+	// True if something was recorded since the last call that changes what the next run does, or noticeably changes its
+	// estimates. The build manager only dirties its package when this is true, so runs that build nothing new don't
+	// dirty the level.
+	bool ConsumeChanges();
+
+private:
+	void SetChanged(bool bInChanged) { bChanged |= bInChanged; }
+	
+	bool bChanged = false;
+};
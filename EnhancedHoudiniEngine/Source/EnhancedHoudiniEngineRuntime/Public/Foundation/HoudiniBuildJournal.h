@@ -0,0 +1,88 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+class IFileHandle;
+class UAutomationGraphNode;
+class UHoudiniBuildWorkItem;
+
+// A work item that an interrupted run finished, as recorded in its journal.
+struct FHoudiniBuildJournalItem
+{
+	FString Fingerprint;
+	FString OutputHash;
+};
+
+// Write-ahead log of a build manager run. Every finished work item and node is appended (and flushed) before the run
+// moves on, so if the editor or the Houdini session dies halfway through, a resumed run knows what was already done.
+// One record per line:
+//
+//   run   <sequence graph>
+//   item  <node> <actor> <fingerprint> <output hash>
+//   node  <node> <unchanged output 0|1>
+//
+// A torn last line is ignored, and dropped from the file when resuming. The journal is deleted once a run finishes
+// without errors.
+class ENHANCEDHOUDINIENGINERUNTIME_API FHoudiniBuildJournal
+{
+public:
+	~FHoudiniBuildJournal();
+	
+	// Starts journaling a run of RunKey. When resuming, the records of an interrupted run of the same RunKey are loaded
+	// and kept. Otherwise the journal starts over.
+	bool Open(const FString& InFilename, const FString& RunKey, bool bResume);
+	void Close(bool bDelete);
+	bool IsOpen() const { return FileHandle.IsValid(); }
+
+	void RecordWorkItem(UHoudiniBuildWorkItem* WorkItem);
+	void RecordNode(UAutomationGraphNode* GraphNode, bool bUnchangedOutput);
+
+	// What the interrupted run finished. Null if it didn't get to it.
+	const FHoudiniBuildJournalItem* FindWorkItem(const UHoudiniBuildWorkItem* WorkItem) const;
+	const bool* FindNode(const UAutomationGraphNode* GraphNode) const;
+	int32 GetNumResumable() const { return WorkItems.Num() + Nodes.Num(); }
+
+protected:
+	// OutCompleteRecords is set to the records that were written out in full, one per line.
+	bool Load(const FString& RunKey, FString& OutCompleteRecords);
+	bool Append(const FString& Record);
+	static FString MakeWorkItemKey(const FString& NodePath, const FString& ActorPath);
+
+	FString Filename;
+	TUniquePtr<IFileHandle> FileHandle;
+
+	// Keyed by node path and actor path.
+	TMap<FString, FHoudiniBuildJournalItem> WorkItems;
+
+	// Node path to whether the node's output was unchanged.
+	TMap<FString, bool> Nodes;
+};
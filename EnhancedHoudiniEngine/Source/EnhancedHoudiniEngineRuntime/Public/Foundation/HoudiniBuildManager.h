@@ -1,4 +1,4 @@
-// Copyright © Mason Stevenson
+﻿// Copyright © Mason Stevenson
 // All rights reserved.
 //
 // Redistribution and use in source and binary forms, with or without
@@ -30,49 +30,43 @@
 // ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
+#include "HoudiniBuildDescriptorPlan.h"
+#include "HoudiniBuildHistory.h"
+#include "HoudiniBuildJournal.h"
+#include "HoudiniBuildSaveQueue.h"
 #include "HoudiniBuildSequenceGraph.h"
+#include "HoudiniBuildShard.h"
 
 #include "HoudiniBuildManager.generated.h"
 
 class UHoudiniBuildSequenceNode;
+class UHoudiniBuildWorkItem;
 struct FHoudiniBuildSequenceInfo;
 class AHoudiniAssetActor;
 class UAutomationGraphNode;
+enum class EEHEBuildState : uint8;
 
-// Can probably just use TPair<> instead, but I don't 100% trust the constructor for that is making a copy.
-USTRUCT()
-struct FEHEBuildSequenceDFSNode
+// A pending work item timeout, or the end of a failed work item's retry backoff. Stored in a min-heap so the manager
+// only ever has to look at the earliest one.
+struct FEHEBuildDeadline
 {
-	GENERATED_BODY()
-
-public:
-	FEHEBuildSequenceDFSNode() = default;
-	FEHEBuildSequenceDFSNode(TObjectPtr<UAutomationGraphNode>& NewSqeuenceNode)
-	{
-		GraphNode = NewSqeuenceNode;
-	}
-	FEHEBuildSequenceDFSNode(TObjectPtr<UAutomationGraphNode>& NewSqeuenceNode, TSet<TObjectPtr<UAutomationGraphNode>>& NewAncestors)
-	{
-		GraphNode = NewSqeuenceNode;
-		Ancestors = NewAncestors;
-	}
-	
-	UPROPERTY()
-	TObjectPtr<UAutomationGraphNode> GraphNode = nullptr;
+	double Time = 0.0;
+	TWeakObjectPtr<UHoudiniBuildWorkItem> WorkItem;
+	int32 BuildSerial = 0;
+	bool bFailDeadline = false;
+	bool bRetryDeadline = false;
 
-	UPROPERTY()
-	TSet<TObjectPtr<UAutomationGraphNode>> Ancestors;
+	bool operator<(const FEHEBuildDeadline& Other) const { return Time < Other.Time; }
 };
 
+DECLARE_DELEGATE_RetVal_TwoParams(bool, FHoudiniBuildCanStartNode, AHoudiniBuildManager* /* BuildManager */, int32 /* NodeIndex */);
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnHoudiniBuildNodeEnded, AHoudiniBuildManager* /* BuildManager */, int32 /* NodeIndex */, UAutomationGraphNode* /* Node */);
+
 UCLASS(Blueprintable)
 class ENHANCEDHOUDINIENGINERUNTIME_API AHoudiniBuildManager : public AActor
 {
 	GENERATED_BODY()
 
-// CONSTANTS
-public:
-	static constexpr double kBuildPollRateSec = 0.100;
-	
 public:
 	AHoudiniBuildManager(const FObjectInitializer& Initializer);
 	
@@ -81,16 +75,85 @@ public:
 	void EditorTick(float DeltaSeconds);
 	virtual bool ShouldTickIfViewportsOnly() const override { return true; } // enables editor tick
 
-	void Run();
+	// Starts a run. Returns false if the run could not be started. When resuming, work that an interrupted run of the same
+	// graph already finished is skipped, see FHoudiniBuildJournal.
+	bool Run(bool bResume = false);
+	bool IsRunning() const { return !ActiveNodes.IsEmpty() || !HeldNodes.IsEmpty(); }
+
+	// True if a node of the current (or last) run ended in an error or expired.
+	bool HasRunFailed() const { return bRunFailed; }
+
+	// Saves the packages still waiting in the save queue (see bSaveDuringRun). Returns false if any save failed.
+	bool FlushSaves();
+	bool IsSaving() const { return !SaveQueue.IsEmpty(); }
+
+	// Works out what a run would build without loading any actors. See FHoudiniBuildDescriptorPlan.
+	bool PlanFromDescriptors(FHoudiniBuildDescriptorPlan& OutPlan) const;
+
+	// Restricts the following runs to the shard's actors, for builds split across several editor processes.
+	void SetShard(const FHoudiniBuildShard& InShard) { Shard = InShard; }
+	const FHoudiniBuildShard& GetShard() const { return Shard; }
+
+	// True if an interrupted run of the current shard left a journal to resume from.
+	bool HasJournal() const;
+
+	// Optional. Asked before each node of a run starts, with the node's index in the run's plan. Nodes it holds back
+	// are asked again every tick.
+	FHoudiniBuildCanStartNode CanStartNodeDelegate;
+
+	// Broadcast when a node of the run finishes, fails or expires.
+	FOnHoudiniBuildNodeEnded OnNodeEndedDelegate;
 	
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	UHoudiniBuildSequenceGraph* SequenceGraph;
+
+	// When several managers in the same world are running, work items from managers with a higher priority are
+	// started first.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 BuildPriority = 0;
+
+	// Read the inputs of every HDA actor, and make actors that take another HDA actor as input wait for it.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bDiscoverInputDependencies = true;
+
+	// Save the packages dirtied by each node as soon as it finishes, while later nodes are still building. Only
+	// packages changed by the run are saved, and never the map or this build manager, which are left for the end.
+	// Once a node fails nothing more is saved, but what was saved before stays saved, so a failed run can leave the
+	// outputs of its earlier nodes on disk.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bSaveDuringRun = false;
+
+	// Durations recorded by previous runs, used to start the longest chains of work first.
+	UPROPERTY(VisibleAnywhere, AdvancedDisplay)
+	FHoudiniBuildHistory BuildHistory;
 	
 protected:
-	void InitializeNodes();
+	// Returns false if the graph can't be run: it has a cycle, this isn't an editor world, or a node failed to initialize.
+	bool InitializeNodes();
+	void DiscoverInputDependencies(const FAutomationGraphPlan& Plan);
 	void RefreshBuildPreview();
+
+	// Scheduling. Nodes and work items push state changes to the manager, which starts ready children immediately.
+	void BindGraphEvents();
+	void UnbindGraphEvents();
+	void OnNodeStateChanged(UAutomationGraphNode* GraphNode, EAutomationGraphNodeState NewState);
+	void OnWorkItemStateChanged(UHoudiniBuildWorkItem* WorkItem, EEHEBuildState NewState);
+	void OnPackageMarkedDirty(UPackage* Package, bool bWasDirty);
+	void QueueDirtiedPackages(int32 NodeIndex, bool bSave);
+	void ProcessReadyNodes();
+	void ComputeCriticalPaths();
+	bool CanCutOff(int32 NodeIndex) const;
+	bool CanStartPipelined(int32 NodeIndex) const;
+	void QueuePipelinedChildren(int32 NodeIndex);
+	void ProcessDeadlines(double CurrentTime);
+	void UpdateTickEnabled();
+	
+	// Only dirties the level when the history changed, so runs that build nothing new leave it clean.
+	void MarkDirtyIfHistoryChanged();
 	
-	void PollActiveNodes();
+	// Where runs of this manager are journaled. Each shard of a split build has its own journal.
+	FString GetJournalPath() const;
+
 	void ResetSequenceGraph();
 	void Cancel();
 	void PrintBuildOrder();
@@ -99,10 +162,50 @@ protected:
 	// UPROPERTY()
 	// TArray<TWeakObjectPtr<AHoudiniAssetActor>> PreviewActors;
 
-	// Nodes that are actively being built. Order shouldn't matter, we are going to poll each of these on tick.
+	// Nodes that are actively being built.
 	UPROPERTY()
 	TSet<TObjectPtr<UAutomationGraphNode>> ActiveNodes;
 
-	double LastTimePolled = 0.0;
+	// Indices into RunPlan of nodes whose parents have all finished. A heap, longest critical path first.
+	TArray<int32> ReadyNodes;
+
+	// Indices into RunPlan of ready nodes that CanStartNodeDelegate held back.
+	TArray<int32> HeldNodes;
+
+	FHoudiniBuildShard Shard;
+
+	// Every node we are currently bound to, so we can unbind when the run ends.
+	UPROPERTY()
+	TArray<TObjectPtr<UAutomationGraphNode>> BoundNodes;
+
+	// The plan this run was started with. Held on to so that edits to the graph mid-run don't affect the run.
+	TSharedPtr<const FAutomationGraphPlan> RunPlan;
+
+	// For each node in RunPlan, the number of parents that still need to finish before it can start.
+	TArray<int32> RemainingParents;
+
+	// For each node in RunPlan, the estimated time from starting it until the end of the longest chain depending on it.
+	TArray<double> CriticalPathSec;
+	TArray<double> NodeTimeStarted;
+
+	// For each node in RunPlan, true once it finished having produced exactly the same output as the previous run.
+	TArray<bool> NodeOutputUnchanged;
+
+	// For each node in RunPlan, false if the shard leaves it to another process.
+	TArray<bool> NodeRunsInShard;
+
+	// Packages dirtied during the run, and the indices into RunPlan of the active nodes that may have dirtied them. A
+	// package is queued for saving once all of those nodes have finished.
+	TMap<TWeakObjectPtr<UPackage>, TArray<int32>> DirtiedPackages;
+
+	FHoudiniBuildSaveQueue SaveQueue;
+	FHoudiniBuildJournal Journal;
+
+	// Min-heap of work item timeouts, ordered by deadline.
+	TArray<FEHEBuildDeadline> Deadlines;
+
+	bool bProcessingReadyNodes = false;
+	bool bHandlingNodeStateChange = false;
+	bool bRunFailed = false;
 	bool bNeedsInitializeGraph = false;
 };
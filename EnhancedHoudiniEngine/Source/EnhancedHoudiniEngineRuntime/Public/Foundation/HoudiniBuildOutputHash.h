@@ -0,0 +1,60 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+class ALandscapeProxy;
+class UHoudiniAssetComponent;
+
+// A digest of what a cook produced: static mesh data, instancer transforms, the landscape height and weight data in the
+// region the HDA wrote to and the state of every other output object. Two cooks with the same output hash produced the same result, so anything
+// downstream of them doesn't need to run again.
+struct ENHANCEDHOUDINIENGINERUNTIME_API FHoudiniBuildOutputHash
+{
+	// Returns an empty string if the outputs couldn't be hashed, which never matches anything.
+	static FString Compute(UHoudiniAssetComponent* AssetComponent);
+
+	// Cheap check that the outputs of the last cook are still there: every output object still points at something,
+	// and a component without outputs only counts if its last cook produced nothing. Outputs can be deleted (or fail
+	// to load) without any of the inputs changing.
+	static bool AreOutputsPresent(UHoudiniAssetComponent* AssetComponent, const FString& LastOutputHash);
+
+	// Landscape outputs are wrapped in HE objects that just point at the landscape, so this looks for those pointers.
+	static void FindReferencedLandscapes(UObject* Object, TSet<ALandscapeProxy*>& OutLandscapes);
+
+	// Adds the part of every landscape that Object (an HDA output object) wrote to, in landscape vertex coordinates
+	// (inclusive on both ends, like FLandscapeEditDataInterface). HE's landscape layer outputs record the extents they
+	// wrote. Landscapes the HDA created, and landscapes referenced by anything else, count as a whole.
+	static void AddLandscapeRegions(UObject* Object, TMap<ALandscapeProxy*, FIntRect>& InOutRegions);
+
+	// The extent of the whole landscape LandscapeProxy is part of.
+	static bool GetLandscapeExtent(ALandscapeProxy* LandscapeProxy, FIntRect& OutExtent);
+};
@@ -0,0 +1,62 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+class UPackage;
+
+// Saves packages a few at a time while a run is still going, so that finished work doesn't pile up in memory until one
+// long save at the end. File writes happen in the background. The queue is bounded: once it is full, the oldest package
+// is saved right away.
+struct ENHANCEDHOUDINIENGINERUNTIME_API FHoudiniBuildSaveQueue
+{
+	void Enqueue(UPackage* Package);
+
+	// Saves queued packages until the time budget is used up. Always saves at least one.
+	void Tick(double BudgetSec);
+
+	// Saves every queued package and waits for the files to be written. Returns false if any save failed.
+	bool Flush();
+
+	// Drops queued packages without saving them. They stay dirty.
+	void Reset();
+
+	bool IsEmpty() const { return Packages.IsEmpty(); }
+	int32 GetNumSaved() const { return NumSaved; }
+	int32 GetNumFailed() const { return NumFailed; }
+
+protected:
+	bool SaveNext();
+	
+	TArray<TWeakObjectPtr<UPackage>> Packages;
+	int32 NumSaved = 0;
+	int32 NumFailed = 0;
+};
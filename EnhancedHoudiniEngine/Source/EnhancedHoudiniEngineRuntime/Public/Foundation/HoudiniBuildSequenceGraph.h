@@ -42,4 +42,14 @@ class ENHANCEDHOUDINIENGINERUNTIME_API UHoudiniBuildSequenceGraph : public UAuto
 
 public:
 	UHoudiniBuildSequenceGraph(const FObjectInitializer& Initializer);
+
+	virtual TArray<FAutomationGraphSupportedNodeInfo> GetSupportedNodeInfo() override;
+
+	// Adds a node type to every sequence graph, for node types that live in other modules (e.g. editor-only ones).
+	// Modules register their node types on startup and unregister them on shutdown.
+	static void RegisterNodeType(TSubclassOf<UAutomationGraphNode> NodeType, const FText& Category);
+	static void UnregisterNodeType(TSubclassOf<UAutomationGraphNode> NodeType);
+
+protected:
+	static TArray<FAutomationGraphSupportedNodeInfo>& GetRegisteredNodeInfo();
 };
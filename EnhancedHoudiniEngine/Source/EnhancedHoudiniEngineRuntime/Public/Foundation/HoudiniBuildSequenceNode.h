@@ -1,4 +1,4 @@
-// Copyright © Mason Stevenson
+﻿// Copyright © Mason Stevenson
 // All rights reserved.
 //
 // Redistribution and use in source and binary forms, with or without
@@ -38,8 +38,65 @@
 
 class UEdNode_HoudiniBuildSequenceNode;
 class UHoudiniAssetComponent;
+class UHoudiniBuildBatch;
 class UHoudiniBuildSequenceNode;
+class UHoudiniCookArbiter;
 class AHoudiniAssetActor;
+class FHoudiniBuildJournal;
+struct FHoudiniBuildJournalItem;
+enum class EEHEBuildState : uint8;
+
+// Ties a work item of a pipelined node to the work item of a parent node that it has to wait for.
+USTRUCT(BlueprintType)
+struct FHoudiniBuildPipelineLink
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TSoftObjectPtr<AHoudiniAssetActor> UpstreamActor;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TSoftObjectPtr<AHoudiniAssetActor> DownstreamActor;
+};
+
+// How a node retries work items whose build failed or ran out of time, e.g. because of a license hiccup, a locked file
+// or a cook that ran slightly over its timeout. A retry waits out its backoff and is then submitted again, while the
+// rest of the node keeps building. The node only fails once a work item has used up all of its attempts.
+USTRUCT(BlueprintType)
+struct FHoudiniBuildRetryPolicy
+{
+	GENERATED_BODY()
+
+public:
+	bool CanRetry(EEHEBuildState FailedState, int32 NumRetries) const;
+	double GetBackoffSec(int32 NumRetries) const;
+	double GetTimeoutScale(int32 NumRetries) const;
+	
+	// How many times a work item is built before the node gives up on it, including the first build. 1 never retries.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(ClampMin=1))
+	int32 MaxAttempts = 1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bRetryErrors = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bRetryExpired = true;
+
+	// How long the first retry waits. Every retry after that waits BackoffMultiplier times longer, up to MaxBackoffSec.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(ClampMin=0))
+	double BackoffSec = 5.0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(ClampMin=1))
+	double BackoffMultiplier = 2.0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(ClampMin=0))
+	double MaxBackoffSec = 60.0;
+
+	// The build timeouts of every retry are this many times longer than the ones of the attempt before it.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(ClampMin=1))
+	double TimeoutMultiplier = 1.0;
+};
 
 USTRUCT(BlueprintType)
 struct FHoudiniBuildSequenceInfo
@@ -59,6 +116,29 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	double BuildFailTimeoutSec = 60.0;
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FHoudiniBuildRetryPolicy RetryPolicy;
+
+	// Maximum number of work items this node will have building at the same time. Remaining work items wait in a
+	// queue and are submitted as earlier ones finish. Timeouts only start counting once a work item is submitted.
+	// Set to 0 to submit every work item at once.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(ClampMin=0))
+	int32 MaxInFlightWorkItems = 16;
+
+	// By default a node only starts once all of its parents have finished. A pipelined node starts as soon as its HDA
+	// parents have started, and each of its actors is built as soon as the upstream actors it is linked to are done.
+	// Actors without any links still wait for the parent nodes to finish.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bPipelined = false;
+
+	// Explicit upstream -> downstream actor links.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(EditCondition="bPipelined"))
+	TArray<FHoudiniBuildPipelineLink> PipelineLinks;
+
+	// Actors that share a tag starting with this prefix (e.g. "Pipeline.Tile_03") are linked.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(EditCondition="bPipelined"))
+	FString PipelineLinkTagPrefix = TEXT("Pipeline.");
+
 	// TODO(): Add back in if vanilla HE ever supports it.
 	// If true, an HDA cook state of "finished with errors" counts as a success for the purposes of this graph.
 	/// UPROPERTY(EditAnywhere, BlueprintReadWrite)
@@ -78,6 +158,10 @@ enum class EEHEBuildState: uint8
 	Error
 };
 
+class UHoudiniBuildWorkItem;
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnHoudiniBuildWorkItemStateChanged, UHoudiniBuildWorkItem* /* WorkItem */, EEHEBuildState /* NewState */);
+
 // Made this a class instead of a struct so we can bind this directly to Houdini delegates.
 UCLASS()
 class ENHANCEDHOUDINIENGINERUNTIME_API UHoudiniBuildWorkItem : public UObject
@@ -88,31 +172,202 @@ public:
 	virtual bool Initialize(UHoudiniBuildSequenceNode* NewOwner, AHoudiniAssetActor* AssetActor);
 	virtual bool Build();
 
+	// Completes this work item with the result of another work item that built the same actor.
+	virtual void FinishAsDuplicate(EEHEBuildState LeaderState);
+
+	// Completes this work item without building, because the actor hasn't changed since it was last built.
+	virtual void FinishUpToDate();
+
+	// Completes this work item by copying the outputs of an identical instance that was already built (see
+	// GetEquivalenceKey). Returns false without changing anything if the outputs can't be copied, in which case this
+	// work item has to be built normally.
+	virtual bool FinishFromRepresentative(UHoudiniBuildWorkItem* Representative);
+
+	// Completes this work item with the outputs its batch just copied in (see UHoudiniBuildBatch).
+	virtual void FinishFromBatch();
+
+	// Completes this work item without building, because an interrupted run already built it (see
+	// FHoudiniBuildJournal). Returns false if the actor's outputs no longer match what that run produced, e.g. because
+	// they were never saved, in which case this work item has to be built normally.
+	virtual bool FinishFromJournal(const FString& JournaledOutputHash);
+
+	// Cooks the actor on its own. Used by the leader of a batch when its result can't be taken from the batched cook.
+	bool BuildUnbatched();
+
+	// For cook sessions that build work items themselves instead of through Build(). Simulated builds don't touch the
+	// actor, so their results are never recorded in the build history.
+	void BeginExternalBuild(bool bInSimulated);
+	void CompleteExternalBuild(bool bSucceeded);
+	bool IsSimulated() const { return bSimulated; }
+
 	virtual void BeginDestroy() override;
+	virtual UWorld* GetWorld() const override;
+
+	// Called by the build manager when one of the timeouts scheduled for BuildSerial is reached.
+	virtual void OnDeadlineReached(int32 ForBuildSerial, bool bFailDeadline);
+
+	// Called by the build manager once the backoff of the retry scheduled after build BuildSerial is over.
+	virtual void OnRetryDeadlineReached(int32 ForBuildSerial);
 	
-	EEHEBuildState GetBuildState();
+	EEHEBuildState GetBuildState() const { return BuildState; }
+	int32 GetBuildSerial() const { return BuildSerial; }
+	double GetTimeStarted() const { return TimeStarted; }
+
+	// How long the last build took, from BuildStarted() until it finished. Zero if it didn't finish by building.
+	double GetBuildDuration() const { return BuildDurationSec; }
+
+	// True if the last build was satisfied by the cook cache instead of cooking.
+	bool WasRestoredFromCache() const { return bRestoredFromCache; }
+
+	// True if the last build copied the outputs of an identical instance instead of cooking.
+	bool WasCopiedFromRepresentative() const { return bCopiedFromRepresentative; }
+
+	// True if the last build was part of a batched cook.
+	bool WasCookedInBatch() const { return bCookedInBatch; }
+
+	// True if the work item was finished by an interrupted run, and taken from its journal.
+	bool WasRestoredFromJournal() const { return bRestoredFromJournal; }
+
+	// The batch this work item is cooked in, if any. The first work item of a batch builds it.
+	UHoudiniBuildBatch* GetBatch() const { return Batch; }
+	void SetBatch(UHoudiniBuildBatch* NewBatch) { Batch = NewBatch; }
+
+	TWeakObjectPtr<AHoudiniAssetActor> GetAssetActor() const { return ToBuild; }
+	UHoudiniBuildSequenceNode* GetOwner() const { return Owner; }
+
+	// True if Package holds the actor, one of its outputs or something cooked into its temporary cook folder.
+	bool OwnsPackage(const UPackage* Package) const;
+
+	// Work items with a higher priority are started first by the cook arbiter.
+	double GetPriority() const { return Priority; }
+	void SetPriority(double NewPriority) { Priority = NewPriority; }
+
+	// Estimated time from starting this work item until the end of the longest chain of nodes that depends on it.
+	// Among work items of the same priority, the ones with the longest remaining path are started first.
+	double GetCriticalPath() const { return CriticalPathSec; }
+	void SetCriticalPath(double NewCriticalPathSec) { CriticalPathSec = NewCriticalPathSec; }
+
+	// The actor fingerprint taken when the owning node started, and the one recorded after the last successful build.
+	const FString& GetFingerprint() const { return Fingerprint; }
+	void SetFingerprint(const FString& NewFingerprint) { Fingerprint = NewFingerprint; }
+	void SetLastBuiltFingerprint(const FString& NewFingerprint) { LastBuiltFingerprint = NewFingerprint; }
+	// Also checks that the outputs of the last build are still there, since deleting them doesn't change the fingerprint.
+	bool IsUpToDate() const;
+
+	// The version of the HDA definition as of this run, and the one the actor was last rebuilt with. See
+	// FHoudiniBuildDefinitionRecord.
+	int32 GetDefinitionVersion() const { return DefinitionVersion; }
+	void SetDefinitionVersion(int32 NewDefinitionVersion) { DefinitionVersion = NewDefinitionVersion; }
+	void SetLastBuiltDefinitionVersion(int32 NewDefinitionVersion) { LastBuiltDefinitionVersion = NewDefinitionVersion; }
+	bool IsDefinitionUnchanged() const { return DefinitionVersion != INDEX_NONE && DefinitionVersion == LastBuiltDefinitionVersion; }
 
-	TWeakObjectPtr<AHoudiniAssetActor> GetAssetActor() { return ToBuild; }
+	// Work items with the same equivalence key cook the same HDA with the same parameters and inputs, regardless of
+	// where their actor is, so one cook can stand in for all of them. Empty if the actor has world-dependent inputs.
+	const FString& GetEquivalenceKey() const { return EquivalenceKey; }
+	void SetEquivalenceKey(const FString& NewEquivalenceKey) { EquivalenceKey = NewEquivalenceKey; }
+
+	// Hash of the outputs produced by the last build, and of the outputs recorded after the previous successful build.
+	const FString& GetOutputHash() const { return OutputHash; }
+	void SetLastOutputHash(const FString& NewOutputHash) { LastOutputHash = NewOutputHash; }
+	bool HasUnchangedOutput() const { return !OutputHash.IsEmpty() && OutputHash == LastOutputHash; }
+
+	// This work item won't be submitted until Upstream has finished. If Upstream fails, so does this work item.
+	void AddDependency(UHoudiniBuildWorkItem* Upstream);
+	bool HasDependencies() const { return NumDependencies > 0; }
+	const TArray<TObjectPtr<UHoudiniBuildWorkItem>>& GetDependents() const { return Dependents; }
+
+	// Fails this work item if it hasn't started yet, or gives up on its pending retry, so nothing waits on it forever.
+	virtual void Abandon();
+
+	// Puts a building work item back into standby so it can be submitted again, e.g. after the cook session it was
+	// building in died. Whatever the interrupted build reports afterwards is ignored.
+	virtual void Interrupt();
+
+	// True while a failed or expired work item waits to be built again (see FHoudiniBuildRetryPolicy). Work items
+	// depending on it aren't failed until it runs out of attempts.
+	bool IsRetryPending() const { return bRetryPending; }
+	int32 GetNumRetries() const { return NumRetries; }
+	int32 GetNumAttempts() const { return NumRetries + 1; }
+	void ResetRetries() { NumRetries = 0; bRetryPending = false; }
+
+	// Puts a work item with a pending retry back into standby so it can be submitted again.
+	void PrepareRetry();
+	
+	// Work items that aren't linked to anything upstream have to wait for the parent nodes as a whole.
+	void SetWaitForParentNodes(bool bNewWaitForParentNodes) { bWaitForParentNodes = bNewWaitForParentNodes; }
+	bool WaitsForParentNodes() const { return bWaitForParentNodes; }
+	bool IsReadyToSubmit(bool bParentNodesFinished) const;
+	void SetArbiter(UHoudiniCookArbiter* NewArbiter) { Arbiter = NewArbiter; }
 	
 protected:
 	virtual void BuildStarted();
+
+	// Finishes a build whose outputs were copied onto the actor instead of cooked, starting it first if it hasn't
+	// been. bCopiedFlag records where the outputs came from. Returns false if the build can't be finished.
+	bool FinishWithCopiedOutputs(bool& bCopiedFlag);
+
 	virtual bool BuildInternal(UHoudiniAssetComponent* AssetComponent) { return false; }
 	virtual void OnHoudiniAssetPostProcess(UHoudiniAssetComponent* AssetComponent, bool Succeeded);
+	void OnHoudiniAssetPostProcessForBuild(UHoudiniAssetComponent* AssetComponent, bool Succeeded, int32 ForBuildSerial);
+	void UnbindPostProcess();
+
+	// All build state transitions go through here so the owning node can react immediately.
+	void SetBuildState(EEHEBuildState NewState);
+
+	void OnDependencyFinished();
+	void OnDependencyFailed();
+	void NotifyDependents(bool bSucceeded);
 	
 	UPROPERTY()
 	TObjectPtr<UHoudiniBuildSequenceNode> Owner = nullptr;
 	
 	UPROPERTY()
 	TWeakObjectPtr<AHoudiniAssetActor> ToBuild = nullptr;
+
+	UPROPERTY()
+	TWeakObjectPtr<UHoudiniCookArbiter> Arbiter = nullptr;
+
+	UPROPERTY()
+	TObjectPtr<UHoudiniBuildBatch> Batch = nullptr;
+
+	// Work items waiting on this one.
+	UPROPERTY()
+	TArray<TObjectPtr<UHoudiniBuildWorkItem>> Dependents;
+
+	int32 NumDependencies = 0;
+	int32 NumPendingDependencies = 0;
+	bool bWaitForParentNodes = false;
 	
+	double Priority = 0.0;
+	double CriticalPathSec = 0.0;
 	double TimeStarted = 0.0;
+	double BuildDurationSec = 0.0;
+	bool bRestoredFromCache = false;
+	bool bCopiedFromRepresentative = false;
+	bool bCookedInBatch = false;
+	bool bRestoredFromJournal = false;
+	bool bSimulated = false;
+	FString Fingerprint;
+	FString LastBuiltFingerprint;
+	FString OutputHash;
+	FString LastOutputHash;
+	FString EquivalenceKey;
+	int32 DefinitionVersion = INDEX_NONE;
+	int32 LastBuiltDefinitionVersion = INDEX_NONE;
 	EEHEBuildState BuildState = EEHEBuildState::Uninitialized;
 
+	// Incremented every time a build starts, so stale timeouts from an earlier build can be ignored.
+	int32 BuildSerial = 0;
+
+	int32 NumRetries = 0;
+	bool bRetryPending = false;
+
 	
 	FDelegateHandle PostOutputProcessingDelegateHande;
 };
 
-UCLASS()
+// HDA nodes skip unchanged actors individually and ignore bSkipWhenInputsUnchanged, see SupportsEarlyCutoff().
+UCLASS(HideCategories=("Early Cutoff"))
 class ENHANCEDHOUDINIENGINERUNTIME_API UHoudiniBuildSequenceNode : public UAutomationGraphNode
 {
 	GENERATED_BODY()
@@ -124,17 +379,106 @@ public:
 
 	//~UAutomationGraphNode interface.
 	virtual bool Activate() override;
+	virtual void Ready() override;
 	virtual void Reset() override;
-	virtual EAutomationGraphNodeState GetState() override;
+	virtual void SetState(EAutomationGraphNodeState NewState) override;
 	virtual FString GetMessageText() override;
 	//~End UAutomationGraphNode interface.
 	
 	TArray<TWeakObjectPtr<AHoudiniAssetActor>> GetHoudiniActors();
+	const TArray<TObjectPtr<UHoudiniBuildWorkItem>>& GetWorkItems() const { return WorkItems; }
+	int32 GetNumInFlight() const { return NumInFlight; }
+	int32 GetNumQueued() const { return WorkItems.Num() - NumFinished - NumInFlight; }
+
+	// Orders the submission queue so the work items with the longest critical path go first. Only valid before the
+	// node is activated.
+	void SortWorkItemsByCriticalPath();
+
+	// When true, work items whose actor hasn't changed since its last successful build finish without building.
+	virtual bool ShouldSkipUnchangedActors() const { return false; }
+
+	// When true, work items try to restore their outputs from the cook cache before building, and store the outputs
+	// of every successful build in it. See FHoudiniCookCache.
+	virtual bool ShouldUseCookCache() const { return false; }
+
+	// When true, work items with the same equivalence key are only cooked once. The others copy the outputs of that
+	// cook. See UHoudiniBuildWorkItem::GetEquivalenceKey.
+	virtual bool ShouldDeduplicateInstances() const { return false; }
+
+	// True for nodes whose work items reload the HDA definition. The build manager tracks which definition version
+	// each of their actors was last built with.
+	virtual bool ReloadsDefinitions() const { return false; }
+	int32 GetNumDeduplicated() const { return NumDeduplicated; }
+
+	// The wrapper HDA that actors of HoudiniAsset are cooked in batches with, or null to cook them one by one. See
+	// UHoudiniBuildBatch.
+	virtual UHoudiniAsset* GetBatchWrapperAsset(UHoudiniAsset* HoudiniAsset) const { return nullptr; }
+	virtual int32 GetMaxBatchSize() const { return 0; }
+
+	// Wrapper actors are spawned on demand and reused by later batches until this node stops.
+	AHoudiniAssetActor* AcquireBatchWrapperActor(UWorld* World, UHoudiniAsset* WrapperAsset, bool& bOutSpawned);
+	void ReleaseBatchWrapperActor(AHoudiniAssetActor* WrapperActor);
+
+	// Whether an HDA node runs depends on its own actors, not just its parents. Unchanged actors are skipped
+	// individually instead (see ShouldSkipUnchangedActors).
+	virtual bool SupportsEarlyCutoff() const override { return false; }
+	virtual bool HasUnchangedOutput() override;
+
+	// Pipelining. Links the work items of this node to the work items of its parents, see FHoudiniBuildSequenceInfo.
+	void LinkPipelinedWorkItems();
+	bool IsPipelined() const { return BuildInfo.bPipelined; }
+
+	// Called by the build manager once every parent node has finished.
+	void NotifyParentNodesFinished();
+	
+	// Called by work items once they are allowed to be submitted.
+	void OnWorkItemReady(UHoudiniBuildWorkItem* WorkItem);
+
+	// Set by the build manager while journaling. When resuming an interrupted run, work items the journal says were
+	// finished aren't built again, as long as their actor still has the same fingerprint and outputs.
+	void SetJournal(const FHoudiniBuildJournal* InJournal) { Journal = InJournal; }
+
+	// Called by work items whenever their build state changes.
+	virtual void OnWorkItemStateChanged(UHoudiniBuildWorkItem* WorkItem, EEHEBuildState NewState);
+
+	// Called by the build manager once a failed work item has waited out its backoff. Submits it again, or gives up on
+	// it if this node has stopped in the meantime.
+	void RetryWorkItem(UHoudiniBuildWorkItem* WorkItem);
+
+	// Work items that had to be retried during the last run, whether or not a retry succeeded.
+	const TArray<TObjectPtr<UHoudiniBuildWorkItem>>& GetRetriedWorkItems() const { return RetriedWorkItems; }
 	
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Build HDA")
 	FHoudiniBuildSequenceInfo BuildInfo;
+
+	// Forwards every work item state change. The build manager uses this to schedule work item timeouts.
+	FOnHoudiniBuildWorkItemStateChanged OnWorkItemStateChangedDelegate;
 	
 protected:
+	// Submits queued work items until the in-flight window is full. Returns false if a work item failed to start.
+	bool SubmitQueuedWorkItems();
+	// Journaled work items are only resumed if the actor still has the fingerprint it had when it was built.
+	bool ShouldFingerprintWorkItems() const { return ShouldSkipUnchangedActors() || ShouldUseCookCache() || ShouldDeduplicateInstances() || Journal != nullptr; }
+	void UpdateFingerprints(TConstArrayView<TObjectPtr<UHoudiniBuildWorkItem>> ToUpdate);
+
+	// The journal record of WorkItem, if the interrupted run being resumed finished it with the same fingerprint.
+	const FHoudiniBuildJournalItem* FindJournaledWorkItem(const UHoudiniBuildWorkItem* WorkItem) const;
+
+	// Returns true if WorkItem was completed by, or is now waiting on, an identical instance.
+	bool TryDeduplicate(UHoudiniBuildWorkItem* WorkItem);
+	void ReleaseWaitingOnRepresentative(UHoudiniBuildWorkItem* Representative);
+
+	// Puts queued work items of the same HDA into a batch led by WorkItem, if its HDA is cooked in batches. The leader is
+	// submitted like any other work item, and builds the whole batch when it starts.
+	void TryBatch(UHoudiniBuildWorkItem* WorkItem);
+
+	// Queues the work items of a finished batch that couldn't take their result from it, so they cook on their own.
+	void ReleaseBatch(UHoudiniBuildWorkItem* Leader);
+	void DestroyBatchWrapperActors();
+
+	// One line per retried work item: how many attempts it took, and how it ended up.
+	void LogRetriedWorkItems() const;
+	
 	UPROPERTY()
 	TSubclassOf<UHoudiniBuildWorkItem> WorkItemClass;
 	
@@ -143,4 +487,46 @@ protected:
 
 	UPROPERTY()
 	bool bFinishedWithError = false;
+
+	int32 NumFinished = 0;
+	int32 NumUpToDate = 0;
+	int32 NumResumed = 0;
+	int32 NumUnchangedOutputs = 0;
+	int32 NumRetries = 0;
+
+	UPROPERTY()
+	TArray<TObjectPtr<UHoudiniBuildWorkItem>> RetriedWorkItems;
+
+	// Work items that are ready to be submitted, in submission order. Everything before NextWorkItemIndex has been
+	// submitted. Without pipelining or dependencies this is just WorkItems.
+	UPROPERTY()
+	TArray<TObjectPtr<UHoudiniBuildWorkItem>> ReadyWorkItems;
+	
+	int32 NextWorkItemIndex = 0;
+	bool bParentNodesFinished = false;
+	int32 NumInFlight = 0;
+	bool bSubmittingWorkItems = false;
+
+	// The first work item of every equivalence key, and the work items waiting for it to finish. Waiting work items
+	// count as in flight, but don't take up room in the in-flight window.
+	UPROPERTY()
+	TMap<FString, TObjectPtr<UHoudiniBuildWorkItem>> Representatives;
+	TMap<FString, TArray<UHoudiniBuildWorkItem*>> WaitingOnRepresentative;
+	int32 NumWaitingOnRepresentative = 0;
+	int32 NumDeduplicated = 0;
+
+	// Work items waiting for the leader of their batch to build. Like work items waiting on a representative, they
+	// count as in flight but don't take up room in the in-flight window.
+	int32 NumWaitingOnBatch = 0;
+	int32 NumBatches = 0;
+	int32 NumCookedInBatch = 0;
+
+	const FHoudiniBuildJournal* Journal = nullptr;
+
+	// Work items that already failed to take their result from a batch, so they aren't batched again.
+	TSet<UHoudiniBuildWorkItem*> Unbatchable;
+
+	// Every wrapper actor spawned by this node, and the ones not currently cooking a batch.
+	TArray<TWeakObjectPtr<AHoudiniAssetActor>> BatchWrapperActors;
+	TArray<TWeakObjectPtr<AHoudiniAssetActor>> IdleBatchWrapperActors;
 };
\ No newline at end of file
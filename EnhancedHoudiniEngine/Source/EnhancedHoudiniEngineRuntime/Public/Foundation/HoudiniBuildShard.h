@@ -0,0 +1,84 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+class AActor;
+class AHoudiniAssetActor;
+struct FAutomationGraphPlan;
+
+// How actors are grouped before the groups are spread across shards.
+enum class EHoudiniBuildShardKey : uint8
+{
+	// Actors in the same world partition grid cell stay together.
+	Cell,
+	// Every actor is its own group.
+	ActorPath,
+};
+
+// Which nodes of a run a shard runs. The others are finished up to date right away.
+enum class EHoudiniBuildShardNodes : uint8
+{
+	All,
+	// Only the nodes that build HDA actors.
+	ActorNodes,
+	// Only the nodes that don't build HDA actors, and that come before every node that does (or aren't connected to
+	// one at all).
+	SharedNodesBefore,
+	// Only the nodes that don't build HDA actors, and that come after a node that does.
+	SharedNodesAfter,
+};
+
+// The part of a build that one editor process is responsible for, when a build is split across several processes.
+// Each shard builds the HDA actors assigned to it. Nodes that don't build HDA actors (landscape nodes, console
+// commands...) change things every shard shares, so the workers of a split build leave them to the coordinator, which
+// runs them before and after the workers.
+struct ENHANCEDHOUDINIENGINERUNTIME_API FHoudiniBuildShard
+{
+	int32 Index = INDEX_NONE;
+	int32 Count = 0;
+	TSet<FSoftObjectPath> Actors;
+	EHoudiniBuildShardNodes Nodes = EHoudiniBuildShardNodes::All;
+
+	bool IsValid() const { return Count > 1 && Index >= 0 && Index < Count; }
+	bool Contains(const AActor* Actor) const;
+
+	// For each node of the plan, whether this shard runs it.
+	void GetNodesToRun(const FAutomationGraphPlan& Plan, TArray<bool>& OutRunsNode) const;
+
+	// Nodes that don't build HDA actors, but come both after and before nodes that do. They can't run before or after
+	// all of the HDA nodes, so a build with any of them can't be split.
+	static TArray<int32> FindInterleavedSharedNodes(const FAutomationGraphPlan& Plan);
+
+	// Spreads the actors across Count shards, keeping the biggest groups apart. Actors that take one another as input
+	// always end up in the same shard, since a shard can't see what another process cooked.
+	static TMap<FSoftObjectPath, int32> Assign(TConstArrayView<AHoudiniAssetActor*> AssetActors, int32 Count, EHoudiniBuildShardKey Key, double CellSize);
+};
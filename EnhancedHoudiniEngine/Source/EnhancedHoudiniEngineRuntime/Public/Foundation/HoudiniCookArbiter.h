@@ -0,0 +1,257 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Containers/Ticker.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+
+#include "HoudiniCookArbiter.generated.h"
+
+class AHoudiniAssetActor;
+class IHoudiniCookSession;
+class UPackage;
+class UHoudiniBuildWorkItem;
+enum class EEHEBuildState : uint8;
+
+USTRUCT(BlueprintType)
+struct FHoudiniCookArbiterProgress
+{
+	GENERATED_BODY()
+
+public:
+	FString ToString() const;
+	
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumQueued = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumBuilding = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumFinished = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumFailed = 0;
+
+	// Submissions that were satisfied by another submission of the same actor instead of cooking again.
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumDeduplicated = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumSessions = 0;
+
+	// Sessions that aren't sitting out a cooldown after failing too many cooks in a row.
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumHealthySessions = 0;
+
+	// Sessions restarted after they stopped answering the heartbeat, and the work items that were submitted again
+	// because of it.
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumSessionRestarts = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumResubmitted = 0;
+
+	// Cook time thrown away by resubmitting work items, from when each one started cooking until its session was
+	// restarted.
+	UPROPERTY(BlueprintReadOnly)
+	double LostSec = 0.0;
+
+	// Failed or expired cooks that will be retried (see FHoudiniBuildRetryPolicy), and leaders currently waiting out
+	// their backoff.
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumRetried = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumAwaitingRetry = 0;
+};
+
+// A cook session in the arbiter's pool, and what the arbiter knows about how it's doing.
+struct FHoudiniCookSessionState
+{
+	TSharedPtr<IHoudiniCookSession> Session;
+	int32 NumBuilding = 0;
+	int32 NumFinished = 0;
+	int32 NumFailed = 0;
+	int32 ConsecutiveFailures = 0;
+	double UnhealthyUntil = 0.0;
+	int32 MissedHeartbeats = 0;
+	int32 NumRestarts = 0;
+
+	bool IsHealthy(double TimeNow) const { return TimeNow >= UnhealthyUntil; }
+	bool HasCapacity() const;
+};
+
+// An actor that already finished building during the current batch, and what built it.
+struct FHoudiniCookArbiterFinished
+{
+	TWeakObjectPtr<UClass> WorkItemClass;
+	FString Fingerprint;
+};
+
+struct FHoudiniCookArbiterEntry
+{
+	TWeakObjectPtr<UHoudiniBuildWorkItem> WorkItem;
+	double Priority = 0.0;
+	double CriticalPathSec = 0.0;
+	uint64 Sequence = 0;
+
+	// TArray heaps are min-heaps, so "less than" means "runs first": higher priority first, then the longest remaining
+	// critical path, then first come first served.
+	bool operator<(const FHoudiniCookArbiterEntry& Other) const
+	{
+		if (Priority != Other.Priority)
+		{
+			return Priority > Other.Priority;
+		}
+		if (CriticalPathSec != Other.CriticalPathSec)
+		{
+			return CriticalPathSec > Other.CriticalPathSec;
+		}
+		return Sequence < Other.Sequence;
+	}
+};
+
+// Owns the one cook queue for a world. Every build manager in the world submits its work items here, so they share
+// the pool of cook sessions through one concurrency limit, and an actor picked up by several managers is only built
+// once. Independent work items go to the least busy session. Work items that share inputs (including other HDA actors)
+// stay on the same session, so each input only needs to be sent to one of them. The pool is configured through the
+// houdini.CookSessions.* console variables.
+//
+// With the HoudiniEngine backend the pool always has exactly one session, since the Houdini Engine plugin can't drive
+// more. Real cooks therefore get no extra parallelism from the pool, only the shared queue, dedupe, health tracking and
+// recovery. Multiple sessions are only simulated, by the stand-in backend.
+UCLASS()
+class ENHANCEDHOUDINIENGINERUNTIME_API UHoudiniCookArbiter : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UHoudiniCookArbiter* Get(const UObject* WorldContextObject);
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	
+	// Queues a work item and starts it right away if there is capacity. Returns false if the work item failed to start
+	// and won't be retried.
+	bool Submit(UHoudiniBuildWorkItem* WorkItem);
+
+	// Called by work items that were submitted to this arbiter whenever their build state changes.
+	void OnWorkItemStateChanged(UHoudiniBuildWorkItem* WorkItem, EEHEBuildState NewState);
+
+	// Called by a failed work item that was waiting to be retried, once it's clear the retry won't happen.
+	void OnRetryAbandoned(UHoudiniBuildWorkItem* WorkItem);
+
+	// Takes back a submission whose run was cancelled. A work item that is building gives up its cook slot and is put
+	// back into standby, so whatever its cook reports afterwards is ignored. Its actor goes to the next submission
+	// waiting on it.
+	void Withdraw(UHoudiniBuildWorkItem* WorkItem);
+
+	// The building work item whose actor or outputs are in Package, if any.
+	UHoudiniBuildWorkItem* FindBuildingWorkItem(const UPackage* Package) const;
+
+	FHoudiniCookArbiterProgress GetProgress() const;
+	
+	// One line per cook session: queue depth, results and health.
+	FString GetSessionStatusString() const;
+	bool IsIdle() const { return Queue.IsEmpty() && BlockedByActor.IsEmpty() && Building.IsEmpty() && AwaitingRetry.IsEmpty(); }
+
+	// Simulates the death of a cook session, see IHoudiniCookSession::Kill.
+	bool KillSession(int32 SessionIndex);
+
+protected:
+	void Enqueue(const FHoudiniCookArbiterEntry& Entry);
+	void Dispatch();
+	void CompleteLeader(UHoudiniBuildWorkItem* Leader, EEHEBuildState FinalState);
+	void ReleaseActor(const TWeakObjectPtr<AHoudiniAssetActor>& AssetActor, UHoudiniBuildWorkItem* Leader);
+	bool IsStillWanted(UHoudiniBuildWorkItem* WorkItem) const;
+
+	// Two submissions of an actor only share a build if they do the same thing to it, and the actor had the same
+	// fingerprint when each of them was queued. Without fingerprints there is no telling whether its inputs changed in
+	// between, so it's built again.
+	static bool IsSameBuild(UClass* WorkItemClass, const FString& Fingerprint, const UHoudiniBuildWorkItem* WorkItem);
+	void FinishBatchIfIdle();
+
+	// Gives up on leaders whose retry can't happen anymore, e.g. because the run that submitted them was cancelled.
+	void PruneAwaitingRetry();
+
+	// Session pool.
+	void UpdateSessionPool();
+	void GetAffinityKeys(UHoudiniBuildWorkItem* WorkItem, TArray<FObjectKey>& OutAffinityKeys) const;
+	int32 ChooseSession(TConstArrayView<FObjectKey> AffinityKeys, double TimeNow) const;
+	void OnSessionCookCompleted(int32 SessionIndex, bool bSucceeded);
+
+	// Session recovery. Every houdini.CookSessions.HeartbeatSec, sessions with work items cooking are asked whether
+	// they are still alive. One that misses too many heartbeats in a row is restarted, and the work items that were
+	// cooking in it are submitted again.
+	bool TickHeartbeat(float DeltaTime);
+	void RecoverSession(int32 SessionIndex);
+
+	// Leaders waiting for a free cook slot.
+	TArray<FHoudiniCookArbiterEntry> Queue;
+
+	// Entries waiting for an actor that is currently owned by a different kind of work item (e.g. a cook waiting on a
+	// rebuild of the same actor).
+	TMap<TWeakObjectPtr<AHoudiniAssetActor>, TArray<FHoudiniCookArbiterEntry>> BlockedByActor;
+
+	// The work item responsible for building each actor, whether it is still queued or already building.
+	TMap<TWeakObjectPtr<AHoudiniAssetActor>, TWeakObjectPtr<UHoudiniBuildWorkItem>> LeaderByActor;
+
+	// Duplicate submissions that will receive their leader's result instead of building.
+	TMap<TWeakObjectPtr<UHoudiniBuildWorkItem>, TArray<TWeakObjectPtr<UHoudiniBuildWorkItem>>> FollowersByLeader;
+
+	// Actors that already finished building during the current batch.
+	TMap<TWeakObjectPtr<AHoudiniAssetActor>, FHoudiniCookArbiterFinished> FinishedByActor;
+	
+	TSet<TWeakObjectPtr<UHoudiniBuildWorkItem>> Building;
+
+	// Leaders that failed and will be submitted again once their backoff is over. They keep their actor (and their
+	// followers) in the meantime, so the actor isn't built by anyone else first.
+	TSet<TWeakObjectPtr<UHoudiniBuildWorkItem>> AwaitingRetry;
+
+	TArray<FHoudiniCookSessionState> Sessions;
+	FString SessionBackend;
+	TMap<TWeakObjectPtr<UHoudiniBuildWorkItem>, int32> SessionByWorkItem;
+
+	// The session that cooked the last work item to use each input (or actor), for the current batch.
+	TMap<FObjectKey, int32> SessionByAffinityKey;
+	
+	FHoudiniCookArbiterProgress BatchProgress;
+	double BatchStartTime = 0.0;
+	bool bBatchActive = false;
+	
+	uint64 NextSequence = 0;
+	bool bDispatching = false;
+
+	FTSTicker::FDelegateHandle HeartbeatTickerHandle;
+	double LastHeartbeatTime = 0.0;
+};
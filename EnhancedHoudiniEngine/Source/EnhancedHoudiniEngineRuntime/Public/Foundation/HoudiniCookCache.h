@@ -0,0 +1,92 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+class UHoudiniAssetComponent;
+class UStaticMesh;
+
+// A content-addressed store of cook results, keyed by actor fingerprint (see FHoudiniBuildFingerprint). Entries hold the
+// data HE wrote into the outputs: static mesh descriptions, materials and simple collision, instancer transforms and the
+// landscape height and paint layer data in the region the HDA wrote to. A cache hit restores that data into the actor's
+// existing outputs instead of cooking, so it only applies when the outputs already have the same structure as the cached
+// cook (same output objects, LOD counts, landscape regions).
+//
+// Entries live in a local directory, and optionally in a shared directory (e.g. a network share) that every machine
+// building the same project reads from and writes to. Both directories are trimmed to a size limit by evicting the
+// least recently used entries. Everything is configured through the houdini.CookCache.* console variables.
+class ENHANCEDHOUDINIENGINERUNTIME_API FHoudiniCookCache
+{
+public:
+	static FHoudiniCookCache& Get();
+
+	bool IsEnabled() const;
+
+	// Restores the outputs of AssetComponent from the entry for Fingerprint. Returns false (and leaves the outputs
+	// untouched) if there is no entry or it doesn't fit the current outputs.
+	bool Restore(const FString& Fingerprint, UHoudiniAssetComponent* AssetComponent);
+
+	// Stores the current outputs of AssetComponent under Fingerprint. Does nothing if some of the outputs can't be
+	// cached.
+	bool Store(const FString& Fingerprint, UHoudiniAssetComponent* AssetComponent);
+
+	// Copies the outputs of From into the outputs of To, with the same rules as Restore(). Doesn't touch the disk and
+	// works whether or not the cache is enabled. Landscape data is only copied between actors that write to the same
+	// landscape region.
+	static bool CopyOutputs(UHoudiniAssetComponent* From, UHoudiniAssetComponent* To);
+
+	// Copies the mesh descriptions, materials and simple collision of From into the static mesh output of To. To has to
+	// have exactly one static mesh with the same number of LODs, and no other outputs that hold cooked data (instancers,
+	// landscapes).
+	static bool CopyStaticMesh(UStaticMesh* From, UHoudiniAssetComponent* To);
+
+	// Evicts least recently used entries until both directories are below their size limits.
+	void Trim();
+
+	FString GetStatusString() const;
+
+protected:
+	FString GetLocalDirectory() const;
+	FString GetSharedDirectory() const;
+	bool ReadEntry(const FString& Fingerprint, TArray<uint8>& OutBytes);
+	bool WriteEntry(const FString& Directory, int64 MaxBytes, const FString& Fingerprint, const TArray<uint8>& Bytes);
+	void TrimDirectory(const FString& Directory, int64 MaxBytes);
+	void TrimIfNeeded(const FString& Directory, int64 MaxBytes, int64 BytesWritten);
+	
+	// Bytes written to each directory since it was last trimmed. Directories are trimmed once the writes add up to a
+	// fraction of their limit, rather than scanning them after every write.
+	TMap<FString, int64> BytesWrittenSinceTrim;
+
+	int32 NumHits = 0;
+	int32 NumMisses = 0;
+	int32 NumStores = 0;
+	int32 NumUncacheable = 0;
+};
@@ -0,0 +1,118 @@
+﻿// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "Containers/Ticker.h"
+
+class UHoudiniBuildWorkItem;
+
+// Somewhere work items can be cooked. The cook arbiter keeps a pool of these and spreads work items across them.
+class ENHANCEDHOUDINIENGINERUNTIME_API IHoudiniCookSession
+{
+public:
+	virtual ~IHoudiniCookSession() = default;
+
+	virtual FString GetName() const = 0;
+
+	// Maximum number of work items cooking in this session at the same time. 0 means no limit.
+	virtual int32 GetCapacity() const = 0;
+
+	// Starts cooking a work item. Work items report back through their build state, and a work item that fails to
+	// start ends up in the error state, just like UHoudiniBuildWorkItem::Build().
+	virtual void Start(UHoudiniBuildWorkItem* WorkItem) = 0;
+
+	// Heartbeat. A session that stops answering while work items are cooking in it has died or hung, as opposed to one
+	// that is just taking a while to cook them. Called on the game thread, so it must not wait on the session.
+	virtual bool IsAlive() const { return true; }
+
+	// Brings back a session that stopped answering. Interrupted are the work items that were cooking in it, which the
+	// cook arbiter submits again afterwards.
+	virtual bool Restart(TConstArrayView<UHoudiniBuildWorkItem*> Interrupted) { return false; }
+
+	// Makes the session stop answering, for testing recovery. Only stand-in sessions can be killed.
+	virtual bool Kill() { return false; }
+};
+
+// Cooks through the session managed by the Houdini Engine plugin. The plugin only drives one session at a time, so
+// a pool never has more than one of these, and HDAs cook no more in parallel than they would without the pool.
+//
+// The Houdini Engine module is editor-only, so this class can't talk to the session itself: it always reports alive
+// and can't restart. The editor module installs a factory that creates a subclass with the heartbeat and restart (see
+// FHoudiniEngineEditorCookSession).
+class ENHANCEDHOUDINIENGINERUNTIME_API FHoudiniEngineCookSession : public IHoudiniCookSession
+{
+public:
+	// Creates a session through the installed factory, or a plain FHoudiniEngineCookSession if there is none.
+	static TSharedRef<IHoudiniCookSession> Create();
+	static void SetFactory(TFunction<TSharedRef<FHoudiniEngineCookSession>()> InFactory);
+
+	virtual FString GetName() const override { return TEXT("HoudiniEngine"); }
+	virtual int32 GetCapacity() const override { return 0; }
+	virtual void Start(UHoudiniBuildWorkItem* WorkItem) override;
+
+protected:
+	static TFunction<TSharedRef<FHoudiniEngineCookSession>()>& GetFactory();
+};
+
+// Pretends to cook: holds on to each work item for a while (houdini.CookSessions.StandInCookSec) and then finishes
+// it, or fails it at the configured rate, without touching the actor. Lets the pool's scheduling, affinity and health
+// tracking be exercised without Houdini or a license. A killed stand-in session stops finishing work items and stops
+// answering the heartbeat until it is restarted (houdini.CookSessions.Kill). Since nothing is actually built, the
+// arbiter only uses stand-in sessions in development builds, and never in commandlets.
+class ENHANCEDHOUDINIENGINERUNTIME_API FHoudiniStandInCookSession : public IHoudiniCookSession
+{
+public:
+	explicit FHoudiniStandInCookSession(int32 InSessionIndex);
+	virtual ~FHoudiniStandInCookSession() override;
+
+	virtual FString GetName() const override { return FString::Printf(TEXT("StandIn_%d"), SessionIndex); }
+	virtual int32 GetCapacity() const override;
+	virtual void Start(UHoudiniBuildWorkItem* WorkItem) override;
+	virtual bool IsAlive() const override { return !bKilled; }
+	virtual bool Restart(TConstArrayView<UHoudiniBuildWorkItem*> Interrupted) override;
+	virtual bool Kill() override;
+
+protected:
+	bool Tick(float DeltaTime);
+
+	struct FStandInCook
+	{
+		TWeakObjectPtr<UHoudiniBuildWorkItem> WorkItem;
+		int32 BuildSerial = 0;
+		double FinishTime = 0.0;
+	};
+	
+	TArray<FStandInCook> Cooking;
+	int32 SessionIndex = 0;
+	bool bKilled = false;
+	FTSTicker::FDelegateHandle TickerHandle;
+};